@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "bench.h"
+#include <golle/numbers.h>
+#include <golle/pool.h>
+#include <golle/random.h>
+#include <openssl/bn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+enum {
+  DEFAULT_BITS = 1024,
+  DEFAULT_PEERS = 3,
+  DEFAULT_ITEMS = 52,
+  DEFAULT_ITERATIONS = 100,
+  MAX_LINE = 4096
+};
+
+static const char *USAGE =
+  "[-b n|--bits=n] [-p n|--peers=n] [-n n|--items=n]"
+  " [-i n|--iterations=n] [-t n|--threads=n] [--split=n]"
+  " [-k file|--key=file]"
+  " [-s seed|--seed=seed] [--kernel=auto|ifma|scalar|none]"
+  " [--latency-us=n] [--jitter-us=n] [--mbps=n]";
+
+static void print_usage (const char *prog, int code) {
+  fprintf (stderr, "Usage: %s %s\n", prog, USAGE);
+  exit (code);
+}
+
+/* Read a positive integer option, or exit. */
+static size_t read_size (const char *prog, const char *arg) {
+  char *end;
+  unsigned long v = strtoul (arg, &end, 10);
+  if (*arg == 0 || *end != 0 || v == 0 || v > INT_MAX) {
+    fprintf (stderr, "Invalid argument %s\n", arg);
+    print_usage (prog, 1);
+  }
+  return v;
+}
+
+/* Read a non-negative real option, or exit. */
+static double read_real (const char *prog, const char *arg) {
+  char *end;
+  double v = strtod (arg, &end);
+  if (*arg == 0 || *end != 0 || v < 0) {
+    fprintf (stderr, "Invalid argument %s\n", arg);
+    print_usage (prog, 1);
+  }
+  return v;
+}
+
+/* Match -x value or --long=value. Returns the value, or NULL. */
+static const char *match (int argc, char *argv[], int *i,
+			  const char *s, const char *l)
+{
+  size_t len = strlen (l);
+  if (s && strcmp (argv[*i], s) == 0) {
+    if (*i + 1 == argc) {
+      print_usage (argv[0], 1);
+    }
+    return argv[++*i];
+  }
+  if (strncmp (argv[*i], l, len) == 0 && argv[*i][len] == '=') {
+    return argv[*i] + len + 1;
+  }
+  return NULL;
+}
+
+void bench_parse_args (int argc, char *argv[], bench_args_t *args) {
+  const char *v;
+  args->bits = DEFAULT_BITS;
+  args->peers = DEFAULT_PEERS;
+  args->items = DEFAULT_ITEMS;
+  args->iterations = DEFAULT_ITERATIONS;
+  args->threads = 1;
+  args->split = 1;
+  args->keyfile = NULL;
+  args->seed = NULL;
+  args->kernel = NULL;
+  args->netsim = 0;
+  args->latency_us = 0;
+  args->jitter_us = 0;
+  args->mbps = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if ((v = match (argc, argv, &i, "-b", "--bits"))) {
+      args->bits = (int)read_size (argv[0], v);
+    }
+    else if ((v = match (argc, argv, &i, "-p", "--peers"))) {
+      args->peers = read_size (argv[0], v);
+    }
+    else if ((v = match (argc, argv, &i, "-n", "--items"))) {
+      args->items = read_size (argv[0], v);
+    }
+    else if ((v = match (argc, argv, &i, "-i", "--iterations"))) {
+      args->iterations = read_size (argv[0], v);
+    }
+    else if ((v = match (argc, argv, &i, "-t", "--threads"))) {
+      args->threads = read_size (argv[0], v);
+    }
+    else if ((v = match (argc, argv, &i, NULL, "--split"))) {
+      args->split = read_size (argv[0], v);
+    }
+    else if ((v = match (argc, argv, &i, "-k", "--key"))) {
+      args->keyfile = v;
+    }
+    else if ((v = match (argc, argv, &i, "-s", "--seed"))) {
+      args->seed = v;
+    }
+    else if ((v = match (argc, argv, &i, NULL, "--kernel"))) {
+      args->kernel = v;
+    }
+    else if ((v = match (argc, argv, &i, NULL, "--latency-us"))) {
+      args->latency_us = read_real (argv[0], v);
+      args->netsim = 1;
+    }
+    else if ((v = match (argc, argv, &i, NULL, "--jitter-us"))) {
+      args->jitter_us = read_real (argv[0], v);
+      args->netsim = 1;
+    }
+    else if ((v = match (argc, argv, &i, NULL, "--mbps"))) {
+      args->mbps = read_real (argv[0], v);
+      args->netsim = 1;
+    }
+    else {
+      fprintf (stderr, "Unrecognised option %s\n", argv[i]);
+      print_usage (argv[0], 2);
+    }
+  }
+
+  /* Make every random choice repeatable, from the key onwards. */
+  if (args->seed) {
+    golle_error err = golle_random_seed_deterministic (args->seed,
+						       strlen (args->seed));
+    if (err == GOLLE_EINVALID) {
+      fprintf (stderr, "Error: --seed needs libgolle configured with "
+	       "--enable-test-random\n");
+      exit (2);
+    }
+    bench_check (err, "golle_random_seed_deterministic");
+  }
+
+  if (args->kernel) {
+    bench_check (golle_num_set_kernel (args->kernel), "golle_num_set_kernel");
+  }
+
+  /* Batches and set-up run on the default pool. It lives as long as
+   * the program. */
+  if (args->threads > 1) {
+    golle_pool_t *pool;
+    bench_check (golle_pool_new (&pool, args->threads), "golle_pool_new");
+    golle_pool_set_default (pool);
+  }
+  golle_num_set_split (args->split);
+}
+
+void bench_check (golle_error err, const char *what) {
+  if (err != GOLLE_OK) {
+    fprintf (stderr, "Error: %s failed with error %d\n", what, (int)err);
+    exit (3);
+  }
+}
+
+/* Read one hexadecimal line of an lgkg key file. */
+static golle_num_t read_hex (FILE *fp, const char *path) {
+  char line[MAX_LINE];
+  BIGNUM *n = NULL;
+  if (!fgets (line, sizeof (line), fp)) {
+    fprintf (stderr, "Error: unexpected EOF in %s\n", path);
+    exit (3);
+  }
+  line[strcspn (line, "\r\n")] = 0;
+  if (!BN_hex2bn (&n, line)) {
+    fprintf (stderr, "Error: bad number in %s\n", path);
+    exit (3);
+  }
+  return n;
+}
+
+void bench_key (bench_args_t *args, golle_key_t *key) {
+  if (args->keyfile) {
+    FILE *fp = fopen (args->keyfile, "r");
+    if (!fp) {
+      fprintf (stderr, "Error: failed to open %s\n", args->keyfile);
+      exit (3);
+    }
+    golle_num_t p = read_hex (fp, args->keyfile);
+    golle_num_t g = read_hex (fp, args->keyfile);
+    fclose (fp);
+    bench_check (golle_key_set_public (key, p, g), "golle_key_set_public");
+    args->bits = BN_num_bits (p);
+    golle_num_delete (p);
+    golle_num_delete (g);
+  }
+  else {
+    fprintf (stderr, "Generating %d-bit key, please wait...\n", args->bits);
+    bench_check (golle_key_gen_public (key, args->bits, INT_MAX),
+		 "golle_key_gen_public");
+  }
+  bench_check (golle_key_gen_private (key), "golle_key_gen_private");
+}
+
+double bench_now (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void bench_begin (bench_t *b, const bench_args_t *args, const char *name) {
+  b->args = args;
+  b->name = name;
+  b->extra = NULL;
+  b->count = 0;
+  b->samples = malloc (sizeof (double) * args->iterations);
+  if (!b->samples) {
+    bench_check (GOLLE_EMEM, name);
+  }
+}
+
+void bench_start (bench_t *b) {
+  b->start = bench_now ();
+}
+
+void bench_stop (bench_t *b) {
+  double t = bench_now () - b->start;
+  if (b->count < b->args->iterations) {
+    b->samples[b->count++] = t;
+  }
+}
+
+static int compare_doubles (const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* The sample at the given percentile of a sorted set. */
+static double percentile (const double *sorted, size_t n, double pc) {
+  size_t i = (size_t)(pc / 100.0 * (n - 1) + 0.5);
+  return sorted[i < n ? i : n - 1];
+}
+
+void bench_end (bench_t *b) {
+  const bench_args_t *a = b->args;
+  double total = 0;
+  size_t n = b->count;
+
+  if (n) {
+    qsort (b->samples, n, sizeof (double), compare_doubles);
+    for (size_t i = 0; i < n; i++) {
+      total += b->samples[i];
+    }
+    printf ("{\"bench\":\"%s\",\"backend\":\"%s\",\"kernel\":\"%s\","
+	    "\"bits\":%d,\"peers\":%zu,\"items\":%zu,\"threads\":%zu,"
+	    "\"split\":%zu,\"iterations\":%zu,"
+	    "\"mean_us\":%.3f,\"min_us\":%.3f,\"p50_us\":%.3f,"
+	    "\"p99_us\":%.3f,\"max_us\":%.3f,\"ops_per_sec\":%.3f%s%s}\n",
+	    b->name, golle_num_backend (), golle_num_kernel (a->bits),
+	    a->bits, a->peers, a->items, a->threads, a->split, n,
+	    total / n * 1e6,
+	    b->samples[0] * 1e6,
+	    percentile (b->samples, n, 50) * 1e6,
+	    percentile (b->samples, n, 99) * 1e6,
+	    b->samples[n - 1] * 1e6,
+	    total > 0 ? n / total : 0.0,
+	    b->extra ? "," : "",
+	    b->extra ? b->extra : "");
+    fflush (stdout);
+  }
+  free (b->samples);
+  b->samples = NULL;
+}
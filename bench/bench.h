@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_BENCH_H
+#define GOLLE_BENCH_H
+
+/*
+ * Shared harness for the benchmark programs. Each program times one or
+ * more operations and prints one JSON object per line to standard output,
+ * so that runs can be collected and compared by a script:
+ *
+ *   {"bench":"eg_encrypt","backend":"openssl","kernel":"scalar",
+ *    "bits":1024,"peers":3,"items":52,"threads":1,"split":1,
+ *    "iterations":100,
+ *    "mean_us":...,"min_us":...,"p50_us":...,"p99_us":...,"max_us":...,
+ *    "ops_per_sec":...}
+ *
+ * Progress and errors go to standard error.
+ */
+
+#include <golle/distribute.h>
+#include <stddef.h>
+
+/* Run-time parameters, common to all benchmarks. */
+typedef struct bench_args_t {
+  int bits; /* Size of p, in bits. */
+  size_t peers; /* Number of peers taking part in a draw. */
+  size_t items; /* Number of items to draw from. */
+  size_t iterations; /* Number of timed iterations. */
+  size_t threads; /* Workers in the default pool, or 1 for none. */
+  size_t split; /* Ways to split single operations, or 1 for none. */
+  const char *keyfile; /* A key from lgkg, instead of generating one. */
+  const char *seed; /* Seed for deterministic randomness, or NULL. */
+  const char *kernel; /* Montgomery kernels to use, or NULL for auto. */
+  int netsim; /* Non-zero if any link parameter was given. */
+  double latency_us; /* Simulated one-way latency. */
+  double jitter_us; /* Simulated jitter. */
+  double mbps; /* Simulated bandwidth, or 0 for unlimited. */
+} bench_args_t;
+
+/* Collects the duration of each iteration. */
+typedef struct bench_t {
+  const bench_args_t *args;
+  const char *name;
+  const char *extra; /* More JSON members for the output, or NULL. */
+  double *samples;
+  size_t count;
+  double start;
+} bench_t;
+
+/* Parse the command line, or print usage and exit. */
+void bench_parse_args (int argc, char *argv[], bench_args_t *args);
+
+/* Set up an ElGamal key with a private part, either generated or read
+ * from args->keyfile. Exits on error. */
+void bench_key (bench_args_t *args, golle_key_t *key);
+
+/* Exit with a message if err is not GOLLE_OK. */
+void bench_check (golle_error err, const char *what);
+
+/* Monotonic time, in seconds. */
+double bench_now (void);
+
+/* Start a named benchmark. */
+void bench_begin (bench_t *b, const bench_args_t *args, const char *name);
+
+/* Time one iteration. Everything between start and stop is measured. */
+void bench_start (bench_t *b);
+void bench_stop (bench_t *b);
+
+/* Print the results as a JSON line and free the samples. */
+void bench_end (bench_t *b);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include "bench.h"
+#include <golle/commit.h>
+#include <golle/merkle.h>
+#include <golle/random.h>
+#include <stdlib.h>
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  bench_t b;
+
+  bench_parse_args (argc, argv, &args);
+
+  /* Commit to something the size of a ciphertext, (a, b). */
+  golle_bin_t secret;
+  bench_check (golle_bin_init (&secret, 2 * ((args.bits + 7) / 8)),
+	       "golle_bin_init");
+  bench_check (golle_random_generate (&secret), "golle_random_generate");
+
+  golle_commit_t **commits = calloc (args.iterations, sizeof (*commits));
+  if (!commits) {
+    bench_check (GOLLE_EMEM, "calloc");
+  }
+
+  bench_begin (&b, &args, "commit_new");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    commits[i] = golle_commit_new (&secret);
+    bench_stop (&b);
+    if (!commits[i]) {
+      bench_check (GOLLE_EMEM, "golle_commit_new");
+    }
+  }
+  bench_end (&b);
+
+  bench_begin (&b, &args, "commit_verify");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    golle_error err = golle_commit_verify (commits[i]);
+    bench_stop (&b);
+    bench_check (err == GOLLE_COMMIT_PASSED ? GOLLE_OK : err,
+		 "golle_commit_verify");
+  }
+  bench_end (&b);
+
+  for (size_t i = 0; i < args.iterations; i++) {
+    golle_commit_delete (commits[i]);
+  }
+
+  /* One commitment per peer at a time, as in a draw. */
+  const golle_bin_t **secrets = calloc (args.peers, sizeof (*secrets));
+  golle_commit_t **batch = calloc (args.peers, sizeof (*batch));
+  if (!secrets || !batch) {
+    bench_check (GOLLE_EMEM, "calloc");
+  }
+  for (size_t i = 0; i < args.peers; i++) {
+    secrets[i] = &secret;
+  }
+
+  bench_begin (&b, &args, "commit_new_many");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    golle_error err = golle_commit_new_many (batch, secrets, args.peers);
+    bench_stop (&b);
+    bench_check (err, "golle_commit_new_many");
+    for (size_t j = 0; j < args.peers; j++) {
+      golle_commit_delete (batch[j]);
+    }
+  }
+  bench_end (&b);
+
+  bench_check (golle_commit_new_many (batch, secrets, args.peers),
+	       "golle_commit_new_many");
+  bench_begin (&b, &args, "commit_verify_many");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    golle_error err =
+      golle_commit_verify_many ((const golle_commit_t *const *)batch,
+				args.peers, NULL);
+    bench_stop (&b);
+    bench_check (err == GOLLE_COMMIT_PASSED ? GOLLE_OK : err,
+		 "golle_commit_verify_many");
+  }
+  bench_end (&b);
+
+  for (size_t i = 0; i < args.peers; i++) {
+    golle_commit_delete (batch[i]);
+  }
+  free (batch);
+  free (secrets);
+
+  /* One vector commitment to --items secrets, opened one at a time. */
+  secrets = calloc (args.items, sizeof (*secrets));
+  if (!secrets) {
+    bench_check (GOLLE_EMEM, "calloc");
+  }
+  for (size_t i = 0; i < args.items; i++) {
+    secrets[i] = &secret;
+  }
+  golle_merkle_t *tree = NULL;
+  bench_begin (&b, &args, "merkle_new");
+  for (size_t i = 0; i < args.iterations; i++) {
+    golle_merkle_delete (tree);
+    bench_start (&b);
+    golle_error err = golle_merkle_new (&tree, secrets, args.items);
+    bench_stop (&b);
+    bench_check (err, "golle_merkle_new");
+  }
+  bench_end (&b);
+
+  golle_merkle_proof_t proof;
+  bench_check (golle_merkle_open (tree, args.items / 2, &proof),
+	       "golle_merkle_open");
+  bench_begin (&b, &args, "merkle_verify");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    golle_error err = golle_merkle_verify (golle_merkle_root (tree), &proof);
+    bench_stop (&b);
+    bench_check (err == GOLLE_COMMIT_PASSED ? GOLLE_OK : err,
+		 "golle_merkle_verify");
+  }
+  bench_end (&b);
+  golle_merkle_proof_clear (&proof);
+  golle_merkle_delete (tree);
+  free (secrets);
+  free (commits);
+  golle_bin_release (&secret);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include "bench.h"
+#include <golle/elgamal.h>
+#include <golle/random.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+  EXTRA_SIZE = 64
+};
+
+/* Time the batch functions on a deck's worth (see --items) at a time.
+ * Each sample is a whole batch. */
+static void bench_many (const bench_args_t *args,
+			const golle_key_t *key,
+			golle_num_t m)
+{
+  char extra[EXTRA_SIZE];
+  bench_t b;
+  size_t n = args->items;
+  golle_num_t *ms = calloc (n, sizeof (*ms));
+  golle_num_t *plain = calloc (n, sizeof (*plain));
+  golle_eg_t *e1 = calloc (n, sizeof (*e1));
+  golle_eg_t *e2 = calloc (n, sizeof (*e2));
+  if (!ms || !plain || !e1 || !e2) {
+    bench_check (GOLLE_EMEM, "calloc");
+  }
+  for (size_t i = 0; i < n; i++) {
+    ms[i] = m;
+    if (!(plain[i] = golle_num_new ())) {
+      bench_check (GOLLE_EMEM, "golle_num_new");
+    }
+  }
+  snprintf (extra, sizeof (extra), "\"lane_kernel\":\"%s\"",
+	    golle_num_lane_kernel (args->bits));
+
+  bench_begin (&b, args, "eg_encrypt_many");
+  b.extra = extra;
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_eg_encrypt_many (key, ms, e1, n),
+		 "golle_eg_encrypt_many");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  bench_begin (&b, args, "eg_reencrypt_many");
+  b.extra = extra;
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_eg_reencrypt_many (key, e1, e2, n),
+		 "golle_eg_reencrypt_many");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  bench_begin (&b, args, "eg_decrypt_many");
+  b.extra = extra;
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_eg_decrypt_many (key, &key->x, 1, e2, plain, n),
+		 "golle_eg_decrypt_many");
+    bench_stop (&b);
+    for (size_t j = 0; j < n; j++) {
+      if (golle_num_cmp (m, plain[j]) != 0) {
+	bench_check (GOLLE_ECRYPTO, "golle_eg_decrypt_many");
+      }
+    }
+  }
+  bench_end (&b);
+
+  for (size_t i = 0; i < n; i++) {
+    golle_eg_clear (e1 + i);
+    golle_eg_clear (e2 + i);
+    golle_num_delete (plain[i]);
+  }
+  free (ms);
+  free (plain);
+  free (e1);
+  free (e2);
+}
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+  bench_t b;
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+
+  /* A message in G. */
+  golle_num_t m = golle_num_rand (key.q);
+  golle_num_t p = golle_num_new ();
+  if (!m || !p) {
+    bench_check (GOLLE_EMEM, "golle_num_new");
+  }
+  bench_check (golle_num_mod_exp (m, key.g, m, key.q), "golle_num_mod_exp");
+
+  golle_eg_t *e1 = calloc (args.iterations, sizeof (golle_eg_t));
+  golle_eg_t *e2 = calloc (args.iterations, sizeof (golle_eg_t));
+  if (!e1 || !e2) {
+    bench_check (GOLLE_EMEM, "calloc");
+  }
+
+  bench_begin (&b, &args, "eg_encrypt");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_eg_encrypt (&key, m, e1 + i, NULL), "golle_eg_encrypt");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  bench_begin (&b, &args, "eg_reencrypt");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_eg_reencrypt (&key, e1 + i, e2 + i, NULL),
+		 "golle_eg_reencrypt");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  bench_begin (&b, &args, "eg_decrypt");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_eg_decrypt (&key, &key.x, 1, e2 + i, p),
+		 "golle_eg_decrypt");
+    bench_stop (&b);
+    if (golle_num_cmp (m, p) != 0) {
+      bench_check (GOLLE_ECRYPTO, "golle_eg_decrypt");
+    }
+  }
+  bench_end (&b);
+
+  bench_many (&args, &key, m);
+
+  for (size_t i = 0; i < args.iterations; i++) {
+    golle_eg_clear (e1 + i);
+    golle_eg_clear (e2 + i);
+  }
+  free (e1);
+  free (e2);
+  golle_num_delete (m);
+  golle_num_delete (p);
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+/*
+ * Times a full draw: golle_generate, including revealing the selection
+ * and checking it for collisions. The draw runs in a single process, and
+ * every other peer echoes the local peer's messages back. That is enough
+ * for each peer's commitment, ciphertext and encryption to verify, so the
+ * local peer does all of the work it would do in a real draw with
+ * `--peers` peers, without any network in the way.
+ */
+#include "bench.h"
+#include <golle/golle.h>
+#include <golle/random.h>
+
+enum {
+  LOCAL_PEER = 0
+};
+
+/* The messages sent by the local peer in the current draw. The
+ * buffers are carved from an arena that is reset after each draw. */
+static golle_bin_arena_t *sent_arena;
+static golle_bin_t *sent_rsend, *sent_hash, *sent_rkeep;
+static golle_eg_t sent_cipher;
+static size_t sent_r;
+static golle_num_t sent_rand;
+static size_t collisions;
+
+static golle_error bcast_commit (golle_t *g,
+				 golle_bin_t *rsend,
+				 golle_bin_t *hash)
+{
+  GOLLE_UNUSED (g);
+  sent_rsend = golle_bin_arena_copy (sent_arena, rsend);
+  GOLLE_ASSERT (sent_rsend, GOLLE_EMEM);
+  sent_hash = golle_bin_arena_copy (sent_arena, hash);
+  GOLLE_ASSERT (sent_hash, GOLLE_EMEM);
+  return GOLLE_OK;
+}
+
+static golle_error bcast_secret (golle_t *g,
+				 golle_eg_t *secret,
+				 golle_bin_t *rkeep)
+{
+  GOLLE_UNUSED (g);
+  sent_rkeep = golle_bin_arena_copy (sent_arena, rkeep);
+  GOLLE_ASSERT (sent_rkeep, GOLLE_EMEM);
+  sent_cipher.a = golle_num_dup (secret->a);
+  GOLLE_ASSERT (sent_cipher.a, GOLLE_EMEM);
+  sent_cipher.b = golle_num_dup (secret->b);
+  GOLLE_ASSERT (sent_cipher.b, GOLLE_EMEM);
+  return GOLLE_OK;
+}
+
+static golle_error accept_commit (golle_t *g,
+				  size_t from,
+				  golle_bin_t *rsend,
+				  golle_bin_t *hash)
+{
+  GOLLE_UNUSED (g);
+  GOLLE_UNUSED (from);
+  golle_error err = golle_bin_copy_into (rsend, sent_rsend);
+  if (err == GOLLE_OK) {
+    err = golle_bin_copy_into (hash, sent_hash);
+  }
+  return err;
+}
+
+static golle_error accept_eg (golle_t *g,
+			      size_t from,
+			      golle_eg_t *eg,
+			      golle_bin_t *rkeep)
+{
+  GOLLE_UNUSED (g);
+  GOLLE_UNUSED (from);
+  eg->a = golle_num_dup (sent_cipher.a);
+  GOLLE_ASSERT (eg->a, GOLLE_EMEM);
+  eg->b = golle_num_dup (sent_cipher.b);
+  GOLLE_ASSERT (eg->b, GOLLE_EMEM);
+  return golle_bin_copy_into (rkeep, sent_rkeep);
+}
+
+static golle_error reveal_rand (golle_t *g,
+				size_t to,
+				size_t r,
+				golle_num_t rand)
+{
+  GOLLE_UNUSED (to);
+  size_t selection, collision;
+  sent_r = r;
+  sent_rand = golle_num_dup (rand);
+  GOLLE_ASSERT (sent_rand, GOLLE_EMEM);
+
+  /* The selection is always revealed to the local peer. */
+  golle_error err = golle_reveal_selection (g, &selection);
+  if (err == GOLLE_OK) {
+    err = golle_reduce_selection (g, selection, &collision);
+  }
+  if (err == GOLLE_ECOLLISION) {
+    collisions++;
+    err = GOLLE_OK;
+  }
+  return err;
+}
+
+static golle_error accept_rand (golle_t *g,
+				size_t from,
+				size_t *r,
+				golle_num_t rand)
+{
+  GOLLE_UNUSED (g);
+  GOLLE_UNUSED (from);
+  *r = sent_r;
+  return golle_num_cpy (rand, sent_rand);
+}
+
+static golle_error bcast_crypt (golle_t *g, const golle_eg_t *eg) {
+  GOLLE_UNUSED (g);
+  GOLLE_UNUSED (eg);
+  return GOLLE_OK;
+}
+
+/* Forget the messages from the last draw. */
+static void clear_sent (void) {
+  sent_rsend = sent_hash = sent_rkeep = NULL;
+  golle_bin_arena_reset (sent_arena);
+  golle_eg_clear (&sent_cipher);
+  golle_num_delete (sent_rand); sent_rand = NULL;
+}
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+  golle_t golle = { 0 };
+  bench_t b;
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+  if (!(sent_arena = golle_bin_arena_new (0))) {
+    bench_check (GOLLE_EMEM, "golle_bin_arena_new");
+  }
+
+  golle.key = &key;
+  golle.num_peers = args.peers;
+  golle.num_items = args.items;
+  golle.bcast_commit = &bcast_commit;
+  golle.bcast_secret = &bcast_secret;
+  golle.accept_commit = &accept_commit;
+  golle.accept_eg = &accept_eg;
+  golle.reveal_rand = &reveal_rand;
+  golle.accept_rand = &accept_rand;
+  golle.bcast_crypt = &bcast_crypt;
+  bench_check (golle_initialise (&golle), "golle_initialise");
+
+  bench_begin (&b, &args, "generate");
+  for (size_t i = 0; i < args.iterations; i++) {
+    /* Start a new deal once every item could have been drawn, so that
+     * the collision list doesn't grow without bound. */
+    if (i && i % args.items == 0) {
+      golle_clear (&golle);
+      bench_check (golle_initialise (&golle), "golle_initialise");
+    }
+    bench_start (&b);
+    bench_check (golle_generate (&golle, 0, LOCAL_PEER), "golle_generate");
+    bench_stop (&b);
+    clear_sent ();
+  }
+  bench_end (&b);
+  fprintf (stderr, "%zu collisions in %zu draws\n",
+	   collisions, args.iterations);
+
+  golle_clear (&golle);
+  golle_bin_arena_delete (sent_arena);
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+/*
+ * Times the group operations, on the Z*p group of the key (see --bits)
+ * and on each curve. Each result has the
+ * group name and the size of one element in the JSON, so the cost and
+ * the bandwidth of the groups can be compared.
+ */
+#include "bench.h"
+#include <golle/group.h>
+#include <golle/random.h>
+#include <stdio.h>
+
+enum {
+  EXTRA_SIZE = 64
+};
+
+/* Start a benchmark tagged with the group. */
+static void begin (bench_t *b,
+		   const bench_args_t *args,
+		   const char *name,
+		   char *extra)
+{
+  bench_begin (b, args, name);
+  b->extra = extra;
+}
+
+static golle_elem_t *elem_new (const golle_group_t *group) {
+  golle_elem_t *e = golle_elem_new (group);
+  if (!e) {
+    bench_check (GOLLE_EMEM, "golle_elem_new");
+  }
+  return e;
+}
+
+/* Time each operation on one group, then delete it. */
+static void bench_group (const bench_args_t *args, golle_group_t *group) {
+  char extra[EXTRA_SIZE];
+  bench_t b;
+
+  snprintf (extra, sizeof (extra), "\"group\":\"%s\",\"elem_bytes\":%zu",
+	    golle_group_name (group), golle_group_elem_size (group));
+
+  golle_num_t q = golle_group_order (group);
+  golle_num_t x = golle_num_rand (q);
+  if (!x) {
+    bench_check (GOLLE_EMEM, "golle_num_rand");
+  }
+  golle_elem_t *h = elem_new (group);
+  golle_elem_t *p = elem_new (group);
+  bench_check (golle_group_exp (group, h, NULL, x), "golle_group_exp");
+
+  begin (&b, args, "group_exp", extra);
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_group_exp (group, p, h, x), "golle_group_exp");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  begin (&b, args, "group_mul", extra);
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_group_mul (group, p, p, h), "golle_group_mul");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  begin (&b, args, "group_inv", extra);
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_group_inv (group, p, p), "golle_group_inv");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  golle_elem_delete (group, h);
+  golle_elem_delete (group, p);
+  golle_num_delete (x);
+  golle_group_delete (group);
+}
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+  golle_group_t *group;
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+
+  bench_check (golle_group_new_modp (&group, &key), "golle_group_new_modp");
+  bench_group (&args, group);
+  bench_check (golle_group_new_curve (&group, GOLLE_CURVE_P256),
+	       "golle_group_new_curve");
+  bench_group (&args, group);
+  bench_check (golle_group_new_curve (&group, GOLLE_CURVE_P384),
+	       "golle_group_new_curve");
+  bench_group (&args, group);
+
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include "bench.h"
+#include <golle/golle.h>
+#include <golle/random.h>
+
+enum {
+  /* The smallest set size to time. */
+  MIN_ITEMS = 8
+};
+
+/* Time golle_initialise for one set size. */
+static void bench_items (const bench_args_t *args, golle_key_t *key) {
+  bench_t b;
+  golle_t golle = { 0 };
+  golle.key = key;
+  golle.num_peers = args->peers;
+  golle.num_items = args->items;
+
+  bench_begin (&b, args, "initialise");
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_initialise (&golle), "golle_initialise");
+    bench_stop (&b);
+    golle_clear (&golle);
+  }
+  bench_end (&b);
+}
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+
+  /* Double the set size up to --items. */
+  size_t items = args.items;
+  for (size_t n = MIN_ITEMS; n < items; n *= 2) {
+    args.items = n;
+    bench_items (&args, &key);
+  }
+  args.items = items;
+  bench_items (&args, &key);
+
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+/*
+ * Times a face-up draw on a loopback table of `--peers` peers, each on
+ * its own thread. Unlike the generate benchmark, every peer does its own
+ * work, so this measures the whole table.
+ */
+#include "bench.h"
+#include <golle/loopback.h>
+#include <golle/random.h>
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+  golle_loopback_t *table;
+  size_t selection, collisions = 0;
+  bench_t b;
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+  bench_check (golle_loopback_new (&table, &key, args.peers, args.items),
+	       "golle_loopback_new");
+
+  bench_begin (&b, &args, "loopback_draw");
+  for (size_t i = 0; i < args.iterations; i++) {
+    /* Start a new deal once every item could have been drawn. */
+    if (i && i % args.items == 0) {
+      bench_check (golle_loopback_reset (table), "golle_loopback_reset");
+    }
+    bench_start (&b);
+    golle_error err = golle_loopback_draw (table, GOLLE_FACE_UP, &selection);
+    bench_stop (&b);
+    if (err == GOLLE_ECOLLISION) {
+      collisions++;
+      err = GOLLE_OK;
+    }
+    bench_check (err, "golle_loopback_draw");
+  }
+  bench_end (&b);
+  fprintf (stderr, "%zu collisions in %zu draws\n",
+	   collisions, args.iterations);
+
+  golle_loopback_delete (table);
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+/*
+ * Times face-up draws on a loopback table whose peers talk over
+ * simulated network links. With --latency-us, --jitter-us or --mbps,
+ * runs that one configuration. Otherwise, sweeps a range of latencies
+ * and bandwidths. Each result has the link parameters in the JSON, and
+ * ops_per_sec is the number of draws per second.
+ */
+#include "bench.h"
+#include <golle/loopback.h>
+#include <golle/random.h>
+#include <stdio.h>
+
+enum {
+  EXTRA_SIZE = 128
+};
+
+/* The sweep, when no link parameters are given. */
+static const double SWEEP_LATENCY_US[] = { 0, 100, 1000, 10000 };
+static const double SWEEP_MBPS[] = { 0, 10 };
+
+#define COUNT(a) (sizeof (a) / sizeof (*(a)))
+
+/* Time draws over one link configuration. */
+static void bench_link (const bench_args_t *args,
+			golle_loopback_t *table,
+			double latency_us,
+			double jitter_us,
+			double mbps)
+{
+  golle_netsim_t model = { 0 };
+  char extra[EXTRA_SIZE];
+  size_t selection;
+  bench_t b;
+
+  model.latency = latency_us * 1e-6;
+  model.jitter = jitter_us * 1e-6;
+  model.bandwidth = mbps * 1e6 / 8;
+  bench_check (golle_loopback_set_netsim (table, &model),
+	       "golle_loopback_set_netsim");
+  bench_check (golle_loopback_reset (table), "golle_loopback_reset");
+
+  snprintf (extra, sizeof (extra),
+	    "\"latency_us\":%.1f,\"jitter_us\":%.1f,\"mbps\":%.1f",
+	    latency_us, jitter_us, mbps);
+  bench_begin (&b, args, "netsim_draw");
+  b.extra = extra;
+  for (size_t i = 0; i < args->iterations; i++) {
+    /* Start a new deal once every item could have been drawn. */
+    if (i && i % args->items == 0) {
+      bench_check (golle_loopback_reset (table), "golle_loopback_reset");
+    }
+    bench_start (&b);
+    golle_error err = golle_loopback_draw (table, GOLLE_FACE_UP, &selection);
+    bench_stop (&b);
+    bench_check (err == GOLLE_ECOLLISION ? GOLLE_OK : err,
+		 "golle_loopback_draw");
+  }
+  bench_end (&b);
+}
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+  golle_loopback_t *table;
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+  bench_check (golle_loopback_new (&table, &key, args.peers, args.items),
+	       "golle_loopback_new");
+
+  if (args.netsim) {
+    bench_link (&args, table, args.latency_us, args.jitter_us, args.mbps);
+  }
+  else {
+    /* Jitter is a tenth of the latency. */
+    for (size_t i = 0; i < COUNT (SWEEP_MBPS); i++) {
+      for (size_t j = 0; j < COUNT (SWEEP_LATENCY_US); j++) {
+	bench_link (&args, table, SWEEP_LATENCY_US[j],
+		    SWEEP_LATENCY_US[j] / 10, SWEEP_MBPS[i]);
+      }
+    }
+  }
+
+  golle_loopback_delete (table);
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
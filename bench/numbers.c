@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include "bench.h"
+#include <golle/numbers.h>
+#include <golle/random.h>
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+  bench_t b;
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+
+  golle_num_t e = golle_num_new ();
+  golle_num_t out = golle_num_new ();
+  if (!e || !out) {
+    bench_check (GOLLE_EMEM, "golle_num_new");
+  }
+
+  /* g^e mod p for a full-size exponent. */
+  bench_begin (&b, &args, "mod_exp");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_check (golle_num_generate_rand (e, key.q), "golle_num_generate_rand");
+    bench_start (&b);
+    bench_check (golle_num_mod_exp (out, key.g, e, key.p), "golle_num_mod_exp");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  /* Drawing the exponent. */
+  bench_begin (&b, &args, "num_rand");
+  for (size_t i = 0; i < args.iterations; i++) {
+    bench_start (&b);
+    bench_check (golle_num_generate_rand (e, key.q), "golle_num_generate_rand");
+    bench_stop (&b);
+  }
+  bench_end (&b);
+
+  golle_num_delete (e);
+  golle_num_delete (out);
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include "bench.h"
+#include <golle/schnorr.h>
+#include <golle/disj.h>
+#include <golle/pep.h>
+#include <golle/elgamal.h>
+#include <golle/random.h>
+#include <limits.h>
+
+/* Make a Schnorr key for proving knowledge of x. */
+static void make_schnorr_key (const golle_key_t *key, golle_schnorr_t *sk) {
+  if (!(sk->Y = golle_num_dup (key->h_product)) ||
+      !(sk->G = golle_num_dup (key->g)) ||
+      !(sk->x = golle_num_dup (key->x)) ||
+      !(sk->q = golle_num_dup (key->q)) ||
+      !(sk->p = golle_num_dup (key->p)))
+    {
+      bench_check (GOLLE_EMEM, "golle_num_dup");
+    }
+}
+
+/* Time the three-move Schnorr proof for key sk (prover) and
+ * check it with vk (verifier). */
+static void bench_schnorr (const bench_args_t *args,
+			   const char *prove_name,
+			   const char *verify_name,
+			   const golle_schnorr_t *sk,
+			   const golle_schnorr_t *vk)
+{
+  bench_t prove, verify;
+  golle_num_t r = golle_num_new ();
+  golle_num_t t = golle_num_new ();
+  golle_num_t s = golle_num_new ();
+  golle_num_t c = golle_num_new ();
+  if (!r || !t || !s || !c) {
+    bench_check (GOLLE_EMEM, "golle_num_new");
+  }
+
+  bench_begin (&prove, args, prove_name);
+  bench_begin (&verify, args, verify_name);
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_check (golle_num_generate_rand (c, sk->q),
+		 "golle_num_generate_rand");
+
+    bench_start (&prove);
+    bench_check (golle_schnorr_commit (sk, r, t), "golle_schnorr_commit");
+    bench_check (golle_schnorr_prove (sk, s, r, c), "golle_schnorr_prove");
+    bench_stop (&prove);
+
+    bench_start (&verify);
+    bench_check (golle_schnorr_verify (vk, s, t, c), "golle_schnorr_verify");
+    bench_stop (&verify);
+  }
+  bench_end (&prove);
+  bench_end (&verify);
+
+  golle_num_delete (r);
+  golle_num_delete (t);
+  golle_num_delete (s);
+  golle_num_delete (c);
+}
+
+/* Time a disjunctive proof of knowledge of one of two keys. */
+static void bench_disj (const bench_args_t *args,
+			const golle_key_t *key)
+{
+  bench_t prove, verify;
+  golle_key_t other = { 0 };
+  golle_schnorr_t known = { 0 }, unknown = { 0 };
+  golle_disj_t d = { 0 };
+
+  /* A second key in the same group. */
+  if (!(other.p = golle_num_dup (key->p)) ||
+      !(other.q = golle_num_dup (key->q)) ||
+      !(other.g = golle_num_new ()))
+    {
+      bench_check (GOLLE_EMEM, "golle_num_dup");
+    }
+  bench_check (golle_find_generator (other.g, other.p, other.q, INT_MAX),
+	       "golle_find_generator");
+  bench_check (golle_key_gen_private (&other), "golle_key_gen_private");
+
+  make_schnorr_key (key, &known);
+  make_schnorr_key (&other, &unknown);
+
+  golle_num_t c = golle_num_new ();
+  if (!c) {
+    bench_check (GOLLE_EMEM, "golle_num_new");
+  }
+
+  bench_begin (&prove, args, "disj_prove");
+  bench_begin (&verify, args, "disj_verify");
+  for (size_t i = 0; i < args->iterations; i++) {
+    bench_check (golle_num_generate_rand (c, key->q),
+		 "golle_num_generate_rand");
+
+    bench_start (&prove);
+    bench_check (golle_disj_commit (&unknown, &known, &d), "golle_disj_commit");
+    bench_check (golle_disj_prove (&unknown, &known, c, &d),
+		 "golle_disj_prove");
+    bench_stop (&prove);
+
+    bench_start (&verify);
+    bench_check (golle_disj_verify (&known, &unknown, &d), "golle_disj_verify");
+    bench_stop (&verify);
+    golle_disj_clear (&d);
+  }
+  bench_end (&prove);
+  bench_end (&verify);
+
+  golle_num_delete (c);
+  golle_schnorr_clear (&known);
+  golle_schnorr_clear (&unknown);
+  golle_key_clear (&other);
+}
+
+/* Time setting up a plaintext equivalence proof, then run it. */
+static void bench_pep (const bench_args_t *args,
+		       const golle_key_t *key)
+{
+  bench_t setup;
+  golle_eg_t e1 = { 0 }, e2 = { 0 };
+  golle_schnorr_t skp = { 0 }, skv = { 0 };
+  golle_num_t k = NULL;
+
+  golle_num_t v = golle_num_rand (key->q);
+  golle_num_t z = golle_num_rand (key->q);
+  if (!v || !z) {
+    bench_check (GOLLE_EMEM, "golle_num_rand");
+  }
+  bench_check (golle_num_mod_exp (v, key->g, v, key->q), "golle_num_mod_exp");
+  bench_check (golle_num_mod_exp (z, key->g, z, key->q), "golle_num_mod_exp");
+  bench_check (golle_eg_encrypt (key, v, &e1, NULL), "golle_eg_encrypt");
+  bench_check (golle_eg_reencrypt (key, &e1, &e2, &k), "golle_eg_reencrypt");
+
+  bench_begin (&setup, args, "pep_setup");
+  for (size_t i = 0; i < args->iterations; i++) {
+    golle_schnorr_clear (&skp);
+    golle_schnorr_clear (&skv);
+    bench_start (&setup);
+    bench_check (golle_pep_prover (key, k, z, &skp), "golle_pep_prover");
+    bench_check (golle_pep_verifier (key, z, &e1, &e2, &skv),
+		 "golle_pep_verifier");
+    bench_stop (&setup);
+  }
+  bench_end (&setup);
+
+  bench_schnorr (args, "pep_prove", "pep_verify", &skp, &skv);
+
+  golle_schnorr_clear (&skp);
+  golle_schnorr_clear (&skv);
+  golle_eg_clear (&e1);
+  golle_eg_clear (&e2);
+  golle_num_delete (k);
+  golle_num_delete (v);
+  golle_num_delete (z);
+}
+
+int main (int argc, char *argv[]) {
+  bench_args_t args;
+  golle_key_t key = { 0 };
+  golle_schnorr_t sk = { 0 };
+
+  bench_parse_args (argc, argv, &args);
+  bench_key (&args, &key);
+
+  make_schnorr_key (&key, &sk);
+  bench_schnorr (&args, "schnorr_prove", "schnorr_verify", &sk, &sk);
+  bench_disj (&args, &key);
+  bench_pep (&args, &key);
+
+  golle_schnorr_clear (&sk);
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -43,18 +43,44 @@
  */
 #define golle_bin_clear(b) golle_bin_release(b)
 
+#ifndef BIN_SMALL_BYTES
+#define BIN_SMALL_BYTES 64
+#endif
+
+/*!
+ * \struct golle_bin_arena_t
+ * \brief A block of memory that buffers can be carved from.
+ * \see golle_bin_arena_alloc()
+ */
+typedef struct golle_bin_arena_t golle_bin_arena_t;
+
 /*!
  * \struct golle_bin_t
  * \brief Represents a binary buffer.
  *
- * \warning You can fill in the values of this structure if
- * necessary, but use the ::golle_bin_new function
- * whenever possible to avoid disparity between the `size`
- * member and the allocated size of `bin`.
+ * Buffers of up to `BIN_SMALL_BYTES` bytes are stored in the structure
+ * itself, so they don't need any allocation. The size can be set when
+ * configuring, with the `BIN_SMALL_BYTES` variable. The default of 64
+ * holds a commitment hash or random value; setting it to the size of a
+ * group element keeps serialised numbers off the heap too.
+ *
+ * \warning You can fill in the `size` and `bin` members of this
+ * structure if necessary (leaving the rest zeroed), but use the
+ * ::golle_bin_new function whenever possible to avoid disparity between
+ * the `size` member and the allocated size of `bin`.
+ *
+ * \warning A buffer may point into itself, so don't copy the structure
+ * by value. Use golle_bin_copy_into() instead.
  */
 typedef struct golle_bin_t {
   size_t size; /*!< Size, in bytes, of bin. */
   void *bin; /*!< Binary bytes. */
+  size_t capacity; /*!< The number of bytes available at `bin`, or 0 if
+		     unknown. */
+  golle_bin_arena_t *arena; /*!< The arena `bin` was carved from, if
+			      any. */
+  unsigned char small[BIN_SMALL_BYTES]; /*!< Storage for small
+					  buffers. */
 } golle_bin_t;
 
 /*!
@@ -87,8 +113,8 @@ GOLLE_EXTERN void golle_bin_release (golle_bin_t *buff);
  * \return The allocated buffer, or NULL if allocation failed.
  * \note This function only performs one `malloc`. It allocates
  * enough space for the structure _and_ the `bin` data itself.
- * The returned object's `bin` member will point to the address
- * just after the object.
+ * The returned object's `bin` member will point into the object if
+ * `size` is small enough, or to the address just after it.
  * \warning Do no independantly `free` the `bin` member of a
  * ::golle_bin_t structure allocated with this function.
  * Call ::golle_bin_delete instead. 
@@ -102,9 +128,10 @@ GOLLE_EXTERN golle_bin_t *golle_bin_new (size_t size);
  * \brief Deallocates resources held by a ::golle_bin_t structure.
  * \param buff The structure to free.
  * \note This function will check the address of the `bin` member
- * of `buff`. If it points to the address just passed the object,
- * it will free the object. If it points elsewhere, it will _also_ free
- * the `bin` member separately.
+ * of `buff`. If it points into or just past the object, it will free
+ * the object. If it points elsewhere, it will _also_ free the `bin`
+ * member separately. If `buff` came from golle_bin_arena_copy(), it
+ * is only zeroed.
  */
 GOLLE_EXTERN void golle_bin_delete (golle_bin_t *buff);
 
@@ -118,7 +145,9 @@ GOLLE_EXTERN void golle_bin_delete (golle_bin_t *buff);
 GOLLE_EXTERN golle_bin_t *golle_bin_copy (const golle_bin_t *buff);
 
 /*!
- * \brief Resize the buffer.
+ * \brief Resize the buffer, keeping its contents up to the smaller
+ * of the two sizes. Memory is only allocated when the buffer grows
+ * beyond its capacity.
  * \param buff The buffer to resize.
  * \param size The new size of the buffer.
  * \return ::GOLLE_OK if successful. 
@@ -127,6 +156,91 @@ GOLLE_EXTERN golle_bin_t *golle_bin_copy (const golle_bin_t *buff);
  */
 GOLLE_EXTERN golle_error golle_bin_resize (golle_bin_t *buff, size_t size);
 
+/*!
+ * \brief Copy the contents of one buffer into another, reusing the
+ * memory of the destination if it is large enough.
+ * \param dest The buffer to copy into. It is resized to fit.
+ * \param src The buffer to copy.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if either buffer is `NULL` or
+ * `src` is empty, or ::GOLLE_EMEM.
+ */
+GOLLE_EXTERN golle_error golle_bin_copy_into (golle_bin_t *dest,
+					      const golle_bin_t *src);
+
+/*!
+ * \brief Make a new arena.
+ *
+ * An arena hands out memory for buffers from large blocks, and takes it
+ * all back at once with golle_bin_arena_reset(). It suits buffers that
+ * are short-lived and numerous, such as the messages of one draw.
+ * Buffers carved from an arena can be released or deleted as usual, but
+ * their memory is only reused after a reset. An arena is not
+ * thread-safe.
+ *
+ * \param block The size of each block, or 0 for a default.
+ * \return The arena, or `NULL` if allocation failed.
+ */
+GOLLE_EXTERN golle_bin_arena_t *golle_bin_arena_new (size_t block);
+
+/*!
+ * \brief Make a new arena for secrets.
+ *
+ * Like golle_bin_arena_new(), but the blocks are whole pages that are
+ * locked out of swap, where the system allows it, and left out of core
+ * dumps. Deleting the arena wipes and unmaps each block in one go, so
+ * buffers carved from it don't need to be released one by one.
+ *
+ * \param block The size of each block, or 0 for a default.
+ * \return The arena, or `NULL` if allocation failed.
+ */
+GOLLE_EXTERN golle_bin_arena_t *golle_bin_arena_new_secure (size_t block);
+
+/*!
+ * \brief Free an arena. Buffers carved from it must not be used again.
+ * \param arena The arena to free.
+ */
+GOLLE_EXTERN void golle_bin_arena_delete (golle_bin_arena_t *arena);
+
+/*!
+ * \brief Take back every buffer carved from an arena. The memory is
+ * zeroed and kept for reuse.
+ * \param arena The arena to reset.
+ */
+GOLLE_EXTERN void golle_bin_arena_reset (golle_bin_arena_t *arena);
+
+/*!
+ * \brief Carve raw memory from an arena.
+ * \param arena The arena.
+ * \param size The number of bytes wanted.
+ * \return The memory, which lasts until the arena is reset, or `NULL`
+ * if `arena` is `NULL` or allocation failed.
+ */
+GOLLE_EXTERN void *golle_bin_arena_carve (golle_bin_arena_t *arena,
+					  size_t size);
+
+/*!
+ * \brief Initialise a buffer with memory from an arena. Like
+ * golle_bin_init(), `buff` is assumed to hold nothing.
+ * \param arena The arena.
+ * \param buff The buffer to initialise.
+ * \param size The size of the buffer.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an argument is `NULL`, or
+ * ::GOLLE_EMEM.
+ */
+GOLLE_EXTERN golle_error golle_bin_arena_alloc (golle_bin_arena_t *arena,
+						golle_bin_t *buff,
+						size_t size);
+
+/*!
+ * \brief Like golle_bin_copy(), but the copy is carved from an arena.
+ * \param arena The arena.
+ * \param buff The buffer to copy.
+ * \return The copy, or `NULL` if an argument was `NULL` or allocation
+ * failed. It lasts until the arena is reset.
+ */
+GOLLE_EXTERN golle_bin_t *golle_bin_arena_copy (golle_bin_arena_t *arena,
+						const golle_bin_t *buff);
+
 /*!
  * @}
  */
@@ -6,6 +6,7 @@
 #define LIBGOLLE_COMMIT_H
 
 #include "bin.h"
+#include "numbers.h"
 #include "platform.h"
 #include "errors.h"
 
@@ -62,6 +63,25 @@ typedef struct golle_commit_t {
  */
 GOLLE_EXTERN golle_commit_t *golle_commit_new (const golle_bin_t *secret);
 
+/*!
+ * \brief Generate commitments to several values at once.
+ * This is equivalent to calling golle_commit_new() for each secret,
+ * but the random values are generated together and the hashing
+ * set-up is shared between all of the commitments.
+ * \param[out] commits An array of `count` pointers. Each is set to a
+ * new commitment, to be freed with golle_commit_delete().
+ * \param secrets An array of `count` secrets.
+ * \param count The number of commitments to make.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an array, a secret, or
+ * the contents of a secret are `NULL` or empty, ::GOLLE_EMEM if
+ * allocation failed, or ::GOLLE_ECRYPTO if hashing failed. On error,
+ * every element of `commits` is `NULL`.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_new_many (golle_commit_t **commits,
+		       const golle_bin_t *const *secrets,
+		       size_t count);
+
 /*!
  * \brief Free resources allocated by a call to ::golle_commit_new.
  * \param commitment A pointer returned by ::golle_commit_new().
@@ -82,6 +102,25 @@ GOLLE_EXTERN void golle_commit_delete (golle_commit_t *commitment);
  */
 GOLLE_EXTERN golle_error golle_commit_verify (const golle_commit_t *commitment);
 
+/*!
+ * \brief Verify several commitments at once, on the default pool (see
+ * @ref pool).
+ * \param commits An array of `count` commitments to verify.
+ * \param count The number of commitments.
+ * \param[out] failed If not `NULL`, and a commitment fails or can't
+ * be checked, this is set to the index of the first one that did.
+ * \return GOLLE_COMMIT_PASSED if every commitment was verified.
+ * GOLLE_COMMIT_FAILED if one of them did not pass.
+ * GOLLE_ERROR if `commits`, any commitment, or any member of a
+ * commitment is `NULL`.
+ * GOLLE_ECRYPTO if hash checking failed, or GOLLE_EMEM if the hashing
+ * context couldn't be made.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_verify_many (const golle_commit_t *const *commits,
+			  size_t count,
+			  size_t *failed);
+
 /*!
  * \brief Release the buffers associated with a commit
  * without freeing the commit structure itself.
@@ -106,6 +145,187 @@ GOLLE_INLINE void golle_commit_clear (golle_commit_t *commit) {
 GOLLE_EXTERN golle_error golle_commit_copy (golle_commit_t *dest,
 					    const golle_commit_t *src);
 
+/*!
+ * \struct golle_commit_pack_t
+ * \brief A commitment whose four buffers share one allocation.
+ *
+ * The contents of `hash`, `rsend`, `rkeep` and `secret` are kept in
+ * that order in a single block, `arena`. The block is kept when the
+ * pack is reset, so a pack that is filled and reset over and over,
+ * once per draw, only allocates when a buffer grows.
+ *
+ * A zero-initialised pack is empty and ready to use. The `commit`
+ * member can be passed to golle_commit_verify() and friends. Each of
+ * its members points at one of the buffers of the pack, or is `NULL`
+ * if that buffer hasn't been set.
+ *
+ * Many packs can share a `pool`. With a pool from
+ * golle_bin_arena_new_secure(), a whole table of commitments is kept
+ * in locked memory and wiped at once when the pool is deleted.
+ *
+ * \warning `commit` points into the pack itself, so a pack mustn't be
+ * copied or moved with `memcpy` while it holds anything.
+ */
+typedef struct golle_commit_pack_t {
+  golle_commit_t commit; /*!< The commitment, pointing at the buffers. */
+  golle_bin_t secret; /*!< The secret, in `arena`. */
+  golle_bin_t rsend; /*!< The first random value, in `arena`. */
+  golle_bin_t rkeep; /*!< The second random value, in `arena`. */
+  golle_bin_t hash; /*!< The hash, in `arena`. */
+  void *arena; /*!< The contents of every buffer. */
+  size_t capacity; /*!< The size of `arena`, in bytes. */
+  golle_bin_arena_t *pool; /*!< If set, `arena` is carved from here
+			     instead of the heap. Set it before the pack
+			     is first used. */
+} golle_commit_pack_t;
+
+/*!
+ * \brief Copy buffers into a pack.
+ * \param pack The pack to fill.
+ * \param secret The new secret, or `NULL` to keep the current one.
+ * \param rsend The new `rsend`, or `NULL` to keep the current one.
+ * \param rkeep The new `rkeep`, or `NULL` to keep the current one.
+ * \param hash The new hash, or `NULL` to keep the current one.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if `pack` is `NULL` or a buffer
+ * is empty, or ::GOLLE_EMEM. On error, the pack is unchanged.
+ */
+GOLLE_EXTERN golle_error golle_commit_pack_set (golle_commit_pack_t *pack,
+						const golle_bin_t *secret,
+						const golle_bin_t *rsend,
+						const golle_bin_t *rkeep,
+						const golle_bin_t *hash);
+
+/*!
+ * \brief Generate a new commitment into a pack, as golle_commit_new().
+ * \param pack The pack to fill. Anything it held is replaced.
+ * \param secret The secret that is to be committed to.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if either argument is `NULL` or
+ * `secret` is empty, ::GOLLE_EMEM, or ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error golle_commit_pack_new (golle_commit_pack_t *pack,
+						const golle_bin_t *secret);
+
+/*!
+ * \brief Empty a pack, but keep its memory for next time.
+ * The old contents are wiped.
+ * \param pack The pack to empty.
+ */
+GOLLE_EXTERN void golle_commit_pack_reset (golle_commit_pack_t *pack);
+
+/*!
+ * \brief Empty a pack and free its memory.
+ * \param pack The pack to release.
+ */
+GOLLE_EXTERN void golle_commit_pack_release (golle_commit_pack_t *pack);
+
+/*!
+ * \struct golle_commit_stream_t
+ * \brief Hashes a commitment from its parts, without building the
+ * secret in memory first.
+ *
+ * The hash of a commitment is taken over `rsend`, `rkeep` and then the
+ * secret. A stream lets the secret be fed in piece by piece, and
+ * numbers be fed in directly in a fixed-width big-endian encoding. The
+ * committer makes the commitment with golle_commit_pack_begin(), feeds
+ * the secret, then calls golle_commit_pack_end(). A verifier who is
+ * given the secret as numbers, such as a ciphertext, calls
+ * golle_commit_stream_begin(), feeds the numbers, then calls
+ * golle_commit_stream_check(). Neither side has to keep the secret in
+ * the commitment.
+ *
+ * A stream can be used for any number of commitments, one at a time.
+ */
+typedef struct golle_commit_stream_t golle_commit_stream_t;
+
+/*!
+ * \brief Make a new stream.
+ * \return The stream, or `NULL` if allocation failed.
+ */
+GOLLE_EXTERN golle_commit_stream_t *golle_commit_stream_new (void);
+
+/*!
+ * \brief Free a stream.
+ * \param stream The stream to free.
+ */
+GOLLE_EXTERN void golle_commit_stream_delete (golle_commit_stream_t *stream);
+
+/*!
+ * \brief Start hashing a commitment.
+ * \param stream The stream.
+ * \param rsend The first random value of the commitment.
+ * \param rkeep The second random value of the commitment.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an argument is `NULL`, or
+ * ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_stream_begin (golle_commit_stream_t *stream,
+			   const golle_bin_t *rsend,
+			   const golle_bin_t *rkeep);
+
+/*!
+ * \brief Feed the next part of the secret.
+ * \param stream The stream.
+ * \param data The bytes to feed.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an argument is `NULL`, or
+ * ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_stream_bin (golle_commit_stream_t *stream,
+			 const golle_bin_t *data);
+
+/*!
+ * \brief Feed a number as the next part of the secret.
+ * \param stream The stream.
+ * \param n The number, which must not be negative.
+ * \param width The number of bytes to encode `n` in. It is padded
+ * with leading zeros. Using the same width for every number makes the
+ * encoding of a list of numbers unambiguous.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an argument is `NULL`, or `n`
+ * is negative or doesn't fit in `width` bytes, ::GOLLE_EMEM, or
+ * ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_stream_num (golle_commit_stream_t *stream,
+			 const golle_num_t n,
+			 size_t width);
+
+/*!
+ * \brief Finish hashing and compare with a commitment's hash.
+ * \param stream The stream.
+ * \param hash The hash that was sent with the commitment.
+ * \return ::GOLLE_COMMIT_PASSED if the hashes match,
+ * ::GOLLE_COMMIT_FAILED if they don't, ::GOLLE_ERROR if an argument is
+ * `NULL`, or ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_stream_check (golle_commit_stream_t *stream,
+			   const golle_bin_t *hash);
+
+/*!
+ * \brief Start a new commitment in a pack, with a secret to be
+ * streamed in. The random values are generated, and the hash is
+ * filled in by golle_commit_pack_end(). The pack's secret is left
+ * empty.
+ * \param pack The pack to fill. Anything it held is replaced.
+ * \param stream The stream to feed the secret to.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an argument is `NULL`,
+ * ::GOLLE_EMEM, or ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_pack_begin (golle_commit_pack_t *pack,
+			 golle_commit_stream_t *stream);
+
+/*!
+ * \brief Finish a commitment started by golle_commit_pack_begin().
+ * \param pack The pack.
+ * \param stream The stream that the secret was fed to.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an argument is `NULL` or the
+ * pack wasn't started, or ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error
+golle_commit_pack_end (golle_commit_pack_t *pack,
+		       golle_commit_stream_t *stream);
+
 /*!
  * @}
  */
@@ -109,6 +109,21 @@ GOLLE_EXTERN golle_error golle_eg_reencrypt (const golle_key_t *key,
 					     const golle_eg_t *e1,
 					     golle_eg_t *e2,
 					     golle_num_t *rand);
+/*!
+ * \brief Multiply a ciphertext into a running product, so that
+ * \f$(a, b)\f$ becomes \f$(aa', bb')\f$. The product decrypts to the
+ * product of the plaintexts.
+ * \param key The key containing the prime used for modulus operations.
+ * \param[in,out] product The running product. If it is empty, it is
+ * taken to be \f$(1, 1)\f$.
+ * \param cipher The ciphertext \f$(a', b')\f$ to multiply in.
+ * \return ::GOLLE_ERROR if any parameter is `NULL`. ::GOLLE_ECRYPTO if
+ * an error happens during cryptography. ::GOLLE_EMEM if memory allocation
+ * fails. ::GOLLE_OK if successful.
+ */
+GOLLE_EXTERN golle_error golle_eg_mul (const golle_key_t *key,
+				       golle_eg_t *product,
+				       const golle_eg_t *cipher);
 /*!
  * \brief Decrypt a message.
  * \param key The key containing the primes used for modulus operations.
@@ -131,6 +146,56 @@ GOLLE_EXTERN golle_error golle_eg_decrypt (const golle_key_t *key,
 					   const golle_eg_t *cipher,
 					   golle_num_t m);
 
+/*!
+ * \brief Encrypt many numbers, each with its own random value, on the
+ * default pool (see @ref pool).
+ * \param key The ElGamal public key to use during encryption.
+ * \param m An array of `count` numbers to encrypt.
+ * \param[out] ciphers An array of `count` empty ::golle_eg_t structures.
+ * \param count The number of numbers to encrypt.
+ * \return As for golle_eg_encrypt(). If any encryption fails, all of
+ * \p ciphers are cleared.
+ * \note The exponents are done together, several at a time where the
+ * size of \f$p\f$ has a lane kernel (see golle_num_mod_exp_many()), so
+ * this is quicker than one golle_eg_encrypt() after another even
+ * without a pool. The same goes for the other batch functions.
+ */
+GOLLE_EXTERN golle_error golle_eg_encrypt_many (const golle_key_t *key,
+						const golle_num_t *m,
+						golle_eg_t *ciphers,
+						size_t count);
+
+/*!
+ * \brief Re-encrypt many ciphertexts on the default pool.
+ * \param key The ElGamal public key used to encrypt the ciphertexts.
+ * \param e1 An array of `count` ciphertexts.
+ * \param[out] e2 An array of `count` empty ::golle_eg_t structures.
+ * \param count The number of ciphertexts.
+ * \return As for golle_eg_reencrypt(). If any re-encryption fails, all
+ * of \p e2 are cleared.
+ */
+GOLLE_EXTERN golle_error golle_eg_reencrypt_many (const golle_key_t *key,
+						  const golle_eg_t *e1,
+						  golle_eg_t *e2,
+						  size_t count);
+
+/*!
+ * \brief Decrypt many ciphertexts on the default pool.
+ * \param key The key containing the primes used for modulus operations.
+ * \param xi An array of private key values, for each member of the group.
+ * \param len The number of keys in `xi`.
+ * \param ciphers An array of `count` ciphertexts.
+ * \param m An array of `count` numbers, which receive the plaintexts.
+ * \param count The number of ciphertexts.
+ * \return As for golle_eg_decrypt().
+ */
+GOLLE_EXTERN golle_error golle_eg_decrypt_many (const golle_key_t *key,
+						const golle_num_t *xi,
+						size_t len,
+						const golle_eg_t *ciphers,
+						golle_num_t *m,
+						size_t count);
+
 /*!
  * @}
  */
@@ -201,6 +201,10 @@ struct golle_t {
  * before dealing any rounds.
  * \param golle The Golle Structure. Must have a valid key, and
  * `num_peers` and `num_items` must be > 0.
+ * \note The item set is computed here, on the default pool if there is
+ * one (see @ref pool). This is most of the time taken for large
+ * `num_items`. The encrypted set \f$S\f$ is not computed, since only
+ * later rounds would need it and golle_generate() deals just one.
  * \return ::GOLLE_ERROR if `golle` is `NULL`, or a member is invalid.
  * ::GOLLE_EMEM if memory allocation fails. ::GOLLE_ECRYPTO if any
  * internal crypto operation fails (indicates a bad key). Upon success,
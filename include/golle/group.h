@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_GROUP_H
+#define LIBGOLLE_GROUP_H
+
+#include "platform.h"
+#include "errors.h"
+#include "numbers.h"
+#include "distribute.h"
+#include "bin.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/group.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief Describes prime-order groups and their elements.
+ */
+
+/*!
+ * \defgroup group Groups
+ * @{
+ * A ::golle_group_t is a cyclic group \f$\mathbb{G}\f$ of prime order
+ * \f$q\f$ with a generator \f$g\f$. There are two kinds:
+ *
+ *  - The order \f$q\f$ subgroup of \f$\mathbb{Z}^{*}_{p}\f$, made from
+ *    the \f$p\f$, \f$q\f$ and \f$g\f$ of a ::golle_key_t. Its elements
+ *    are held in Montgomery form, so a chain of golle_group_mul() calls
+ *    converts nothing until the result is written out with
+ *    golle_elem_to_bin().
+ *  - A named elliptic curve of prime order, such as P-256. Elements are
+ *    points, and are far smaller and cheaper to work with than those of
+ *    \f$\mathbb{Z}^{*}_{p}\f$ at the same security level.
+ *
+ * The group is written multiplicatively either way, so on a curve
+ * golle_group_mul() adds points and golle_group_exp() multiplies a
+ * point by a scalar. Exponents are ::golle_num_t values in
+ * \f$\mathbb{Z}_{q}\f$.
+ *
+ * Only the group operations are here. ElGamal, the proofs, commitments
+ * and golle_generate() take a ::golle_key_t and always work in
+ * \f$\mathbb{Z}^{*}_{p}\f$; none of them uses a ::golle_group_t yet.
+ */
+
+/*!
+ * \struct golle_group_t
+ * \brief An opaque pointer to a group.
+ */
+typedef struct golle_group_t golle_group_t;
+
+/*!
+ * \struct golle_elem_t
+ * \brief An opaque pointer to an element of a group. An element can
+ * only be used with the group that made it.
+ */
+typedef struct golle_elem_t golle_elem_t;
+
+/*!
+ * \enum golle_curve
+ * \brief The elliptic curves that can be used as groups.
+ */
+typedef enum golle_curve {
+  GOLLE_CURVE_P256, /*!< NIST P-256, about 128-bit security. */
+  GOLLE_CURVE_P384 /*!< NIST P-384, about 192-bit security. */
+} golle_curve;
+
+/*!
+ * \brief Make the order \f$q\f$ subgroup of \f$\mathbb{Z}^{*}_{p}\f$.
+ * \param[out] group Receives the new group.
+ * \param key A key with `p`, `q` and `g` set. They are copied.
+ * \return ::GOLLE_OK if successful. ::GOLLE_EMEM if memory runs out.
+ * ::GOLLE_EINVALID if `p` is even. ::GOLLE_ERROR if an argument is
+ * `NULL`.
+ */
+GOLLE_EXTERN golle_error golle_group_new_modp (golle_group_t **group,
+					       const golle_key_t *key);
+
+/*!
+ * \brief Make the group of points on an elliptic curve.
+ * \param[out] group Receives the new group.
+ * \param curve The curve.
+ * \return ::GOLLE_OK if successful. ::GOLLE_EMEM if memory runs out.
+ * ::GOLLE_EINVALID if the curve isn't known. ::GOLLE_ERROR if `group`
+ * is `NULL`.
+ */
+GOLLE_EXTERN golle_error golle_group_new_curve (golle_group_t **group,
+						golle_curve curve);
+
+/*!
+ * \brief Free a group. Its elements must be freed first.
+ * \param group The group.
+ */
+GOLLE_EXTERN void golle_group_delete (golle_group_t *group);
+
+/*!
+ * \brief Get the name of a group, such as `"modp"` or `"p256"`.
+ * \param group The group.
+ * \return The name, or `NULL` if `group` is `NULL`.
+ */
+GOLLE_EXTERN const char *golle_group_name (const golle_group_t *group);
+
+/*!
+ * \brief Get the order of a group.
+ * \param group The group.
+ * \return \f$q\f$, which belongs to the group and must not be changed,
+ * or `NULL` if `group` is `NULL`.
+ */
+GOLLE_EXTERN golle_num_t golle_group_order (const golle_group_t *group);
+
+/*!
+ * \brief Get the size of an element written with golle_elem_to_bin().
+ * \param group The group.
+ * \return The number of bytes, or 0 if `group` is `NULL`.
+ */
+GOLLE_EXTERN size_t golle_group_elem_size (const golle_group_t *group);
+
+/*!
+ * \brief Make an element. Its value is unspecified until it is set.
+ * \param group The group.
+ * \return The new element, or `NULL` if memory runs out.
+ */
+GOLLE_EXTERN golle_elem_t *golle_elem_new (const golle_group_t *group);
+
+/*!
+ * \brief Wipe and free an element.
+ * \param group The group that made it.
+ * \param e The element. May be `NULL`.
+ */
+GOLLE_EXTERN void golle_elem_delete (const golle_group_t *group,
+				     golle_elem_t *e);
+
+/*!
+ * \brief Copy an element.
+ * \param group The group.
+ * \param[out] dst The copy.
+ * \param src The element to copy.
+ * \return ::GOLLE_OK, ::GOLLE_EMEM or ::GOLLE_ERROR.
+ */
+GOLLE_EXTERN golle_error golle_elem_cpy (const golle_group_t *group,
+					 golle_elem_t *dst,
+					 const golle_elem_t *src);
+
+/*!
+ * \brief Compare two elements.
+ * \param group The group.
+ * \param a The first element.
+ * \param b The second element.
+ * \return 0 if they are equal, non-zero if not or if an argument is
+ * `NULL`.
+ */
+GOLLE_EXTERN int golle_elem_cmp (const golle_group_t *group,
+				 const golle_elem_t *a,
+				 const golle_elem_t *b);
+
+/*!
+ * \brief Calculate \f$r = a^{n}\f$.
+ * \param group The group.
+ * \param[out] r The result. May be `a`.
+ * \param a The base. If `NULL`, the generator \f$g\f$ is used.
+ * \param n The exponent.
+ * \return ::GOLLE_OK, ::GOLLE_EMEM, ::GOLLE_ECRYPTO or ::GOLLE_ERROR.
+ */
+GOLLE_EXTERN golle_error golle_group_exp (const golle_group_t *group,
+					  golle_elem_t *r,
+					  const golle_elem_t *a,
+					  const golle_num_t n);
+
+/*!
+ * \brief Calculate \f$r = ab\f$.
+ * \param group The group.
+ * \param[out] r The result. May be `a` or `b`.
+ * \param a The first element.
+ * \param b The second element.
+ * \return ::GOLLE_OK, ::GOLLE_EMEM, ::GOLLE_ECRYPTO or ::GOLLE_ERROR.
+ */
+GOLLE_EXTERN golle_error golle_group_mul (const golle_group_t *group,
+					  golle_elem_t *r,
+					  const golle_elem_t *a,
+					  const golle_elem_t *b);
+
+/*!
+ * \brief Calculate \f$r = a^{-1}\f$.
+ * \param group The group.
+ * \param[out] r The result. May be `a`.
+ * \param a The element.
+ * \return ::GOLLE_OK, ::GOLLE_EMEM, ::GOLLE_ECRYPTO or ::GOLLE_ERROR.
+ */
+GOLLE_EXTERN golle_error golle_group_inv (const golle_group_t *group,
+					  golle_elem_t *r,
+					  const golle_elem_t *a);
+
+/*!
+ * \brief Write an element out. Elements of \f$\mathbb{Z}^{*}_{p}\f$ are
+ * big-endian and padded to the size of \f$p\f$; points are compressed.
+ * \param group The group.
+ * \param e The element.
+ * \param[out] bin Receives the bytes, resized as needed.
+ * \return ::GOLLE_OK, ::GOLLE_EMEM or ::GOLLE_ERROR.
+ */
+GOLLE_EXTERN golle_error golle_elem_to_bin (const golle_group_t *group,
+					    const golle_elem_t *e,
+					    golle_bin_t *bin);
+
+/*!
+ * \brief Read an element written by golle_elem_to_bin(), checking that
+ * it belongs to the group.
+ * \param group The group.
+ * \param bin The bytes.
+ * \param[out] e Receives the element.
+ * \return ::GOLLE_OK if successful. ::GOLLE_EOUTOFRANGE if the bytes
+ * aren't an element of the group. ::GOLLE_EMEM or ::GOLLE_ERROR.
+ */
+GOLLE_EXTERN golle_error golle_bin_to_elem (const golle_group_t *group,
+					    const golle_bin_t *bin,
+					    golle_elem_t *e);
+
+/*!
+ *@}
+ */
+
+GOLLE_END_C
+
+#endif
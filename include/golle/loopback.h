@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_LOOPBACK_H
+#define LIBGOLLE_LOOPBACK_H
+
+#include "platform.h"
+#include "errors.h"
+#include "distribute.h"
+#include "golle.h"
+#include "netsim.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/loopback.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief An in-process transport for simulating a table of peers.
+ */
+
+/*!
+ * \defgroup loopback Loopback transport
+ * @{
+ * A loopback table runs every peer of a game in the current process,
+ * each on its own thread with its own ::golle_t and private key. The
+ * peers talk over in-memory channels instead of sockets, and every
+ * callback of ::golle_t is implemented by the table.
+ *
+ * This is useful for testing and measuring the protocol with any
+ * number of peers, without a network.
+ */
+
+/*!
+ * \struct golle_loopback_t
+ * \brief An opaque pointer to a table of simulated peers.
+ */
+typedef struct golle_loopback_t golle_loopback_t;
+
+/*!
+ * \brief Set up a table of peers and start their threads.
+ * \param[out] table Receives the new table.
+ * \param key The public key parameters \f$p\f$, \f$q\f$ and \f$g\f$.
+ * Each peer generates its own private key in this group, and the
+ * public keys are combined as in the @ref distribute module.
+ * \param num_peers The number of peers at the table.
+ * \param num_items The number of items to draw from.
+ * \return ::GOLLE_OK if successful. ::GOLLE_ERROR if any argument is
+ * `NULL` or zero. ::GOLLE_EMEM if memory or threads couldn't be allocated.
+ * Otherwise, an error from key generation or golle_initialise().
+ */
+GOLLE_EXTERN golle_error golle_loopback_new (golle_loopback_t **table,
+					     const golle_key_t *key,
+					     size_t num_peers,
+					     size_t num_items);
+
+/*!
+ * \brief Stop all of the peers and free the table.
+ * \param table The table to free.
+ */
+GOLLE_EXTERN void golle_loopback_delete (golle_loopback_t *table);
+
+/*!
+ * \brief Draw one item. Every peer calls golle_generate() at once.
+ * \param table The table to draw on.
+ * \param to The peer to reveal the item to, or ::GOLLE_FACE_UP to
+ * reveal it to everyone.
+ * \param[out] selection If not `NULL`, receives the item drawn, as seen
+ * by peer `to` (or by peer 0 if the draw is face up).
+ * \return ::GOLLE_OK if the draw succeeded. ::GOLLE_ECOLLISION if the
+ * item had already been drawn, in which case `selection` is still set.
+ * ::GOLLE_EOUTOFRANGE if `to` is not a peer. Otherwise the first error
+ * reported by a peer.
+ */
+GOLLE_EXTERN golle_error golle_loopback_draw (golle_loopback_t *table,
+					      size_t to,
+					      size_t *selection);
+
+/*!
+ * \brief Get the outcome of the last draw for one peer.
+ * \param table The table.
+ * \param peer The peer to query.
+ * \param[out] selection If not `NULL`, receives the item drawn, if the
+ * peer was shown it.
+ * \return The peer's result from golle_generate(), or
+ * ::GOLLE_ENOTFOUND if the draw succeeded but was hidden from the peer.
+ * ::GOLLE_EOUTOFRANGE if `peer` is not at the table.
+ */
+GOLLE_EXTERN golle_error golle_loopback_result (const golle_loopback_t *table,
+						size_t peer,
+						size_t *selection);
+
+/*!
+ * \brief Start a new game, forgetting all of the items drawn so far.
+ * \param table The table to reset.
+ * \return ::GOLLE_OK, or the first error from golle_initialise().
+ */
+GOLLE_EXTERN golle_error golle_loopback_reset (golle_loopback_t *table);
+
+/*!
+ * \brief Send messages between peers over simulated network links.
+ * Each ordered pair of peers gets its own ::golle_link_t. Messages that
+ * a peer sends to itself are never delayed.
+ * \param table The table.
+ * \param model The link parameters, or `NULL` to stop simulating.
+ * \return ::GOLLE_OK, or ::GOLLE_ERROR if `table` is `NULL` or the model
+ * is invalid.
+ * \warning Don't call this during a draw.
+ */
+GOLLE_EXTERN golle_error golle_loopback_set_netsim (golle_loopback_t *table,
+						    const golle_netsim_t *model);
+
+/*!
+ * @}
+ */
+
+GOLLE_END_C
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_MAP_H
+#define LIBGOLLE_MAP_H
+
+#include "platform.h"
+#include "errors.h"
+#include "types.h"
+#include "bin.h"
+#include "numbers.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/map.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief Describes the structures and operations for working with
+ * hash maps.
+ */
+/*!
+ * \defgroup map Hash maps
+ * @{
+ * A map associates binary keys, or numbers, with values of a fixed
+ * size. Keys are copied into the map as ::golle_bin_t buffers.
+ *
+ * The map uses open addressing with Robin Hood probing: every entry
+ * lives in one array, and an entry that is far from its home slot takes
+ * the place of one that is nearer to its own. This keeps probe
+ * sequences short even when the map is nearly full, so finding,
+ * inserting and erasing take expected constant time. The hash of each
+ * entry is kept in a separate array, which is what a probe walks, and
+ * keys are only compared when their hashes are equal.
+ *
+ * The hash is fast but not cryptographic. Each map mixes its own seed
+ * into it.
+ *
+ * \warning Inserting or erasing an entry may move other entries, so a
+ * pointer returned by golle_map_find() or an iterator is only good
+ * until the map is next changed.
+ */
+
+/*!
+ * \struct golle_map_t
+ * \brief An opaque pointer to a hash map.
+ */
+typedef struct golle_map_t golle_map_t;
+
+/*!
+ * \struct golle_map_iterator_t
+ * \brief A type used for iterating through all the entries in a map.
+ * Initialise it with golle_map_iterator().
+ */
+typedef struct golle_map_iterator_t {
+  golle_map_t *map; /*!< The map. */
+  size_t next; /*!< The slot to look at next. */
+} golle_map_iterator_t;
+
+/*!
+ * \brief Hash a block of memory. The hash is not cryptographic.
+ * \param data The memory to hash.
+ * \param size The number of bytes to hash.
+ * \param seed A value to mix into the hash.
+ * \return The hash.
+ */
+GOLLE_EXTERN uint64_t golle_map_hash (const void *data,
+				      size_t size,
+				      uint64_t seed);
+
+/*!
+ * \brief Allocate a new map.
+ * \param[out] map Pointer which will hold the address of the map.
+ * \param size The size of each value, in bytes. If it is 0, the map
+ * holds keys only, and works as a set.
+ * \return ::GOLLE_OK if successful. ::GOLLE_EMEM if memory couldn't be
+ * allocated. ::GOLLE_ERROR if \p map is NULL. Otherwise, the error from
+ * drawing the map's random hash seed.
+ */
+GOLLE_EXTERN golle_error golle_map_new (golle_map_t **map, size_t size);
+
+/*!
+ * \brief Deallocate a map and all of its entries.
+ * \param map The map to be destroyed.
+ */
+GOLLE_EXTERN void golle_map_delete (golle_map_t *map);
+
+/*!
+ * \brief Get the number of entries in a map.
+ * \param map The map to test.
+ * \return The number of entries in the map. If \p map is NULL, returns 0.
+ */
+GOLLE_EXTERN size_t golle_map_size (const golle_map_t *map);
+
+/*!
+ * \brief Make room for a number of entries, so that inserting up to that
+ * many doesn't allocate slots.
+ * \param map The map.
+ * \param count The number of entries to make room for in total.
+ * \return ::GOLLE_OK, ::GOLLE_EMEM, or ::GOLLE_ERROR if \p map is NULL.
+ */
+GOLLE_EXTERN golle_error golle_map_reserve (golle_map_t *map, size_t count);
+
+/*!
+ * \brief Insert a copy of a key and its value into the map.
+ * \param map The map to insert into.
+ * \param key The key.
+ * \param size The size of the key.
+ * \param value The value, which is the size given to golle_map_new().
+ * If \p value is NULL, the value is zeroed.
+ * \return ::GOLLE_OK if the entry was inserted. ::GOLLE_EEXISTS if the
+ * key is already in the map. ::GOLLE_EMEM if memory couldn't be
+ * allocated. ::GOLLE_ERROR if \p map or \p key is NULL.
+ */
+GOLLE_EXTERN golle_error golle_map_insert (golle_map_t *map,
+					   const void *key,
+					   size_t size,
+					   const void *value);
+
+/*!
+ * \brief Find the value for a key.
+ * \param map The map to search.
+ * \param key The key.
+ * \param size The size of the key.
+ * \param[out] value Receives the address of the value in the map. May
+ * be NULL, to test whether the key is there.
+ * \return ::GOLLE_OK if the key was found. ::GOLLE_ENOTFOUND if it
+ * wasn't. ::GOLLE_ERROR if \p map or \p key is NULL.
+ */
+GOLLE_EXTERN golle_error golle_map_find (const golle_map_t *map,
+					 const void *key,
+					 size_t size,
+					 void **value);
+
+/*!
+ * \brief Erase a key and its value from the map.
+ * \param map The map to erase from.
+ * \param key The key.
+ * \param size The size of the key.
+ * \return ::GOLLE_OK if the entry was erased. ::GOLLE_ENOTFOUND if the
+ * key wasn't in the map. ::GOLLE_ERROR if \p map or \p key is NULL.
+ */
+GOLLE_EXTERN golle_error golle_map_erase (golle_map_t *map,
+					  const void *key,
+					  size_t size);
+
+/*!
+ * \brief Insert a number as a key. The key is the big-endian binary
+ * form of the number, as given by golle_num_to_bin().
+ * \param map The map to insert into.
+ * \param key The number.
+ * \param value The value, or NULL for a zeroed value.
+ * \return As for golle_map_insert().
+ */
+GOLLE_EXTERN golle_error golle_map_insert_num (golle_map_t *map,
+					       const golle_num_t key,
+					       const void *value);
+
+/*!
+ * \brief Find the value for a number.
+ * \param map The map to search.
+ * \param key The number.
+ * \param[out] value Receives the address of the value, or may be NULL.
+ * \return As for golle_map_find(). ::GOLLE_EMEM if the number couldn't
+ * be converted.
+ */
+GOLLE_EXTERN golle_error golle_map_find_num (golle_map_t *map,
+					     const golle_num_t key,
+					     void **value);
+
+/*!
+ * \brief Erase a number and its value from the map.
+ * \param map The map to erase from.
+ * \param key The number.
+ * \return As for golle_map_erase(). ::GOLLE_EMEM if the number couldn't
+ * be converted.
+ */
+GOLLE_EXTERN golle_error golle_map_erase_num (golle_map_t *map,
+					      const golle_num_t key);
+
+/*!
+ * \brief Remove all entries from a map. The slots are kept.
+ * \param map The map to clear.
+ * \return ::GOLLE_OK if the \p map was cleared. ::GOLLE_ERROR if \p map
+ * was NULL.
+ */
+GOLLE_EXTERN golle_error golle_map_clear (golle_map_t *map);
+
+/*!
+ * \brief Initialise an iterator to iterate over the given map. Entries
+ * come in no particular order.
+ *
+ * \param map The map to iterate over.
+ * \param[out] iter The iterator to initialise.
+ * \return ::GOLLE_OK if the iterator was initialised. ::GOLLE_ERROR if
+ * \p map or \p iter is NULL.
+ */
+GOLLE_EXTERN golle_error golle_map_iterator (golle_map_t *map,
+					     golle_map_iterator_t *iter);
+
+/*!
+ * \brief Get the next entry of the iterator.
+ * \param iter The iterator.
+ * \param[out] key Is populated with the key of the next entry.
+ * \param[out] value Is populated with the address of its value. May be
+ * NULL.
+ * \return ::GOLLE_OK if the operation was successful.
+ * ::GOLLE_ERROR if \p iter or \p key is NULL. ::GOLLE_END if the
+ * iterator is at the end of the map.
+ */
+GOLLE_EXTERN golle_error golle_map_iterator_next (golle_map_iterator_t *iter,
+						  const golle_bin_t **key,
+						  void **value);
+
+/*!
+ * \brief Set the iterator back to its initial state.
+ * \param iter The iterator to reset.
+ * \return ::GOLLE_OK if the operation was successful. ::GOLLE_ERROR if
+ * \p iter is NULL.
+ */
+GOLLE_EXTERN golle_error golle_map_iterator_reset (golle_map_iterator_t *iter);
+
+/*!
+ *@}
+ */
+
+GOLLE_END_C
+
+#endif
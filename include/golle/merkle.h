@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_MERKLE_H
+#define LIBGOLLE_MERKLE_H
+
+#include "platform.h"
+#include "errors.h"
+#include "bin.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/merkle.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief Commit to many values at once under a single hash.
+ */
+
+/*!
+ * \defgroup merkle Vector Commitment
+ * @{
+ * A vector commitment is a single commitment to a list of secrets,
+ * such as the ciphertexts of every card a peer will be dealt. It is
+ * built as a Merkle tree:
+ * - Each secret gets its own random value `r`, and its leaf is the
+ *   hash of (`r`, `secret`).
+ * - Each node above the leaves is the hash of its two children. A node
+ *   without a sibling moves up a level unchanged.
+ * - The root is the hash of the number of secrets and the top node.
+ *
+ * Only the root is broadcast, whatever the number of secrets. Later,
+ * one secret can be opened with a ::golle_merkle_proof_t, which holds
+ * the secret, its random value and the sibling hashes on the path to
+ * the root, so an opening costs a logarithmic number of hashes to send
+ * and check. Otherwise, all of the secrets can be opened at once by
+ * revealing every secret and random value (see
+ * golle_merkle_verify_all()).
+ *
+ * Leaves, nodes and the root are hashed with SHA-512 under different
+ * prefixes, so one can't be passed off as another.
+ */
+
+/*!
+ * \struct golle_merkle_t
+ * \brief A vector commitment held by the committing party.
+ */
+typedef struct golle_merkle_t golle_merkle_t;
+
+/*!
+ * \struct golle_merkle_proof_t
+ * \brief The opening of one secret in a vector commitment.
+ */
+typedef struct golle_merkle_proof_t {
+  size_t index; /*!< The position of the secret. */
+  size_t count; /*!< The number of secrets in the commitment. */
+  golle_bin_t secret; /*!< The secret. */
+  golle_bin_t random; /*!< The random value hashed with the secret. */
+  golle_bin_t path; /*!< The sibling hashes from the leaf upwards,
+		      one after another. Empty if there is one secret. */
+} golle_merkle_proof_t;
+
+/*!
+ * \brief Commit to a list of secrets.
+ * \param[out] tree Set to the new commitment. Free it with
+ * golle_merkle_delete().
+ * \param secrets An array of `count` secrets. Each is copied.
+ * \param count The number of secrets.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if `count` is 0 or any argument or
+ * secret is `NULL` or empty, ::GOLLE_EMEM if allocation failed, or
+ * ::GOLLE_ECRYPTO if hashing failed.
+ */
+GOLLE_EXTERN golle_error golle_merkle_new (golle_merkle_t **tree,
+					   const golle_bin_t *const *secrets,
+					   size_t count);
+
+/*!
+ * \brief Free a vector commitment.
+ * \param tree The commitment to free.
+ */
+GOLLE_EXTERN void golle_merkle_delete (golle_merkle_t *tree);
+
+/*!
+ * \brief Get the root hash, which is what gets broadcast.
+ * \param tree The commitment.
+ * \return The root, owned by `tree`, or `NULL` if `tree` is `NULL`.
+ */
+GOLLE_EXTERN const golle_bin_t *golle_merkle_root (const golle_merkle_t *tree);
+
+/*!
+ * \brief Get the number of secrets in a commitment.
+ * \param tree The commitment.
+ * \return The number of secrets, or 0 if `tree` is `NULL`.
+ */
+GOLLE_EXTERN size_t golle_merkle_count (const golle_merkle_t *tree);
+
+/*!
+ * \brief Get the random value of one secret, to open them all at once.
+ * \param tree The commitment.
+ * \param index The position of the secret.
+ * \return The random value, owned by `tree`, or `NULL` if `tree` is
+ * `NULL` or `index` is out of range.
+ */
+GOLLE_EXTERN const golle_bin_t *
+golle_merkle_random (const golle_merkle_t *tree, size_t index);
+
+/*!
+ * \brief Make the opening of one secret.
+ * \param tree The commitment.
+ * \param index The position of the secret to open.
+ * \param[out] proof Filled with the opening. Release it with
+ * golle_merkle_proof_clear().
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if an argument is `NULL`,
+ * ::GOLLE_EOUTOFRANGE if `index` is out of range, or ::GOLLE_EMEM.
+ */
+GOLLE_EXTERN golle_error golle_merkle_open (const golle_merkle_t *tree,
+					    size_t index,
+					    golle_merkle_proof_t *proof);
+
+/*!
+ * \brief Release the buffers of an opening.
+ * \param proof The opening to release.
+ */
+GOLLE_EXTERN void golle_merkle_proof_clear (golle_merkle_proof_t *proof);
+
+/*!
+ * \brief Check the opening of one secret against a root.
+ * \param root The root that was broadcast.
+ * \param proof The opening.
+ * \return ::GOLLE_COMMIT_PASSED if the secret was committed to at
+ * `proof->index`, ::GOLLE_COMMIT_FAILED if not or if the random value
+ * isn't the size golle_merkle_open() gives, ::GOLLE_ERROR if an
+ * argument is `NULL` or the path is the wrong length, or
+ * ::GOLLE_ECRYPTO if hashing failed.
+ */
+GOLLE_EXTERN golle_error golle_merkle_verify (const golle_bin_t *root,
+					      const golle_merkle_proof_t *proof);
+
+/*!
+ * \brief Check the opening of every secret at once.
+ * \param root The root that was broadcast.
+ * \param secrets An array of `count` secrets.
+ * \param randoms The random value of each secret.
+ * \param count The number of secrets.
+ * \return ::GOLLE_COMMIT_PASSED if exactly these secrets were committed
+ * to, in this order, ::GOLLE_COMMIT_FAILED if not or if a random value
+ * is the wrong size, ::GOLLE_ERROR if `count` is 0 or any argument is `NULL`, ::GOLLE_EMEM, or
+ * ::GOLLE_ECRYPTO.
+ */
+GOLLE_EXTERN golle_error
+golle_merkle_verify_all (const golle_bin_t *root,
+			 const golle_bin_t *const *secrets,
+			 const golle_bin_t *const *randoms,
+			 size_t count);
+
+/*!
+ * @}
+ */
+
+GOLLE_END_C
+
+#endif
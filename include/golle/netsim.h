@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_NETSIM_H
+#define LIBGOLLE_NETSIM_H
+
+#include "platform.h"
+#include "errors.h"
+#include "types.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/netsim.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief A simple model of network links, for simulating a real
+ * network under an in-process transport.
+ */
+
+/*!
+ * \defgroup netsim Network simulation
+ * @{
+ * A link delays each message by its serialisation time at the link's
+ * bandwidth, plus a fixed latency and a random jitter. A link only
+ * sends one message at a time, so a message queues behind the ones
+ * before it, and messages are always delivered in order.
+ *
+ * A transport that is built on the ::golle_t callbacks can keep one
+ * ::golle_link_t for each pair of peers. It asks golle_link_send() when
+ * a message will arrive, and the receiver waits until then with
+ * golle_netsim_wait(). The @ref loopback transport does this when
+ * golle_loopback_set_netsim() is called.
+ */
+
+/*!
+ * \struct golle_netsim_t
+ * \brief The parameters of a simulated link.
+ */
+typedef struct golle_netsim_t {
+  double latency; /*!< The one-way delay, in seconds. */
+  double jitter; /*!< The maximum extra delay, in seconds. The extra delay
+		   is uniformly distributed in `[0, jitter)`. */
+  double bandwidth; /*!< The capacity of the link, in bytes per second.
+		      Zero means unlimited. */
+  uintmax_t seed; /*!< Seed for the jitter, so that runs are repeatable. */
+} golle_netsim_t;
+
+/*!
+ * \struct golle_link_t
+ * \brief The state of one direction of a simulated link.
+ * \note A link is not thread-safe. Only the sending side should use it.
+ */
+typedef struct golle_link_t {
+  golle_netsim_t model; /*!< The link parameters. */
+  double busy_until; /*!< When the link finishes sending its last message. */
+  double last_delivery; /*!< When the last message will be delivered. */
+  uintmax_t state; /*!< The state of the jitter generator. */
+} golle_link_t;
+
+/*!
+ * \brief Set up a link.
+ * \param link The link to set up.
+ * \param model The link parameters.
+ * \param id A number that is different for each link, which is mixed
+ * into the seed so that links don't all have the same jitter.
+ * \return ::GOLLE_OK, or ::GOLLE_ERROR if an argument is `NULL` or any
+ * parameter of the model is negative.
+ */
+GOLLE_EXTERN golle_error golle_link_init (golle_link_t *link,
+					  const golle_netsim_t *model,
+					  uintmax_t id);
+
+/*!
+ * \brief Send a message over a link.
+ * \param link The link.
+ * \param now The time the message is sent, from golle_netsim_now().
+ * \param bytes The size of the message.
+ * \return The time at which the message is delivered.
+ */
+GOLLE_EXTERN double golle_link_send (golle_link_t *link,
+				     double now,
+				     size_t bytes);
+
+/*!
+ * \brief Get the current time.
+ * \return Seconds since an arbitrary point, from a monotonic clock.
+ */
+GOLLE_EXTERN double golle_netsim_now (void);
+
+/*!
+ * \brief Sleep until the given time.
+ * \param until A time from golle_netsim_now().
+ */
+GOLLE_EXTERN void golle_netsim_wait (double until);
+
+/*!
+ * @}
+ */
+
+GOLLE_END_C
+
+#endif
@@ -31,6 +31,26 @@ GOLLE_BEGIN_C
  *
  * Many functions here are simply wrappers around their OpenSSL analogues.
  * This is done for the same reason that we hide the `BIGNUM` type.
+ *
+ * The modular exponentiations, which are most of the library's time,
+ * are done by a backend chosen when the library is configured. The
+ * default is OpenSSL; `--with-bignum=gmp` uses GMP instead. Numbers are
+ * `BIGNUM`s either way, and golle_num_backend() tells which is in use.
+ *
+ * Moduli of 1024, 2048, 3072 and 4096 bits, the usual key sizes, also
+ * have Montgomery kernels of their own, with the size fixed at compile
+ * time. Where the CPU has AVX-512 IFMA, sizes that the IFMA kernels do
+ * faster than the backend skip it. golle_num_kernel() tells which
+ * kernel a size gets, and golle_num_set_kernel() changes it.
+ *
+ * Batches of exponents with one modulus, through golle_num_mod_exp_many()
+ * and the `_many` functions of the other modules, can also go to lane
+ * kernels, which do eight exponents at once, one to each lane of the
+ * vector registers.
+ *
+ * Single operations on a key, such as golle_eg_encrypt(), can instead
+ * be spread over the default pool for lower latency; see
+ * golle_num_set_split().
  */
 
 
@@ -193,6 +213,89 @@ GOLLE_EXTERN golle_error golle_num_mod_exp (golle_num_t out,
 					    const golle_num_t exp, 
 					    const golle_num_t mod);
 
+/*!
+ * \brief Calculate \f$m_i = g_i^{n_i} \mod q\f$ for a batch of
+ * exponents with the same modulus.
+ * \param out The \f$m_i\f$, each already allocated.
+ * \param base The \f$g_i\f$.
+ * \param exp The \f$n_i\f$.
+ * \param count The number of exponents.
+ * \param mod \f$q\f$
+ * \return ::GOLLE_ERROR if any argument is `NULL`.
+ * ::GOLLE_ECRYPTO if an operation fails.
+ * ::GOLLE_EMEM if resources run out.
+ * ::GOLLE_OK if successful.
+ * \note Where there is a lane kernel for the size of \f$q\f$ (see
+ * golle_num_lane_kernel()), the exponents are done several at a time,
+ * which takes less time per exponent than golle_num_mod_exp() but longer
+ * for the group as a whole.
+ */
+GOLLE_EXTERN golle_error golle_num_mod_exp_many (golle_num_t *out,
+						 const golle_num_t *base,
+						 const golle_num_t *exp,
+						 size_t count,
+						 const golle_num_t mod);
+
+/*!
+ * \brief Get the name of the backend doing modular exponentiation.
+ * \return `"openssl"` or `"gmp"`.
+ */
+GOLLE_EXTERN const char *golle_num_backend (void);
+
+/*!
+ * \brief Choose the kernels for moduli of the fixed sizes.
+ * \param name `"auto"` for the fastest the CPU supports at each size,
+ * which is the default; `"ifma"` or `"scalar"` for that kernel at every
+ * size; or `"none"` to send every exponent to the backend. `"ifma"`
+ * also turns on the lane kernels for batches, and `"scalar"` and
+ * `"none"` turn them off.
+ * \return ::GOLLE_ERROR if `name` is `NULL`. ::GOLLE_EINVALID if the
+ * kernel is unknown, or can't run here. ::GOLLE_OK otherwise.
+ * \note This isn't thread-safe. Call it before exponents are being done
+ * on other threads.
+ */
+GOLLE_EXTERN golle_error golle_num_set_kernel (const char *name);
+
+/*!
+ * \brief Get the name of the kernel doing modular exponentiation for a
+ * modulus of the given size.
+ * \param bits The size of the modulus.
+ * \return `"ifma"` or `"scalar"`, or `"none"` if the size goes to the
+ * backend.
+ */
+GOLLE_EXTERN const char *golle_num_kernel (int bits);
+
+/*!
+ * \brief Get the name of the kernel doing batches of modular
+ * exponentiations, several at a time, for a modulus of the given size.
+ * \param bits The size of the modulus.
+ * \return `"ifma-lanes"`, or `"none"` if batches at this size are done
+ * one exponent at a time.
+ */
+GOLLE_EXTERN const char *golle_num_lane_kernel (int bits);
+
+/*!
+ * \brief Split single operations across the default pool.
+ * \param ways The most workers to use for one operation, or 0 or 1 to
+ * do each operation on the calling thread, which is the default.
+ * \note When it is on, the exponents of golle_eg_encrypt(),
+ * golle_eg_reencrypt(), golle_schnorr_commit() and
+ * golle_schnorr_verify() run at once on the pool (see
+ * golle_pool_set_default()), and each exponent is cut into pieces that
+ * also run at once. A piece raises a power of the key's base that is
+ * worked out on first use and then kept, so the first operation with a
+ * key takes longer. This costs a little more work in all, for less
+ * time from call to return. It isn't thread-safe: call it before
+ * operations are being done.
+ */
+GOLLE_EXTERN void golle_num_set_split (size_t ways);
+
+/*!
+ * \brief Get the number of ways single operations are split.
+ * \return The value given to golle_num_set_split(), or 1 if it is off.
+ */
+GOLLE_EXTERN size_t golle_num_split (void);
+
 /*!
  * \brief Print a number, in big-endian hexadecimal, to the given file pointer.
  * \param file The file pointer to print to.
@@ -214,6 +317,61 @@ GOLLE_EXTERN golle_error golle_num_xor (golle_num_t out,
 					const golle_num_t x1,
 					const golle_num_t x2);
 
+/*!
+ * \brief The number of operand-size buckets kept for each counted operation.
+ * Bucket 0 holds operations on operands of at most 64 bits, and each
+ * following bucket doubles the limit (128, 256, ..., 4096 bits). The last
+ * bucket holds everything larger than 4096 bits.
+ */
+#define GOLLE_NUM_STATS_BUCKETS 8
+
+/*!
+ * \brief The big-number operations that are counted by the library.
+ */
+typedef enum golle_num_op {
+  GOLLE_NUM_OP_MOD_EXP = 0, /*!< Modular exponentiation. */
+  GOLLE_NUM_OP_MOD_MUL, /*!< Modular multiplication. */
+  GOLLE_NUM_OP_MOD_INVERSE, /*!< Modular inversion. */
+  GOLLE_NUM_OP_RAND, /*!< Random number draws. */
+  GOLLE_NUM_OP_PRIME, /*!< Prime tests and prime generation. */
+
+  GOLLE_NUM_OP_COUNT /*!< The number of counted operations. */
+} golle_num_op;
+
+/*!
+ * \struct golle_num_stats_t
+ * \brief A snapshot of the big-number operation counters.
+ */
+typedef struct golle_num_stats_t {
+  /*! The number of times each operation was performed, bucketed by
+   * the size of the operand (the modulus, or the range of a random
+   * draw). See ::GOLLE_NUM_STATS_BUCKETS. */
+  uintmax_t count[GOLLE_NUM_OP_COUNT][GOLLE_NUM_STATS_BUCKETS];
+} golle_num_stats_t;
+
+/*!
+ * \brief Get the bucket that an operand of the given size is counted in.
+ * \param bits The size of the operand, in bits.
+ * \return An index less than ::GOLLE_NUM_STATS_BUCKETS.
+ */
+GOLLE_EXTERN size_t golle_num_stats_bucket (int bits);
+
+/*!
+ * \brief Take a snapshot of the operation counters.
+ * \param[out] stats Receives the totals for all threads since the last
+ * call to golle_num_stats_reset().
+ * \return ::GOLLE_OK, or ::GOLLE_ERROR if `stats` is `NULL`.
+ * \note The counters are always on. They are kept per-thread and summed
+ * here, so the snapshot may miss operations that are in flight on other
+ * threads.
+ */
+GOLLE_EXTERN golle_error golle_num_stats_get (golle_num_stats_t *stats);
+
+/*!
+ * \brief Set all of the operation counters back to zero.
+ */
+GOLLE_EXTERN void golle_num_stats_reset (void);
+
 /*!
  * @}
  */
@@ -55,6 +55,26 @@
 #define GOLLE_INLINE static inline
 #endif
 
+#if GOLLE_MSC
+#define GOLLE_THREAD_LOCAL __declspec(thread)
+#elif GOLLE_GNUC
+#define GOLLE_THREAD_LOCAL __thread
+#else
+/*!
+ * Platform-specific storage class for thread-local variables.
+ */
+#define GOLLE_THREAD_LOCAL
+#endif
+
+#if GOLLE_GNUC
+#define GOLLE_CACHE_ALIGNED __attribute__((aligned(64)))
+#else
+/*!
+ * Align a type or variable to a cache line, to avoid false sharing.
+ */
+#define GOLLE_CACHE_ALIGNED
+#endif
+
 #ifdef __cplusplus
 #define GOLLE_BEGIN_C extern "C" {
 #define GOLLE_END_C  }
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_POOL_H
+#define LIBGOLLE_POOL_H
+
+#include "platform.h"
+#include "errors.h"
+#include "types.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/pool.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief Describes a pool of threads for running loops in parallel.
+ */
+/*!
+ * \defgroup pool Thread pools
+ * @{
+ * A pool owns a fixed number of worker threads, which sleep until a
+ * loop is handed to them with golle_pool_parallel_for(). The loop is
+ * cut into chunks, and the chunks are dealt out evenly to the workers
+ * and to the calling thread, which works too. A thread that runs out
+ * of chunks steals half of what another has left, so the load evens
+ * out when some items take longer than others.
+ *
+ * The batch functions of the library, such as golle_eg_encrypt_many(),
+ * run on the process's default pool, which is set with
+ * golle_pool_set_default(). There is none until one is set, and
+ * without one, batches run on the calling thread.
+ *
+ * A pool runs one loop at a time. If a loop is started while the pool
+ * is busy, including from inside a loop on the same pool, it runs on
+ * the calling thread instead of waiting.
+ */
+
+/*!
+ * \struct golle_pool_t
+ * \brief An opaque pointer to a thread pool.
+ */
+typedef struct golle_pool_t golle_pool_t;
+
+/*!
+ * \brief The body of a parallel loop.
+ * \param arg The argument given to golle_pool_parallel_for().
+ * \param begin The first index to work on.
+ * \param end One past the last index to work on.
+ * \return ::GOLLE_OK to carry on. Anything else stops the loop, and
+ * is returned by golle_pool_parallel_for().
+ */
+typedef golle_error (*golle_pool_fn_t) (void *arg, size_t begin, size_t end);
+
+/*!
+ * \brief Start a pool of threads.
+ * \param[out] pool Receives the new pool.
+ * \param workers The number of threads that work on a loop, counting
+ * the one that starts it, so `workers - 1` threads are made. If it is
+ * 0, one worker is used for each online processor.
+ * \return ::GOLLE_OK if successful. ::GOLLE_EMEM if memory or threads
+ * couldn't be allocated. ::GOLLE_ERROR if \p pool is NULL.
+ */
+GOLLE_EXTERN golle_error golle_pool_new (golle_pool_t **pool, size_t workers);
+
+/*!
+ * \brief Stop the threads and free a pool. If it is the default pool,
+ * there is no default afterwards.
+ * \param pool The pool. It must not be running a loop.
+ */
+GOLLE_EXTERN void golle_pool_delete (golle_pool_t *pool);
+
+/*!
+ * \brief Get the number of threads that work on a loop.
+ * \param pool The pool.
+ * \return The number of workers, counting the calling thread. If
+ * \p pool is NULL, returns 1.
+ */
+GOLLE_EXTERN size_t golle_pool_workers (const golle_pool_t *pool);
+
+/*!
+ * \brief Set the pool used by the batch functions of the library.
+ * \param pool The pool, or NULL to run batches on the calling thread.
+ */
+GOLLE_EXTERN void golle_pool_set_default (golle_pool_t *pool);
+
+/*!
+ * \brief Get the pool used by the batch functions of the library.
+ * \return The default pool, or NULL if there isn't one.
+ */
+GOLLE_EXTERN golle_pool_t *golle_pool_get_default (void);
+
+/*!
+ * \brief Call a function over the indices `[0, count)`, in parallel.
+ * \param pool The pool to use. If NULL, the default pool is used, and
+ * if there is no default, the loop runs on the calling thread.
+ * \param count The number of indices.
+ * \param grain The number of indices in each chunk. If 0, a size is
+ * chosen that gives each worker a few chunks.
+ * \param fn The body of the loop. It is called once for each chunk,
+ * from any of the workers, so it must be safe to call concurrently.
+ * \param arg An argument to pass to \p fn.
+ * \return ::GOLLE_OK if every call of \p fn returned ::GOLLE_OK.
+ * Otherwise, the value returned for the earliest chunk that failed,
+ * as a loop on one thread would give. Chunks after a failed one are
+ * skipped if they haven't started. ::GOLLE_ERROR if \p fn is NULL.
+ */
+GOLLE_EXTERN golle_error golle_pool_parallel_for (golle_pool_t *pool,
+						  size_t count,
+						  size_t grain,
+						  golle_pool_fn_t fn,
+						  void *arg);
+
+/*!
+ *@}
+ */
+
+GOLLE_END_C
+
+#endif
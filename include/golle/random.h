@@ -28,7 +28,39 @@
  *
  * A well-behaved application will call golle_random_clear()
  * before exiting.
+ *
+ * All of the library's random data and random numbers come from the
+ * current random source. The default source is a buffered AES-CTR
+ * generator private to each thread, which is seeded from OpenSSL's
+ * generator and so avoids its locking on every call.
+ *
+ * For tests and benchmarks, a library configured with
+ * `--enable-test-random` lets golle_random_set_source() replace it,
+ * and golle_random_seed_deterministic() replace it with a generator
+ * whose output depends only on a seed, so that a run can be repeated
+ * exactly. This includes the primes of a new key. OpenSSL's own
+ * generator is never replaced, so other users of OpenSSL in the same
+ * process are not affected.
+ */
+
+/*!
+ * \brief A function that fills a buffer with random bytes.
+ * \param state The `state` member of the ::golle_random_source_t.
+ * \param buffer The buffer to fill.
+ * \param size The number of bytes to write.
+ * \return ::GOLLE_OK, or an error code.
+ */
+typedef golle_error (*golle_random_fn) (void *state,
+					 void *buffer,
+					 size_t size);
+
+/*!
+ * \brief A source of random bytes.
  */
+typedef struct golle_random_source_t {
+  golle_random_fn generate; /*!< Produces the random bytes. */
+  void *state; /*!< Passed to `generate`. */
+} golle_random_source_t;
 
 /*!
  * \brief Seed the system's random generator.
@@ -44,9 +76,39 @@ GOLLE_EXTERN golle_error golle_random_seed (void);
  */
 GOLLE_EXTERN golle_error golle_random_generate (golle_bin_t *buffer);
 
+/*!
+ * \brief Replace the random source.
+ * \param source The new source, which is copied. The `state` must stay
+ * valid until the source is replaced again. If `NULL`, the default
+ * source is restored.
+ * \return ::GOLLE_OK, or ::GOLLE_ERROR if `source` has no `generate`
+ * function. ::GOLLE_EINVALID if the library wasn't configured with
+ * `--enable-test-random`.
+ * \warning This is not thread-safe. Change the source only while no
+ * other thread is using the library.
+ */
+GOLLE_EXTERN golle_error
+golle_random_set_source (const golle_random_source_t *source);
+
+/*!
+ * \brief Use a deterministic generator as the random source.
+ * The same seed always produces the same sequence of random data.
+ * \param seed The seed.
+ * \param size The size of the seed in bytes.
+ * \return ::GOLLE_OK, ::GOLLE_ERROR if `seed` is `NULL`, or
+ * ::GOLLE_EMEM if the generator couldn't be created. ::GOLLE_EINVALID
+ * if the library wasn't configured with `--enable-test-random`.
+ * \warning The output is predictable by anyone who knows the seed.
+ * Use this for testing, benchmarking and replaying runs only.
+ * \warning This is not thread-safe, as for golle_random_set_source().
+ */
+GOLLE_EXTERN golle_error golle_random_seed_deterministic (const void *seed,
+							  size_t size);
+
 /*!
  * \brief Safely destroy the random state. This function
- * should be called before application exit.
+ * should be called before application exit. It also restores
+ * the default random source.
  * \return Always returns GOLLE_OK.
  */
 GOLLE_EXTERN golle_error golle_random_clear (void);
@@ -93,6 +93,25 @@ GOLLE_EXTERN golle_error golle_schnorr_verify (const golle_schnorr_t *key,
 					       const golle_num_t s,
 					       const golle_num_t t,
 					       const golle_num_t c);
+/*!
+ * \brief Verify many proofs against one key, on the default pool (see
+ * @ref pool).
+ * \param key A key containing g, h, and q.
+ * \param s An array of `count` values of \f$s\f$.
+ * \param t An array of `count` values of \f$t\f$.
+ * \param c An array of `count` values of \f$c\f$.
+ * \param count The number of proofs.
+ * \param[out] failed If not `NULL`, and a proof fails or can't be
+ * checked, this is set to the index of the first one that did.
+ * \return ::GOLLE_OK if every proof was verified. Otherwise, as for
+ * golle_schnorr_verify().
+ */
+GOLLE_EXTERN golle_error golle_schnorr_verify_many (const golle_schnorr_t *key,
+						    const golle_num_t *s,
+						    const golle_num_t *t,
+						    const golle_num_t *c,
+						    size_t count,
+						    size_t *failed);
 /*!
  * @}
  */
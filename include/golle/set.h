@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_SET_H
+#define LIBGOLLE_SET_H
+
+#include "platform.h"
+#include "errors.h"
+#include "types.h"
+#include "bin.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/set.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief Describes the structures and operations for working with
+ * ordered sets.
+ */
+/*!
+ * \defgroup set Ordered sets
+ * @{
+ * A set holds unique items in the order given by a comparison
+ * function. Items are copied into the set as ::golle_bin_t buffers.
+ *
+ * The set is a B-tree. Each node holds many items side by side, and
+ * items small enough to fit inside a ::golle_bin_t need no allocation
+ * of their own, so a lookup touches few cache lines. Inserting, finding
+ * and erasing an item each take O(log n) time.
+ *
+ * \warning Inserting or erasing an item may move other items, so a
+ * pointer returned by golle_set_find() or an iterator is only good
+ * until the set is next changed.
+ */
+
+/*!
+ * \struct golle_set_t
+ * \brief An opaque pointer to an ordered set.
+ */
+typedef struct golle_set_t golle_set_t;
+
+/*!
+ * \struct golle_set_iterator_t
+ * \brief A type used for iterating through the items of a set, in order.
+ */
+typedef struct golle_set_iterator_t golle_set_iterator_t;
+
+/*!
+ * \brief Compares two items.
+ * \param l The left-hand item.
+ * \param r The right-hand item.
+ * \return Less than 0 if `l` comes before `r`, 0 if they are the same
+ * item, or greater than 0 if `l` comes after `r`.
+ */
+typedef int (*golle_set_comp_t) (const golle_bin_t *l, const golle_bin_t *r);
+
+/*!
+ * \brief Allocate a new set.
+ * \param[out] set Pointer which will hold the address of the set.
+ * \param comp The function that orders the items.
+ * \return ::GOLLE_OK if successful. ::GOLLE_EMEM if memory couldn't be
+ * allocated. ::GOLLE_ERROR if \p set or \p comp is NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_new (golle_set_t **set,
+					golle_set_comp_t comp);
+
+/*!
+ * \brief Deallocate a set and all of its items.
+ * \param set The set to be destroyed.
+ */
+GOLLE_EXTERN void golle_set_delete (golle_set_t *set);
+
+/*!
+ * \brief Get the number of items in a set.
+ * \param set The set to test.
+ * \return The number of items in the set. If \p set is NULL, returns 0.
+ */
+GOLLE_EXTERN size_t golle_set_size (const golle_set_t *set);
+
+/*!
+ * \brief Insert a copy of an item into the set.
+ * \param set The set to insert into.
+ * \param item The item.
+ * \param size The size of the item.
+ * \return ::GOLLE_OK if the item was inserted. ::GOLLE_EEXISTS if an
+ * equal item is already in the set. ::GOLLE_EMEM if memory couldn't
+ * be allocated. ::GOLLE_ERROR if \p set or \p item is NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_insert (golle_set_t *set,
+					   const void *item,
+					   size_t size);
+
+/*!
+ * \brief Erase an item from the set.
+ * \param set The set to erase from.
+ * \param item An item equal to the one to erase.
+ * \param size The size of the item.
+ * \return ::GOLLE_OK if the item was erased. ::GOLLE_ENOTFOUND if it
+ * wasn't in the set. ::GOLLE_ERROR if \p set or \p item is NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_erase (golle_set_t *set,
+					  const void *item,
+					  size_t size);
+
+/*!
+ * \brief Find an item in the set.
+ * \param set The set to search.
+ * \param item An item equal to the one to find.
+ * \param size The size of the item.
+ * \param[out] found Receives the item in the set.
+ * \return ::GOLLE_OK if the item was found. ::GOLLE_ENOTFOUND if it
+ * wasn't in the set. ::GOLLE_ERROR if any pointer is NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_find (const golle_set_t *set,
+					 const void *item,
+					 size_t size,
+					 const golle_bin_t **found);
+
+/*!
+ * \brief Remove all items from a set.
+ * \param set The set to clear.
+ * \return ::GOLLE_OK if the \p set was cleared. ::GOLLE_ERROR if \p set
+ * was NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_clear (golle_set_t *set);
+
+/*!
+ * \brief Check that the tree behind a set is well formed. Meant for
+ * testing.
+ * \param set The set to check.
+ * \return ::GOLLE_OK if it is. ::GOLLE_EINVALID if it isn't.
+ * ::GOLLE_ERROR if \p set is NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_check (const golle_set_t *set);
+
+/*!
+ * \brief Create an iterator to iterate over the given set in order. The
+ * iterator begins by pointing to before the first item.
+ *
+ * \param set The set to iterate over.
+ * \param[out] iter Receives the address of the new iterator.
+ * \return ::GOLLE_OK if the iterator was created. ::GOLLE_EMEM if the
+ * iterator couldn't be allocated. ::GOLLE_ERROR if \p set or \p iter is
+ * NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_iterator (golle_set_t *set,
+					     golle_set_iterator_t **iter);
+
+/*!
+ * \brief Free any resources associated with an iterator.
+ * \param iter The iterator to free.
+ */
+GOLLE_EXTERN void golle_set_iterator_free (golle_set_iterator_t *iter);
+
+/*!
+ * \brief Get the next item of the iterator.
+ * \param iter The iterator.
+ * \param[out] item Is populated with the next item in the set.
+ * \return ::GOLLE_OK if the operation was successful.
+ * ::GOLLE_ERROR if \p iter or \p item is NULL. ::GOLLE_END if the
+ * iterator is at the end of the set.
+ */
+GOLLE_EXTERN golle_error golle_set_iterator_next (golle_set_iterator_t *iter,
+						  const golle_bin_t **item);
+
+/*!
+ * \brief Set the iterator back to its initial state.
+ * \param iter The iterator to reset.
+ * \return ::GOLLE_OK if the operation was successful. ::GOLLE_ERROR if
+ * \p iter is NULL.
+ */
+GOLLE_EXTERN golle_error golle_set_iterator_reset (golle_set_iterator_t *iter);
+
+/*!
+ *@}
+ */
+
+GOLLE_END_C
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#ifndef LIBGOLLE_VECTOR_H
+#define LIBGOLLE_VECTOR_H
+
+#include "platform.h"
+#include "errors.h"
+#include "types.h"
+
+GOLLE_BEGIN_C
+
+/*!
+ * \file golle/vector.h
+ * \author Anthony Arnold
+ * \copyright MIT License
+ * \date 2014
+ * \brief Describes the structures and operations for working with
+ * vectors.
+ */
+/*!
+ * \defgroup vector Vectors
+ * @{
+ * A vector holds items of one size back to back in a single block,
+ * which grows as items are pushed. Compared with a ::golle_list_t,
+ * pushing an item doesn't allocate unless the block is full, iterating
+ * walks memory in order, and iterators live on the stack.
+ *
+ * Items are erased by moving the last item into their place, which
+ * takes constant time but doesn't keep the order of the items.
+ *
+ * \warning Pushing an item may move every item, so pointers into the
+ * vector are only good until the next push.
+ */
+
+/*!
+ * \struct golle_vector_t
+ * \brief An opaque pointer to a vector.
+ */
+typedef struct golle_vector_t golle_vector_t;
+
+/*!
+ * \struct golle_vector_iterator_t
+ * \brief A type used for iterating through all the items in a vector.
+ * Initialise it with golle_vector_iterator().
+ */
+typedef struct golle_vector_iterator_t {
+  golle_vector_t *vector; /*!< The vector. */
+  size_t next; /*!< The index of the next item. */
+} golle_vector_iterator_t;
+
+/*!
+ * \brief Allocate a new vector.
+ * \param[out] vector Pointer which will hold the address of the vector.
+ * \param size The size of each item, in bytes.
+ * \return ::GOLLE_OK if successful. ::GOLLE_EMEM if memory couldn't be
+ * allocated. ::GOLLE_ERROR if \p vector is NULL or \p size is 0.
+ */
+GOLLE_EXTERN golle_error golle_vector_new (golle_vector_t **vector,
+					   size_t size);
+
+/*!
+ * \brief Deallocate a vector.
+ * \param vector The vector to be destroyed.
+ */
+GOLLE_EXTERN void golle_vector_delete (golle_vector_t *vector);
+
+/*!
+ * \brief Get the number of items in a vector.
+ * \param vector The vector to test.
+ * \return The number of items in the vector. If \p vector is NULL,
+ * returns 0.
+ */
+GOLLE_EXTERN size_t golle_vector_size (const golle_vector_t *vector);
+
+/*!
+ * \brief Make room for a number of items, so that pushing up to that
+ * many doesn't allocate.
+ * \param vector The vector.
+ * \param count The number of items to make room for in total.
+ * \return ::GOLLE_OK, ::GOLLE_EMEM, or ::GOLLE_ERROR if \p vector is
+ * NULL.
+ */
+GOLLE_EXTERN golle_error golle_vector_reserve (golle_vector_t *vector,
+					       size_t count);
+
+/*!
+ * \brief Get the item at an index.
+ * \param vector The vector.
+ * \param index The index of the item.
+ * \return The address of the item, or NULL if \p vector is NULL or
+ * \p index is out of range.
+ */
+GOLLE_EXTERN void *golle_vector_at (const golle_vector_t *vector,
+				    size_t index);
+
+/*!
+ * \brief Append an item to the vector.
+ * The item will be copied.
+ *
+ * \param vector The vector to append to.
+ * \param item The item to append, which is the size given to
+ * golle_vector_new(). If \p item is NULL, the new item is zeroed.
+ * \return ::GOLLE_OK if the item was appended.
+ * ::GOLLE_EMEM if memory couldn't be
+ * allocated, or ::GOLLE_ERROR if \p vector is NULL.
+ */
+GOLLE_EXTERN golle_error golle_vector_push (golle_vector_t *vector,
+					    const void *item);
+
+/*!
+ * \brief Append many identical items to the vector.
+ * \param vector The vector to append to.
+ * \param item The item to append. If \p item is NULL, the new items are
+ * zeroed.
+ * \param count The number of new items to append.
+ * \return ::GOLLE_OK if the items were appended.
+ * ::GOLLE_EMEM if memory couldn't be
+ * allocated, or ::GOLLE_ERROR if \p vector is NULL.
+ */
+GOLLE_EXTERN golle_error golle_vector_push_many (golle_vector_t *vector,
+						 const void *item,
+						 size_t count);
+
+/*!
+ * \brief Erase the item at an index by moving the last item into its
+ * place.
+ * \param vector The vector.
+ * \param index The index of the item to erase.
+ * \return ::GOLLE_OK if the item was erased. ::GOLLE_ENOTFOUND if
+ * \p index is out of range. ::GOLLE_ERROR if \p vector is NULL.
+ */
+GOLLE_EXTERN golle_error golle_vector_swap_erase (golle_vector_t *vector,
+						  size_t index);
+
+/*!
+ * \brief Remove all items from a vector. The memory is kept.
+ * \param vector The vector to clear.
+ * \return ::GOLLE_OK if the \p vector was cleared. ::GOLLE_ERROR if
+ * \p vector was NULL.
+ */
+GOLLE_EXTERN golle_error golle_vector_pop_all (golle_vector_t *vector);
+
+/*!
+ * \brief Initialise an iterator to iterate over the given vector. The
+ * iterator begins by pointing to before the first item in the vector.
+ *
+ * \param vector The vector to iterate over.
+ * \param[out] iter The iterator to initialise.
+ * \return ::GOLLE_OK if the iterator was initialised. ::GOLLE_ERROR if
+ * \p vector or \p iter is NULL.
+ */
+GOLLE_EXTERN golle_error golle_vector_iterator (golle_vector_t *vector,
+						golle_vector_iterator_t *iter);
+
+/*!
+ * \brief Get the next value of the iterator.
+ * \param iter The iterator.
+ * \param[out] item Is populated with the next item pointed to by the
+ * iterator.
+ * \return ::GOLLE_OK if the operation was successful.
+ * ::GOLLE_ERROR if \p iter or
+ *  \p item is NULL. ::GOLLE_END if the iterator is at the end of the
+ *  vector.
+ *
+ * \warning The returned pointer is the address of the item in the
+ *  vector. Be wary.
+ */
+GOLLE_EXTERN golle_error
+golle_vector_iterator_next (golle_vector_iterator_t *iter, void **item);
+
+/*!
+ * \brief Set the iterator back to its initial state.
+ * \param iter The iterator to reset.
+ * \return ::GOLLE_OK if the operation was successful. ::GOLLE_ERROR if
+ * \p iter is NULL.
+ */
+GOLLE_EXTERN golle_error
+golle_vector_iterator_reset (golle_vector_iterator_t *iter);
+
+/*!
+ * \brief Erase the item that the iterator last returned, with
+ * golle_vector_swap_erase(). The next call to
+ * golle_vector_iterator_next() returns the item that was moved into
+ * its place, so every item is still visited once.
+ *
+ * \param iter The location to remove an item from.
+ *
+ * \return ::GOLLE_OK if the operation was successful.
+ * ::GOLLE_ENOTFOUND if the iterator is not pointing to an item (it is
+ * at the very start or very end of the vector). ::GOLLE_ERROR if
+ * \p iter is NULL.
+ */
+GOLLE_EXTERN golle_error golle_vector_erase_at (golle_vector_iterator_t *iter);
+
+/*!
+ *@}
+ */
+
+GOLLE_END_C
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_ATOMIC_H
+#define GOLLE_SRC_ATOMIC_H
+
+#include <golle/platform.h>
+
+/*
+ * Atomic operations on machine words. The relaxed forms are
+ * for counters and other bookkeeping where ordering doesn't matter.
+ * The acquire and release forms order the surrounding memory accesses,
+ * for handing data from one thread to another.
+ * Without compiler support they degrade to plain accesses, which is
+ * only correct for single-threaded use.
+ */
+#if GOLLE_GNUC
+#define GOLLE_ATOMIC_ADD(p,v) __atomic_fetch_add ((p), (v), __ATOMIC_RELAXED)
+#define GOLLE_ATOMIC_LOAD(p) __atomic_load_n ((p), __ATOMIC_RELAXED)
+#define GOLLE_ATOMIC_STORE(p,v) __atomic_store_n ((p), (v), __ATOMIC_RELAXED)
+#define GOLLE_ATOMIC_SUB_ACQ_REL(p,v) \
+  __atomic_fetch_sub ((p), (v), __ATOMIC_ACQ_REL)
+#define GOLLE_ATOMIC_LOAD_ACQUIRE(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define GOLLE_ATOMIC_STORE_RELEASE(p,v) \
+  __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+#else
+#define GOLLE_ATOMIC_ADD(p,v) ((*(p) += (v)) - (v))
+#define GOLLE_ATOMIC_LOAD(p) (*(p))
+#define GOLLE_ATOMIC_STORE(p,v) (*(p) = (v))
+#define GOLLE_ATOMIC_SUB_ACQ_REL(p,v) ((*(p) -= (v)) + (v))
+#define GOLLE_ATOMIC_LOAD_ACQUIRE(p) (*(p))
+#define GOLLE_ATOMIC_STORE_RELEASE(p,v) (*(p) = (v))
+#endif
+
+#endif
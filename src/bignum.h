@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_BIGNUM_H
+#define GOLLE_SRC_BIGNUM_H
+
+#include <golle/platform.h>
+#include <openssl/bn.h>
+
+/*
+ * The arithmetic backend, chosen by configure with --with-bignum.
+ * Numbers are always OpenSSL BIGNUMs; a backend only decides how the
+ * expensive operations on them are done. bignum_openssl.c and
+ * bignum_gmp.c each define these, and golle_num_backend().
+ */
+
+/* r = a^e mod m, with the same results and return value as
+ * BN_mod_exp(). */
+GOLLE_EXTERN int golle_bignum_mod_exp (BIGNUM *r,
+				       const BIGNUM *a,
+				       const BIGNUM *e,
+				       const BIGNUM *m,
+				       BN_CTX *ctx);
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/numbers.h>
+#include "bignum.h"
+#include <openssl/crypto.h>
+#include <gmp.h>
+#include <stdlib.h>
+
+/*
+ * Converting between BIGNUM and mpz_t goes through big-endian bytes.
+ * That is linear in the size of the numbers, against the cubic cost
+ * of the exponent, so it doesn't show beyond a few hundred bits.
+ */
+
+/* Set z to n, using buf, which holds at least BN_num_bytes (n). */
+static void to_mpz (mpz_t z, const BIGNUM *n, unsigned char *buf) {
+  size_t size = BN_num_bytes (n);
+  BN_bn2bin (n, buf);
+  mpz_import (z, size, 1, 1, 1, 0, buf);
+  if (BN_is_negative (n)) {
+    mpz_neg (z, z);
+  }
+}
+
+/* Set n to z, which is not negative, using buf, which holds at least
+ * as many bytes as z. */
+static int from_mpz (BIGNUM *n, const mpz_t z, unsigned char *buf) {
+  size_t size = 0;
+  mpz_export (buf, &size, 1, 1, 1, 0, z);
+  return BN_bin2bn (buf, (int)size, n) != NULL;
+}
+
+/* Overwrite the limbs of z before it's freed. GMP doesn't wipe. */
+static void wipe_mpz (mpz_t z) {
+  size_t limbs = mpz_size (z);
+  if (limbs) {
+    OPENSSL_cleanse (mpz_limbs_modify (z, limbs),
+		     limbs * sizeof (mp_limb_t));
+  }
+  mpz_clear (z);
+}
+
+const char *golle_num_backend (void) {
+  return "gmp";
+}
+
+int golle_bignum_mod_exp (BIGNUM *r,
+			  const BIGNUM *a,
+			  const BIGNUM *e,
+			  const BIGNUM *m,
+			  BN_CTX *ctx)
+{
+  /* GMP would divide by zero, and doesn't do negative exponents
+   * without an inverse. Leave the odd cases to OpenSSL. */
+  if (BN_is_zero (m) || BN_is_negative (e)) {
+    return BN_mod_exp (r, a, e, m, ctx);
+  }
+
+  size_t size = BN_num_bytes (a);
+  if ((size_t)BN_num_bytes (e) > size) {
+    size = BN_num_bytes (e);
+  }
+  if ((size_t)BN_num_bytes (m) > size) {
+    size = BN_num_bytes (m);
+  }
+  unsigned char *buf = malloc (size + 1);
+  if (!buf) {
+    return 0;
+  }
+
+  mpz_t za, ze, zm;
+  mpz_inits (za, ze, zm, NULL);
+  to_mpz (za, a, buf);
+  to_mpz (ze, e, buf);
+  to_mpz (zm, m, buf);
+
+  /* Exponents are often secret, so use the constant-time ladder
+   * wherever it works: a positive exponent and an odd modulus. That's
+   * every modulus in a key. */
+  if (mpz_odd_p (zm) && mpz_sgn (ze) > 0) {
+    mpz_powm_sec (za, za, ze, zm);
+  }
+  else {
+    mpz_powm (za, za, ze, zm);
+  }
+  int rc = from_mpz (r, za, buf);
+
+  OPENSSL_cleanse (buf, size + 1);
+  free (buf);
+  wipe_mpz (za);
+  wipe_mpz (ze);
+  mpz_clear (zm);
+  return rc;
+}
@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/numbers.h>
+#include "bignum.h"
+
+const char *golle_num_backend (void) {
+  return "openssl";
+}
+
+int golle_bignum_mod_exp (BIGNUM *r,
+			  const BIGNUM *a,
+			  const BIGNUM *e,
+			  const BIGNUM *m,
+			  BN_CTX *ctx)
+{
+  return BN_mod_exp (r, a, e, m, ctx);
+}
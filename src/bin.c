@@ -6,6 +6,15 @@
 #if HAVE_STRING_H
 #include <string.h>
 #endif
+#include "bin.h"
+#include "secure.h"
+
+enum {
+  /* Default size of an arena block */
+  ARENA_BLOCK = 4096,
+  /* Alignment of memory carved from an arena */
+  ARENA_ALIGN = 2 * sizeof (void *)
+};
 
 /* Safely clear a buffer's memory */
 #define CLEAR_BUFF(b) \
@@ -15,12 +24,98 @@
  * if allocated with golle_bin_new() */
 #define BIN_LOCAL(b) (((char *)b) + sizeof (golle_bin_t))
 
+/* True if the bin member was malloc'd on its own. */
+#define BIN_OWNED(b) \
+  ((b)->bin && !(b)->arena &&				\
+   (b)->bin != (b)->small && (b)->bin != BIN_LOCAL (b))
+
+/* A block of arena memory. */
+typedef struct arena_block_t {
+  struct arena_block_t *next;
+  size_t size;
+  size_t used;
+  unsigned char data[];
+} arena_block_t;
+
+struct golle_bin_arena_t {
+  size_t block;
+  /* Blocks are locked pages rather than heap memory. */
+  int secure;
+  arena_block_t *head;
+  /* The block being carved from. Earlier blocks are full. */
+  arena_block_t *current;
+};
+
+/* Free a block of an arena. */
+static void arena_block_free (golle_bin_arena_t *arena, arena_block_t *b) {
+  if (arena->secure) {
+    golle_secure_unmap (b, sizeof (*b) + b->size);
+  }
+  else {
+    memset (b->data, 0, b->used);
+    free (b);
+  }
+}
+
+void *golle_bin_arena_carve (golle_bin_arena_t *arena, size_t size) {
+  GOLLE_ASSERT (arena, NULL);
+  GOLLE_ASSERT (size <= SIZE_MAX - ARENA_ALIGN, NULL);
+  size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+
+  arena_block_t *b = arena->current;
+  while (b && b->size - b->used < size) {
+    b = b->next;
+  }
+  if (!b) {
+    /* Add a new block at the end */
+    arena_block_t **link = &arena->head;
+    while (*link) {
+      link = &(*link)->next;
+    }
+    size_t bytes = size > arena->block ? size : arena->block;
+    GOLLE_ASSERT (bytes <= SIZE_MAX - sizeof (*b), NULL);
+    if (arena->secure) {
+      b = golle_secure_map (sizeof (*b) + bytes);
+    }
+    else {
+      b = malloc (sizeof (*b) + bytes);
+    }
+    GOLLE_ASSERT (b, NULL);
+    b->next = NULL;
+    b->size = bytes;
+    b->used = 0;
+    *link = b;
+  }
+  arena->current = b;
+
+  void *p = b->data + b->used;
+  b->used += size;
+  return p;
+}
+
+/* Point a buffer at storage of the given capacity. */
+static void bin_attach (golle_bin_t *buff,
+			void *bin,
+			size_t size,
+			size_t capacity,
+			golle_bin_arena_t *arena)
+{
+  buff->bin = bin;
+  buff->size = size;
+  buff->capacity = capacity;
+  buff->arena = arena;
+}
+
 golle_error golle_bin_init (golle_bin_t *buff, size_t size) {
   /* Allocate data an existing buffer. */
   GOLLE_ASSERT (buff, GOLLE_ERROR);
-  buff->bin = malloc (size);
-  GOLLE_ASSERT (buff->bin, GOLLE_EMEM);
-  buff->size = size;
+  if (size <= sizeof (buff->small)) {
+    bin_attach (buff, buff->small, size, sizeof (buff->small), NULL);
+    return GOLLE_OK;
+  }
+  void *bin = malloc (size);
+  GOLLE_ASSERT (bin, GOLLE_EMEM);
+  bin_attach (buff, bin, size, size, NULL);
   return GOLLE_OK;
 }
 
@@ -28,9 +123,17 @@ void golle_bin_release (golle_bin_t *buff) {
   if (buff && buff->bin) {
     /* Zeroing memory is safer. */
     CLEAR_BUFF (buff);
-    free (buff->bin);
-    buff->bin = NULL;
-    buff->size = 0;
+    if (BIN_OWNED (buff)) {
+      free (buff->bin);
+    }
+    bin_attach (buff, NULL, 0, 0, NULL);
+  }
+}
+
+void golle_bin_move (golle_bin_t *dest, const golle_bin_t *src) {
+  *dest = *src;
+  if (src->bin == src->small) {
+    dest->bin = dest->small;
   }
 }
 
@@ -38,14 +141,19 @@ golle_bin_t *golle_bin_new (size_t size) {
   /* Allocate enough room for the
    * bin object and the data buffer in one.
    */
-  golle_bin_t *bin = malloc (size + sizeof (*bin));
+  size_t extra = size > BIN_SMALL_BYTES ? size : 0;
+  golle_bin_t *bin = malloc (sizeof (*bin) + extra);
   GOLLE_ASSERT (bin, NULL);
 
   /* The data is part of the bin memory block. */
-  bin->size = size;
-  bin->bin = BIN_LOCAL(bin);
+  if (extra) {
+    bin_attach (bin, BIN_LOCAL (bin), size, size, NULL);
+  }
+  else {
+    bin_attach (bin, bin->small, size, sizeof (bin->small), NULL);
+  }
   CLEAR_BUFF (bin);
-  
+
   return bin;
 }
 
@@ -56,8 +164,11 @@ void golle_bin_delete (golle_bin_t *buff) {
   /* Always zero to be safe. */
   CLEAR_BUFF (buff);
 
-  if (buff->bin != NULL &&
-      buff->bin != BIN_LOCAL (buff)) 
+  if (buff->arena) {
+    /* The arena owns the memory. */
+    return;
+  }
+  if (BIN_OWNED (buff))
     {
       /* Only free the data individually if
        * it wasn't allocated as part of the bin. */
@@ -83,26 +194,125 @@ golle_bin_t *golle_bin_copy (const golle_bin_t *buff) {
 golle_error golle_bin_resize (golle_bin_t *buff, size_t size) {
   GOLLE_ASSERT (buff, GOLLE_ERROR);
   GOLLE_ASSERT (size, GOLLE_ERROR);
-  /*
-   * This function is essentially a 
-   * realloc for buffers but without copying old data.
-   */
-  void *b = buff->bin;
 
-  if (buff->bin == BIN_LOCAL (buff)) {
-    /* force a malloc */
-    b = NULL;
+  /* A buffer filled in by hand has as much room as its size. */
+  size_t capacity = buff->capacity;
+  if (!capacity && buff->bin) {
+    capacity = buff->size;
   }
 
-  void * newbin = realloc (b, size);
+  if (size <= capacity) {
+    /* Shrinking or growing in place. */
+    if (size < buff->size) {
+      memset ((char *)buff->bin + size, 0, buff->size - size);
+    }
+    buff->size = size;
+    return GOLLE_OK;
+  }
+
+  /* Move to new storage. */
+  void *newbin;
+  golle_bin_arena_t *arena = buff->arena;
+  if (!buff->bin && size <= sizeof (buff->small)) {
+    newbin = buff->small;
+    capacity = sizeof (buff->small);
+  }
+  else if (arena) {
+    newbin = golle_bin_arena_carve (arena, size);
+    capacity = size;
+  }
+  else {
+    newbin = malloc (size);
+    capacity = size;
+  }
   GOLLE_ASSERT (newbin, GOLLE_EMEM);
 
-  if (buff->bin == BIN_LOCAL (buff)) {
+  if (buff->bin) {
     memcpy (newbin, buff->bin, buff->size);
-    memset (buff->bin, 0, buff->size);
+    golle_bin_release (buff);
+  }
+  bin_attach (buff, newbin, size, capacity, arena);
+  return GOLLE_OK;
+}
+
+golle_error golle_bin_copy_into (golle_bin_t *dest, const golle_bin_t *src) {
+  GOLLE_ASSERT (dest, GOLLE_ERROR);
+  GOLLE_ASSERT (src, GOLLE_ERROR);
+  GOLLE_ASSERT (src->bin, GOLLE_ERROR);
+  golle_error err = golle_bin_resize (dest, src->size);
+  if (err == GOLLE_OK) {
+    memmove (dest->bin, src->bin, src->size);
   }
+  return err;
+}
 
-  buff->bin = newbin;
-  buff->size = size;
+golle_bin_arena_t *golle_bin_arena_new (size_t block) {
+  golle_bin_arena_t *arena = calloc (1, sizeof (*arena));
+  GOLLE_ASSERT (arena, NULL);
+  arena->block = block ? block : ARENA_BLOCK;
+  return arena;
+}
+
+golle_bin_arena_t *golle_bin_arena_new_secure (size_t block) {
+  golle_bin_arena_t *arena = golle_bin_arena_new (block);
+  if (arena) {
+    arena->secure = 1;
+  }
+  return arena;
+}
+
+void golle_bin_arena_delete (golle_bin_arena_t *arena) {
+  if (arena) {
+    arena_block_t *b = arena->head;
+    while (b) {
+      arena_block_t *next = b->next;
+      arena_block_free (arena, b);
+      b = next;
+    }
+    free (arena);
+  }
+}
+
+void golle_bin_arena_reset (golle_bin_arena_t *arena) {
+  if (arena) {
+    for (arena_block_t *b = arena->head; b; b = b->next) {
+      memset (b->data, 0, b->used);
+      b->used = 0;
+    }
+    arena->current = arena->head;
+  }
+}
+
+golle_error golle_bin_arena_alloc (golle_bin_arena_t *arena,
+				   golle_bin_t *buff,
+				   size_t size)
+{
+  GOLLE_ASSERT (arena, GOLLE_ERROR);
+  GOLLE_ASSERT (buff, GOLLE_ERROR);
+  void *bin = golle_bin_arena_carve (arena, size);
+  GOLLE_ASSERT (bin, GOLLE_EMEM);
+  bin_attach (buff, bin, size, size, arena);
   return GOLLE_OK;
 }
+
+golle_bin_t *golle_bin_arena_copy (golle_bin_arena_t *arena,
+				   const golle_bin_t *buff)
+{
+  GOLLE_ASSERT (arena, NULL);
+  GOLLE_ASSERT (buff, NULL);
+  GOLLE_ASSERT (buff->bin, NULL);
+
+  /* The structure and data are carved together, like golle_bin_new(). */
+  size_t extra = buff->size > BIN_SMALL_BYTES ? buff->size : 0;
+  GOLLE_ASSERT (extra <= SIZE_MAX - sizeof (golle_bin_t), NULL);
+  golle_bin_t *copy = golle_bin_arena_carve (arena, sizeof (*copy) + extra);
+  GOLLE_ASSERT (copy, NULL);
+  if (extra) {
+    bin_attach (copy, BIN_LOCAL (copy), buff->size, buff->size, arena);
+  }
+  else {
+    bin_attach (copy, copy->small, buff->size, sizeof (copy->small), arena);
+  }
+  memcpy (copy->bin, buff->bin, buff->size);
+  return copy;
+}
@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_BIN_H
+#define GOLLE_SRC_BIN_H
+
+#include <golle/bin.h>
+
+/* Move a buffer into another structure. src is left to be forgotten,
+ * not released. A small buffer points into its own structure, so the
+ * moved one is pointed into dest. */
+void golle_bin_move (golle_bin_t *dest, const golle_bin_t *src);
+
+#endif
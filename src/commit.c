@@ -5,10 +5,18 @@
 #include <golle/config.h>
 #include <golle/commit.h>
 #include <golle/types.h>
-#include <golle/random.h>
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
 #include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <golle/pool.h>
+#include <pthread.h>
+#include "probes.h"
+#include "random.h"
 
 enum {
   /* Number of bits in a random commitment, rounded up
@@ -16,7 +24,20 @@ enum {
    * number of bits in a byte. */
   RANDOM_BITS = (COMMIT_RANDOM_BITS + CHAR_BIT - 1) & ~(CHAR_BIT -1),
   /* The number of random bytes used in a commitment. */
-  RANDOM_BYTES = (RANDOM_BITS + CHAR_BIT - 1) / CHAR_BIT
+  RANDOM_BYTES = (RANDOM_BITS + CHAR_BIT - 1) / CHAR_BIT,
+  /* The size of a commitment hash. */
+  HASH_BYTES = SHA512_DIGEST_LENGTH
+};
+
+/* The buffers of a pack, in the order they are laid out. The hashed
+ * buffers are last and in hashing order, so that they can be hashed
+ * in one go. */
+enum {
+  PACK_HASH,
+  PACK_RSEND,
+  PACK_RKEEP,
+  PACK_SECRET,
+  PACK_MEMBERS
 };
 
 /* Check that every member of a commitment object
@@ -33,60 +54,119 @@ enum {
   GOLLE_ASSERT (commitment->hash->bin, GOLLE_ERROR);
 
 /*
- * Create a random buffer
+ * Hash into out, which must have room for EVP_MAX_MD_SIZE bytes.
+ * ALWAYS IN THE ORDER: rsend, rkeep, secret.
  */
-static golle_bin_t *random_buffer (void) {
-  golle_bin_t *rand = golle_bin_new (RANDOM_BYTES);
-  if (rand) {
-    /* This call will take care of any seeding required. */
-    golle_error err = golle_random_generate (rand);
-    if (err != GOLLE_OK) {
-      golle_bin_delete (rand);
-      rand = NULL;
-    }
+static int hash_commit (EVP_MD_CTX *ctx,
+			const golle_bin_t *rsend,
+			const golle_bin_t *rkeep,
+			const golle_bin_t *secret,
+			unsigned char *out,
+			unsigned int *len)
+{
+  return EVP_DigestInit_ex (ctx, EVP_sha512(), NULL) &&
+    EVP_DigestUpdate (ctx, rsend->bin, rsend->size) &&
+    EVP_DigestUpdate (ctx, rkeep->bin, rkeep->size) &&
+    EVP_DigestUpdate (ctx, secret->bin, secret->size) &&
+    EVP_DigestFinal_ex (ctx, out, len);
+}
+
+/*
+ * Make a buffer holding a copy of the given bytes.
+ */
+static golle_bin_t *bin_from (const void *bytes, size_t size) {
+  golle_bin_t *bin = golle_bin_new (size);
+  if (bin) {
+    memcpy (bin->bin, bytes, size);
   }
-  return rand;
+  return bin;
 }
 
 /*
- * Create a hash. ALWAYS IN THE ORDER: rsend, rkeep, secret.
+ * Fill in a commitment to the secret, using the given random bytes.
  */
-static golle_bin_t *get_hash (const golle_bin_t *rsend,
-		       const golle_bin_t *rkeep,
-		       const golle_bin_t *secret)
+static golle_error make_commit (EVP_MD_CTX *ctx,
+				golle_commit_t *commit,
+				const golle_bin_t *secret,
+				const unsigned char *random)
 {
-  golle_bin_t *hash = NULL;
-
-  EVP_MD_CTX *ctx = EVP_MD_CTX_create ();
-  GOLLE_ASSERT (ctx, NULL);
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int len;
 
-  if (!EVP_DigestInit_ex (ctx, EVP_sha512(), NULL)) {
-    goto out;
+  if (!(commit->secret = golle_bin_copy (secret)) ||
+      !(commit->rsend = bin_from (random, RANDOM_BYTES)) ||
+      !(commit->rkeep = bin_from (random + RANDOM_BYTES, RANDOM_BYTES))) {
+    return GOLLE_EMEM;
   }
 
-  if (!EVP_DigestUpdate (ctx, rsend->bin, rsend->size)) {
-    goto out;
+  /* Hash the secret and the random buffers */
+  if (!hash_commit (ctx, commit->rsend, commit->rkeep, commit->secret,
+		    md, &len)) {
+    return GOLLE_ECRYPTO;
   }
+  GOLLE_ASSERT (commit->hash = bin_from (md, len), GOLLE_EMEM);
+  return GOLLE_OK;
+}
 
-  if (!EVP_DigestUpdate (ctx, rkeep->bin, rkeep->size)) {
+golle_error golle_commit_new_many (golle_commit_t **commits,
+				   const golle_bin_t *const *secrets,
+				   size_t count)
+{
+  GOLLE_ASSERT (commits, GOLLE_ERROR);
+  GOLLE_ASSERT (secrets, GOLLE_ERROR);
+  for (size_t i = 0; i < count; i++) {
+    commits[i] = NULL;
+  }
+  for (size_t i = 0; i < count; i++) {
+    GOLLE_ASSERT (secrets[i], GOLLE_ERROR);
+    GOLLE_ASSERT (secrets[i]->bin, GOLLE_ERROR);
+    GOLLE_ASSERT (secrets[i]->size, GOLLE_ERROR);
+  }
+  GOLLE_ASSERT (count <= SIZE_MAX / (2 * RANDOM_BYTES), GOLLE_EMEM);
+
+  golle_error err = GOLLE_OK;
+  size_t random_size = 2 * RANDOM_BYTES * count;
+  unsigned char *random = NULL;
+  EVP_MD_CTX *ctx = NULL;
+  size_t i = 0;
+
+  /* All of the random values in one go, and one digest context. */
+  if (!(random = malloc (random_size)) ||
+      !(ctx = EVP_MD_CTX_create ())) {
+    err = GOLLE_EMEM;
     goto out;
   }
-
-  if (!EVP_DigestUpdate (ctx, secret->bin, secret->size)) {
+  if ((err = golle_random_bytes (random, random_size)) != GOLLE_OK) {
     goto out;
   }
 
-  hash = golle_bin_new ((size_t)EVP_MD_CTX_size (ctx));
-  if (hash) {
-    if (!EVP_DigestFinal_ex (ctx, hash->bin, NULL)) {
-      golle_bin_delete (hash);
-      hash = NULL;
+  for (; i < count; i++) {
+    if (!(commits[i] = calloc (1, sizeof (golle_commit_t)))) {
+      err = GOLLE_EMEM;
+      break;
+    }
+    err = make_commit (ctx, commits[i], secrets[i],
+		       random + 2 * RANDOM_BYTES * i);
+    if (err != GOLLE_OK) {
+      i++;
+      break;
     }
   }
 
  out:
-    EVP_MD_CTX_destroy (ctx);
-    return hash;
+  if (err != GOLLE_OK) {
+    /* All or nothing. */
+    while (i-- > 0) {
+      golle_commit_delete (commits[i]);
+      commits[i] = NULL;
+    }
+  }
+  if (random) {
+    OPENSSL_cleanse (random, random_size);
+    free (random);
+  }
+  EVP_MD_CTX_destroy (ctx);
+  return err;
 }
 
 golle_commit_t *golle_commit_new (const golle_bin_t *secret) {
@@ -95,87 +175,122 @@ golle_commit_t *golle_commit_new (const golle_bin_t *secret) {
   GOLLE_ASSERT (secret->size, NULL);
 
   golle_commit_t *commit = NULL;
-  golle_bin_t
-    *secret_copy = NULL,
-    *rkeep = NULL,
-    *rsend = NULL,
-    *hash = NULL;
+  golle_error err;
+  GOLLE_PROBE1 (commit_new_entry, secret->size);
+  err = golle_commit_new_many (&commit, &secret, 1);
+  GOLLE_PROBE1 (commit_new_return, err);
+  GOLLE_UNUSED (err);
+  return commit;
+}
 
-  /* Copy the secret. */
-  secret_copy = golle_bin_copy (secret);
-  if (!secret_copy) {
-    goto error;
+void golle_commit_delete (golle_commit_t *commitment) {
+  if (commitment) {
+    golle_commit_clear (commitment);
+    free (commitment);
   }
+}
 
-  /* Generate the two random values */
-  rsend = random_buffer ();
-  if (!rsend) {
-    goto error;
+/* A batch of commitments being verified. */
+typedef struct verify_batch_t {
+  const golle_commit_t *const *commits;
+  pthread_mutex_t lock;
+  golle_error err;
+  size_t failed;
+} verify_batch_t;
+
+/* Verify one commitment, using the hashing context ctx. */
+static golle_error verify_one (EVP_MD_CTX *ctx, const golle_commit_t *c) {
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int len;
+
+  /* Get the hash of the current values and compare it to
+   * the hash that was sent previously. */
+  if (!hash_commit (ctx, c->rsend, c->rkeep, c->secret, md, &len) ||
+      len != c->hash->size) {
+    return GOLLE_ECRYPTO;
+  }
+  if (memcmp (md, c->hash->bin, len)) {
+    /* Didn't hash to the same value. */
+    return GOLLE_COMMIT_FAILED;
   }
+  return GOLLE_COMMIT_PASSED;
+}
+
+static golle_error verify_chunk (void *arg, size_t begin, size_t end) {
+  verify_batch_t *b = arg;
+  golle_error err = GOLLE_COMMIT_PASSED;
+  size_t i = begin;
 
-  rkeep = random_buffer ();
-  if (!rkeep) {
-    goto error;
+  EVP_MD_CTX *ctx = EVP_MD_CTX_create ();
+  if (!ctx) {
+    err = GOLLE_EMEM;
   }
-  
-  /* Hash the secret and the random buffers */
-  hash = get_hash (rsend, rkeep, secret_copy);
-  if (!hash) {
-    goto error;
+  for (; ctx && i < end; i++) {
+    err = verify_one (ctx, b->commits[i]);
+    if (err != GOLLE_COMMIT_PASSED) {
+      break;
+    }
   }
+  EVP_MD_CTX_destroy (ctx);
 
-  commit = malloc (sizeof (*commit));
-  if (!commit) {
-    goto error;
+  if (err == GOLLE_COMMIT_PASSED) {
+    return GOLLE_OK;
+  }
+  /* Keep the earliest failure, and stop the others. */
+  pthread_mutex_lock (&b->lock);
+  if (b->err == GOLLE_COMMIT_PASSED || i < b->failed) {
+    b->err = err;
+    b->failed = i;
   }
+  pthread_mutex_unlock (&b->lock);
+  return GOLLE_EABORT;
+}
 
-  commit->secret = secret_copy;
-  commit->rsend = rsend;
-  commit->rkeep = rkeep;
-  commit->hash = hash;
-  
-  return commit;
+golle_error golle_commit_verify_many (const golle_commit_t *const *commits,
+				      size_t count,
+				      size_t *failed)
+{
+  GOLLE_ASSERT (commits, GOLLE_ERROR);
+  for (size_t i = 0; i < count; i++) {
+    ASSERT_FULL_COMMIT (commits[i]);
+  }
+  /* One commitment isn't worth the pool. */
+  if (count == 1) {
+    golle_error err = golle_commit_verify (commits[0]);
+    if (err != GOLLE_COMMIT_PASSED && failed) {
+      *failed = 0;
+    }
+    return err;
+  }
+  GOLLE_PROBE1 (commit_verify_entry, count);
 
-  /* General error handling. */
- error:
-  golle_bin_delete (secret_copy);
-  golle_bin_delete (rsend);
-  golle_bin_delete (rkeep);
-  golle_bin_delete (hash);
-  return NULL;
-}
+  verify_batch_t b = { .commits = commits, .err = GOLLE_COMMIT_PASSED };
+  pthread_mutex_init (&b.lock, NULL);
 
-void golle_commit_delete (golle_commit_t *commitment) {
-  if (commitment) {
-    golle_commit_clear (commitment);
-    free (commitment);
+  golle_error err = golle_pool_parallel_for (NULL, count, 0,
+					     &verify_chunk, &b);
+  if (err == GOLLE_OK || err == GOLLE_EABORT) {
+    err = b.err;
+    if (err != GOLLE_COMMIT_PASSED && failed) {
+      *failed = b.failed;
+    }
   }
+
+  pthread_mutex_destroy (&b.lock);
+  GOLLE_PROBE1 (commit_verify_return, err);
+  return err;
 }
 
 golle_error golle_commit_verify (const golle_commit_t *commitment) {
   ASSERT_FULL_COMMIT (commitment);
+  EVP_MD_CTX *ctx = EVP_MD_CTX_create ();
+  GOLLE_ASSERT (ctx, GOLLE_ECRYPTO);
+  GOLLE_PROBE1 (commit_verify_entry, 1);
 
-  /* Get the hash of the current values. */
-  golle_bin_t *check = get_hash (commitment->rsend,
-				 commitment->rkeep,
-				 commitment->secret);
-
-  GOLLE_ASSERT (check, GOLLE_ECRYPTO);
-
-  /* Compare it to the hash that was sent previously. */
-  golle_error err = GOLLE_COMMIT_PASSED;
-  if (check->size != commitment->hash->size) {
-    err = GOLLE_ECRYPTO;
-  }
-  else {
-    int cmp = memcmp (check->bin, commitment->hash->bin, check->size);
-    if (cmp) {
-      /* Didn't hash to the same value. */
-      err = GOLLE_COMMIT_FAILED;
-    }
-  }
+  golle_error err = verify_one (ctx, commitment);
 
-  golle_bin_delete (check);
+  EVP_MD_CTX_destroy (ctx);
+  GOLLE_PROBE1 (commit_verify_return, err);
   return err;
 }
 
@@ -229,3 +344,303 @@ golle_error golle_commit_copy (golle_commit_t *dest,
   golle_bin_delete (secret);
   return GOLLE_EMEM;
 }
+
+/* Get the buffers of a pack, and the commitment members that
+ * point at them, in layout order. */
+static void pack_members (golle_commit_pack_t *pack,
+			  golle_bin_t **bins,
+			  golle_bin_t ***views)
+{
+  bins[PACK_HASH] = &pack->hash;
+  bins[PACK_RSEND] = &pack->rsend;
+  bins[PACK_RKEEP] = &pack->rkeep;
+  bins[PACK_SECRET] = &pack->secret;
+  views[PACK_HASH] = &pack->commit.hash;
+  views[PACK_RSEND] = &pack->commit.rsend;
+  views[PACK_RKEEP] = &pack->commit.rkeep;
+  views[PACK_SECRET] = &pack->commit.secret;
+}
+
+/* Get memory for the arena of a pack. */
+static void *pack_alloc (golle_commit_pack_t *pack, size_t size) {
+  if (pack->pool) {
+    return golle_bin_arena_carve (pack->pool, size);
+  }
+  return malloc (size);
+}
+
+/* Replace the arena of a pack. */
+static void pack_swap_arena (golle_commit_pack_t *pack,
+			     void *arena,
+			     size_t capacity)
+{
+  if (pack->arena) {
+    OPENSSL_cleanse (pack->arena, pack->capacity);
+    if (!pack->pool) {
+      free (pack->arena);
+    }
+  }
+  pack->arena = arena;
+  pack->capacity = capacity;
+}
+
+golle_error golle_commit_pack_set (golle_commit_pack_t *pack,
+				   const golle_bin_t *secret,
+				   const golle_bin_t *rsend,
+				   const golle_bin_t *rkeep,
+				   const golle_bin_t *hash)
+{
+  GOLLE_ASSERT (pack, GOLLE_ERROR);
+  const golle_bin_t *src[PACK_MEMBERS] = { hash, rsend, rkeep, secret };
+  golle_bin_t *bins[PACK_MEMBERS], **views[PACK_MEMBERS];
+  size_t size[PACK_MEMBERS], offset[PACK_MEMBERS], total = 0;
+  unsigned char *arena = pack->arena;
+  int move = 0;
+
+  pack_members (pack, bins, views);
+  for (int i = 0; i < PACK_MEMBERS; i++) {
+    if (src[i]) {
+      GOLLE_ASSERT (src[i]->bin, GOLLE_ERROR);
+      GOLLE_ASSERT (src[i]->size, GOLLE_ERROR);
+      size[i] = src[i]->size;
+    }
+    else {
+      size[i] = *views[i] ? bins[i]->size : 0;
+      /* A buffer that we keep, but which has to move. */
+      move |= *views[i] && bins[i]->bin != arena + total;
+    }
+    GOLLE_ASSERT (size[i] <= SIZE_MAX - total, GOLLE_EMEM);
+    offset[i] = total;
+    total += size[i];
+  }
+
+  /* Only allocate when the buffers outgrow the arena. */
+  if (move || total > pack->capacity) {
+    GOLLE_ASSERT (arena = pack_alloc (pack, total), GOLLE_EMEM);
+    for (int i = 0; i < PACK_MEMBERS; i++) {
+      if (!src[i] && *views[i]) {
+	memcpy (arena + offset[i], bins[i]->bin, size[i]);
+      }
+    }
+    pack_swap_arena (pack, arena, total);
+  }
+
+  for (int i = 0; i < PACK_MEMBERS; i++) {
+    if (src[i]) {
+      memcpy (arena + offset[i], src[i]->bin, size[i]);
+    }
+    if (src[i] || *views[i]) {
+      bins[i]->bin = arena + offset[i];
+      bins[i]->size = size[i];
+      *views[i] = bins[i];
+    }
+  }
+  return GOLLE_OK;
+}
+
+golle_error golle_commit_pack_new (golle_commit_pack_t *pack,
+				   const golle_bin_t *secret)
+{
+  GOLLE_ASSERT (pack, GOLLE_ERROR);
+  GOLLE_ASSERT (secret, GOLLE_ERROR);
+  GOLLE_ASSERT (secret->bin, GOLLE_ERROR);
+  GOLLE_ASSERT (secret->size, GOLLE_ERROR);
+  GOLLE_ASSERT (secret->size <= SIZE_MAX - HASH_BYTES - 2 * RANDOM_BYTES,
+		GOLLE_EMEM);
+
+  golle_bin_t *bins[PACK_MEMBERS], **views[PACK_MEMBERS];
+  size_t size[PACK_MEMBERS] = {
+    HASH_BYTES, RANDOM_BYTES, RANDOM_BYTES, secret->size
+  };
+  size_t total = HASH_BYTES + 2 * RANDOM_BYTES + secret->size;
+  unsigned char *arena;
+
+  golle_commit_pack_reset (pack);
+  if (total > pack->capacity) {
+    GOLLE_ASSERT (arena = pack_alloc (pack, total), GOLLE_EMEM);
+    pack_swap_arena (pack, arena, total);
+  }
+  arena = pack->arena;
+
+  /* rsend and rkeep in one draw, then the secret after them. */
+  unsigned char *hashed = arena + HASH_BYTES;
+  golle_error err = golle_random_bytes (hashed, 2 * RANDOM_BYTES);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  memcpy (hashed + 2 * RANDOM_BYTES, secret->bin, secret->size);
+  GOLLE_ASSERT (SHA512 (hashed, total - HASH_BYTES, arena), GOLLE_ECRYPTO);
+
+  pack_members (pack, bins, views);
+  for (int i = 0; i < PACK_MEMBERS; i++) {
+    bins[i]->bin = arena;
+    bins[i]->size = size[i];
+    *views[i] = bins[i];
+    arena += size[i];
+  }
+  return GOLLE_OK;
+}
+
+void golle_commit_pack_reset (golle_commit_pack_t *pack) {
+  if (pack) {
+    golle_bin_t *bins[PACK_MEMBERS], **views[PACK_MEMBERS];
+    pack_members (pack, bins, views);
+    for (int i = 0; i < PACK_MEMBERS; i++) {
+      bins[i]->bin = NULL;
+      bins[i]->size = 0;
+      *views[i] = NULL;
+    }
+    if (pack->arena) {
+      OPENSSL_cleanse (pack->arena, pack->capacity);
+    }
+  }
+}
+
+void golle_commit_pack_release (golle_commit_pack_t *pack) {
+  if (pack) {
+    golle_commit_pack_reset (pack);
+    pack_swap_arena (pack, NULL, 0);
+  }
+}
+
+struct golle_commit_stream_t {
+  EVP_MD_CTX *ctx;
+  /* For encoding numbers. */
+  unsigned char *scratch;
+  size_t capacity;
+};
+
+golle_commit_stream_t *golle_commit_stream_new (void) {
+  golle_commit_stream_t *stream = calloc (1, sizeof (*stream));
+  if (stream && !(stream->ctx = EVP_MD_CTX_create ())) {
+    free (stream);
+    stream = NULL;
+  }
+  return stream;
+}
+
+void golle_commit_stream_delete (golle_commit_stream_t *stream) {
+  if (stream) {
+    EVP_MD_CTX_destroy (stream->ctx);
+    free (stream->scratch);
+    free (stream);
+  }
+}
+
+golle_error golle_commit_stream_begin (golle_commit_stream_t *stream,
+				       const golle_bin_t *rsend,
+				       const golle_bin_t *rkeep)
+{
+  GOLLE_ASSERT (stream, GOLLE_ERROR);
+  GOLLE_ASSERT (rsend && rsend->bin, GOLLE_ERROR);
+  GOLLE_ASSERT (rkeep && rkeep->bin, GOLLE_ERROR);
+
+  /* ALWAYS IN THE ORDER: rsend, rkeep, secret. */
+  if (!EVP_DigestInit_ex (stream->ctx, EVP_sha512(), NULL) ||
+      !EVP_DigestUpdate (stream->ctx, rsend->bin, rsend->size) ||
+      !EVP_DigestUpdate (stream->ctx, rkeep->bin, rkeep->size)) {
+    return GOLLE_ECRYPTO;
+  }
+  return GOLLE_OK;
+}
+
+golle_error golle_commit_stream_bin (golle_commit_stream_t *stream,
+				     const golle_bin_t *data)
+{
+  GOLLE_ASSERT (stream, GOLLE_ERROR);
+  GOLLE_ASSERT (data && (data->bin || !data->size), GOLLE_ERROR);
+  GOLLE_ASSERT (EVP_DigestUpdate (stream->ctx, data->bin, data->size),
+		GOLLE_ECRYPTO);
+  return GOLLE_OK;
+}
+
+golle_error golle_commit_stream_num (golle_commit_stream_t *stream,
+				     const golle_num_t n,
+				     size_t width)
+{
+  static const unsigned char zeros[64] = { 0 };
+  GOLLE_ASSERT (stream, GOLLE_ERROR);
+  GOLLE_ASSERT (n, GOLLE_ERROR);
+  const BIGNUM *bn = n;
+  size_t size = BN_num_bytes (bn);
+  GOLLE_ASSERT (!BN_is_negative (bn), GOLLE_ERROR);
+  GOLLE_ASSERT (size <= width, GOLLE_ERROR);
+
+  /* Leading zeros first. */
+  for (size_t pad = width - size; pad > 0; ) {
+    size_t len = pad < sizeof (zeros) ? pad : sizeof (zeros);
+    GOLLE_ASSERT (EVP_DigestUpdate (stream->ctx, zeros, len), GOLLE_ECRYPTO);
+    pad -= len;
+  }
+
+  if (size > stream->capacity) {
+    unsigned char *scratch = realloc (stream->scratch, size);
+    GOLLE_ASSERT (scratch, GOLLE_EMEM);
+    stream->scratch = scratch;
+    stream->capacity = size;
+  }
+  BN_bn2bin (bn, stream->scratch);
+  GOLLE_ASSERT (EVP_DigestUpdate (stream->ctx, stream->scratch, size),
+		GOLLE_ECRYPTO);
+  return GOLLE_OK;
+}
+
+golle_error golle_commit_stream_check (golle_commit_stream_t *stream,
+				       const golle_bin_t *hash)
+{
+  GOLLE_ASSERT (stream, GOLLE_ERROR);
+  GOLLE_ASSERT (hash && hash->bin, GOLLE_ERROR);
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int len;
+
+  GOLLE_ASSERT (EVP_DigestFinal_ex (stream->ctx, md, &len), GOLLE_ECRYPTO);
+  if (len != hash->size || memcmp (md, hash->bin, len)) {
+    return GOLLE_COMMIT_FAILED;
+  }
+  return GOLLE_COMMIT_PASSED;
+}
+
+golle_error golle_commit_pack_begin (golle_commit_pack_t *pack,
+				     golle_commit_stream_t *stream)
+{
+  GOLLE_ASSERT (pack, GOLLE_ERROR);
+  GOLLE_ASSERT (stream, GOLLE_ERROR);
+  size_t total = HASH_BYTES + 2 * RANDOM_BYTES;
+  unsigned char *arena;
+
+  golle_commit_pack_reset (pack);
+  if (total > pack->capacity) {
+    GOLLE_ASSERT (arena = pack_alloc (pack, total), GOLLE_EMEM);
+    pack_swap_arena (pack, arena, total);
+  }
+  arena = pack->arena;
+
+  /* Leave room for the hash at the front. */
+  golle_error err = golle_random_bytes (arena + HASH_BYTES, 2 * RANDOM_BYTES);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  pack->rsend.bin = arena + HASH_BYTES;
+  pack->rsend.size = RANDOM_BYTES;
+  pack->rkeep.bin = arena + HASH_BYTES + RANDOM_BYTES;
+  pack->rkeep.size = RANDOM_BYTES;
+  pack->commit.rsend = &pack->rsend;
+  pack->commit.rkeep = &pack->rkeep;
+
+  return golle_commit_stream_begin (stream, &pack->rsend, &pack->rkeep);
+}
+
+golle_error golle_commit_pack_end (golle_commit_pack_t *pack,
+				   golle_commit_stream_t *stream)
+{
+  GOLLE_ASSERT (pack, GOLLE_ERROR);
+  GOLLE_ASSERT (stream, GOLLE_ERROR);
+  /* Only a pack laid out by golle_commit_pack_begin. */
+  GOLLE_ASSERT (pack->commit.rsend && !pack->commit.hash, GOLLE_ERROR);
+  GOLLE_ASSERT (pack->rsend.bin == (char *)pack->arena + HASH_BYTES,
+		GOLLE_ERROR);
+
+  unsigned int len;
+  GOLLE_ASSERT (EVP_DigestFinal_ex (stream->ctx, pack->arena, &len),
+		GOLLE_ECRYPTO);
+  pack->hash.bin = pack->arena;
+  pack->hash.size = len;
+  pack->commit.hash = &pack->hash;
+  return GOLLE_OK;
+}
@@ -27,7 +27,7 @@ static golle_error get_s1 (const golle_schnorr_t *key,
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_mul (cx, c1, key->x, key->q, ctx)) {
+  if (!golle_bn_mod_mul (cx, c1, key->x, key->q, ctx)) {
     err = GOLLE_EMEM;
     goto out;
   }
@@ -62,23 +62,23 @@ static golle_error get_t2 (const golle_schnorr_t *key,
     goto out;
   }
   /* Get inverse of g */
-  if (!BN_mod_inverse (invS, key->G, key->p, ctx)) {
+  if (!golle_bn_mod_inverse (invS, key->G, key->p, ctx)) {
     err = GOLLE_ECRYPTO;
   }
 
   /* GS = G^-s */
-  if (!BN_mod_exp (GS, invS, s2, key->p, ctx)) {
+  if (!golle_bn_mod_exp (GS, invS, s2, key->p, ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
   /* YC = Y^c2 */
-  if (!BN_mod_exp (YC, key->Y, c2, key->p, ctx)) {
+  if (!golle_bn_mod_exp (YC, key->Y, c2, key->p, ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
 
   /* Product */
-  if (!BN_mod_mul (t2, GS, YC, key->p, ctx)) {
+  if (!golle_bn_mod_mul (t2, GS, YC, key->p, ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
@@ -125,7 +125,7 @@ golle_error check_key (const golle_schnorr_t *key,
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_exp (yc, key->Y, c, key->p, ctx)) {
+  if (!golle_bn_mod_exp (yc, key->Y, c, key->p, ctx)) {
     err = GOLLE_EMEM;
     goto out;
   }
@@ -135,12 +135,12 @@ golle_error check_key (const golle_schnorr_t *key,
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_exp (gs, key->G, s, key->p, ctx)) {
+  if (!golle_bn_mod_exp (gs, key->G, s, key->p, ctx)) {
     err = GOLLE_EMEM;
     goto out;
   }
   /* Get G^s * t */
-  if (!BN_mod_mul (gst, gs, t, key->p, ctx)) {
+  if (!golle_bn_mod_mul (gst, gs, t, key->p, ctx)) {
     err = GOLLE_EMEM;
     goto out;
   }
@@ -5,7 +5,9 @@
 
 #include <golle/distribute.h>
 #include <openssl/bn.h>
+#include <openssl/opensslv.h>
 #include <golle/random.h>
+#include "numbers.h"
 
 enum {
   /* Number of bits in p */
@@ -36,7 +38,7 @@ static golle_num_t get_h (const golle_num_t x,
     goto out;
   }
   
-  if (!BN_mod_exp (h, g, x, p, ctx)) {
+  if (!golle_bn_mod_exp (h, g, x, p, ctx)) {
     BN_free (h);
     h = NULL;
   }
@@ -164,16 +166,17 @@ golle_error golle_key_set_public (golle_key_t *key,
 golle_error golle_key_gen_private (golle_key_t *key) {
   GOLLE_ASSERT (key, GOLLE_ERROR);
 
-  /* Always seed first. It won't actually do anything
-   * if seeding isn't required. */
-  golle_error err = golle_random_seed ();
-  GOLLE_ASSERT (err == GOLLE_OK, err);
-  
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  /* The private key goes on OpenSSL's locked heap, if the
+   * application has set one up with CRYPTO_secure_malloc_init(). */
+  BIGNUM* r = BN_secure_new ();
+#else
   BIGNUM* r = BN_new ();
+#endif
   GOLLE_ASSERT (r, GOLLE_EMEM);
 
-  err = GOLLE_OK;
-  if (!BN_rand_range (r, key->q)) {
+  golle_error err = GOLLE_OK;
+  if (!golle_bn_rand_range (r, key->q)) {
     err = GOLLE_EMEM;
   }
 
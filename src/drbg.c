@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include "drbg.h"
+#include "secure.h"
+#include <golle/random.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <pthread.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  /* The largest amount handed to EVP in one call. */
+  MAX_CHUNK = INT_MAX & ~0xF,
+  /* Size of the AES-256 key. */
+  KEY_BYTES = 32,
+  /* Keystream generated by a thread at a time. */
+  THREAD_BUFFER = 4096
+};
+
+/* Output between reseeds of a thread's generator. */
+#define GOLLE_DRBG_RESEED_BYTES ((size_t)1 << 30)
+
+struct golle_drbg_t {
+  EVP_CIPHER_CTX *ctx;
+  pthread_mutex_t lock;
+};
+
+golle_drbg_t *golle_drbg_new (const void *seed, size_t size) {
+  GOLLE_ASSERT (seed || size == 0, NULL);
+  unsigned char key[SHA256_DIGEST_LENGTH];
+  unsigned char iv[16] = { 0 };
+
+  golle_drbg_t *drbg = calloc (1, sizeof (*drbg));
+  GOLLE_ASSERT (drbg, NULL);
+
+  SHA256 (seed, size, key);
+  drbg->ctx = EVP_CIPHER_CTX_new ();
+  if (!drbg->ctx ||
+      !EVP_EncryptInit_ex (drbg->ctx, EVP_aes_256_ctr (), NULL, key, iv) ||
+      pthread_mutex_init (&drbg->lock, NULL) != 0) {
+    EVP_CIPHER_CTX_free (drbg->ctx);
+    free (drbg);
+    drbg = NULL;
+  }
+  memset (key, 0, sizeof (key));
+  return drbg;
+}
+
+void golle_drbg_delete (golle_drbg_t *drbg) {
+  if (drbg) {
+    EVP_CIPHER_CTX_free (drbg->ctx);
+    pthread_mutex_destroy (&drbg->lock);
+    free (drbg);
+  }
+}
+
+golle_error golle_drbg_generate (void *drbg, void *buffer, size_t size) {
+  GOLLE_ASSERT (drbg, GOLLE_ERROR);
+  GOLLE_ASSERT (buffer || size == 0, GOLLE_ERROR);
+  golle_drbg_t *d = drbg;
+  unsigned char *out = buffer;
+  golle_error err = GOLLE_OK;
+  if (size == 0) {
+    return GOLLE_OK;
+  }
+
+  /* The keystream is the encryption of zeros. */
+  memset (buffer, 0, size);
+  pthread_mutex_lock (&d->lock);
+  while (size > 0 && err == GOLLE_OK) {
+    int len = size > MAX_CHUNK ? MAX_CHUNK : (int)size;
+    int outl;
+    if (!EVP_EncryptUpdate (d->ctx, out, &outl, out, len) || outl != len) {
+      err = GOLLE_ECRYPTO;
+    }
+    out += len;
+    size -= len;
+  }
+  pthread_mutex_unlock (&d->lock);
+  return err;
+}
+
+/* A thread's generator. Bytes before `pos` in `buf` are used up. */
+typedef struct thread_drbg_t {
+  EVP_CIPHER_CTX *ctx;
+  unsigned char buf[THREAD_BUFFER];
+  size_t pos;
+  size_t output;
+  unsigned forks;
+} thread_drbg_t;
+
+static pthread_once_t thread_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+static int thread_key_ok = 0;
+/* Bumped in the child after fork(). */
+static volatile unsigned forks = 0;
+
+static void thread_drbg_free (void *p) {
+  thread_drbg_t *t = p;
+  if (t) {
+    EVP_CIPHER_CTX_free (t->ctx);
+    golle_secure_unmap (t, sizeof (*t));
+  }
+}
+
+static void on_fork_child (void) {
+  forks++;
+}
+
+static void thread_init (void) {
+  thread_key_ok = pthread_key_create (&thread_key, thread_drbg_free) == 0 &&
+    pthread_atfork (NULL, NULL, on_fork_child) == 0;
+}
+
+/* Start the keystream again under a new key. */
+static int rekey (thread_drbg_t *t, const unsigned char *key) {
+  static const unsigned char iv[16] = { 0 };
+  return EVP_EncryptInit_ex (t->ctx, EVP_aes_256_ctr (), NULL, key, iv);
+}
+
+/* Take a fresh key from OpenSSL. */
+static golle_error reseed (thread_drbg_t *t) {
+  unsigned char key[KEY_BYTES];
+  golle_error err = golle_random_seed ();
+  if (err == GOLLE_OK) {
+    if (RAND_bytes (key, KEY_BYTES) != 1 || !rekey (t, key)) {
+      err = GOLLE_ECRYPTO;
+    }
+  }
+  OPENSSL_cleanse (key, KEY_BYTES);
+  t->pos = THREAD_BUFFER;
+  t->output = 0;
+  t->forks = forks;
+  return err;
+}
+
+/* Make a new block of output. The first KEY_BYTES become the next key
+ * and are wiped, the rest is handed out. */
+static golle_error refill (thread_drbg_t *t) {
+  int outl;
+  memset (t->buf, 0, THREAD_BUFFER);
+  if (!EVP_EncryptUpdate (t->ctx, t->buf, &outl, t->buf, THREAD_BUFFER) ||
+      outl != THREAD_BUFFER ||
+      !rekey (t, t->buf)) {
+    return GOLLE_ECRYPTO;
+  }
+  OPENSSL_cleanse (t->buf, KEY_BYTES);
+  t->pos = KEY_BYTES;
+  return GOLLE_OK;
+}
+
+/* Get the calling thread's generator, making it if needed. */
+static thread_drbg_t *thread_drbg (void) {
+  pthread_once (&thread_once, thread_init);
+  GOLLE_ASSERT (thread_key_ok, NULL);
+
+  thread_drbg_t *t = pthread_getspecific (thread_key);
+  if (!t) {
+    /* The buffered output is kept out of swap. */
+    t = golle_secure_map (sizeof (*t));
+    GOLLE_ASSERT (t, NULL);
+    if (!(t->ctx = EVP_CIPHER_CTX_new ()) ||
+	reseed (t) != GOLLE_OK ||
+	pthread_setspecific (thread_key, t) != 0) {
+      thread_drbg_free (t);
+      t = NULL;
+    }
+  }
+  return t;
+}
+
+golle_error golle_drbg_thread_generate (void *buffer, size_t size) {
+  GOLLE_ASSERT (buffer || size == 0, GOLLE_ERROR);
+  thread_drbg_t *t = thread_drbg ();
+  GOLLE_ASSERT (t, GOLLE_EMEM);
+  unsigned char *out = buffer;
+  golle_error err = GOLLE_OK;
+
+  if (t->forks != forks || t->output >= GOLLE_DRBG_RESEED_BYTES) {
+    err = reseed (t);
+  }
+  while (size > 0 && err == GOLLE_OK) {
+    if (t->pos == THREAD_BUFFER) {
+      err = refill (t);
+      continue;
+    }
+    size_t len = THREAD_BUFFER - t->pos;
+    if (len > size) {
+      len = size;
+    }
+    memcpy (out, t->buf + t->pos, len);
+    OPENSSL_cleanse (t->buf + t->pos, len);
+    t->pos += len;
+    t->output += len;
+    out += len;
+    size -= len;
+  }
+  return err;
+}
+
+void golle_drbg_thread_clear (void) {
+  pthread_once (&thread_once, thread_init);
+  if (thread_key_ok) {
+    thread_drbg_free (pthread_getspecific (thread_key));
+    pthread_setspecific (thread_key, NULL);
+  }
+}
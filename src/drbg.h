@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_DRBG_H
+#define GOLLE_SRC_DRBG_H
+
+#include <golle/errors.h>
+#include <stddef.h>
+
+/*
+ * A deterministic random bit generator. The output is the AES-256-CTR
+ * keystream under the SHA-256 hash of the seed, starting from a zero
+ * counter, so the same seed always gives the same bytes. It is safe to
+ * share between threads, but then the order in which the threads get
+ * their bytes is up to the scheduler.
+ */
+typedef struct golle_drbg_t golle_drbg_t;
+
+/* Make a generator from a seed of any length. NULL on failure. */
+golle_drbg_t *golle_drbg_new (const void *seed, size_t size);
+
+/* Free a generator. */
+void golle_drbg_delete (golle_drbg_t *drbg);
+
+/* Fill the buffer with the next `size` bytes of output. The first
+ * argument is a golle_drbg_t, so this can be a random source. */
+golle_error golle_drbg_generate (void *drbg, void *buffer, size_t size);
+
+/*
+ * Each thread also has a private, buffered generator, which is where
+ * the library's random data comes from by default. It is seeded from
+ * OpenSSL the first time it is used, reseeded after every
+ * gigabyte of output, and after fork() in the child.
+ * After each block of output the key is replaced with fresh keystream,
+ * so a copy of the state doesn't reveal what was generated before.
+ */
+
+/* Fill the buffer from the calling thread's generator. */
+golle_error golle_drbg_thread_generate (void *buffer, size_t size);
+
+/* Free the calling thread's generator. It is made again when needed. */
+void golle_drbg_thread_clear (void);
+
+#endif
@@ -5,7 +5,10 @@
 #include <golle/elgamal.h>
 #include <openssl/bn.h>
 #include <golle/random.h>
+#include <golle/pool.h>
 #include <limits.h>
+#include "numbers.h"
+#include "probes.h"
 
 #define TOCBN(g) ((const BIGNUM*)(g))
 #define TOBN(g) ((BIGNUM*)(g))
@@ -31,36 +34,21 @@ static golle_error copy_num (golle_num_t *num,
   return GOLLE_OK;
 }
 
-/* Calculate a * b ^ c mod p */
-static golle_error mod_mul_exp (golle_num_t res,
-				const golle_num_t a,
-				const golle_num_t b,
-				const golle_num_t c,
-				const golle_num_t p,
-				BN_CTX *ctx)
+/* Calculate a = g^r and b = h^r mod p. They can be split across the
+ * default pool, see golle_num_set_split(). */
+static golle_error exp_g_h (const golle_key_t *key,
+			    const golle_num_t r,
+			    BIGNUM *a,
+			    BIGNUM *b,
+			    BN_CTX *ctx)
 {
-  BIGNUM *t;
-  golle_error err = GOLLE_OK;
-  BN_CTX_start (ctx);
-
-  if (!(t = BN_CTX_get (ctx))) {
-    err = GOLLE_EMEM;
-    goto out;
+  BIGNUM *out[2] = { a, b };
+  const BIGNUM *base[2] = { TOCBN (key->g), TOCBN (key->h_product) };
+  const BIGNUM *exp[2] = { TOCBN (r), TOCBN (r) };
+  if (!golle_bn_mod_exp_split (out, base, exp, 2, TOCBN (key->p), ctx)) {
+    return GOLLE_ECRYPTO;
   }
-  /* Get t = b ^ c */
-  if (!BN_mod_exp (t, TOCBN (b), TOCBN (c), TOCBN (p), ctx)) {
-    err = GOLLE_ECRYPTO;
-    goto out;
-  }
-  /* res = t * a */
-  if (!BN_mod_mul (TOBN (res), t, TOCBN (a), TOCBN (p), ctx)) {
-    err = GOLLE_ECRYPTO;
-    goto out;
-  }
-
- out:
-  BN_CTX_end (ctx);
-  return err;
+  return GOLLE_OK;
 }
 
 /* Calculate the sum of x mod p */
@@ -104,7 +92,7 @@ static golle_error mod_prod_exp (golle_num_t r,
   /* Get the sum of the exponents */
   if ((err = mod_sum (x, xi, len, p, ctx)) == GOLLE_OK) {
     /* Exponentitate */
-    if (!BN_mod_exp (r, a, x, TOCBN (p), ctx)) {
+    if (!golle_bn_mod_exp (r, a, x, TOCBN (p), ctx)) {
       err = GOLLE_ECRYPTO;
     }
   }
@@ -167,6 +155,7 @@ golle_error golle_eg_encrypt (const golle_key_t *key,
 
   ctx = BN_CTX_new ();
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  GOLLE_PROBE0 (eg_encrypt_entry);
 
   BN_CTX_start (ctx);
 
@@ -185,23 +174,20 @@ golle_error golle_eg_encrypt (const golle_key_t *key,
     goto out;
   }
 
-  /* Calculate g^r */
-  if (!(a = BN_CTX_get (ctx))) {
+  /* Calculate g^r and h^r */
+  if (!(a = BN_CTX_get (ctx)) ||
+      !(b = BN_CTX_get (ctx))) {
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_exp (a, TOCBN (key->g), r, TOCBN (key->p), ctx)) {
-    err = GOLLE_ECRYPTO;
+  err = exp_g_h (key, r, a, b, ctx);
+  if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Calculate mh^r */
-  if (!(b = BN_CTX_get (ctx))) {
-    err = GOLLE_EMEM;
-    goto out;
-  }
-  err = mod_mul_exp (b, m, key->h_product, r, key->p, ctx);
-  if (err != GOLLE_OK) {
+  if (!golle_bn_mod_mul (b, b, TOCBN (m), TOCBN (key->p), ctx)) {
+    err = GOLLE_ECRYPTO;
     goto out;
   }
 
@@ -228,6 +214,7 @@ golle_error golle_eg_encrypt (const golle_key_t *key,
   BN_CTX_end (ctx);
   BN_CTX_free (ctx);
   
+  GOLLE_PROBE1 (eg_encrypt_return, err);
   return err;
 }
 
@@ -250,6 +237,7 @@ golle_error golle_eg_reencrypt (const golle_key_t *key,
 
   ctx = BN_CTX_new ();
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  GOLLE_PROBE0 (eg_reencrypt_entry);
   BN_CTX_start (ctx);
 
   /* Get random r in Z*q */
@@ -264,15 +252,14 @@ golle_error golle_eg_reencrypt (const golle_key_t *key,
     goto out;
   }
 
-  /* Calculate ag^r */
-  err = mod_mul_exp (a, e1->a, key->g, r, key->p, ctx);
+  /* Calculate ag^r and bh^r */
+  err = exp_g_h (key, r, a, b, ctx);
   if (err != GOLLE_OK) {
     goto out;
   }
-
-  /* Calculate bh^r */
-  err = mod_mul_exp (b, e1->b, key->h_product, r, key->p, ctx);
-  if (err != GOLLE_OK) {
+  if (!golle_bn_mod_mul (a, a, TOCBN (e1->a), TOCBN (key->p), ctx) ||
+      !golle_bn_mod_mul (b, b, TOCBN (e1->b), TOCBN (key->p), ctx)) {
+    err = GOLLE_ECRYPTO;
     goto out;
   }
 
@@ -296,9 +283,42 @@ golle_error golle_eg_reencrypt (const golle_key_t *key,
   BN_CTX_end (ctx);
   BN_CTX_free (ctx);
   
+  GOLLE_PROBE1 (eg_reencrypt_return, err);
   return err; 
 }
 
+golle_error golle_eg_mul (const golle_key_t *key,
+			  golle_eg_t *product,
+			  const golle_eg_t *cipher)
+{
+  golle_error err = GOLLE_OK;
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  GOLLE_ASSERT (key->p, GOLLE_ERROR);
+  GOLLE_ASSERT (product, GOLLE_ERROR);
+  GOLLE_ASSERT (cipher, GOLLE_ERROR);
+  GOLLE_ASSERT (cipher->a, GOLLE_ERROR);
+  GOLLE_ASSERT (cipher->b, GOLLE_ERROR);
+
+  /* An empty product is (1, 1). */
+  if (!product->a && !(product->a = golle_num_new_int (1))) {
+    return GOLLE_EMEM;
+  }
+  if (!product->b && !(product->b = golle_num_new_int (1))) {
+    return GOLLE_EMEM;
+  }
+
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  if (!golle_bn_mod_mul (TOBN (product->a), TOCBN (product->a),
+			 TOCBN (cipher->a), TOCBN (key->p), ctx) ||
+      !golle_bn_mod_mul (TOBN (product->b), TOCBN (product->b),
+			 TOCBN (cipher->b), TOCBN (key->p), ctx)) {
+    err = GOLLE_ECRYPTO;
+  }
+  BN_CTX_free (ctx);
+  return err;
+}
+
 golle_error golle_eg_decrypt (const golle_key_t *key,
 			      const golle_num_t *xi,
 			      size_t len,
@@ -328,6 +348,7 @@ golle_error golle_eg_decrypt (const golle_key_t *key,
   /* Get a context for temporaries. */
   ctx = BN_CTX_new ();
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  GOLLE_PROBE1 (eg_decrypt_entry, len);
   BN_CTX_start (ctx);
 
   /* Calculate a^x */
@@ -342,12 +363,12 @@ golle_error golle_eg_decrypt (const golle_key_t *key,
     goto out;
   }
   /* Invert a^x */
-  if (!BN_mod_inverse (ax, ax, TOBN(key->p), ctx)) {
+  if (!golle_bn_mod_inverse (ax, ax, TOBN(key->p), ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
   /* Multiply by b */
-  if (!BN_mod_mul (m, ax, cipher->b, TOBN(key->p), ctx)) {
+  if (!golle_bn_mod_mul (m, ax, cipher->b, TOBN(key->p), ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
@@ -355,5 +376,270 @@ golle_error golle_eg_decrypt (const golle_key_t *key,
  out:
   BN_CTX_end (ctx);
   BN_CTX_free (ctx);
+  GOLLE_PROBE1 (eg_decrypt_return, err);
+  return err;
+}
+
+/* The arguments of a batch, shared by every chunk. */
+typedef struct eg_batch_t {
+  const golle_key_t *key;
+  const golle_num_t *m;
+  const BIGNUM *x; /* The sum of the xi, for decryption. */
+  const golle_eg_t *in;
+  golle_eg_t *out;
+  golle_num_t *plain;
+} eg_batch_t;
+
+/* A chunk is done a group at a time, with the exponents of a group
+ * going to golle_bn_mod_exp_many() together. */
+enum {
+  GROUP = GOLLE_MONT_LANES
+};
+
+/* Get n numbers from the context. */
+static int ctx_get (BN_CTX *ctx, BIGNUM **x, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (!(x[i] = BN_CTX_get (ctx))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Set gr[i] = g^r and hr[i] = h^r, for n new random r. */
+static golle_error exp_random (const golle_key_t *key,
+			       size_t n,
+			       BIGNUM **gr,
+			       BIGNUM **hr,
+			       BN_CTX *ctx)
+{
+  const BIGNUM *base[2 * GROUP], *exp[2 * GROUP];
+  BIGNUM *out[2 * GROUP];
+  golle_num_t r[GROUP] = { NULL };
+  golle_error err = GOLLE_OK;
+
+  for (size_t i = 0; i < n; i++) {
+    if (!(r[i] = r_in_Zq (NULL, key->q))) {
+      err = GOLLE_EMEM;
+      goto out;
+    }
+    base[i] = TOCBN (key->g);
+    base[n + i] = TOCBN (key->h_product);
+    exp[i] = exp[n + i] = TOCBN (r[i]);
+    out[i] = gr[i];
+    out[n + i] = hr[i];
+  }
+  if (!golle_bn_mod_exp_many (out, base, exp, 2 * n, TOCBN (key->p), ctx)) {
+    err = GOLLE_ECRYPTO;
+  }
+ out:
+  for (size_t i = 0; i < n; i++) {
+    golle_num_delete (r[i]);
+  }
+  return err;
+}
+
+/* Set c = (a * g^r, b * h^r), which is an encryption of m if a is 1 and
+ * b is m. */
+static golle_error blind (const golle_key_t *key,
+			  golle_eg_t *c,
+			  const BIGNUM *a,
+			  BIGNUM *gr,
+			  const BIGNUM *b,
+			  BIGNUM *hr,
+			  BN_CTX *ctx)
+{
+  if ((a && !golle_bn_mod_mul (gr, gr, a, TOCBN (key->p), ctx)) ||
+      !golle_bn_mod_mul (hr, hr, b, TOCBN (key->p), ctx)) {
+    return GOLLE_ECRYPTO;
+  }
+  golle_error err = copy_num (&c->a, gr);
+  if (err == GOLLE_OK) {
+    err = copy_num (&c->b, hr);
+  }
+  return err;
+}
+
+static golle_error encrypt_chunk (void *arg, size_t begin, size_t end) {
+  eg_batch_t *b = arg;
+  BIGNUM *gr[GROUP], *hr[GROUP];
+  golle_error err = GOLLE_OK;
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  BN_CTX_start (ctx);
+  if (!ctx_get (ctx, gr, GROUP) || !ctx_get (ctx, hr, GROUP)) {
+    err = GOLLE_EMEM;
+  }
+
+  for (size_t i = begin; i < end && err == GOLLE_OK; i += GROUP) {
+    size_t n = end - i < GROUP ? end - i : GROUP;
+    for (size_t j = 0; j < n && err == GOLLE_OK; j++) {
+      if (BN_cmp (TOCBN (b->m[i + j]), TOCBN (b->key->q)) >= 0) {
+	err = GOLLE_EOUTOFRANGE;
+      }
+    }
+    if (err == GOLLE_OK) {
+      err = exp_random (b->key, n, gr, hr, ctx);
+    }
+    for (size_t j = 0; j < n && err == GOLLE_OK; j++) {
+      err = blind (b->key, b->out + i + j, NULL, gr[j],
+		   TOCBN (b->m[i + j]), hr[j], ctx);
+    }
+  }
+
+  BN_CTX_end (ctx);
+  BN_CTX_free (ctx);
+  return err;
+}
+
+static golle_error reencrypt_chunk (void *arg, size_t begin, size_t end) {
+  eg_batch_t *b = arg;
+  BIGNUM *gr[GROUP], *hr[GROUP];
+  golle_error err = GOLLE_OK;
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  BN_CTX_start (ctx);
+  if (!ctx_get (ctx, gr, GROUP) || !ctx_get (ctx, hr, GROUP)) {
+    err = GOLLE_EMEM;
+  }
+
+  for (size_t i = begin; i < end && err == GOLLE_OK; i += GROUP) {
+    size_t n = end - i < GROUP ? end - i : GROUP;
+    err = exp_random (b->key, n, gr, hr, ctx);
+    for (size_t j = 0; j < n && err == GOLLE_OK; j++) {
+      const golle_eg_t *c = b->in + i + j;
+      err = blind (b->key, b->out + i + j, TOCBN (c->a), gr[j],
+		   TOCBN (c->b), hr[j], ctx);
+    }
+  }
+
+  BN_CTX_end (ctx);
+  BN_CTX_free (ctx);
+  return err;
+}
+
+static golle_error decrypt_chunk (void *arg, size_t begin, size_t end) {
+  eg_batch_t *b = arg;
+  const BIGNUM *p = TOCBN (b->key->p);
+  const BIGNUM *base[GROUP], *exp[GROUP];
+  BIGNUM *ax[GROUP];
+  golle_error err = GOLLE_OK;
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  BN_CTX_start (ctx);
+  if (!ctx_get (ctx, ax, GROUP)) {
+    err = GOLLE_EMEM;
+  }
+
+  /* m = b / a^x for each ciphertext. */
+  for (size_t i = begin; i < end && err == GOLLE_OK; i += GROUP) {
+    size_t n = end - i < GROUP ? end - i : GROUP;
+    for (size_t j = 0; j < n; j++) {
+      const golle_eg_t *c = b->in + i + j;
+      if (!c->a || !c->b || !b->plain[i + j]) {
+	err = GOLLE_ERROR;
+      }
+      base[j] = TOCBN (c->a);
+      exp[j] = b->x;
+    }
+    if (err == GOLLE_OK &&
+	!golle_bn_mod_exp_many (ax, base, exp, n, p, ctx)) {
+      err = GOLLE_ECRYPTO;
+    }
+    for (size_t j = 0; j < n && err == GOLLE_OK; j++) {
+      if (!golle_bn_mod_inverse (ax[j], ax[j], p, ctx) ||
+	  !golle_bn_mod_mul (TOBN (b->plain[i + j]), ax[j],
+			     TOCBN (b->in[i + j].b), p, ctx)) {
+	err = GOLLE_ECRYPTO;
+      }
+    }
+  }
+
+  BN_CTX_end (ctx);
+  BN_CTX_free (ctx);
+  return err;
+}
+
+/* Run a batch of ciphertexts on the default pool, in chunks that fill
+ * the lanes. On failure, none of the output ciphertexts are kept. */
+static golle_error run_cipher_batch (eg_batch_t *b,
+				     size_t count,
+				     golle_pool_fn_t fn)
+{
+  size_t grain = golle_bn_lanes_grain (TOCBN (b->key->p), 2);
+  golle_error err = golle_pool_parallel_for (NULL, count, grain, fn, b);
+  if (err != GOLLE_OK) {
+    for (size_t i = 0; i < count; i++) {
+      golle_eg_clear (b->out + i);
+    }
+  }
+  return err;
+}
+
+golle_error golle_eg_encrypt_many (const golle_key_t *key,
+				   const golle_num_t *m,
+				   golle_eg_t *ciphers,
+				   size_t count)
+{
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  GOLLE_ASSERT (m, GOLLE_ERROR);
+  GOLLE_ASSERT (ciphers, GOLLE_ERROR);
+  GOLLE_ASSERT (key->p, GOLLE_ERROR);
+  GOLLE_ASSERT (key->q, GOLLE_ERROR);
+  GOLLE_ASSERT (key->h_product, GOLLE_ERROR);
+  for (size_t i = 0; i < count; i++) {
+    GOLLE_ASSERT (m[i], GOLLE_ERROR);
+  }
+  eg_batch_t b = { .key = key, .m = m, .out = ciphers };
+  return run_cipher_batch (&b, count, &encrypt_chunk);
+}
+
+golle_error golle_eg_reencrypt_many (const golle_key_t *key,
+				     const golle_eg_t *e1,
+				     golle_eg_t *e2,
+				     size_t count)
+{
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  GOLLE_ASSERT (e1, GOLLE_ERROR);
+  GOLLE_ASSERT (e2, GOLLE_ERROR);
+  GOLLE_ASSERT (key->p, GOLLE_ERROR);
+  GOLLE_ASSERT (key->q, GOLLE_ERROR);
+  GOLLE_ASSERT (key->h_product, GOLLE_ERROR);
+  for (size_t i = 0; i < count; i++) {
+    GOLLE_ASSERT (e1[i].a && e1[i].b, GOLLE_ERROR);
+  }
+  eg_batch_t b = { .key = key, .in = e1, .out = e2 };
+  return run_cipher_batch (&b, count, &reencrypt_chunk);
+}
+
+golle_error golle_eg_decrypt_many (const golle_key_t *key,
+				   const golle_num_t *xi,
+				   size_t len,
+				   const golle_eg_t *ciphers,
+				   golle_num_t *m,
+				   size_t count)
+{
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  GOLLE_ASSERT (xi, GOLLE_ERROR);
+  GOLLE_ASSERT (len, GOLLE_ERROR);
+  GOLLE_ASSERT (ciphers, GOLLE_ERROR);
+  GOLLE_ASSERT (m, GOLLE_ERROR);
+  GOLLE_ASSERT (key->p, GOLLE_ERROR);
+  GOLLE_ASSERT (key->q, GOLLE_ERROR);
+
+  /* Every ciphertext takes the same x: the sum of the xi. */
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  golle_num_t x = golle_num_new ();
+  golle_error err = x ? mod_sum (x, xi, len, key->p, ctx) : GOLLE_EMEM;
+  BN_CTX_free (ctx);
+
+  if (err == GOLLE_OK) {
+    eg_batch_t b = { .key = key, .x = TOCBN (x),
+		     .in = ciphers, .plain = m };
+    size_t grain = golle_bn_lanes_grain (TOCBN (key->p), 1);
+    err = golle_pool_parallel_for (NULL, count, grain, &decrypt_chunk, &b);
+  }
+  golle_num_delete (x);
   return err;
 }
@@ -5,7 +5,8 @@
 #include <golle/config.h>
 #include <golle/numbers.h>
 #include <golle/elgamal.h>
-#include <golle/list.h>
+#include <golle/vector.h>
+#include <golle/pool.h>
 #include <golle/pep.h>
 #if HAVE_STRING_H
 #include <string.h>
@@ -15,27 +16,44 @@
 #endif
 #include <openssl/bn.h>
 #include "numbers.h"
+#include "probes.h"
+
+/* Run one phase of golle_generate(), storing the result in err and
+ * bracketing it with tracepoints. */
+#define RUN_PHASE(name, expr) do {		\
+    GOLLE_PHASE_ENTRY (name);			\
+    err = (expr);				\
+    GOLLE_PHASE_RETURN (name, err);		\
+  } while (0)
 
 /* Represents data sent by a peer */
 typedef struct peer_data_t {
-  golle_commit_t commitment;
+  golle_commit_pack_t commitment;
   golle_eg_t cipher;
-  BIGNUM randomness;
+  BIGNUM *randomness;
   size_t r;
 } peer_data_t;
 
 /* The reserved data */
 typedef struct golle_res_t {
-  /* The set S = { E(g^(ni) } for n = num_items and i in [0, num_peers) */
-  golle_eg_t *S;
   /* The index of the items, g^n. */
-  BIGNUM *items;
+  BIGNUM **items;
   /* Data send by peers. */
   peer_data_t *peer_data;
+  /* Our own commitment. */
+  golle_commit_pack_t commitment;
+  /* For hashing commitments to ciphertexts. */
+  golle_commit_stream_t *stream;
+  /* Locked memory for every commitment, wiped in one go. */
+  golle_bin_arena_t *secure;
   /* The product of all ciphertexts */
   golle_eg_t product;
-  /* A list of encrypted selections for checking collisions */
-  golle_list_t *selections;
+  /* The encrypted selections, for checking collisions */
+  golle_vector_t *selections;
+  /* Montgomery multiplication modulo p, and h in Montgomery form, hR,
+   * for the collision test. Both are made by golle_initialise. */
+  BN_MONT_CTX *mont;
+  BIGNUM *h_mont;
 } golle_res_t;
 
 /* Copy an ElGamal ciphertext */
@@ -48,6 +66,16 @@ static golle_error eg_copy (golle_eg_t *dest, const golle_eg_t *src) {
   return GOLLE_OK;
 }
 
+/* Non-zero if x is in [0, p). */
+static int in_range (const BIGNUM *x, const BIGNUM *p) {
+  return x && !BN_is_negative (x) && BN_cmp (x, p) < 0;
+}
+
+/* Non-zero if x is in [1, p). */
+static int in_Zp (const BIGNUM *x, const BIGNUM *p) {
+  return !BN_is_zero (x) && !BN_is_negative (x) && BN_cmp (x, p) < 0;
+}
+
 /* Use Schnorr to test for ciphertext equivalence. */
 static golle_error collision_test (const golle_t *golle,
 				   const golle_eg_t *e1, 
@@ -56,6 +84,8 @@ static golle_error collision_test (const golle_t *golle,
   golle_error err = GOLLE_OK;
   BN_CTX *ctx;
   BIGNUM *b;
+  const golle_res_t *r = golle->reserved;
+  const BIGNUM *p = golle->key->p;
   if (!GOLLE_EG_FULL (e1) || !GOLLE_EG_FULL(e2)) {
     /* No collision, selection already discarded. */
     return GOLLE_OK;
@@ -69,6 +99,19 @@ static golle_error collision_test (const golle_t *golle,
     goto out;
   }
   
+  /* (m1 * h ^ r1) / (m2 * h ^ r2) == h exactly when
+   * m1 * h ^ r1 == (m2 * h ^ r2) * h. With h in Montgomery form, one
+   * Montgomery product gives the right side as it is, with no inverse
+   * and nothing to convert. */
+  if (in_Zp (e1->b, p) && in_Zp (e2->b, p)) {
+    if (!golle_bn_mod_mul_mont (b, e2->b, r->h_mont, p, r->mont, ctx)) {
+      err = GOLLE_ECRYPTO;
+      goto out;
+    }
+    err = golle_num_cmp (b, e1->b) ? GOLLE_OK : GOLLE_ECOLLISION;
+    goto out;
+  }
+
   /* b = (m1 * h ^ r1) / (m2 * h ^ r2) */
   if ((err = golle_mod_div (b, e1->b, e2->b, golle->key->p, ctx)) != GOLLE_OK)
     {
@@ -96,29 +139,22 @@ static golle_error check_for_collisions (golle_t *golle,
 					 const golle_eg_t *cipher,
 					 size_t *collision)
 {
-  golle_list_iterator_t *iter;
   golle_res_t *r = golle->reserved;
-  golle_error err = golle_list_iterator (r->selections, &iter);
-  if (err == GOLLE_OK) {
-    void *item;
-    size_t index = 0;
-    while ( (err = golle_list_iterator_next (iter, &item)) == GOLLE_OK) {
-      err = collision_test (golle, item, cipher);
-      if (err == GOLLE_ECOLLISION) {
-	/* Collision found at index. Discard the existing item. */
-	golle_eg_clear (item);
-	*collision = index;
-	err = GOLLE_ECOLLISION;
-	break;
-      }
-      else if (err != GOLLE_OK) {
-	break;
-      }
-      index++;
+  golle_error err = GOLLE_OK;
+  size_t count = golle_vector_size (r->selections);
+  GOLLE_PROBE1 (check_for_collisions_entry, count);
+
+  for (size_t index = 0; index < count; index++) {
+    golle_eg_t *item = golle_vector_at (r->selections, index);
+    err = collision_test (golle, item, cipher);
+    if (err == GOLLE_ECOLLISION) {
+      /* Collision found at index. Discard the existing item. */
+      golle_eg_clear (item);
+      *collision = index;
+      break;
     }
-    golle_list_iterator_free (iter);
-    if (err == GOLLE_END) {
-      err = GOLLE_OK;
+    else if (err != GOLLE_OK) {
+      break;
     }
   }
 
@@ -127,32 +163,37 @@ static golle_error check_for_collisions (golle_t *golle,
     golle_eg_t copy = { 0 };
     err = eg_copy (&copy, cipher);
     if (err == GOLLE_OK) {
-      err = golle_list_push (r->selections, &copy, sizeof (copy));
+      err = golle_vector_push (r->selections, &copy);
+    }
+    if (err != GOLLE_OK) {
+      golle_eg_clear (&copy);
     }
   }
+  GOLLE_PROBE1 (check_for_collisions_return, err);
   return err;
 }
 
-/* Clear all of the items from the list. */
-static void clear_selections (golle_list_t *selections) {
-  golle_list_iterator_t *iter;
-  golle_error err = golle_list_iterator (selections, &iter);
-  if (err == GOLLE_OK) {
+/* Clear all of the items from the vector. */
+static void clear_selections (golle_vector_t *selections) {
+  golle_vector_iterator_t iter;
+  if (golle_vector_iterator (selections, &iter) == GOLLE_OK) {
     void *item;
-    while ( (err = golle_list_iterator_next (iter, &item)) == GOLLE_OK) {
+    while (golle_vector_iterator_next (&iter, &item) == GOLLE_OK) {
       golle_eg_clear (item);
     }
-    golle_list_iterator_free (iter);
   }
 }
 
-/* Compute the item set. This is g^n for each item number n. */
-static golle_error precompute_items (BIGNUM *items,
-				     size_t num_items,
-				     const golle_key_t *key)
-{
+/* The arguments of a precomputation, shared by every chunk. */
+typedef struct precompute_t {
+  const golle_key_t *key;
+  BIGNUM **items;
+} precompute_t;
+
+/* Compute g^n for the item numbers n in [begin, end). */
+static golle_error items_chunk (void *arg, size_t begin, size_t end) {
+  precompute_t *pc = arg;
   golle_error err = GOLLE_OK;
-  size_t i = 0;
   /* A context for mod_exp in a loop. */
   BN_CTX *ctx = BN_CTX_new ();
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
@@ -165,69 +206,41 @@ static golle_error precompute_items (BIGNUM *items,
   }
 
   /* Compute each exponential */
-  for (;err == GOLLE_OK && i < num_items; i++) {
-    BIGNUM *b = items + i;
-    BN_init (b);
+  for (size_t i = begin; err == GOLLE_OK && i < end; i++) {
     if (!BN_set_word (t, i)) {
       err = GOLLE_EMEM;
     }
-    else if (!BN_mod_exp (b, key->g, t, key->p, ctx)) {
+    else if (!golle_bn_mod_exp (pc->items[i], pc->key->g, t,
+				pc->key->p, ctx)) {
       err = GOLLE_EMEM;
     }
   }
 
   BN_CTX_end (ctx);
   BN_CTX_free (ctx);
-  if (err != GOLLE_OK) {
-    /* Clean up everything that was initialised. */
-    for (size_t j = 0; j < i; j++) {
-      BN_clear (items + j);
-    }
-  }
   return err;
 }
 
-/* Compute the S set. */
-static golle_error precompute_S (golle_eg_t *S,
-				 size_t num_peers,
-				 size_t num_items,
-				 const golle_key_t *key)
+/* Compute the item set. This is g^n for each item number n.
+ * The items are independent, so they are shared out over the pool. */
+static golle_error precompute_items (BIGNUM **items,
+				     size_t num_items,
+				     const golle_key_t *key)
 {
-  
-  golle_error err = GOLLE_OK;
-  size_t i = 0;
-  /* A context for mod_exp in a loop. */
-  BN_CTX *ctx = BN_CTX_new ();
-  GOLLE_ASSERT (ctx, GOLLE_EMEM);
-  BN_CTX_start (ctx);
-
-  /* Temporary for the exponent. */
-  BIGNUM *t = BN_CTX_get (ctx);
-  if (!t) {
-    err = GOLLE_EMEM;
-  }
-
-  /* Compute each exponential */
-  for (;err == GOLLE_OK && i < num_peers; i++) {
-    golle_eg_t *eg = S + i;
-
-    if (!BN_set_word (t, i * num_items)) {
-      err = GOLLE_EMEM;
-    }
-    else if (!BN_mod_exp (t, key->g, t, key->q, ctx)) {
-      err = GOLLE_EMEM;
-    }
-    else {
-      err = golle_eg_encrypt (key, t, eg, NULL);
+  precompute_t pc = { .key = key, .items = items };
+  for (size_t i = 0; i < num_items; i++) {
+    /* golle_clear() frees any that were made. */
+    if (!(items[i] = BN_new ())) {
+      return GOLLE_EMEM;
     }
   }
 
-  BN_CTX_end (ctx);
-  BN_CTX_free (ctx);
+  golle_error err = golle_pool_parallel_for (NULL, num_items, 0,
+					     &items_chunk, &pc);
   if (err != GOLLE_OK) {
-    /* Clean up everything that was initialised. */
-    for (size_t j = 0; j < i; j++) {
-      golle_eg_clear (S + j);
+    /* Clean up everything. */
+    for (size_t i = 0; i < num_items; i++) {
+      BN_clear (items[i]);
     }
   }
   return err;
@@ -260,49 +273,31 @@ static golle_error small_random (golle_num_t r,
   return err;
 }
 
-/* Get a ciphertext as a buffer */
-static golle_error eg_to_buffer (golle_bin_t *result,
-				     const golle_eg_t *c) 
+/* Feed a ciphertext to a commitment stream. Both numbers are the
+ * width of p, so the encoding is unambiguous. */
+static golle_error stream_cipher (const golle_t *golle,
+				  golle_commit_stream_t *stream,
+				  const golle_eg_t *n)
 {
-  golle_error err = GOLLE_OK;
-  golle_bin_t b1 = { 0 }, b2 = { 0 };
-  /* Get both numbers as buffers */
-  err = golle_num_to_bin (c->a, &b1);
-  if (err != GOLLE_OK) {
-    goto out;
-  }
-  err = golle_num_to_bin (c->a, &b1);
-  if (err != GOLLE_OK) {
-    goto out;
-  }
-  /* Make result the correct size */
-  err = golle_bin_resize (result, b1.size + b2.size);
-  if (err != GOLLE_OK) {
-    goto out;
+  size_t width = BN_num_bytes (golle->key->p);
+  golle_error err = golle_commit_stream_num (stream, n->a, width);
+  if (err == GOLLE_OK) {
+    err = golle_commit_stream_num (stream, n->b, width);
   }
-
-  /* Concatenate */
-  memcpy (result->bin, b1.bin, b1.size);
-  memcpy ((char *)result->bin + b1.size, b2.bin, b2.size);
-
- out:
-  golle_bin_clear (&b1);
-  golle_bin_clear (&b2);
   return err;
 }
 
 /* Get a commitment to the ciphertext */
-static golle_commit_t *commit_to_cipher (const golle_eg_t *n) {
-  /* Get ciphertext as a buffer */
-  golle_bin_t b = { 0 };
-  golle_error err = eg_to_buffer (&b, n);
-  if (err != GOLLE_OK) {
-    return NULL;
+static golle_error commit_to_cipher (golle_t *golle, const golle_eg_t *n) {
+  golle_res_t *r = golle->reserved;
+  golle_error err = golle_commit_pack_begin (&r->commitment, r->stream);
+  if (err == GOLLE_OK) {
+    err = stream_cipher (golle, r->stream, n);
   }
-  /* Get commitment to buffer */
-  golle_commit_t *c = golle_commit_new (&b);
-  golle_bin_clear (&b);
-  return c;
+  if (err == GOLLE_OK) {
+    err = golle_commit_pack_end (&r->commitment, r->stream);
+  }
+  return err;
 }
 
 /* Sum up selections to get the final choice */
@@ -340,7 +335,7 @@ static golle_error validate_encryption (const golle_key_t *key,
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_exp (e, key->g, base, key->q, ctx)) {
+  if (!golle_bn_mod_exp (e, key->g, base, key->q, ctx)) {
     err = GOLLE_EMEM;
     goto out;
   }
@@ -369,8 +364,11 @@ static golle_error get_randoms (golle_t *golle) {
     peer_data_t *p = r->peer_data + i;
 
     /* Accept from peer i */
-    BN_init (&p->randomness);
-    err = golle->accept_rand (golle, i, &p->r, &p->randomness);
+    if (!p->randomness && !(p->randomness = BN_new ())) {
+      err = GOLLE_EMEM;
+      break;
+    }
+    err = golle->accept_rand (golle, i, &p->r, p->randomness);
     if (err != GOLLE_OK) {
       break;
     }
@@ -385,7 +383,7 @@ static golle_error get_randoms (golle_t *golle) {
     err = validate_encryption (golle->key,
 			       &p->cipher,
 			       p->r,
-			       &p->randomness);
+			       p->randomness);
     if (err != GOLLE_OK) {
       break;
     }
@@ -407,11 +405,7 @@ static golle_error get_commitments (golle_t *golle) {
     if (err != GOLLE_OK) break;
 
     /* Copy into storage. */
-    if (!(p->commitment.rsend = golle_bin_copy (&rsend)) ||
-	!(p->commitment.hash = golle_bin_copy (&hash)))
-      {
-	err = GOLLE_EMEM;
-      }
+    err = golle_commit_pack_set (&p->commitment, NULL, &rsend, NULL, &hash);
 
     /* Clean up */
     golle_bin_clear (&rsend);
@@ -426,7 +420,7 @@ static golle_error get_commitments (golle_t *golle) {
 /* Get the revealed commitments from each peer */
 static golle_error get_ciphertexts (golle_t *golle) {
   golle_error err = GOLLE_OK;;
-  golle_bin_t rkeep = { 0 }, secret = { 0 };
+  golle_bin_t rkeep = { 0 };
   golle_eg_t cipher = { 0 };
 
   golle_res_t *r = golle->reserved;
@@ -437,24 +431,13 @@ static golle_error get_ciphertexts (golle_t *golle) {
     err = golle->accept_eg (golle, i, &cipher, &rkeep);
     if (err != GOLLE_OK) break;
 
-    /* Convert cipher to a buffer */
-    err = eg_to_buffer (&secret, &cipher);
-    if (err != GOLLE_OK) break;
-
-    /* Copy into storage. */
-    if (!(p->commitment.rkeep = golle_bin_copy (&rkeep)) ||
-	!(p->commitment.secret = golle_bin_copy (&secret))) 
-      {
-	err = GOLLE_EMEM;
-      }
-    if (!(p->cipher.a = golle_num_dup (cipher.a)) ||
-	!(p->cipher.b = golle_num_dup (cipher.b)))
-      {
-	err = GOLLE_EMEM;
-      }
+    /* Keep rkeep, and take the ciphertext. The commitment is checked
+     * against the ciphertext itself, so it isn't stored again. */
+    err = golle_commit_pack_set (&p->commitment, NULL, NULL, &rkeep, NULL);
+    p->cipher = cipher;
+    cipher.a = cipher.b = NULL;
 
     /* Clean up */
-    golle_bin_clear (&secret);
     golle_bin_clear (&rkeep);
     golle_eg_clear (&cipher);
     if (err != GOLLE_OK) {
@@ -468,15 +451,27 @@ static golle_error get_ciphertexts (golle_t *golle) {
 static golle_error check_commitments (golle_t *golle) {
   golle_error err = GOLLE_OK;
   golle_res_t *r = golle->reserved;
-  for (size_t i = 0; i < golle->num_peers; i++) {
+  for (size_t i = 0; i < golle->num_peers && err == GOLLE_OK; i++) {
     peer_data_t *p = r->peer_data + i;
+    const golle_commit_t *c = &p->commitment.commit;
 
-    err = golle_commit_verify (&p->commitment);
-    if (err != GOLLE_COMMIT_PASSED) {
-      err = GOLLE_ENOCOMMIT;
-      break;
+    if (!c->rsend || !c->rkeep || !c->hash) {
+      return GOLLE_ENOCOMMIT;
+    }
+    /* Nothing outside [0, p) can have been committed to, and it
+     * wouldn't stream. That's the peer's fault, not ours. */
+    if (!in_range (p->cipher.a, golle->key->p) ||
+	!in_range (p->cipher.b, golle->key->p)) {
+      return GOLLE_ENOCOMMIT;
+    }
+    err = golle_commit_stream_begin (r->stream, c->rsend, c->rkeep);
+    if (err == GOLLE_OK) {
+      err = stream_cipher (golle, r->stream, &p->cipher);
+    }
+    if (err == GOLLE_OK) {
+      err = golle_commit_stream_check (r->stream, c->hash);
+      err = err == GOLLE_COMMIT_PASSED ? GOLLE_OK : GOLLE_ENOCOMMIT;
     }
-    err = GOLLE_OK;
   }
   return err;
 }
@@ -487,56 +482,33 @@ static void clear_peer_data (golle_t *golle) {
   for (size_t i = 0; i < golle->num_peers; i++) {
     peer_data_t *p = r->peer_data + i;
 
-    golle_commit_clear (&p->commitment);
+    golle_commit_pack_reset (&p->commitment);
     golle_eg_clear (&p->cipher);
-    BN_clear_free (&p->randomness);
+    BN_clear_free (p->randomness);
+    p->randomness = NULL;
   }
   golle_eg_clear (&r->product);
 }
 
 /* Compute the product of all ciphertexts */
 static golle_error prod_ciphers (golle_t *golle) {
-  BIGNUM *a, *b;
-  golle_error err = GOLLE_OK;
   golle_res_t *r = golle->reserved;
-  BN_CTX *ctx = BN_CTX_new ();
-  GOLLE_ASSERT (ctx, GOLLE_EMEM);
-  
-  BN_CTX_start (ctx);
-  if (!(a = BN_CTX_get (ctx)) ||
-      !(b = BN_CTX_get (ctx)) ||
-      !BN_set_word (a, 1) ||
-      !BN_set_word (b, 1))
-    {
-      err = GOLLE_EMEM;
-      goto out;
-    }
-
   for (size_t i = 0; i < golle->num_peers; i++) {
-    peer_data_t *p = r->peer_data + i;
-    if (!BN_mod_mul (a, a, p->cipher.a, golle->key->p, ctx) ||
-	!BN_mod_mul (b, b, p->cipher.b, golle->key->p, ctx))
-      {
-	err = GOLLE_ECRYPTO;
-	goto out;
-      }
-  }
-  if (!(r->product.a = golle_num_dup (a)) ||
-      !(r->product.b = golle_num_dup (b)))
-    {
-      err = GOLLE_EMEM;
-      goto out;
+    golle_error err = golle_eg_mul (golle->key,
+				    &r->product,
+				    &r->peer_data[i].cipher);
+    if (err != GOLLE_OK) {
+      return err;
     }
-
- out:
-  BN_CTX_free (ctx);
-  return err;
+  }
+  return GOLLE_OK;
 }
 
 golle_error golle_initialise (golle_t *golle) {
   golle_error err = GOLLE_OK;
   GOLLE_ASSERT (golle, GOLLE_ERROR);
   GOLLE_ASSERT (golle->key, GOLLE_ERROR);
+  GOLLE_ASSERT (golle->key->h_product, GOLLE_ERROR);
   GOLLE_ASSERT (golle->num_peers, GOLLE_ERROR);
   GOLLE_ASSERT (golle->num_items, GOLLE_ERROR);
 
@@ -544,13 +516,32 @@ golle_error golle_initialise (golle_t *golle) {
   golle_res_t *priv = calloc (sizeof (golle_res_t), 1);
   GOLLE_ASSERT (priv, GOLLE_EMEM);
 
-  if (!(priv->S = calloc (sizeof (golle_eg_t), golle->num_peers)) ||
-      !(priv->items = calloc (sizeof (BIGNUM), golle->num_items)) ||
-      !(priv->peer_data = calloc (sizeof(peer_data_t), golle->num_peers)))
+  if (!(priv->items = calloc (sizeof (BIGNUM *), golle->num_items)) ||
+      !(priv->peer_data = calloc (sizeof(peer_data_t), golle->num_peers)) ||
+      !(priv->stream = golle_commit_stream_new ()) ||
+      !(priv->secure = golle_bin_arena_new_secure (0)) ||
+      !(priv->mont = BN_MONT_CTX_new ()) ||
+      !(priv->h_mont = BN_new ()))
     {
       err = GOLLE_EMEM;
       goto out;
     }
+  BN_CTX *ctx = BN_CTX_new ();
+  if (!ctx || !BN_MONT_CTX_set (priv->mont, golle->key->p, ctx) ||
+      !BN_nnmod (priv->h_mont, golle->key->h_product, golle->key->p, ctx) ||
+      !BN_to_montgomery (priv->h_mont, priv->h_mont, priv->mont, ctx))
+    {
+      /* p must be odd, as a prime is. */
+      err = ctx ? GOLLE_ECRYPTO : GOLLE_EMEM;
+    }
+  BN_CTX_free (ctx);
+  if (err != GOLLE_OK) {
+    goto out;
+  }
+  priv->commitment.pool = priv->secure;
+  for (size_t i = 0; i < golle->num_peers; i++) {
+    priv->peer_data[i].commitment.pool = priv->secure;
+  }
 
   /* Pre-compute the item set. */
   err = precompute_items (priv->items, 
@@ -560,16 +551,11 @@ golle_error golle_initialise (golle_t *golle) {
     goto out;
   }
 
-  /* Pre-compute the S set. */
-  err = precompute_S (priv->S, 
-		      golle->num_peers, 
-		      golle->num_items,  
-		      golle->key);
-  if (err != GOLLE_OK) {
-    goto out;
+  /* Allocate the selections, with room for a whole deal. */
+  err = golle_vector_new (&priv->selections, sizeof (golle_eg_t));
+  if (err == GOLLE_OK) {
+    err = golle_vector_reserve (priv->selections, golle->num_items);
   }
-  /* Allocate the list */
-  err = golle_list_new (&priv->selections);
   if (err != GOLLE_OK) {
     goto out;
   }
@@ -589,15 +575,10 @@ void golle_clear (golle_t *golle) {
       return;
     }
 
-    if (r->S) {
-      for (size_t i = 0; i < golle->num_peers; i++) {
-	golle_eg_clear (r->S + i);
-      }
-      free (r->S);
-    }
     if (r->items) {
+      /* The items are public, so there's nothing to wipe. */
       for (size_t i = 0; i < golle->num_items; i++) {
-	BN_clear_free(r->items + i);
+	BN_free(r->items[i]);
       }
       free (r->items);
     }
@@ -605,11 +586,16 @@ void golle_clear (golle_t *golle) {
       clear_peer_data (golle);
       free (r->peer_data);
     }
+    golle_commit_stream_delete (r->stream);
     /* Clear the list */
     clear_selections (r->selections);
-    golle_list_delete (r->selections);
+    golle_vector_delete (r->selections);
 
     golle_eg_clear (&r->product);
+    BN_MONT_CTX_free (r->mont);
+    BN_free (r->h_mont);
+    /* Every commitment lives in the secure arena. */
+    golle_bin_arena_delete (r->secure);
     free (r);
   }
 }
@@ -627,6 +613,8 @@ golle_error golle_generate (golle_t *golle,
   golle_commit_t *commit = NULL;
   golle_error err = GOLLE_OK;
   GOLLE_ASSERT (golle, GOLLE_ERROR);
+  GOLLE_ASSERT (golle->reserved, GOLLE_ERROR);
+  golle_res_t *res = golle->reserved;
   GOLLE_ASSERT (peer < golle->num_peers || peer == GOLLE_FACE_UP, GOLLE_ERROR);
   GOLLE_ASSERT (golle->bcast_commit, GOLLE_ERROR);
   GOLLE_ASSERT (golle->bcast_secret, GOLLE_ERROR);
@@ -642,6 +630,7 @@ golle_error golle_generate (golle_t *golle,
   /* A context for random numbers and exponents */
   BN_CTX *ctx = BN_CTX_new ();
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  GOLLE_PROBE2 (generate_entry, round, peer);
   BN_CTX_start (ctx);
 
   /* Initialise temporaries */
@@ -661,69 +650,74 @@ golle_error golle_generate (golle_t *golle,
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_exp (gr, golle->key->g, r, golle->key->q, ctx)) {
+  if (!golle_bn_mod_exp (gr, golle->key->g, r, golle->key->q, ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
 
   /* Get ciphertext C = E(g^r) */
-  err = golle_eg_encrypt (golle->key, gr, &C, (golle_num_t *)&crand);
+  RUN_PHASE ("encrypt",
+	     golle_eg_encrypt (golle->key, gr, &C, (golle_num_t *)&crand));
   if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Get a commitment to C */
-  if (!(commit = commit_to_cipher (&C))) {
-    err = GOLLE_EMEM;
+  RUN_PHASE ("commit", commit_to_cipher (golle, &C));
+  if (err != GOLLE_OK) {
     goto out;
   }
+  commit = &res->commitment.commit;
 
   /* Output the commitment */
-  err = golle->bcast_commit (golle, commit->rsend, commit->hash);
+  RUN_PHASE ("bcast_commit",
+	     golle->bcast_commit (golle, commit->rsend, commit->hash));
   if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Accept the commitment from each peer */
-  err = get_commitments (golle);
+  RUN_PHASE ("accept_commit", get_commitments (golle));
   if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Output the ciphertext and rkeep buffers */
-  err = golle->bcast_secret (golle, &C, commit->rkeep);
+  RUN_PHASE ("bcast_secret", golle->bcast_secret (golle, &C, commit->rkeep));
   if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Accept the ciphertext and rkeep buffers */
-  err = get_ciphertexts (golle);
+  RUN_PHASE ("accept_eg", get_ciphertexts (golle));
   if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Check all commitments. */
-  err = check_commitments (golle);
+  RUN_PHASE ("verify", check_commitments (golle));
   if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Compute the product of all of the ciphers */
-  err = prod_ciphers (golle);
+  RUN_PHASE ("combine", prod_ciphers (golle));
   if (err != GOLLE_OK) {
     goto out;
   }
 
   /* Send the selection and random value to the correct peer(s) */
-  err = golle->reveal_rand (golle, peer, BN_get_word (r), crand);
+  RUN_PHASE ("reveal_rand",
+	     golle->reveal_rand (golle, peer, BN_get_word (r), crand));
 
  out:
   BN_CTX_end (ctx);
   BN_CTX_free (ctx);
   golle_eg_clear (&C);
-  golle_commit_delete (commit);
+  golle_commit_pack_reset (&res->commitment);
   clear_peer_data (golle);
   golle_num_delete (crand);
+  GOLLE_PROBE1 (generate_return, err);
   return err;
 }
 
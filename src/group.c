@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include "group.h"
+#include "numbers.h"
+#include <stdlib.h>
+
+/* Shorthand for a call into the kind of group. */
+#define OPS(group) ((group)->ops)
+
+/* Hand out a group that was filled in, or free it if that failed. */
+static golle_error group_new (golle_group_t **group,
+			      golle_error err,
+			      golle_group_t *g)
+{
+  if (err != GOLLE_OK) {
+    golle_group_delete (g);
+    return err;
+  }
+  *group = g;
+  return GOLLE_OK;
+}
+
+golle_error golle_group_new_modp (golle_group_t **group,
+				  const golle_key_t *key)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  golle_group_t *g = calloc (1, sizeof (*g));
+  GOLLE_ASSERT (g, GOLLE_EMEM);
+  return group_new (group, golle_group_init_modp (g, key), g);
+}
+
+golle_error golle_group_new_curve (golle_group_t **group,
+				   golle_curve curve)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  golle_group_t *g = calloc (1, sizeof (*g));
+  GOLLE_ASSERT (g, GOLLE_EMEM);
+  return group_new (group, golle_group_init_curve (g, curve), g);
+}
+
+void golle_group_delete (golle_group_t *group) {
+  if (group) {
+    if (group->ops) {
+      OPS (group)->destroy (group);
+    }
+    BN_free (group->order);
+    free (group);
+  }
+}
+
+const char *golle_group_name (const golle_group_t *group) {
+  GOLLE_ASSERT (group, NULL);
+  return OPS (group)->name (group);
+}
+
+golle_num_t golle_group_order (const golle_group_t *group) {
+  GOLLE_ASSERT (group, NULL);
+  return group->order;
+}
+
+size_t golle_group_elem_size (const golle_group_t *group) {
+  GOLLE_ASSERT (group, 0);
+  return group->elem_size;
+}
+
+golle_elem_t *golle_elem_new (const golle_group_t *group) {
+  GOLLE_ASSERT (group, NULL);
+  return OPS (group)->elem_new (group);
+}
+
+void golle_elem_delete (const golle_group_t *group, golle_elem_t *e) {
+  if (group && e) {
+    OPS (group)->elem_delete (e);
+  }
+}
+
+golle_error golle_elem_cpy (const golle_group_t *group,
+			    golle_elem_t *dst,
+			    const golle_elem_t *src)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  GOLLE_ASSERT (dst, GOLLE_ERROR);
+  GOLLE_ASSERT (src, GOLLE_ERROR);
+  GOLLE_ASSERT (OPS (group)->cpy (group, dst, src), GOLLE_EMEM);
+  return GOLLE_OK;
+}
+
+int golle_elem_cmp (const golle_group_t *group,
+		    const golle_elem_t *a,
+		    const golle_elem_t *b)
+{
+  GOLLE_ASSERT (group, 1);
+  GOLLE_ASSERT (a, 1);
+  GOLLE_ASSERT (b, 1);
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, 1);
+  int c = OPS (group)->cmp (group, a, b, ctx);
+  BN_CTX_free (ctx);
+  return c;
+}
+
+golle_error golle_group_exp (const golle_group_t *group,
+			     golle_elem_t *r,
+			     const golle_elem_t *a,
+			     const golle_num_t n)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  GOLLE_ASSERT (r, GOLLE_ERROR);
+  GOLLE_ASSERT (n, GOLLE_ERROR);
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+
+  golle_error err = GOLLE_OK;
+  if (!OPS (group)->exp (group, r, a, n, ctx)) {
+    err = GOLLE_ECRYPTO;
+  }
+  BN_CTX_free (ctx);
+  return err;
+}
+
+golle_error golle_group_mul (const golle_group_t *group,
+			     golle_elem_t *r,
+			     const golle_elem_t *a,
+			     const golle_elem_t *b)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  GOLLE_ASSERT (r, GOLLE_ERROR);
+  GOLLE_ASSERT (a, GOLLE_ERROR);
+  GOLLE_ASSERT (b, GOLLE_ERROR);
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+
+  golle_error err = GOLLE_OK;
+  if (!OPS (group)->mul (group, r, a, b, ctx)) {
+    err = GOLLE_ECRYPTO;
+  }
+  BN_CTX_free (ctx);
+  return err;
+}
+
+golle_error golle_group_inv (const golle_group_t *group,
+			     golle_elem_t *r,
+			     const golle_elem_t *a)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  GOLLE_ASSERT (r, GOLLE_ERROR);
+  GOLLE_ASSERT (a, GOLLE_ERROR);
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+
+  golle_error err = GOLLE_OK;
+  if (!OPS (group)->inv (group, r, a, ctx)) {
+    err = GOLLE_ECRYPTO;
+  }
+  BN_CTX_free (ctx);
+  return err;
+}
+
+golle_error golle_elem_to_bin (const golle_group_t *group,
+			       const golle_elem_t *e,
+			       golle_bin_t *bin)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  GOLLE_ASSERT (e, GOLLE_ERROR);
+  GOLLE_ASSERT (bin, GOLLE_ERROR);
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  golle_error err = OPS (group)->to_bin (group, e, bin, ctx);
+  BN_CTX_free (ctx);
+  return err;
+}
+
+golle_error golle_bin_to_elem (const golle_group_t *group,
+			       const golle_bin_t *bin,
+			       golle_elem_t *e)
+{
+  GOLLE_ASSERT (group, GOLLE_ERROR);
+  GOLLE_ASSERT (bin, GOLLE_ERROR);
+  GOLLE_ASSERT (bin->bin, GOLLE_ERROR);
+  GOLLE_ASSERT (e, GOLLE_ERROR);
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  golle_error err = OPS (group)->from_bin (group, bin, e, ctx);
+  BN_CTX_free (ctx);
+  return err;
+}
+
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_GROUP_H
+#define GOLLE_SRC_GROUP_H
+
+#include <golle/group.h>
+#include <openssl/bn.h>
+
+/*
+ * The operations of one kind of group. group.c checks the arguments
+ * and makes the context; group_modp.c and group_ec.c do the work.
+ */
+typedef struct group_ops_t {
+  const char *(*name) (const golle_group_t *group);
+  void (*destroy) (golle_group_t *group);
+  golle_elem_t *(*elem_new) (const golle_group_t *group);
+  void (*elem_delete) (golle_elem_t *e);
+  int (*cpy) (const golle_group_t *group,
+	      golle_elem_t *dst,
+	      const golle_elem_t *src);
+  int (*cmp) (const golle_group_t *group,
+	      const golle_elem_t *a,
+	      const golle_elem_t *b,
+	      BN_CTX *ctx);
+  /* a is NULL for the generator. */
+  int (*exp) (const golle_group_t *group,
+	      golle_elem_t *r,
+	      const golle_elem_t *a,
+	      const BIGNUM *n,
+	      BN_CTX *ctx);
+  int (*mul) (const golle_group_t *group,
+	      golle_elem_t *r,
+	      const golle_elem_t *a,
+	      const golle_elem_t *b,
+	      BN_CTX *ctx);
+  int (*inv) (const golle_group_t *group,
+	      golle_elem_t *r,
+	      const golle_elem_t *a,
+	      BN_CTX *ctx);
+  golle_error (*to_bin) (const golle_group_t *group,
+			 const golle_elem_t *e,
+			 golle_bin_t *bin,
+			 BN_CTX *ctx);
+  golle_error (*from_bin) (const golle_group_t *group,
+			   const golle_bin_t *bin,
+			   golle_elem_t *e,
+			   BN_CTX *ctx);
+} group_ops_t;
+
+struct golle_group_t {
+  const group_ops_t *ops;
+  /* The order, q */
+  BIGNUM *order;
+  /* The size of an element written out. */
+  size_t elem_size;
+  /* Whatever the kind of group needs. */
+  void *impl;
+};
+
+/* Fill in a group of each kind. */
+GOLLE_EXTERN golle_error golle_group_init_modp (golle_group_t *group,
+						const golle_key_t *key);
+GOLLE_EXTERN golle_error golle_group_init_curve (golle_group_t *group,
+						 golle_curve curve);
+
+#endif
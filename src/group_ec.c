@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include "group.h"
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+
+/* Elements are EC_POINTs on the curve held in impl. */
+#define CURVE(group) ((const EC_GROUP *)(group)->impl)
+#define PT(e) ((EC_POINT *)(e))
+#define CPT(e) ((const EC_POINT *)(e))
+
+static const char *ec_name (const golle_group_t *group) {
+  switch (EC_GROUP_get_curve_name (CURVE (group))) {
+  case NID_X9_62_prime256v1:
+    return "p256";
+  case NID_secp384r1:
+    return "p384";
+  }
+  return "ec";
+}
+
+static void ec_destroy (golle_group_t *group) {
+  EC_GROUP_free (group->impl);
+}
+
+static golle_elem_t *ec_elem_new (const golle_group_t *group) {
+  return (golle_elem_t *)EC_POINT_new (CURVE (group));
+}
+
+static void ec_elem_delete (golle_elem_t *e) {
+  EC_POINT_clear_free (PT (e));
+}
+
+static int ec_cpy (const golle_group_t *group,
+		   golle_elem_t *dst,
+		   const golle_elem_t *src)
+{
+  GOLLE_UNUSED (group);
+  return EC_POINT_copy (PT (dst), CPT (src));
+}
+
+static int ec_cmp (const golle_group_t *group,
+		   const golle_elem_t *a,
+		   const golle_elem_t *b,
+		   BN_CTX *ctx)
+{
+  return EC_POINT_cmp (CURVE (group), CPT (a), CPT (b), ctx);
+}
+
+static int ec_exp (const golle_group_t *group,
+		   golle_elem_t *r,
+		   const golle_elem_t *a,
+		   const BIGNUM *n,
+		   BN_CTX *ctx)
+{
+  /* The generator has its own precomputed multiples. */
+  if (!a) {
+    return EC_POINT_mul (CURVE (group), PT (r), n, NULL, NULL, ctx);
+  }
+  return EC_POINT_mul (CURVE (group), PT (r), NULL, CPT (a), n, ctx);
+}
+
+static int ec_mul (const golle_group_t *group,
+		   golle_elem_t *r,
+		   const golle_elem_t *a,
+		   const golle_elem_t *b,
+		   BN_CTX *ctx)
+{
+  return EC_POINT_add (CURVE (group), PT (r), CPT (a), CPT (b), ctx);
+}
+
+static int ec_inv (const golle_group_t *group,
+		   golle_elem_t *r,
+		   const golle_elem_t *a,
+		   BN_CTX *ctx)
+{
+  if (r != a && !EC_POINT_copy (PT (r), CPT (a))) {
+    return 0;
+  }
+  return EC_POINT_invert (CURVE (group), PT (r), ctx);
+}
+
+static golle_error ec_to_bin (const golle_group_t *group,
+			      const golle_elem_t *e,
+			      golle_bin_t *bin,
+			      BN_CTX *ctx)
+{
+  const point_conversion_form_t form = POINT_CONVERSION_COMPRESSED;
+  /* The identity is a single zero byte. */
+  size_t size = EC_POINT_point2oct (CURVE (group), CPT (e), form,
+				    NULL, 0, ctx);
+  GOLLE_ASSERT (size, GOLLE_ECRYPTO);
+  GOLLE_ASSERT (golle_bin_resize (bin, size) == GOLLE_OK, GOLLE_EMEM);
+  if (EC_POINT_point2oct (CURVE (group), CPT (e), form,
+			  bin->bin, size, ctx) != size) {
+    return GOLLE_ECRYPTO;
+  }
+  return GOLLE_OK;
+}
+
+static golle_error ec_from_bin (const golle_group_t *group,
+				const golle_bin_t *bin,
+				golle_elem_t *e,
+				BN_CTX *ctx)
+{
+  /* OpenSSL checks that the point is on the curve. The curves have a
+   * cofactor of 1, so that puts it in the group. */
+  if (!EC_POINT_oct2point (CURVE (group), PT (e), bin->bin, bin->size, ctx)) {
+    return GOLLE_EOUTOFRANGE;
+  }
+  return GOLLE_OK;
+}
+
+static const group_ops_t ec_ops = {
+  .name = &ec_name,
+  .destroy = &ec_destroy,
+  .elem_new = &ec_elem_new,
+  .elem_delete = &ec_elem_delete,
+  .cpy = &ec_cpy,
+  .cmp = &ec_cmp,
+  .exp = &ec_exp,
+  .mul = &ec_mul,
+  .inv = &ec_inv,
+  .to_bin = &ec_to_bin,
+  .from_bin = &ec_from_bin
+};
+
+golle_error golle_group_init_curve (golle_group_t *group,
+				    golle_curve curve)
+{
+  int nid;
+  switch (curve) {
+  case GOLLE_CURVE_P256:
+    nid = NID_X9_62_prime256v1;
+    break;
+  case GOLLE_CURVE_P384:
+    nid = NID_secp384r1;
+    break;
+  default:
+    return GOLLE_EINVALID;
+  }
+
+  EC_GROUP *ec = EC_GROUP_new_by_curve_name (nid);
+  GOLLE_ASSERT (ec, GOLLE_EMEM);
+  group->ops = &ec_ops;
+  group->impl = ec;
+  if (!(group->order = BN_new ()) ||
+      !EC_GROUP_get_order (ec, group->order, NULL))
+    {
+      return GOLLE_EMEM;
+    }
+  /* A compressed point: a tag byte, then x. */
+  group->elem_size = 1 + (EC_GROUP_get_degree (ec) + 7) / 8;
+  return GOLLE_OK;
+}
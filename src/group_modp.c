@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include "group.h"
+#include "numbers.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The order q subgroup of Z*p. Elements are BIGNUMs in Montgomery form,
+ * xR mod p, so a product is one Montgomery multiplication with nothing
+ * to convert. Since x -> xR mod p is one-to-one, equal elements have
+ * equal forms and are compared as they are. Only writing an element
+ * out, and raising it to a power, which the kernels do in their own
+ * form, take it back to x.
+ */
+typedef struct modp_t {
+  BIGNUM *p;
+  BIGNUM *g;
+  BN_MONT_CTX *mont;
+} modp_t;
+
+#define MODP(group) ((const modp_t *)(group)->impl)
+#define BN(e) ((BIGNUM *)(e))
+#define CBN(e) ((const BIGNUM *)(e))
+
+static const char *modp_name (const golle_group_t *group) {
+  GOLLE_UNUSED (group);
+  return "modp";
+}
+
+static void modp_destroy (golle_group_t *group) {
+  modp_t *m = group->impl;
+  if (m) {
+    BN_free (m->p);
+    BN_free (m->g);
+    BN_MONT_CTX_free (m->mont);
+    free (m);
+  }
+}
+
+static golle_elem_t *modp_elem_new (const golle_group_t *group) {
+  GOLLE_UNUSED (group);
+  return (golle_elem_t *)BN_new ();
+}
+
+static void modp_elem_delete (golle_elem_t *e) {
+  BN_clear_free (BN (e));
+}
+
+static int modp_cpy (const golle_group_t *group,
+		     golle_elem_t *dst,
+		     const golle_elem_t *src)
+{
+  GOLLE_UNUSED (group);
+  return BN_copy (BN (dst), CBN (src)) != NULL;
+}
+
+static int modp_cmp (const golle_group_t *group,
+		     const golle_elem_t *a,
+		     const golle_elem_t *b,
+		     BN_CTX *ctx)
+{
+  GOLLE_UNUSED (group);
+  GOLLE_UNUSED (ctx);
+  return BN_cmp (CBN (a), CBN (b));
+}
+
+static int modp_exp (const golle_group_t *group,
+		     golle_elem_t *r,
+		     const golle_elem_t *a,
+		     const BIGNUM *n,
+		     BN_CTX *ctx)
+{
+  const modp_t *m = MODP (group);
+  if (!a) {
+    return golle_bn_mod_exp (BN (r), m->g, n, m->p, ctx) &&
+      BN_to_montgomery (BN (r), CBN (r), m->mont, ctx);
+  }
+  BN_CTX_start (ctx);
+  BIGNUM *x = BN_CTX_get (ctx);
+  int ok = x &&
+    BN_from_montgomery (x, CBN (a), m->mont, ctx) &&
+    golle_bn_mod_exp (BN (r), x, n, m->p, ctx) &&
+    BN_to_montgomery (BN (r), CBN (r), m->mont, ctx);
+  BN_CTX_end (ctx);
+  return ok;
+}
+
+static int modp_mul (const golle_group_t *group,
+		     golle_elem_t *r,
+		     const golle_elem_t *a,
+		     const golle_elem_t *b,
+		     BN_CTX *ctx)
+{
+  const modp_t *m = MODP (group);
+  return golle_bn_mod_mul_mont (BN (r), CBN (a), CBN (b), m->p, m->mont, ctx);
+}
+
+static int modp_inv (const golle_group_t *group,
+		     golle_elem_t *r,
+		     const golle_elem_t *a,
+		     BN_CTX *ctx)
+{
+  /* The inverse of xR is 1/(xR); two conversions make it R/x. */
+  const modp_t *m = MODP (group);
+  return golle_bn_mod_inverse (BN (r), CBN (a), m->p, ctx) &&
+    BN_to_montgomery (BN (r), CBN (r), m->mont, ctx) &&
+    BN_to_montgomery (BN (r), CBN (r), m->mont, ctx);
+}
+
+static golle_error modp_to_bin (const golle_group_t *group,
+				const golle_elem_t *e,
+				golle_bin_t *bin,
+				BN_CTX *ctx)
+{
+  golle_error err = GOLLE_OK;
+  BN_CTX_start (ctx);
+  BIGNUM *x = BN_CTX_get (ctx);
+  if (!x || !BN_from_montgomery (x, CBN (e), MODP (group)->mont, ctx)) {
+    err = GOLLE_EMEM;
+  }
+  else if (golle_bin_resize (bin, group->elem_size) != GOLLE_OK) {
+    err = GOLLE_EMEM;
+  }
+  else {
+    /* Pad to the size of p. */
+    unsigned char *out = bin->bin;
+    size_t pad = group->elem_size - BN_num_bytes (x);
+    memset (out, 0, pad);
+    BN_bn2bin (x, out + pad);
+  }
+  BN_CTX_end (ctx);
+  return err;
+}
+
+static golle_error modp_from_bin (const golle_group_t *group,
+				  const golle_bin_t *bin,
+				  golle_elem_t *e,
+				  BN_CTX *ctx)
+{
+  const modp_t *m = MODP (group);
+  GOLLE_ASSERT (bin->size == group->elem_size, GOLLE_EOUTOFRANGE);
+  GOLLE_ASSERT (BN_bin2bn (bin->bin, (int)bin->size, BN (e)), GOLLE_EMEM);
+
+  /* It must be in [1, p), and in the subgroup: e^q = 1. */
+  if (BN_is_zero (CBN (e)) || BN_cmp (CBN (e), m->p) >= 0) {
+    return GOLLE_EOUTOFRANGE;
+  }
+  golle_error err = GOLLE_OK;
+  BN_CTX_start (ctx);
+  BIGNUM *t = BN_CTX_get (ctx);
+  if (!t || !golle_bn_mod_exp (t, CBN (e), group->order, m->p, ctx)) {
+    err = GOLLE_EMEM;
+  }
+  else if (!BN_is_one (t)) {
+    err = GOLLE_EOUTOFRANGE;
+  }
+  else if (!BN_to_montgomery (BN (e), CBN (e), m->mont, ctx)) {
+    err = GOLLE_EMEM;
+  }
+  BN_CTX_end (ctx);
+  return err;
+}
+
+static const group_ops_t modp_ops = {
+  .name = &modp_name,
+  .destroy = &modp_destroy,
+  .elem_new = &modp_elem_new,
+  .elem_delete = &modp_elem_delete,
+  .cpy = &modp_cpy,
+  .cmp = &modp_cmp,
+  .exp = &modp_exp,
+  .mul = &modp_mul,
+  .inv = &modp_inv,
+  .to_bin = &modp_to_bin,
+  .from_bin = &modp_from_bin
+};
+
+golle_error golle_group_init_modp (golle_group_t *group,
+				   const golle_key_t *key)
+{
+  GOLLE_ASSERT (key->p, GOLLE_ERROR);
+  GOLLE_ASSERT (key->q, GOLLE_ERROR);
+  GOLLE_ASSERT (key->g, GOLLE_ERROR);
+
+  GOLLE_ASSERT (BN_is_odd (key->p), GOLLE_EINVALID);
+
+  modp_t *m = calloc (1, sizeof (*m));
+  GOLLE_ASSERT (m, GOLLE_EMEM);
+  group->ops = &modp_ops;
+  group->impl = m;
+  if (!(m->p = BN_dup (key->p)) ||
+      !(m->g = BN_dup (key->g)) ||
+      !(group->order = BN_dup (key->q)) ||
+      !(m->mont = BN_MONT_CTX_new ()))
+    {
+      return GOLLE_EMEM;
+    }
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  int ok = BN_MONT_CTX_set (m->mont, m->p, ctx);
+  BN_CTX_free (ctx);
+  GOLLE_ASSERT (ok, GOLLE_EMEM);
+  group->elem_size = BN_num_bytes (m->p);
+  return GOLLE_OK;
+}
@@ -0,0 +1,652 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include <golle/loopback.h>
+#include <golle/config.h>
+#include <golle/numbers.h>
+#include <golle/netsim.h>
+#include <openssl/bn.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "atomic.h"
+
+enum {
+  /* Slots in each channel. A draw sends at most four messages down
+   * any one channel, so senders should never have to wait. */
+  CHANNEL_SLOTS = 8,
+  /* Times to poll an empty or full channel before yielding. */
+  SPIN_LIMIT = 64
+};
+
+/* Message types, in the order they are sent during a draw. */
+typedef enum msg_type {
+  MSG_COMMIT,
+  MSG_SECRET,
+  MSG_RAND,
+  MSG_CRYPT
+} msg_type;
+
+/* Commands for the peer threads. */
+typedef enum command {
+  CMD_RESET,
+  CMD_DRAW,
+  CMD_QUIT
+} command;
+
+/* A message from one peer. Broadcast messages are shared by every
+ * receiver, who copy out what they need. The last one frees it. */
+typedef struct msg_t {
+  msg_type type;
+  size_t refs;
+  golle_bin_t *b1; /* rsend or rkeep */
+  golle_bin_t *b2; /* hash */
+  golle_eg_t eg;
+  size_t r;
+  golle_num_t rand;
+} msg_t;
+
+/* A single-producer, single-consumer ring of messages. */
+typedef struct channel_t {
+  GOLLE_CACHE_ALIGNED size_t head; /* Written by the receiver. */
+  GOLLE_CACHE_ALIGNED size_t tail; /* Written by the sender. */
+  golle_link_t link; /* Used by the sender, if simulating a network. */
+  msg_t *slots[CHANNEL_SLOTS];
+  double deliver[CHANNEL_SLOTS]; /* When each message arrives. */
+} channel_t;
+
+/* A simulated peer. The golle_t is first so that the callbacks can
+ * get back to the peer. */
+typedef struct peer_t {
+  golle_t golle;
+  golle_key_t key;
+  golle_loopback_t *table;
+  size_t index;
+  pthread_t thread;
+  golle_error err;
+  int known;
+  size_t selection;
+} peer_t;
+
+struct golle_loopback_t {
+  size_t num_peers;
+  peer_t *peers;
+  /* Channel from peer i to peer j is at i * num_peers + j. */
+  channel_t *channels;
+  /* Set when a peer fails, to wake up everyone waiting on it. */
+  int aborted;
+  /* Non-zero if messages between peers go over simulated links. */
+  int simulate;
+
+  /* Hands commands to the peer threads. */
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  size_t threads;
+  size_t generation;
+  size_t running;
+  command cmd;
+  size_t to;
+};
+
+#define PEER(g) ((peer_t *)(g))
+
+static channel_t *channel (golle_loopback_t *t, size_t from, size_t to) {
+  return t->channels + from * t->num_peers + to;
+}
+
+/* The size of a message on the wire. */
+static size_t msg_bytes (const msg_t *m) {
+  size_t bytes = sizeof (m->type);
+  if (m->b1) {
+    bytes += m->b1->size;
+  }
+  if (m->b2) {
+    bytes += m->b2->size;
+  }
+  if (m->eg.a && m->eg.b) {
+    bytes += BN_num_bytes ((BIGNUM *)m->eg.a) + BN_num_bytes ((BIGNUM *)m->eg.b);
+  }
+  if (m->rand) {
+    bytes += sizeof (m->r) + BN_num_bytes ((BIGNUM *)m->rand);
+  }
+  return bytes;
+}
+
+static msg_t *msg_new (msg_type type, size_t refs) {
+  msg_t *m = calloc (1, sizeof (*m));
+  if (m) {
+    m->type = type;
+    m->refs = refs;
+  }
+  return m;
+}
+
+static void msg_free (msg_t *m) {
+  golle_bin_delete (m->b1);
+  golle_bin_delete (m->b2);
+  golle_eg_clear (&m->eg);
+  golle_num_delete (m->rand);
+  free (m);
+}
+
+/* Drop one reference to a message. */
+static void msg_release (msg_t *m) {
+  if (GOLLE_ATOMIC_SUB_ACQ_REL (&m->refs, 1) == 1) {
+    msg_free (m);
+  }
+}
+
+/* Wait for a channel to change, or give up if the draw was aborted. */
+static int wait_or_abort (golle_loopback_t *t, unsigned *spins) {
+  if (GOLLE_ATOMIC_LOAD (&t->aborted)) {
+    return 1;
+  }
+  if (++*spins > SPIN_LIMIT) {
+    sched_yield ();
+  }
+  return 0;
+}
+
+static golle_error channel_send (golle_loopback_t *t,
+				 size_t from,
+				 size_t to,
+				 msg_t *m)
+{
+  unsigned spins = 0;
+  channel_t *c = channel (t, from, to);
+  size_t tail = c->tail;
+  while (tail - GOLLE_ATOMIC_LOAD_ACQUIRE (&c->head) == CHANNEL_SLOTS) {
+    if (wait_or_abort (t, &spins)) {
+      msg_release (m);
+      return GOLLE_EABORT;
+    }
+  }
+  /* Messages to self don't touch the network. */
+  c->deliver[tail % CHANNEL_SLOTS] = (t->simulate && from != to) ?
+    golle_link_send (&c->link, golle_netsim_now (), msg_bytes (m)) : 0;
+  c->slots[tail % CHANNEL_SLOTS] = m;
+  GOLLE_ATOMIC_STORE_RELEASE (&c->tail, tail + 1);
+  return GOLLE_OK;
+}
+
+static msg_t *channel_recv (golle_loopback_t *t, channel_t *c) {
+  unsigned spins = 0;
+  size_t head = c->head;
+  while (GOLLE_ATOMIC_LOAD_ACQUIRE (&c->tail) == head) {
+    if (wait_or_abort (t, &spins)) {
+      return NULL;
+    }
+  }
+  if (c->deliver[head % CHANNEL_SLOTS] > 0) {
+    golle_netsim_wait (c->deliver[head % CHANNEL_SLOTS]);
+  }
+  msg_t *m = c->slots[head % CHANNEL_SLOTS];
+  GOLLE_ATOMIC_STORE_RELEASE (&c->head, head + 1);
+  return m;
+}
+
+/* Receive a message of the given type from a peer. */
+static golle_error recv_from (peer_t *self,
+			      size_t from,
+			      msg_type type,
+			      msg_t **m)
+{
+  GOLLE_ASSERT (from < self->table->num_peers, GOLLE_EOUTOFRANGE);
+  *m = channel_recv (self->table, channel (self->table, from, self->index));
+  GOLLE_ASSERT (*m, GOLLE_EABORT);
+  if ((*m)->type != type) {
+    msg_release (*m);
+    return GOLLE_ERROR;
+  }
+  return GOLLE_OK;
+}
+
+/* Send a message to every peer, or to every peer but this one. */
+static golle_error broadcast (peer_t *self, msg_t *m, int include_self) {
+  golle_loopback_t *t = self->table;
+  golle_error err = GOLLE_OK;
+  for (size_t i = 0; i < t->num_peers; i++) {
+    if (i == self->index && !include_self) {
+      continue;
+    }
+    if (err == GOLLE_OK) {
+      err = channel_send (t, self->index, i, m);
+    }
+    else {
+      /* Nobody will receive it now. */
+      msg_release (m);
+    }
+  }
+  return err;
+}
+
+static golle_error eg_copy_into (golle_eg_t *dest, const golle_eg_t *src) {
+  if (!(dest->a = golle_num_dup (src->a)) ||
+      !(dest->b = golle_num_dup (src->b)))
+    {
+      golle_eg_clear (dest);
+      return GOLLE_EMEM;
+    }
+  return GOLLE_OK;
+}
+
+static golle_error bcast_commit (golle_t *g,
+				 golle_bin_t *rsend,
+				 golle_bin_t *hash)
+{
+  peer_t *self = PEER (g);
+  msg_t *m = msg_new (MSG_COMMIT, self->table->num_peers);
+  GOLLE_ASSERT (m, GOLLE_EMEM);
+  if (!(m->b1 = golle_bin_copy (rsend)) ||
+      !(m->b2 = golle_bin_copy (hash)))
+    {
+      msg_free (m);
+      return GOLLE_EMEM;
+    }
+  return broadcast (self, m, 1);
+}
+
+static golle_error bcast_secret (golle_t *g,
+				 golle_eg_t *secret,
+				 golle_bin_t *rkeep)
+{
+  peer_t *self = PEER (g);
+  msg_t *m = msg_new (MSG_SECRET, self->table->num_peers);
+  GOLLE_ASSERT (m, GOLLE_EMEM);
+  if (!(m->b1 = golle_bin_copy (rkeep)) ||
+      eg_copy_into (&m->eg, secret) != GOLLE_OK)
+    {
+      msg_free (m);
+      return GOLLE_EMEM;
+    }
+  return broadcast (self, m, 1);
+}
+
+static golle_error accept_commit (golle_t *g,
+				  size_t from,
+				  golle_bin_t *rsend,
+				  golle_bin_t *hash)
+{
+  msg_t *m;
+  golle_error err = recv_from (PEER (g), from, MSG_COMMIT, &m);
+  if (err == GOLLE_OK) {
+    err = golle_bin_copy_into (rsend, m->b1);
+    if (err == GOLLE_OK) {
+      err = golle_bin_copy_into (hash, m->b2);
+    }
+    msg_release (m);
+  }
+  return err;
+}
+
+static golle_error accept_eg (golle_t *g,
+			      size_t from,
+			      golle_eg_t *eg,
+			      golle_bin_t *rkeep)
+{
+  msg_t *m;
+  golle_error err = recv_from (PEER (g), from, MSG_SECRET, &m);
+  if (err == GOLLE_OK) {
+    err = eg_copy_into (eg, &m->eg);
+    if (err == GOLLE_OK) {
+      err = golle_bin_copy_into (rkeep, m->b1);
+    }
+    msg_release (m);
+  }
+  return err;
+}
+
+static golle_error reveal_rand (golle_t *g,
+				size_t to,
+				size_t r,
+				golle_num_t rand)
+{
+  peer_t *self = PEER (g);
+  golle_loopback_t *t = self->table;
+  golle_error err;
+  size_t selection, collision;
+
+  /* Send r and the randomness to the peer(s) that see the selection. */
+  msg_t *m = msg_new (MSG_RAND, to == GOLLE_FACE_UP ? t->num_peers : 1);
+  GOLLE_ASSERT (m, GOLLE_EMEM);
+  m->r = r;
+  if (!(m->rand = golle_num_dup (rand))) {
+    msg_free (m);
+    return GOLLE_EMEM;
+  }
+  if (to == GOLLE_FACE_UP) {
+    err = broadcast (self, m, 1);
+  }
+  else {
+    err = channel_send (t, self->index, to, m);
+  }
+  if (err != GOLLE_OK) {
+    return err;
+  }
+
+  /* Then follow the protocol for the local peer. */
+  if (to == self->index || to == GOLLE_FACE_UP) {
+    err = golle_reveal_selection (g, &selection);
+    if (err == GOLLE_OK) {
+      self->known = 1;
+      self->selection = selection;
+    }
+    if (err == GOLLE_OK && to == self->index) {
+      err = golle_reduce_selection (g, selection, &collision);
+    }
+  }
+  else {
+    err = golle_check_selection (g, to, &collision);
+  }
+  return err;
+}
+
+static golle_error accept_rand (golle_t *g,
+				size_t from,
+				size_t *r,
+				golle_num_t rand)
+{
+  msg_t *m;
+  golle_error err = recv_from (PEER (g), from, MSG_RAND, &m);
+  if (err == GOLLE_OK) {
+    *r = m->r;
+    err = golle_num_cpy (rand, m->rand);
+    msg_release (m);
+  }
+  return err;
+}
+
+static golle_error bcast_crypt (golle_t *g, const golle_eg_t *eg) {
+  peer_t *self = PEER (g);
+  if (self->table->num_peers == 1) {
+    return GOLLE_OK;
+  }
+  msg_t *m = msg_new (MSG_CRYPT, self->table->num_peers - 1);
+  GOLLE_ASSERT (m, GOLLE_EMEM);
+  if (eg_copy_into (&m->eg, eg) != GOLLE_OK) {
+    msg_free (m);
+    return GOLLE_EMEM;
+  }
+  return broadcast (self, m, 0);
+}
+
+static golle_error accept_crypt (golle_t *g, golle_eg_t *eg, size_t from) {
+  msg_t *m;
+  golle_error err = recv_from (PEER (g), from, MSG_CRYPT, &m);
+  if (err == GOLLE_OK) {
+    err = eg_copy_into (eg, &m->eg);
+    msg_release (m);
+  }
+  return err;
+}
+
+/* Start a new game for one peer. */
+static golle_error peer_reset (peer_t *p) {
+  golle_clear (&p->golle);
+  p->golle.reserved = NULL;
+  return golle_initialise (&p->golle);
+}
+
+static void *peer_main (void *arg) {
+  peer_t *p = arg;
+  golle_loopback_t *t = p->table;
+  size_t seen = 0;
+  for (;;) {
+    /* Wait for the next command */
+    pthread_mutex_lock (&t->lock);
+    while (t->generation == seen) {
+      pthread_cond_wait (&t->start, &t->lock);
+    }
+    seen = t->generation;
+    command cmd = t->cmd;
+    size_t to = t->to;
+    pthread_mutex_unlock (&t->lock);
+
+    p->known = 0;
+    if (cmd == CMD_DRAW) {
+      p->err = golle_generate (&p->golle, 0, to);
+    }
+    else if (cmd == CMD_RESET) {
+      p->err = peer_reset (p);
+    }
+    if (p->err != GOLLE_OK && p->err != GOLLE_ECOLLISION) {
+      /* Don't leave the others waiting for this peer. */
+      GOLLE_ATOMIC_STORE (&t->aborted, 1);
+    }
+
+    pthread_mutex_lock (&t->lock);
+    if (--t->running == 0) {
+      pthread_cond_signal (&t->done);
+    }
+    pthread_mutex_unlock (&t->lock);
+
+    if (cmd == CMD_QUIT) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+/* Free anything left in the channels by an aborted draw. */
+static void drain_channels (golle_loopback_t *t) {
+  for (size_t i = 0; i < t->num_peers * t->num_peers; i++) {
+    channel_t *c = t->channels + i;
+    while (c->head != c->tail) {
+      msg_release (c->slots[c->head++ % CHANNEL_SLOTS]);
+    }
+  }
+}
+
+/* Have every peer thread carry out a command, and wait for them. */
+static void run_command (golle_loopback_t *t, command cmd, size_t to) {
+  pthread_mutex_lock (&t->lock);
+  drain_channels (t);
+  t->aborted = 0;
+  t->cmd = cmd;
+  t->to = to;
+  t->running = t->threads;
+  t->generation++;
+  pthread_cond_broadcast (&t->start);
+  while (t->running) {
+    pthread_cond_wait (&t->done, &t->lock);
+  }
+  pthread_mutex_unlock (&t->lock);
+}
+
+/* The overall result of a command. A collision is only reported if
+ * nothing worse happened. */
+static golle_error table_result (const golle_loopback_t *t) {
+  golle_error err = GOLLE_OK;
+  for (size_t i = 0; i < t->num_peers; i++) {
+    golle_error e = t->peers[i].err;
+    if (e != GOLLE_OK && e != GOLLE_ECOLLISION) {
+      return e;
+    }
+    if (e == GOLLE_ECOLLISION) {
+      err = e;
+    }
+  }
+  return err;
+}
+
+/* Give each peer a private key, and combine the public keys. */
+static golle_error make_keys (golle_loopback_t *t, const golle_key_t *key) {
+  golle_error err = GOLLE_OK;
+  for (size_t i = 0; err == GOLLE_OK && i < t->num_peers; i++) {
+    golle_key_t *k = &t->peers[i].key;
+    if (!(k->p = golle_num_dup (key->p)) ||
+	!(k->q = golle_num_dup (key->q)) ||
+	!(k->g = golle_num_dup (key->g)))
+      {
+	err = GOLLE_EMEM;
+      }
+    else {
+      err = golle_key_gen_private (k);
+    }
+  }
+  for (size_t i = 0; err == GOLLE_OK && i < t->num_peers; i++) {
+    for (size_t j = 0; err == GOLLE_OK && j < t->num_peers; j++) {
+      if (i != j) {
+	err = golle_key_accum_h (&t->peers[i].key, t->peers[j].key.h);
+      }
+    }
+  }
+  return err;
+}
+
+golle_error golle_loopback_new (golle_loopback_t **table,
+				const golle_key_t *key,
+				size_t num_peers,
+				size_t num_items)
+{
+  GOLLE_ASSERT (table, GOLLE_ERROR);
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  GOLLE_ASSERT (key->p && key->q && key->g, GOLLE_ERROR);
+  GOLLE_ASSERT (num_peers, GOLLE_ERROR);
+  GOLLE_ASSERT (num_items, GOLLE_ERROR);
+
+  golle_loopback_t *t = calloc (1, sizeof (*t));
+  GOLLE_ASSERT (t, GOLLE_EMEM);
+  t->num_peers = num_peers;
+  if (pthread_mutex_init (&t->lock, NULL) != 0) {
+    free (t);
+    return GOLLE_EMEM;
+  }
+  pthread_cond_init (&t->start, NULL);
+  pthread_cond_init (&t->done, NULL);
+
+  golle_error err = GOLLE_OK;
+  if (!(t->peers = calloc (num_peers, sizeof (peer_t))) ||
+      !(t->channels = calloc (num_peers * num_peers, sizeof (channel_t))))
+    {
+      err = GOLLE_EMEM;
+      goto out;
+    }
+
+  for (size_t i = 0; i < num_peers; i++) {
+    peer_t *p = t->peers + i;
+    p->table = t;
+    p->index = i;
+    p->golle.num_peers = num_peers;
+    p->golle.num_items = num_items;
+    p->golle.key = &p->key;
+    p->golle.bcast_commit = &bcast_commit;
+    p->golle.bcast_secret = &bcast_secret;
+    p->golle.accept_commit = &accept_commit;
+    p->golle.accept_eg = &accept_eg;
+    p->golle.reveal_rand = &reveal_rand;
+    p->golle.accept_rand = &accept_rand;
+    p->golle.accept_crypt = &accept_crypt;
+    p->golle.bcast_crypt = &bcast_crypt;
+  }
+
+  err = make_keys (t, key);
+  if (err != GOLLE_OK) {
+    goto out;
+  }
+
+  for (; t->threads < num_peers; t->threads++) {
+    peer_t *p = t->peers + t->threads;
+    if (pthread_create (&p->thread, NULL, &peer_main, p) != 0) {
+      err = GOLLE_EMEM;
+      goto out;
+    }
+  }
+
+  /* Every peer sets up its own golle_t in parallel. */
+  err = golle_loopback_reset (t);
+
+ out:
+  if (err != GOLLE_OK) {
+    golle_loopback_delete (t);
+    t = NULL;
+  }
+  *table = t;
+  return err;
+}
+
+void golle_loopback_delete (golle_loopback_t *table) {
+  if (!table) {
+    return;
+  }
+  if (table->threads) {
+    run_command (table, CMD_QUIT, 0);
+    for (size_t i = 0; i < table->threads; i++) {
+      pthread_join (table->peers[i].thread, NULL);
+    }
+  }
+  if (table->peers) {
+    if (table->channels) {
+      drain_channels (table);
+    }
+    for (size_t i = 0; i < table->num_peers; i++) {
+      golle_clear (&table->peers[i].golle);
+      golle_key_clear (&table->peers[i].key);
+    }
+  }
+  free (table->channels);
+  free (table->peers);
+  pthread_cond_destroy (&table->start);
+  pthread_cond_destroy (&table->done);
+  pthread_mutex_destroy (&table->lock);
+  free (table);
+}
+
+golle_error golle_loopback_draw (golle_loopback_t *table,
+				 size_t to,
+				 size_t *selection)
+{
+  GOLLE_ASSERT (table, GOLLE_ERROR);
+  GOLLE_ASSERT (to < table->num_peers || to == GOLLE_FACE_UP,
+		GOLLE_EOUTOFRANGE);
+
+  run_command (table, CMD_DRAW, to);
+  golle_error err = table_result (table);
+  if (selection && (err == GOLLE_OK || err == GOLLE_ECOLLISION)) {
+    *selection = table->peers[to == GOLLE_FACE_UP ? 0 : to].selection;
+  }
+  return err;
+}
+
+golle_error golle_loopback_result (const golle_loopback_t *table,
+				   size_t peer,
+				   size_t *selection)
+{
+  GOLLE_ASSERT (table, GOLLE_ERROR);
+  GOLLE_ASSERT (peer < table->num_peers, GOLLE_EOUTOFRANGE);
+  const peer_t *p = table->peers + peer;
+  if (p->err != GOLLE_OK && p->err != GOLLE_ECOLLISION) {
+    return p->err;
+  }
+  GOLLE_ASSERT (p->known, GOLLE_ENOTFOUND);
+  if (selection) {
+    *selection = p->selection;
+  }
+  return p->err;
+}
+
+golle_error golle_loopback_reset (golle_loopback_t *table) {
+  GOLLE_ASSERT (table, GOLLE_ERROR);
+  run_command (table, CMD_RESET, 0);
+  return table_result (table);
+}
+
+golle_error golle_loopback_set_netsim (golle_loopback_t *table,
+				      const golle_netsim_t *model)
+{
+  GOLLE_ASSERT (table, GOLLE_ERROR);
+  if (!model) {
+    table->simulate = 0;
+    return GOLLE_OK;
+  }
+  for (size_t i = 0; i < table->num_peers * table->num_peers; i++) {
+    golle_error err = golle_link_init (&table->channels[i].link, model, i);
+    if (err != GOLLE_OK) {
+      table->simulate = 0;
+      return err;
+    }
+  }
+  table->simulate = 1;
+  return GOLLE_OK;
+}
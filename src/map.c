@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/map.h>
+#include <string.h>
+#include <golle/types.h>
+#include "bin.h"
+#include "random.h"
+
+enum {
+  /* Slots to make on the first insert. A power of two. */
+  MIN_CAPACITY = 16,
+  /* Grow when more than LOAD_NUM/LOAD_DEN of the slots are full. */
+  LOAD_NUM = 7,
+  LOAD_DEN = 8
+};
+
+/* A hash of 0 marks an empty slot. */
+#define EMPTY 0
+
+struct golle_map_t {
+  /* The hash of the entry in each slot. Probes walk this. */
+  uint64_t *hashes;
+  golle_bin_t *keys;
+  unsigned char *values;
+  size_t size;
+  /* The space given to each value. Never 0, so that every value has
+   * an address even when values are empty. */
+  size_t stride;
+  size_t count;
+  size_t capacity;
+  uint64_t seed;
+  /* Room for a value being moved about. */
+  unsigned char *spare;
+  /* Numbers are converted to keys here. */
+  golle_bin_t scratch;
+};
+
+/* The address of the value in a slot. */
+#define VALUE(m, i) ((m)->values + (i) * (m)->stride)
+
+static uint64_t rotl (uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+/* The finalisation step from MurmurHash3. */
+static uint64_t fmix (uint64_t k) {
+  k ^= k >> 33;
+  k *= UINT64_C (0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= UINT64_C (0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+  return k;
+}
+
+uint64_t golle_map_hash (const void *data, size_t size, uint64_t seed) {
+  const uint64_t c1 = UINT64_C (0x87c37b91114253d5);
+  const uint64_t c2 = UINT64_C (0x4cf5ad432745937f);
+  const unsigned char *p = data;
+  uint64_t h = seed ^ (size * c1);
+  uint64_t k;
+
+  /* Whole words. The copy lets the compiler do an unaligned load. */
+  for (; size >= sizeof (k); size -= sizeof (k), p += sizeof (k)) {
+    memcpy (&k, p, sizeof (k));
+    k *= c1;
+    k = rotl (k, 31);
+    k *= c2;
+    h ^= k;
+    h = rotl (h, 27) * 5 + 0x52dce729;
+  }
+
+  /* The tail */
+  k = 0;
+  for (size_t i = 0; i < size; i++) {
+    k |= (uint64_t)p[i] << (i * 8);
+  }
+  k *= c1;
+  k = rotl (k, 31);
+  k *= c2;
+  h ^= k;
+
+  return fmix (h);
+}
+
+/* Hash a key for a map. Never gives EMPTY. */
+static uint64_t key_hash (const golle_map_t *map,
+			  const void *key,
+			  size_t size)
+{
+  uint64_t h = golle_map_hash (key, size, map->seed);
+  return h == EMPTY ? 1 : h;
+}
+
+/* How far the entry in slot i is from its home slot. */
+static size_t distance (const golle_map_t *map, size_t i) {
+  size_t mask = map->capacity - 1;
+  return (i - (size_t)(map->hashes[i] & mask)) & mask;
+}
+
+/* Find the slot holding a key, or SIZE_MAX. */
+static size_t find_slot (const golle_map_t *map,
+			 const void *key,
+			 size_t size)
+{
+  if (!map->count) {
+    return SIZE_MAX;
+  }
+  uint64_t h = key_hash (map, key, size);
+  size_t mask = map->capacity - 1;
+  for (size_t i = h & mask, d = 0; ; i = (i + 1) & mask, d++) {
+    /* Stop at an empty slot, or one whose entry is nearer home than
+     * the key would be. The key would have displaced it. */
+    if (map->hashes[i] == EMPTY || distance (map, i) < d) {
+      return SIZE_MAX;
+    }
+    if (map->hashes[i] == h && map->keys[i].size == size &&
+	memcmp (map->keys[i].bin, key, size) == 0) {
+      return i;
+    }
+  }
+}
+
+/* Place an entry, which isn't already there, into the slots. The key
+ * and value are consumed, and may be swapped with others on the way. */
+static void place (golle_map_t *map,
+		   uint64_t h,
+		   golle_bin_t *key,
+		   unsigned char *value)
+{
+  size_t mask = map->capacity - 1;
+  for (size_t i = h & mask, d = 0; ; i = (i + 1) & mask, d++) {
+    if (map->hashes[i] == EMPTY) {
+      map->hashes[i] = h;
+      golle_bin_move (map->keys + i, key);
+      memcpy (VALUE (map, i), value, map->size);
+      return;
+    }
+    size_t e = distance (map, i);
+    if (e < d) {
+      /* Rob the richer entry of its slot, and carry on placing it. */
+      uint64_t th = map->hashes[i];
+      golle_bin_t tk;
+      map->hashes[i] = h;
+      h = th;
+      golle_bin_move (&tk, map->keys + i);
+      golle_bin_move (map->keys + i, key);
+      golle_bin_move (key, &tk);
+      for (size_t j = 0; j < map->size; j++) {
+	unsigned char t = VALUE (map, i)[j];
+	VALUE (map, i)[j] = value[j];
+	value[j] = t;
+      }
+      d = e;
+    }
+  }
+}
+
+/* Move every entry into a bigger set of slots. */
+static golle_error rehash (golle_map_t *map, size_t capacity) {
+  uint64_t *hashes = calloc (capacity, sizeof (*hashes));
+  golle_bin_t *keys = malloc (capacity * sizeof (*keys));
+  unsigned char *values = malloc (capacity * map->stride);
+  if (!hashes || !keys || !values) {
+    free (hashes);
+    free (keys);
+    free (values);
+    return GOLLE_EMEM;
+  }
+
+  uint64_t *old_hashes = map->hashes;
+  golle_bin_t *old_keys = map->keys;
+  unsigned char *old_values = map->values;
+  size_t old_capacity = map->capacity;
+  map->hashes = hashes;
+  map->keys = keys;
+  map->values = values;
+  map->capacity = capacity;
+
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_hashes[i] != EMPTY) {
+      memcpy (map->spare, old_values + i * map->stride, map->size);
+      place (map, old_hashes[i], old_keys + i, map->spare);
+    }
+  }
+  free (old_hashes);
+  free (old_keys);
+  free (old_values);
+  return GOLLE_OK;
+}
+
+golle_error golle_map_new (golle_map_t **map, size_t size) {
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+
+  golle_map_t *m = calloc (1, sizeof (*m));
+  GOLLE_ASSERT (m, GOLLE_EMEM);
+  m->size = size;
+  m->stride = size ? size : 1;
+  if (!(m->spare = malloc (m->stride))) {
+    free (m);
+    return GOLLE_EMEM;
+  }
+  /* Keys can come from peers, so the seed mustn't be guessable. */
+  golle_error err = golle_random_bytes (&m->seed, sizeof (m->seed));
+  if (err != GOLLE_OK) {
+    free (m->spare);
+    free (m);
+    return err;
+  }
+
+  *map = m;
+  return GOLLE_OK;
+}
+
+void golle_map_delete (golle_map_t *map) {
+  if (map) {
+    golle_map_clear (map);
+    golle_bin_release (&map->scratch);
+    free (map->hashes);
+    free (map->keys);
+    free (map->values);
+    free (map->spare);
+    free (map);
+  }
+}
+
+size_t golle_map_size (const golle_map_t *map) {
+  GOLLE_ASSERT (map, 0);
+  return map->count;
+}
+
+golle_error golle_map_reserve (golle_map_t *map, size_t count) {
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  size_t capacity = map->capacity ? map->capacity : MIN_CAPACITY;
+  while (count > capacity / LOAD_DEN * LOAD_NUM) {
+    GOLLE_ASSERT (capacity <= SIZE_MAX / 2 / sizeof (golle_bin_t),
+		  GOLLE_EMEM);
+    capacity *= 2;
+  }
+  if (capacity == map->capacity) {
+    return GOLLE_OK;
+  }
+  GOLLE_ASSERT (capacity <= SIZE_MAX / map->stride, GOLLE_EMEM);
+  return rehash (map, capacity);
+}
+
+golle_error golle_map_insert (golle_map_t *map,
+			      const void *key,
+			      size_t size,
+			      const void *value)
+{
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  GOLLE_ASSERT (find_slot (map, key, size) == SIZE_MAX, GOLLE_EEXISTS);
+
+  golle_error err = golle_map_reserve (map, map->count + 1);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+
+  /* Copy the key. Small keys are kept in the slot itself. */
+  golle_bin_t copy;
+  err = golle_bin_init (&copy, size);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  memcpy (copy.bin, key, size);
+
+  if (value) {
+    memcpy (map->spare, value, map->size);
+  }
+  else {
+    memset (map->spare, 0, map->size);
+  }
+  place (map, key_hash (map, key, size), &copy, map->spare);
+  map->count++;
+  return GOLLE_OK;
+}
+
+golle_error golle_map_find (const golle_map_t *map,
+			    const void *key,
+			    size_t size,
+			    void **value)
+{
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+
+  size_t i = find_slot (map, key, size);
+  GOLLE_ASSERT (i != SIZE_MAX, GOLLE_ENOTFOUND);
+  if (value) {
+    *value = VALUE (map, i);
+  }
+  return GOLLE_OK;
+}
+
+golle_error golle_map_erase (golle_map_t *map,
+			     const void *key,
+			     size_t size)
+{
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+
+  size_t i = find_slot (map, key, size);
+  GOLLE_ASSERT (i != SIZE_MAX, GOLLE_ENOTFOUND);
+  golle_bin_release (map->keys + i);
+
+  /* Shift the entries after it back a slot, until one is home. That
+   * leaves no hole for a probe to stop at early. */
+  size_t mask = map->capacity - 1;
+  for (size_t j = (i + 1) & mask;
+       map->hashes[j] != EMPTY && distance (map, j) != 0;
+       i = j, j = (j + 1) & mask)
+    {
+      map->hashes[i] = map->hashes[j];
+      golle_bin_move (map->keys + i, map->keys + j);
+      memcpy (VALUE (map, i), VALUE (map, j), map->size);
+    }
+  map->hashes[i] = EMPTY;
+  map->count--;
+  return GOLLE_OK;
+}
+
+golle_error golle_map_insert_num (golle_map_t *map,
+				  const golle_num_t key,
+				  const void *value)
+{
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  golle_error err = golle_num_to_bin (key, &map->scratch);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  return golle_map_insert (map, map->scratch.bin, map->scratch.size, value);
+}
+
+golle_error golle_map_find_num (golle_map_t *map,
+				const golle_num_t key,
+				void **value)
+{
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  golle_error err = golle_num_to_bin (key, &map->scratch);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  return golle_map_find (map, map->scratch.bin, map->scratch.size, value);
+}
+
+golle_error golle_map_erase_num (golle_map_t *map, const golle_num_t key) {
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  golle_error err = golle_num_to_bin (key, &map->scratch);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  return golle_map_erase (map, map->scratch.bin, map->scratch.size);
+}
+
+golle_error golle_map_clear (golle_map_t *map) {
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  for (size_t i = 0; i < map->capacity; i++) {
+    if (map->hashes[i] != EMPTY) {
+      golle_bin_release (map->keys + i);
+      map->hashes[i] = EMPTY;
+    }
+  }
+  map->count = 0;
+  return GOLLE_OK;
+}
+
+golle_error golle_map_iterator (golle_map_t *map,
+				golle_map_iterator_t *iter)
+{
+  GOLLE_ASSERT (map, GOLLE_ERROR);
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+
+  iter->map = map;
+  iter->next = 0;
+  return GOLLE_OK;
+}
+
+golle_error golle_map_iterator_next (golle_map_iterator_t *iter,
+				     const golle_bin_t **key,
+				     void **value)
+{
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+
+  golle_map_t *m = iter->map;
+  for (; iter->next < m->capacity; iter->next++) {
+    size_t i = iter->next;
+    if (m->hashes[i] != EMPTY) {
+      *key = m->keys + i;
+      if (value) {
+	*value = VALUE (m, i);
+      }
+      iter->next++;
+      return GOLLE_OK;
+    }
+  }
+  return GOLLE_END;
+}
+
+golle_error golle_map_iterator_reset (golle_map_iterator_t *iter) {
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+  iter->next = 0;
+  return GOLLE_OK;
+}
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/config.h>
+#include <golle/merkle.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "random.h"
+
+enum {
+  /* The random value of each secret, as for a single commitment. */
+  RANDOM_BITS = (COMMIT_RANDOM_BITS + CHAR_BIT - 1) & ~(CHAR_BIT -1),
+  RANDOM_BYTES = (RANDOM_BITS + CHAR_BIT - 1) / CHAR_BIT,
+  /* The size of each node. */
+  HASH_BYTES = SHA512_DIGEST_LENGTH,
+  /* Bytes of the secret count hashed into the root. */
+  COUNT_BYTES = 8
+};
+
+/* Prefixes that keep leaves, nodes and roots apart. */
+static const unsigned char LEAF = 0, NODE = 1, ROOT = 2;
+
+struct golle_merkle_t {
+  size_t count;
+  /* The nodes of each level, leaves first. Level k starts at
+   * node offset[k], and the top level holds a single node. */
+  size_t levels;
+  size_t *offset;
+  unsigned char *nodes;
+  golle_bin_t **secrets;
+  /* Random values of each secret, pointing into random. */
+  golle_bin_t *randoms;
+  unsigned char *random;
+  golle_bin_t root;
+};
+
+/* Hash a prefix and up to two blocks of bytes. */
+static int hash (EVP_MD_CTX *ctx,
+		 unsigned char prefix,
+		 const void *a, size_t alen,
+		 const void *b, size_t blen,
+		 unsigned char *out)
+{
+  return EVP_DigestInit_ex (ctx, EVP_sha512 (), NULL) &&
+    EVP_DigestUpdate (ctx, &prefix, 1) &&
+    EVP_DigestUpdate (ctx, a, alen) &&
+    EVP_DigestUpdate (ctx, b, blen) &&
+    EVP_DigestFinal_ex (ctx, out, NULL);
+}
+
+static int hash_leaf (EVP_MD_CTX *ctx,
+		      const golle_bin_t *random,
+		      const golle_bin_t *secret,
+		      unsigned char *out)
+{
+  return hash (ctx, LEAF, random->bin, random->size,
+	       secret->bin, secret->size, out);
+}
+
+static int hash_node (EVP_MD_CTX *ctx,
+		      const unsigned char *left,
+		      const unsigned char *right,
+		      unsigned char *out)
+{
+  return hash (ctx, NODE, left, HASH_BYTES, right, HASH_BYTES, out);
+}
+
+/* The root binds the number of secrets, so that a proof can't claim
+ * a different shape of tree. */
+static int hash_root (EVP_MD_CTX *ctx,
+		      size_t count,
+		      const unsigned char *top,
+		      unsigned char *out)
+{
+  unsigned char c[COUNT_BYTES];
+  uint64_t n = count;
+  for (int i = COUNT_BYTES - 1; i >= 0; i--, n >>= CHAR_BIT) {
+    c[i] = (unsigned char)n;
+  }
+  return hash (ctx, ROOT, c, COUNT_BYTES, top, HASH_BYTES, out);
+}
+
+/* The number of levels in a tree with `count` leaves. */
+static size_t count_levels (size_t count) {
+  size_t levels = 1;
+  for (; count > 1; count = (count + 1) / 2) {
+    levels++;
+  }
+  return levels;
+}
+
+/* Allocate the offsets and nodes for `count` leaves. */
+static golle_error alloc_levels (size_t count,
+				 size_t *levels,
+				 size_t **offset,
+				 unsigned char **nodes)
+{
+  size_t total = 0;
+  *levels = count_levels (count);
+  *offset = malloc (sizeof (size_t) * *levels);
+  GOLLE_ASSERT (*offset, GOLLE_EMEM);
+
+  for (size_t k = 0, n = count; k < *levels; k++, n = (n + 1) / 2) {
+    (*offset)[k] = total;
+    total += n;
+  }
+  if (total > SIZE_MAX / HASH_BYTES ||
+      !(*nodes = malloc (total * HASH_BYTES))) {
+    free (*offset);
+    *offset = NULL;
+    return GOLLE_EMEM;
+  }
+  return GOLLE_OK;
+}
+
+/* Fill in every level above the leaves, then the root. */
+static golle_error build (EVP_MD_CTX *ctx,
+			  size_t count,
+			  size_t levels,
+			  const size_t *offset,
+			  unsigned char *nodes,
+			  unsigned char *root)
+{
+  size_t n = count;
+  for (size_t k = 0; k + 1 < levels; k++, n = (n + 1) / 2) {
+    const unsigned char *in = nodes + offset[k] * HASH_BYTES;
+    unsigned char *out = nodes + offset[k + 1] * HASH_BYTES;
+    size_t i;
+
+    for (i = 0; i + 1 < n; i += 2) {
+      if (!hash_node (ctx, in + i * HASH_BYTES, in + (i + 1) * HASH_BYTES,
+		      out + (i / 2) * HASH_BYTES)) {
+	return GOLLE_ECRYPTO;
+      }
+    }
+    if (i < n) {
+      /* No sibling. Move up unchanged. */
+      memcpy (out + (i / 2) * HASH_BYTES, in + i * HASH_BYTES, HASH_BYTES);
+    }
+  }
+  if (!hash_root (ctx, count, nodes + offset[levels - 1] * HASH_BYTES,
+		  root)) {
+    return GOLLE_ECRYPTO;
+  }
+  return GOLLE_OK;
+}
+
+/* Check an array of secrets. */
+static golle_error check_bins (const golle_bin_t *const *bins, size_t count) {
+  GOLLE_ASSERT (bins, GOLLE_ERROR);
+  for (size_t i = 0; i < count; i++) {
+    GOLLE_ASSERT (bins[i], GOLLE_ERROR);
+    GOLLE_ASSERT (bins[i]->bin, GOLLE_ERROR);
+    GOLLE_ASSERT (bins[i]->size, GOLLE_ERROR);
+  }
+  return GOLLE_OK;
+}
+
+golle_error golle_merkle_new (golle_merkle_t **tree,
+			      const golle_bin_t *const *secrets,
+			      size_t count)
+{
+  GOLLE_ASSERT (tree, GOLLE_ERROR);
+  GOLLE_ASSERT (count, GOLLE_ERROR);
+  golle_error err = check_bins (secrets, count);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  GOLLE_ASSERT (count <= SIZE_MAX / RANDOM_BYTES, GOLLE_EMEM);
+
+  EVP_MD_CTX *ctx = NULL;
+  golle_merkle_t *t = calloc (1, sizeof (*t));
+  GOLLE_ASSERT (t, GOLLE_EMEM);
+  t->count = count;
+
+  if (!(t->secrets = calloc (count, sizeof (*t->secrets))) ||
+      !(t->randoms = calloc (count, sizeof (*t->randoms))) ||
+      !(t->random = malloc (count * RANDOM_BYTES)) ||
+      !(ctx = EVP_MD_CTX_create ())) {
+    err = GOLLE_EMEM;
+    goto out;
+  }
+  if ((err = alloc_levels (count, &t->levels,
+			   &t->offset, &t->nodes)) != GOLLE_OK ||
+      (err = golle_bin_init (&t->root, HASH_BYTES)) != GOLLE_OK) {
+    goto out;
+  }
+
+  /* Every random value in one draw. */
+  if ((err = golle_random_bytes (t->random,
+				 count * RANDOM_BYTES)) != GOLLE_OK) {
+    goto out;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    t->randoms[i].size = RANDOM_BYTES;
+    t->randoms[i].bin = t->random + i * RANDOM_BYTES;
+    if (!(t->secrets[i] = golle_bin_copy (secrets[i]))) {
+      err = GOLLE_EMEM;
+      goto out;
+    }
+    if (!hash_leaf (ctx, t->randoms + i, t->secrets[i],
+		    t->nodes + i * HASH_BYTES)) {
+      err = GOLLE_ECRYPTO;
+      goto out;
+    }
+  }
+  err = build (ctx, count, t->levels, t->offset, t->nodes, t->root.bin);
+
+ out:
+  EVP_MD_CTX_destroy (ctx);
+  if (err != GOLLE_OK) {
+    golle_merkle_delete (t);
+    t = NULL;
+  }
+  *tree = t;
+  return err;
+}
+
+void golle_merkle_delete (golle_merkle_t *tree) {
+  if (tree) {
+    if (tree->secrets) {
+      for (size_t i = 0; i < tree->count; i++) {
+	golle_bin_delete (tree->secrets[i]);
+      }
+      free (tree->secrets);
+    }
+    if (tree->random) {
+      OPENSSL_cleanse (tree->random, tree->count * RANDOM_BYTES);
+      free (tree->random);
+    }
+    free (tree->randoms);
+    free (tree->offset);
+    free (tree->nodes);
+    golle_bin_release (&tree->root);
+    free (tree);
+  }
+}
+
+const golle_bin_t *golle_merkle_root (const golle_merkle_t *tree) {
+  GOLLE_ASSERT (tree, NULL);
+  return &tree->root;
+}
+
+size_t golle_merkle_count (const golle_merkle_t *tree) {
+  GOLLE_ASSERT (tree, 0);
+  return tree->count;
+}
+
+const golle_bin_t *golle_merkle_random (const golle_merkle_t *tree,
+					size_t index)
+{
+  GOLLE_ASSERT (tree, NULL);
+  GOLLE_ASSERT (index < tree->count, NULL);
+  return tree->randoms + index;
+}
+
+/* The number of siblings on the path from a leaf to the top. */
+static size_t path_length (size_t index, size_t count) {
+  size_t len = 0;
+  for (; count > 1; index /= 2, count = (count + 1) / 2) {
+    if ((index ^ 1) < count) {
+      len++;
+    }
+  }
+  return len;
+}
+
+golle_error golle_merkle_open (const golle_merkle_t *tree,
+			       size_t index,
+			       golle_merkle_proof_t *proof)
+{
+  GOLLE_ASSERT (tree, GOLLE_ERROR);
+  GOLLE_ASSERT (proof, GOLLE_ERROR);
+  GOLLE_ASSERT (index < tree->count, GOLLE_EOUTOFRANGE);
+
+  /* Filled in place, as the buffers may point into themselves. */
+  golle_merkle_proof_t *p = proof;
+  golle_error err;
+  size_t len = path_length (index, tree->count);
+
+  memset (p, 0, sizeof (*p));
+  if ((err = golle_bin_init (&p->secret,
+			     tree->secrets[index]->size)) != GOLLE_OK ||
+      (err = golle_bin_init (&p->random, RANDOM_BYTES)) != GOLLE_OK ||
+      (len && (err = golle_bin_init (&p->path,
+				     len * HASH_BYTES)) != GOLLE_OK)) {
+    golle_merkle_proof_clear (p);
+    return err;
+  }
+  p->index = index;
+  p->count = tree->count;
+  memcpy (p->secret.bin, tree->secrets[index]->bin, p->secret.size);
+  memcpy (p->random.bin, tree->randoms[index].bin, RANDOM_BYTES);
+
+  /* Collect the siblings. */
+  unsigned char *out = p->path.bin;
+  size_t i = index, n = tree->count;
+  for (size_t k = 0; n > 1; k++, i /= 2, n = (n + 1) / 2) {
+    if ((i ^ 1) < n) {
+      memcpy (out, tree->nodes + (tree->offset[k] + (i ^ 1)) * HASH_BYTES,
+	      HASH_BYTES);
+      out += HASH_BYTES;
+    }
+  }
+  return GOLLE_OK;
+}
+
+void golle_merkle_proof_clear (golle_merkle_proof_t *proof) {
+  if (proof) {
+    golle_bin_release (&proof->secret);
+    golle_bin_release (&proof->random);
+    golle_bin_release (&proof->path);
+  }
+}
+
+/* Compare a computed root with the one that was broadcast. */
+static golle_error check_root (const golle_bin_t *root,
+			       const unsigned char *computed)
+{
+  if (root->size != HASH_BYTES ||
+      memcmp (root->bin, computed, HASH_BYTES)) {
+    return GOLLE_COMMIT_FAILED;
+  }
+  return GOLLE_COMMIT_PASSED;
+}
+
+golle_error golle_merkle_verify (const golle_bin_t *root,
+				 const golle_merkle_proof_t *proof)
+{
+  GOLLE_ASSERT (root, GOLLE_ERROR);
+  GOLLE_ASSERT (root->bin, GOLLE_ERROR);
+  GOLLE_ASSERT (proof, GOLLE_ERROR);
+  GOLLE_ASSERT (proof->secret.bin, GOLLE_ERROR);
+  GOLLE_ASSERT (proof->random.bin, GOLLE_ERROR);
+  GOLLE_ASSERT (proof->index < proof->count, GOLLE_ERROR);
+  GOLLE_ASSERT (proof->path.size ==
+		path_length (proof->index, proof->count) * HASH_BYTES,
+		GOLLE_ERROR);
+
+  unsigned char h[HASH_BYTES];
+  golle_error err = GOLLE_ECRYPTO;
+  /* The random value has a fixed size, or bytes could be moved from
+   * it to the secret without changing the leaf. */
+  if (proof->random.size != RANDOM_BYTES) {
+    return GOLLE_COMMIT_FAILED;
+  }
+
+  EVP_MD_CTX *ctx = EVP_MD_CTX_create ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+
+  if (!hash_leaf (ctx, &proof->random, &proof->secret, h)) {
+    goto out;
+  }
+
+  /* Hash up to the top. The index says which side each sibling is on. */
+  const unsigned char *sib = proof->path.bin;
+  size_t i = proof->index, n = proof->count;
+  for (; n > 1; i /= 2, n = (n + 1) / 2) {
+    if ((i ^ 1) >= n) {
+      continue;
+    }
+    if (!((i & 1) ? hash_node (ctx, sib, h, h) : hash_node (ctx, h, sib, h))) {
+      goto out;
+    }
+    sib += HASH_BYTES;
+  }
+  if (hash_root (ctx, proof->count, h, h)) {
+    err = check_root (root, h);
+  }
+
+ out:
+  EVP_MD_CTX_destroy (ctx);
+  return err;
+}
+
+golle_error golle_merkle_verify_all (const golle_bin_t *root,
+				     const golle_bin_t *const *secrets,
+				     const golle_bin_t *const *randoms,
+				     size_t count)
+{
+  GOLLE_ASSERT (root, GOLLE_ERROR);
+  GOLLE_ASSERT (root->bin, GOLLE_ERROR);
+  GOLLE_ASSERT (count, GOLLE_ERROR);
+  golle_error err = check_bins (secrets, count);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  err = check_bins (randoms, count);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  /* As in golle_merkle_verify(). */
+  for (size_t i = 0; i < count; i++) {
+    if (randoms[i]->size != RANDOM_BYTES) {
+      return GOLLE_COMMIT_FAILED;
+    }
+  }
+
+  unsigned char h[HASH_BYTES];
+  size_t levels, *offset = NULL;
+  unsigned char *nodes = NULL;
+  EVP_MD_CTX *ctx = EVP_MD_CTX_create ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+
+  if ((err = alloc_levels (count, &levels, &offset, &nodes)) != GOLLE_OK) {
+    goto out;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (!hash_leaf (ctx, randoms[i], secrets[i], nodes + i * HASH_BYTES)) {
+      err = GOLLE_ECRYPTO;
+      goto out;
+    }
+  }
+  if ((err = build (ctx, count, levels, offset, nodes, h)) == GOLLE_OK) {
+    err = check_root (root, h);
+  }
+
+ out:
+  EVP_MD_CTX_destroy (ctx);
+  free (offset);
+  free (nodes);
+  return err;
+}
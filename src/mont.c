@@ -0,0 +1,615 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/numbers.h>
+#include <golle/config.h>
+#include "mont.h"
+#include <openssl/crypto.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GOLLE_MONT
+
+enum {
+  /* Exponents are taken five bits at a time. */
+  WINDOW = 5,
+  TABLE = 1 << WINDOW
+};
+
+typedef unsigned __int128 u128;
+
+/* r = x - m if x + hi * 2^(64n) >= m, or else x, without branching on
+ * the result. r must not be x. */
+GOLLE_INLINE void sub_cond (uint64_t *r,
+			    const uint64_t *x,
+			    uint64_t hi,
+			    const uint64_t *m,
+			    int n)
+{
+  uint64_t borrow = 0;
+  for (int j = 0; j < n; j++) {
+    u128 d = (u128)x[j] - m[j] - borrow;
+    r[j] = (uint64_t)d;
+    borrow = (uint64_t)(d >> 64) & 1;
+  }
+  uint64_t keep = (uint64_t)0 - (~hi & borrow);
+  for (int j = 0; j < n; j++) {
+    r[j] = (x[j] & keep) | (r[j] & ~keep);
+  }
+}
+
+/* t = a * b, schoolbook. t has 2n words. */
+GOLLE_INLINE void scalar_product (uint64_t *t,
+				  const uint64_t *a,
+				  const uint64_t *b,
+				  int n)
+{
+  memset (t, 0, 2 * n * sizeof (*t));
+  for (int i = 0; i < n; i++) {
+    uint64_t c = 0;
+    for (int j = 0; j < n; j++) {
+      u128 s = (u128)a[j] * b[i] + t[i + j] + c;
+      t[i + j] = (uint64_t)s;
+      c = (uint64_t)(s >> 64);
+    }
+    t[i + n] = c;
+  }
+}
+
+/* t = a * a. Each cross product is done once and doubled. */
+GOLLE_INLINE void scalar_square (uint64_t *t, const uint64_t *a, int n) {
+  memset (t, 0, 2 * n * sizeof (*t));
+  for (int i = 0; i < n; i++) {
+    uint64_t c = 0;
+    for (int j = i + 1; j < n; j++) {
+      u128 s = (u128)a[i] * a[j] + t[i + j] + c;
+      t[i + j] = (uint64_t)s;
+      c = (uint64_t)(s >> 64);
+    }
+    t[i + n] = c;
+  }
+
+  uint64_t top = 0;
+  for (int i = 0; i < 2 * n; i++) {
+    uint64_t w = t[i];
+    t[i] = (w << 1) | top;
+    top = w >> 63;
+  }
+
+  uint64_t c = 0;
+  for (int i = 0; i < n; i++) {
+    u128 sq = (u128)a[i] * a[i];
+    u128 s = (u128)t[2 * i] + (uint64_t)sq + c;
+    t[2 * i] = (uint64_t)s;
+    s = (u128)t[2 * i + 1] + (uint64_t)(sq >> 64) + (uint64_t)(s >> 64);
+    t[2 * i + 1] = (uint64_t)s;
+    c = (uint64_t)(s >> 64);
+  }
+}
+
+/* r = t / 2^(64n) mod m, for t < m * 2^(64n). t is overwritten. */
+GOLLE_INLINE void scalar_redc (uint64_t *r,
+			       uint64_t *t,
+			       const uint64_t *m,
+			       uint64_t n0,
+			       int n)
+{
+  uint64_t hi = 0;
+  for (int i = 0; i < n; i++) {
+    uint64_t u = t[i] * n0;
+    uint64_t c = 0;
+    for (int j = 0; j < n; j++) {
+      u128 s = (u128)u * m[j] + t[i + j] + c;
+      t[i + j] = (uint64_t)s;
+      c = (uint64_t)(s >> 64);
+    }
+    u128 s = (u128)t[i + n] + c + hi;
+    t[i + n] = (uint64_t)s;
+    hi = (uint64_t)(s >> 64);
+  }
+  sub_cond (r, t + n, hi, m, n);
+}
+
+/* The portable kernels, one pair for each size. The word count is a
+ * constant in each, so the compiler can unroll for it. */
+#define SCALAR_KERNEL(n)						\
+  static void scalar_mul_##n (uint64_t *r,				\
+			      const uint64_t *a,			\
+			      const uint64_t *b,			\
+			      const uint64_t *m,			\
+			      uint64_t n0)				\
+  {									\
+    uint64_t t[2 * (n)];						\
+    scalar_product (t, a, b, (n));					\
+    scalar_redc (r, t, m, n0, (n));					\
+  }									\
+  static void scalar_sqr_##n (uint64_t *r,				\
+			      const uint64_t *a,			\
+			      const uint64_t *m,			\
+			      uint64_t n0)				\
+  {									\
+    uint64_t t[2 * (n)];						\
+    scalar_square (t, a, (n));						\
+    scalar_redc (r, t, m, n0, (n));					\
+  }
+
+SCALAR_KERNEL (16)
+SCALAR_KERNEL (32)
+SCALAR_KERNEL (48)
+SCALAR_KERNEL (64)
+
+/* Portable C is no match for the backends' assembly on 64-bit words,
+ * so these are only used when asked for. */
+static const golle_mont_kernel_t scalar_kernels[GOLLE_MONT_SIZES] = {
+  { "scalar", 1024, 16, 64, 1, 0, &scalar_mul_16, &scalar_sqr_16 },
+  { "scalar", 2048, 32, 64, 1, 0, &scalar_mul_32, &scalar_sqr_32 },
+  { "scalar", 3072, 48, 64, 1, 0, &scalar_mul_48, &scalar_sqr_48 },
+  { "scalar", 4096, 64, 64, 1, 0, &scalar_mul_64, &scalar_sqr_64 }
+};
+
+/* The kernel in use for each size, or NULL for the backend, and the
+ * lane kernel, or NULL to do a batch one at a time. Chosen on first
+ * use. */
+static const golle_mont_kernel_t *kernels[GOLLE_MONT_SIZES];
+static const golle_mont_kernel_t *lane_kernels[GOLLE_MONT_SIZES];
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+/* Use the given kernels for every size, or only the fast ones. */
+static void use_kernels (const golle_mont_kernel_t *k,
+			 const golle_mont_kernel_t *lanes,
+			 int fast_only)
+{
+  for (int i = 0; i < GOLLE_MONT_SIZES; i++) {
+    kernels[i] = k && (k[i].fast || !fast_only) ? k + i : NULL;
+    lane_kernels[i] =
+      lanes && (lanes[i].fast || !fast_only) ? lanes + i : NULL;
+  }
+}
+
+static void choose_kernels (void) {
+  use_kernels (NULL, NULL, 0);
+#ifdef GOLLE_MONT_IFMA
+  if (golle_mont_ifma_supported ()) {
+    use_kernels (golle_mont_ifma, golle_mont_ifma_lanes, 1);
+  }
+#endif
+}
+
+/* The index of the size for a modulus of the given bits, or -1. */
+static int size_index (int bits) {
+  for (int i = 0; i < GOLLE_MONT_SIZES; i++) {
+    int size = scalar_kernels[i].bits;
+    if (bits > size - 64 && bits <= size) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Set x, which is less than 2^(digit_bits * n), to n digits in d. */
+static void to_digits (uint64_t *d,
+		       int n,
+		       int digit_bits,
+		       const BIGNUM *x,
+		       unsigned char *buf)
+{
+  size_t size = BN_num_bytes (x);
+  BN_bn2bin (x, buf);
+  memset (d, 0, n * sizeof (*d));
+  for (size_t i = 0; i < size; i++) {
+    uint64_t byte = buf[size - 1 - i];
+    size_t bit = 8 * i;
+    size_t at = bit / digit_bits, shift = bit % digit_bits;
+    d[at] |= byte << shift;
+    if (shift + 8 > (size_t)digit_bits && at + 1 < (size_t)n) {
+      d[at + 1] |= byte >> (digit_bits - shift);
+    }
+  }
+  if (digit_bits < 64) {
+    uint64_t mask = ((uint64_t)1 << digit_bits) - 1;
+    for (int i = 0; i < n; i++) {
+      d[i] &= mask;
+    }
+  }
+}
+
+/* Set x to the n digits in d. buf holds n * digit_bits / 8 bytes. */
+static int from_digits (BIGNUM *x,
+			const uint64_t *d,
+			int n,
+			int digit_bits,
+			unsigned char *buf)
+{
+  size_t size = ((size_t)n * digit_bits + 7) / 8;
+  for (size_t i = 0; i < size; i++) {
+    size_t bit = 8 * i;
+    size_t at = bit / digit_bits, shift = bit % digit_bits;
+    uint64_t byte = d[at] >> shift;
+    if (shift + 8 > (size_t)digit_bits && at + 1 < (size_t)n) {
+      byte |= d[at + 1] << (digit_bits - shift);
+    }
+    buf[size - 1 - i] = (unsigned char)byte;
+  }
+  return BN_bin2bn (buf, (int)size, x) != NULL;
+}
+
+/* -1/m mod 2^64, for odd m, by Newton's method. Each step doubles the
+ * number of correct bits, starting from three. */
+static uint64_t neg_inverse (uint64_t m) {
+  uint64_t inv = m;
+  for (int i = 0; i < 5; i++) {
+    inv *= 2 - m * inv;
+  }
+  return (uint64_t)0 - inv;
+}
+
+/* Copy entry `index` of the table into r, reading every entry. */
+static void table_select (uint64_t *r,
+			  const uint64_t *table,
+			  unsigned index,
+			  int n)
+{
+  memset (r, 0, n * sizeof (*r));
+  for (unsigned i = 0; i < TABLE; i++) {
+    uint64_t mask = (uint64_t)0 - (uint64_t)(i == index);
+    const uint64_t *entry = table + (size_t)i * n;
+    for (int j = 0; j < n; j++) {
+      r[j] |= entry[j] & mask;
+    }
+  }
+}
+
+/* The window of exponent bits starting at bit i. */
+static unsigned window_at (const BIGNUM *e, int i) {
+  unsigned w = 0;
+  for (int b = WINDOW - 1; b >= 0; b--) {
+    w = (w << 1) | (unsigned)BN_is_bit_set (e, i + b);
+  }
+  return w;
+}
+
+const golle_mont_kernel_t *golle_mont_find (const BIGNUM *m) {
+  pthread_once (&kernels_once, choose_kernels);
+  if (!BN_is_odd (m) || BN_is_negative (m)) {
+    return NULL;
+  }
+  int i = size_index (BN_num_bits (m));
+  return i < 0 ? NULL : kernels[i];
+}
+
+int golle_mont_mod_exp (const golle_mont_kernel_t *k,
+			BIGNUM *r,
+			const BIGNUM *a,
+			const BIGNUM *e,
+			const BIGNUM *m,
+			BN_CTX *ctx)
+{
+  if (BN_is_zero (e)) {
+    return BN_one (r);
+  }
+
+  const int n = k->digits, db = k->digit_bits;
+  const size_t bytes = ((size_t)n * db + 7) / 8;
+  /* The table, then the modulus, R^2, the result, a spare and 1. */
+  const size_t words = (size_t)(TABLE + 5) * n;
+  uint64_t *w = calloc (words, sizeof (*w));
+  unsigned char *buf = malloc (bytes);
+  BN_CTX_start (ctx);
+  BIGNUM *t = BN_CTX_get (ctx);
+  int rc = 0;
+  if (!w || !buf || !t) {
+    goto done;
+  }
+  uint64_t *table = w, *mod = w + TABLE * n, *rr = mod + n;
+  uint64_t *acc = rr + n, *tmp = acc + n, *one = tmp + n;
+
+  /* The modulus and R^2 mod m, where R = 2^(db * n). */
+  to_digits (mod, n, db, m, buf);
+  uint64_t n0 = neg_inverse (mod[0]);
+  BN_zero (t);
+  if (!BN_set_bit (t, 2 * db * n) || !BN_nnmod (t, t, m, ctx)) {
+    goto done;
+  }
+  to_digits (rr, n, db, t, buf);
+
+  /* a, reduced, into the table as aR, after R mod m for a^0. */
+  if (!BN_nnmod (t, a, m, ctx)) {
+    goto done;
+  }
+  to_digits (tmp, n, db, t, buf);
+  one[0] = 1;
+  k->mul (table, rr, one, mod, n0);
+  k->mul (table + n, tmp, rr, mod, n0);
+  for (int i = 2; i < TABLE; i++) {
+    k->mul (table + i * n, table + (i - 1) * n, table + n, mod, n0);
+  }
+
+  /* Fixed windows from the top, with a multiply for every window, so
+   * the time depends only on the length of e. */
+  int i = (BN_num_bits (e) + WINDOW - 1) / WINDOW * WINDOW - WINDOW;
+  table_select (acc, table, window_at (e, i), n);
+  for (i -= WINDOW; i >= 0; i -= WINDOW) {
+    for (int s = 0; s < WINDOW; s++) {
+      k->sqr (acc, acc, mod, n0);
+    }
+    table_select (tmp, table, window_at (e, i), n);
+    k->mul (acc, acc, tmp, mod, n0);
+  }
+
+  /* Out of Montgomery form, and below m. */
+  k->mul (acc, acc, one, mod, n0);
+  if (from_digits (r, acc, n, db, buf)) {
+    rc = BN_cmp (r, m) < 0 || BN_sub (r, r, m);
+  }
+
+ done:
+  BN_CTX_end (ctx);
+  if (w) {
+    OPENSSL_cleanse (w, words * sizeof (*w));
+    free (w);
+  }
+  if (buf) {
+    OPENSSL_cleanse (buf, bytes);
+    free (buf);
+  }
+  return rc;
+}
+
+/* Copy the n digits in d to lane l of x. */
+static void to_lane (uint64_t *x, const uint64_t *d, int n, int l) {
+  for (int i = 0; i < n; i++) {
+    x[(size_t)i * GOLLE_MONT_LANES + l] = d[i];
+  }
+}
+
+/* Copy lane l of x to the n digits in d. */
+static void from_lane (uint64_t *d, const uint64_t *x, int n, int l) {
+  for (int i = 0; i < n; i++) {
+    d[i] = x[(size_t)i * GOLLE_MONT_LANES + l];
+  }
+}
+
+/* Copy entry index[l] of the table into lane l of r, reading every
+ * entry. Each word of r is built up in full before moving on, so it
+ * can stay in a register. */
+static void table_select_lanes (uint64_t *r,
+				const uint64_t *table,
+				const unsigned *index,
+				int n)
+{
+  const size_t width = (size_t)n * GOLLE_MONT_LANES;
+  uint64_t mask[TABLE][GOLLE_MONT_LANES];
+  for (unsigned i = 0; i < TABLE; i++) {
+    for (int l = 0; l < GOLLE_MONT_LANES; l++) {
+      mask[i][l] = (uint64_t)0 - (uint64_t)(i == index[l]);
+    }
+  }
+  for (size_t j = 0; j < width; j += GOLLE_MONT_LANES) {
+    uint64_t word[GOLLE_MONT_LANES] = { 0 };
+    for (unsigned i = 0; i < TABLE; i++) {
+      const uint64_t *entry = table + i * width + j;
+      for (int l = 0; l < GOLLE_MONT_LANES; l++) {
+	word[l] |= entry[l] & mask[i][l];
+      }
+    }
+    memcpy (r + j, word, sizeof (word));
+  }
+}
+
+const golle_mont_kernel_t *golle_mont_find_lanes (const BIGNUM *m) {
+  pthread_once (&kernels_once, choose_kernels);
+  if (!BN_is_odd (m) || BN_is_negative (m)) {
+    return NULL;
+  }
+  int i = size_index (BN_num_bits (m));
+  return i < 0 ? NULL : lane_kernels[i];
+}
+
+int golle_mont_mod_exp_lanes (const golle_mont_kernel_t *k,
+			      BIGNUM **r,
+			      const BIGNUM **a,
+			      const BIGNUM **e,
+			      size_t count,
+			      const BIGNUM *m,
+			      BN_CTX *ctx)
+{
+  /* Every lane takes as many windows as the longest exponent. */
+  int bits = 0;
+  for (size_t l = 0; l < count; l++) {
+    if (BN_num_bits (e[l]) > bits) {
+      bits = BN_num_bits (e[l]);
+    }
+  }
+  if (bits == 0) {
+    for (size_t l = 0; l < count; l++) {
+      if (!BN_one (r[l])) {
+	return 0;
+      }
+    }
+    return 1;
+  }
+
+  const int n = k->digits, db = k->digit_bits;
+  const size_t width = (size_t)n * GOLLE_MONT_LANES;
+  const size_t bytes = ((size_t)n * db + 7) / 8;
+  /* The table, then R^2, the result, a spare and 1, in lanes, then the
+   * modulus and the digits of one number. */
+  const size_t words = (size_t)(TABLE + 4) * width + 2 * n;
+  uint64_t *w = calloc (words, sizeof (*w));
+  unsigned char *buf = malloc (bytes);
+  BN_CTX_start (ctx);
+  BIGNUM *t = BN_CTX_get (ctx);
+  int rc = 0;
+  if (!w || !buf || !t) {
+    goto done;
+  }
+  uint64_t *table = w, *rr = w + TABLE * width, *acc = rr + width;
+  uint64_t *tmp = acc + width, *one = tmp + width;
+  uint64_t *mod = one + width, *d = mod + n;
+
+  /* The modulus and R^2 mod m, where R = 2^(db * n). */
+  to_digits (mod, n, db, m, buf);
+  uint64_t n0 = neg_inverse (mod[0]);
+  BN_zero (t);
+  if (!BN_set_bit (t, 2 * db * n) || !BN_nnmod (t, t, m, ctx)) {
+    goto done;
+  }
+  to_digits (d, n, db, t, buf);
+  for (int l = 0; l < GOLLE_MONT_LANES; l++) {
+    to_lane (rr, d, n, l);
+    one[l] = 1;
+  }
+
+  /* Each a, reduced, into the table as aR. Unused lanes are zero. */
+  for (size_t l = 0; l < count; l++) {
+    if (!BN_nnmod (t, a[l], m, ctx)) {
+      goto done;
+    }
+    to_digits (d, n, db, t, buf);
+    to_lane (tmp, d, n, (int)l);
+  }
+  k->mul (table, rr, one, mod, n0);
+  k->mul (table + width, tmp, rr, mod, n0);
+  for (int i = 2; i < TABLE; i++) {
+    k->mul (table + i * width, table + (i - 1) * width, table + width,
+	    mod, n0);
+  }
+
+  /* Fixed windows, as for a single exponent. */
+  unsigned index[GOLLE_MONT_LANES] = { 0 };
+  int i = (bits + WINDOW - 1) / WINDOW * WINDOW - WINDOW;
+  for (size_t l = 0; l < count; l++) {
+    index[l] = window_at (e[l], i);
+  }
+  table_select_lanes (acc, table, index, n);
+  for (i -= WINDOW; i >= 0; i -= WINDOW) {
+    for (int s = 0; s < WINDOW; s++) {
+      k->sqr (acc, acc, mod, n0);
+    }
+    for (size_t l = 0; l < count; l++) {
+      index[l] = window_at (e[l], i);
+    }
+    table_select_lanes (tmp, table, index, n);
+    k->mul (acc, acc, tmp, mod, n0);
+  }
+
+  /* Out of Montgomery form, and below m. */
+  k->mul (acc, acc, one, mod, n0);
+  rc = 1;
+  for (size_t l = 0; l < count && rc; l++) {
+    from_lane (d, acc, n, (int)l);
+    rc = from_digits (r[l], d, n, db, buf) &&
+      (BN_cmp (r[l], m) < 0 || BN_sub (r[l], r[l], m));
+  }
+
+ done:
+  BN_CTX_end (ctx);
+  if (w) {
+    OPENSSL_cleanse (w, words * sizeof (*w));
+    free (w);
+  }
+  if (buf) {
+    OPENSSL_cleanse (buf, bytes);
+    free (buf);
+  }
+  return rc;
+}
+
+golle_error golle_num_set_kernel (const char *name) {
+  GOLLE_ASSERT (name, GOLLE_ERROR);
+  pthread_once (&kernels_once, choose_kernels);
+  if (strcmp (name, "auto") == 0) {
+    choose_kernels ();
+  }
+  else if (strcmp (name, "scalar") == 0) {
+    use_kernels (scalar_kernels, NULL, 0);
+  }
+#ifdef GOLLE_MONT_IFMA
+  else if (strcmp (name, "ifma") == 0 && golle_mont_ifma_supported ()) {
+    use_kernels (golle_mont_ifma, golle_mont_ifma_lanes, 0);
+  }
+#endif
+  else if (strcmp (name, "none") == 0) {
+    use_kernels (NULL, NULL, 0);
+  }
+  else {
+    return GOLLE_EINVALID;
+  }
+  return GOLLE_OK;
+}
+
+const char *golle_num_kernel (int bits) {
+  pthread_once (&kernels_once, choose_kernels);
+  int i = size_index (bits);
+  return i < 0 || !kernels[i] ? "none" : kernels[i]->name;
+}
+
+const char *golle_num_lane_kernel (int bits) {
+  pthread_once (&kernels_once, choose_kernels);
+  int i = size_index (bits);
+  return i < 0 || !lane_kernels[i] ? "none" : lane_kernels[i]->name;
+}
+
+#else
+
+/* Built without kernels: every exponent goes to the backend. */
+
+const golle_mont_kernel_t *golle_mont_find (const BIGNUM *m) {
+  GOLLE_UNUSED (m);
+  return NULL;
+}
+
+int golle_mont_mod_exp (const golle_mont_kernel_t *k,
+			BIGNUM *r,
+			const BIGNUM *a,
+			const BIGNUM *e,
+			const BIGNUM *m,
+			BN_CTX *ctx)
+{
+  GOLLE_UNUSED (k);
+  return BN_mod_exp (r, a, e, m, ctx);
+}
+
+const golle_mont_kernel_t *golle_mont_find_lanes (const BIGNUM *m) {
+  GOLLE_UNUSED (m);
+  return NULL;
+}
+
+int golle_mont_mod_exp_lanes (const golle_mont_kernel_t *k,
+			      BIGNUM **r,
+			      const BIGNUM **a,
+			      const BIGNUM **e,
+			      size_t count,
+			      const BIGNUM *m,
+			      BN_CTX *ctx)
+{
+  GOLLE_UNUSED (k);
+  for (size_t i = 0; i < count; i++) {
+    if (!BN_mod_exp (r[i], a[i], e[i], m, ctx)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+golle_error golle_num_set_kernel (const char *name) {
+  GOLLE_ASSERT (name, GOLLE_ERROR);
+  if (strcmp (name, "auto") == 0 || strcmp (name, "none") == 0) {
+    return GOLLE_OK;
+  }
+  return GOLLE_EINVALID;
+}
+
+const char *golle_num_kernel (int bits) {
+  GOLLE_UNUSED (bits);
+  return "none";
+}
+
+const char *golle_num_lane_kernel (int bits) {
+  GOLLE_UNUSED (bits);
+  return "none";
+}
+
+#endif
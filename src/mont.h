@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_MONT_H
+#define GOLLE_SRC_MONT_H
+
+#include <golle/platform.h>
+#include <openssl/bn.h>
+#include <stdint.h>
+
+/*
+ * Montgomery exponentiation for moduli of a few fixed sizes, those of
+ * the usual keys. Each size has its own kernels, with the number of
+ * digits known at compile time. mont.c has portable kernels on 64-bit
+ * words; mont_ifma.c has AVX-512 IFMA kernels on 52-bit digits.
+ * golle_num_set_kernel() chooses between them. By default, a size gets
+ * the IFMA kernel if the CPU has IFMA and the kernel is faster than
+ * the backend at that size, and goes to the backend otherwise.
+ *
+ * Lane kernels do GOLLE_MONT_LANES exponents at once, one to each lane
+ * of a vector, all with the same modulus. They are for batches: a
+ * group of exponents takes longer than one does alone, but less time
+ * per exponent.
+ */
+
+enum {
+  /* The number of modulus sizes with kernels: 1024, 2048, 3072 and
+   * 4096 bits. */
+  GOLLE_MONT_SIZES = 4,
+  /* The number of exponents in a lane kernel. */
+  GOLLE_MONT_LANES = 8
+};
+
+/* r = a * b / R mod m, where R = 2^(digit_bits * digits). n0 is
+ * -1/m mod 2^64. r may be a or b. */
+typedef void (*golle_mont_mul_fn) (uint64_t *r,
+				   const uint64_t *a,
+				   const uint64_t *b,
+				   const uint64_t *m,
+				   uint64_t n0);
+
+/* r = a * a / R mod m. r may be a. */
+typedef void (*golle_mont_sqr_fn) (uint64_t *r,
+				   const uint64_t *a,
+				   const uint64_t *m,
+				   uint64_t n0);
+
+/* The kernels for one modulus size. Numbers are held as `digits`
+ * little-endian digits of `digit_bits` bits each, one to a word. Inputs
+ * are below m, or outputs of the same kernel; outputs are below 2m.
+ * For lane kernels, a and b hold `lanes` numbers, with digit i of lane
+ * l at [i * lanes + l]; m is still a single number. */
+typedef struct golle_mont_kernel_t {
+  const char *name;
+  int bits; /* The largest modulus, in bits. */
+  int digits;
+  int digit_bits;
+  int lanes; /* 1, or GOLLE_MONT_LANES. */
+  int fast; /* Non-zero if it beats the backends, so "auto" uses it. */
+  golle_mont_mul_fn mul;
+  golle_mont_sqr_fn sqr;
+} golle_mont_kernel_t;
+
+#ifdef GOLLE_MONT_IFMA
+/* Non-zero if the CPU can run the IFMA kernels. */
+GOLLE_EXTERN int golle_mont_ifma_supported (void);
+
+/* The IFMA kernels, one for each size. */
+GOLLE_EXTERN const golle_mont_kernel_t golle_mont_ifma[GOLLE_MONT_SIZES];
+
+/* The IFMA lane kernels, one for each size. */
+GOLLE_EXTERN const golle_mont_kernel_t golle_mont_ifma_lanes[GOLLE_MONT_SIZES];
+#endif
+
+/* The kernel for exponents modulo m, or NULL if m isn't one of the
+ * sizes, is even, or kernels are turned off. */
+GOLLE_EXTERN const golle_mont_kernel_t *golle_mont_find (const BIGNUM *m);
+
+/* r = a^e mod m, using kernel k from golle_mont_find (m). e must not be
+ * negative. Returns 1 on success and 0 on failure, like BN_mod_exp(). */
+GOLLE_EXTERN int golle_mont_mod_exp (const golle_mont_kernel_t *k,
+				     BIGNUM *r,
+				     const BIGNUM *a,
+				     const BIGNUM *e,
+				     const BIGNUM *m,
+				     BN_CTX *ctx);
+
+/* The lane kernel for exponents modulo m, or NULL if there is none. */
+GOLLE_EXTERN const golle_mont_kernel_t *golle_mont_find_lanes (const BIGNUM *m);
+
+/* r[i] = a[i]^e[i] mod m for each i < count, using lane kernel k from
+ * golle_mont_find_lanes (m). count is at most k->lanes, and no e[i] may
+ * be negative. Returns 1 on success and 0 on failure. */
+GOLLE_EXTERN int golle_mont_mod_exp_lanes (const golle_mont_kernel_t *k,
+					   BIGNUM **r,
+					   const BIGNUM **a,
+					   const BIGNUM **e,
+					   size_t count,
+					   const BIGNUM *m,
+					   BN_CTX *ctx);
+
+#endif
@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/config.h>
+#include "mont.h"
+
+#ifdef GOLLE_MONT_IFMA
+#include <immintrin.h>
+#include <string.h>
+
+/*
+ * Montgomery arithmetic on 52-bit digits with AVX-512 IFMA, eight
+ * digits to a register. Digits are only carried at the end of each
+ * operation, since 64-bit lanes have room for the sums. The digit count
+ * is padded to a multiple of eight, which leaves R > 4m, so results
+ * below 2m can be fed back in without a final subtraction.
+ *
+ * Both kernels work on a window of digits that moves down one digit a
+ * step. The multiple of m for each step depends on the one before, so
+ * that chain sets the speed: to keep it short, the lowest digit is
+ * kept in a scalar, and the high halves of products are added before
+ * the shift, against copies of a and m moved up a digit.
+ *
+ * `wide` is set for sizes where the top digit can be non-zero, so a
+ * product reaches a digit past the top one, in one more register.
+ */
+
+#define IFMA __attribute__ ((target ("avx512f,avx512ifma")))
+#define IFMA_INLINE static inline __attribute__ ((always_inline)) IFMA
+
+#define MASK52 ((((uint64_t)1) << 52) - 1)
+
+/* Loops over the registers of a number must be unrolled, or the
+ * registers end up in memory. */
+#define UNROLL _Pragma ("GCC unroll 16")
+
+enum {
+  /* The most registers in a number: 4096 bits is 80 digits. */
+  MAX_REGS = 10,
+  MAX_DIGITS = MAX_REGS * 8
+};
+
+IFMA_INLINE uint64_t lane0 (__m512i v) {
+  return (uint64_t)_mm_cvtsi128_si64 (_mm512_castsi512_si128 (v));
+}
+
+IFMA_INLINE uint64_t lane1 (__m512i v) {
+  return (uint64_t)_mm_extract_epi64 (_mm512_castsi512_si128 (v), 1);
+}
+
+/* Move the digits of v up by one, into regs + 1 registers. */
+IFMA_INLINE void shift_up (__m512i *up, const __m512i *v, int regs) {
+  const __m512i zero = _mm512_setzero_si512 ();
+  up[0] = _mm512_alignr_epi64 (v[0], zero, 7);
+  UNROLL
+  for (int j = 1; j < regs; j++) {
+    up[j] = _mm512_alignr_epi64 (v[j], v[j - 1], 7);
+  }
+  up[regs] = _mm512_alignr_epi64 (zero, v[regs - 1], 7);
+}
+
+/* Move the digits of acc down by one, taking lane 0 of fill in at the
+ * top. */
+IFMA_INLINE void shift_down (__m512i *acc, int regs, __m512i fill) {
+  UNROLL
+  for (int j = 0; j < regs - 1; j++) {
+    acc[j] = _mm512_alignr_epi64 (acc[j + 1], acc[j], 1);
+  }
+  acc[regs - 1] = _mm512_alignr_epi64 (fill, acc[regs - 1], 1);
+}
+
+/* Load the digits of m and its copy moved up a digit. */
+IFMA_INLINE void load (__m512i *v, __m512i *up, const uint64_t *x, int regs) {
+  UNROLL
+  for (int j = 0; j < regs; j++) {
+    v[j] = _mm512_loadu_si512 (x + 8 * j);
+  }
+  shift_up (up, v, regs);
+}
+
+/* Carry through `digits` digits of r. */
+static void normalise (uint64_t *r, int digits) {
+  uint64_t carry = 0;
+  for (int i = 0; i < digits; i++) {
+    uint64_t d = r[i] + carry;
+    r[i] = d & MASK52;
+    carry = d >> 52;
+  }
+}
+
+/* r = a * b / R, almost: each step adds a times one digit of b and the
+ * multiple of m that clears the lowest digit. The multiples of a and m
+ * go to separate accumulators, so only the second waits on the chain. */
+IFMA_INLINE void ifma_mul (uint64_t *r,
+			   const uint64_t *a,
+			   const uint64_t *b,
+			   const uint64_t *m,
+			   uint64_t n0,
+			   int regs,
+			   int wide)
+{
+  const int digits = regs * 8, top = regs + wide;
+  __m512i av[MAX_REGS], mv[MAX_REGS], au[MAX_REGS + 1], mu[MAX_REGS + 1];
+  __m512i accA[MAX_REGS + 1], accM[MAX_REGS + 1];
+  const __m512i zero = _mm512_setzero_si512 ();
+  load (av, au, a, regs);
+  load (mv, mu, m, regs);
+  UNROLL
+  for (int j = 0; j < top; j++) {
+    accA[j] = accM[j] = zero;
+  }
+
+  /* The lowest digit. Lane 0 of the accumulators isn't used. */
+  uint64_t low = 0;
+  const uint64_t a0 = a[0], m0 = m[0];
+  for (int i = 0; i < digits; i++) {
+    const uint64_t bi = b[i];
+    __m512i bv = _mm512_set1_epi64 ((long long)bi);
+    UNROLL
+    for (int j = 0; j < regs; j++) {
+      accA[j] = _mm512_madd52lo_epu64 (accA[j], av[j], bv);
+    }
+    UNROLL
+    for (int j = 0; j < top; j++) {
+      accA[j] = _mm512_madd52hi_epu64 (accA[j], au[j], bv);
+    }
+
+    /* The multiple of m that zeroes the low digit, and what that
+     * digit carries into the next. */
+    uint64_t t = low + ((a0 * bi) & MASK52);
+    uint64_t y = (t * n0) & MASK52;
+    uint64_t my = (uint64_t)(((unsigned __int128)m0 * y) >> 52);
+    uint64_t carry = (t + ((m0 * y) & MASK52)) >> 52;
+
+    __m512i yv = _mm512_set1_epi64 ((long long)y);
+    UNROLL
+    for (int j = 0; j < regs; j++) {
+      accM[j] = _mm512_madd52lo_epu64 (accM[j], mv[j], yv);
+    }
+    low = lane1 (accA[0]) + lane1 (accM[0]) + my + carry;
+    UNROLL
+    for (int j = 0; j < top; j++) {
+      accM[j] = _mm512_madd52hi_epu64 (accM[j], mu[j], yv);
+    }
+    shift_down (accA, top, zero);
+    shift_down (accM, top, zero);
+  }
+
+  /* The sum is below R, so nothing is left above the top digit. */
+  UNROLL
+  for (int j = 0; j < regs; j++) {
+    _mm512_storeu_si512 (r + 8 * j, _mm512_add_epi64 (accA[j], accM[j]));
+  }
+  r[0] = low;
+  normalise (r, digits);
+}
+
+/* r = a * a / R, almost. The square comes first, with each cross
+ * product done once and doubled, then it's reduced a digit at a time. */
+IFMA_INLINE void ifma_sqr (uint64_t *r,
+			   const uint64_t *a,
+			   const uint64_t *m,
+			   uint64_t n0,
+			   int regs,
+			   int wide)
+{
+  const int digits = regs * 8, top = regs + wide;
+  __m512i av[MAX_REGS], mv[MAX_REGS], au[MAX_REGS + 1], mu[MAX_REGS + 1];
+  __m512i acc[MAX_REGS + 1];
+  /* Two numbers, and a register's worth past the end to load from. */
+  uint64_t p[2 * MAX_DIGITS + 8];
+  const __m512i zero = _mm512_setzero_si512 ();
+  load (av, au, a, regs);
+  UNROLL
+  for (int j = 0; j < top; j++) {
+    acc[j] = zero;
+  }
+
+  /* Digit i of the window holds digit i + j of the square. Step i adds
+   * a[j] * a[i] for j > i: the low half to lane j and the high half to
+   * lane j + 1, so the lanes below those are masked off, and whole
+   * registers drop out as i goes up. */
+  for (int i = 0; i < digits; i++) {
+    __m512i bv = _mm512_set1_epi64 ((long long)a[i]);
+    UNROLL
+    for (int j = 0; j < regs; j++) {
+      int skip = i + 1 - 8 * j;
+      if (skip < 8) {
+	__mmask8 k = skip > 0 ? (__mmask8)(0xFF << skip) : 0xFF;
+	acc[j] = _mm512_mask_madd52lo_epu64 (acc[j], k, av[j], bv);
+      }
+    }
+    UNROLL
+    for (int j = 0; j < top; j++) {
+      int skip = i + 2 - 8 * j;
+      if (skip < 8) {
+	__mmask8 k = skip > 0 ? (__mmask8)(0xFF << skip) : 0xFF;
+	acc[j] = _mm512_mask_madd52hi_epu64 (acc[j], k, au[j], bv);
+      }
+    }
+    p[i] = lane0 (acc[0]);
+    shift_down (acc, top, zero);
+  }
+  UNROLL
+  for (int j = 0; j < regs; j++) {
+    _mm512_storeu_si512 (p + digits + 8 * j, acc[j]);
+  }
+
+  /* Double, and add the squares on the diagonal. */
+  for (int i = 0; i < digits; i++) {
+    unsigned __int128 sq = (unsigned __int128)a[i] * a[i];
+    p[2 * i] = 2 * p[2 * i] + ((uint64_t)sq & MASK52);
+    p[2 * i + 1] = 2 * p[2 * i + 1] + (uint64_t)(sq >> 52);
+  }
+  normalise (p, 2 * digits);
+  memset (p + 2 * digits, 0, 8 * sizeof (*p));
+
+  /* Reduce: the window starts on the low half and takes in a digit of
+   * the high half at each step. */
+  load (mv, mu, m, regs);
+  UNROLL
+  for (int j = 0; j < regs; j++) {
+    acc[j] = _mm512_loadu_si512 (p + 8 * j);
+  }
+  if (wide) {
+    acc[regs] = _mm512_loadu_si512 (p + digits);
+  }
+  uint64_t low = p[0];
+  const uint64_t m0 = m[0];
+  for (int i = 0; i < digits; i++) {
+    uint64_t y = (low * n0) & MASK52;
+    uint64_t my = (uint64_t)(((unsigned __int128)m0 * y) >> 52);
+    uint64_t carry = (low + ((m0 * y) & MASK52)) >> 52;
+
+    __m512i yv = _mm512_set1_epi64 ((long long)y);
+    UNROLL
+    for (int j = 0; j < regs; j++) {
+      acc[j] = _mm512_madd52lo_epu64 (acc[j], mv[j], yv);
+    }
+    low = lane1 (acc[0]) + my + carry;
+    UNROLL
+    for (int j = 0; j < top; j++) {
+      acc[j] = _mm512_madd52hi_epu64 (acc[j], mu[j], yv);
+    }
+    shift_down (acc, top, _mm512_loadu_si512 (p + i + top * 8));
+  }
+
+  UNROLL
+  for (int j = 0; j < regs; j++) {
+    _mm512_storeu_si512 (r + 8 * j, acc[j]);
+  }
+  r[0] = low;
+  normalise (r, digits);
+}
+
+#define IFMA_KERNEL(regs, wide)						\
+  IFMA static void ifma_mul_##regs (uint64_t *r,			\
+				    const uint64_t *a,			\
+				    const uint64_t *b,			\
+				    const uint64_t *m,			\
+				    uint64_t n0)			\
+  {									\
+    ifma_mul (r, a, b, m, n0, (regs), (wide));				\
+  }									\
+  IFMA static void ifma_sqr_##regs (uint64_t *r,			\
+				    const uint64_t *a,			\
+				    const uint64_t *m,			\
+				    uint64_t n0)			\
+  {									\
+    ifma_sqr (r, a, m, n0, (regs), (wide));				\
+  }
+
+/* Only 2048 bits reaches the top digit: 2049 bits in 40 digits. */
+IFMA_KERNEL (3, 0)
+IFMA_KERNEL (5, 1)
+IFMA_KERNEL (8, 0)
+IFMA_KERNEL (10, 0)
+
+/* At 1024 bits there are too few registers to hide the chain, and
+ * OpenSSL's own assembly is faster. */
+const golle_mont_kernel_t golle_mont_ifma[GOLLE_MONT_SIZES] = {
+  { "ifma", 1024, 24, 52, 1, 0, &ifma_mul_3, &ifma_sqr_3 },
+  { "ifma", 2048, 40, 52, 1, 1, &ifma_mul_5, &ifma_sqr_5 },
+  { "ifma", 3072, 64, 52, 1, 1, &ifma_mul_8, &ifma_sqr_8 },
+  { "ifma", 4096, 80, 52, 1, 1, &ifma_mul_10, &ifma_sqr_10 }
+};
+
+/*
+ * The lane kernels: eight numbers with the same modulus, one to each
+ * lane, so register j holds digit j of all of them. Nothing moves
+ * between lanes, and each lane has its own multiple of m, so there's
+ * no chain through a scalar. The result is built a column at a time,
+ * each column summing the products whose digits add up to it, and only
+ * two columns are live at once. Numbers aren't padded here: the
+ * digits only need R > 4m.
+ */
+
+enum {
+  /* 4096 bits and two more, in 52-bit digits. */
+  MAX_LANE_DIGITS = 79
+};
+
+#define LANE(x, i) _mm512_loadu_si512 ((x) + 8 * (i))
+#define BCAST(x) _mm512_set1_epi64 ((long long)(x))
+
+enum {
+  /* Accumulators for each half of a column. More of them make the
+   * chains through each one shorter. */
+  CHAINS = 4
+};
+
+/* Add the products of x and y with digits summing to column k, for x
+ * digits from lo to hi: the low halves to l, and the high halves, which
+ * belong to the next column, to h. Each product goes to the next
+ * accumulator along. */
+#define COLUMN(x, y, lo, hi, k)						\
+  do {									\
+    int j_ = (lo);							\
+    for (; j_ + CHAINS - 1 <= (hi); j_ += CHAINS) {			\
+      UNROLL								\
+      for (int c_ = 0; c_ < CHAINS; c_++) {				\
+	__m512i x_ = x (j_ + c_), y_ = y ((k) - j_ - c_);		\
+	l[c_] = _mm512_madd52lo_epu64 (l[c_], x_, y_);			\
+	h[c_] = _mm512_madd52hi_epu64 (h[c_], x_, y_);			\
+      }									\
+    }									\
+    UNROLL								\
+    for (int c_ = 0; c_ < CHAINS - 1; c_++) {				\
+      if (j_ + c_ <= (hi)) {						\
+	__m512i x_ = x (j_ + c_), y_ = y ((k) - j_ - c_);		\
+	l[c_] = _mm512_madd52lo_epu64 (l[c_], x_, y_);			\
+	h[c_] = _mm512_madd52hi_epu64 (h[c_], x_, y_);			\
+      }									\
+    }									\
+  } while (0)
+
+/* The sum of the accumulators, which are then cleared. */
+IFMA_INLINE __m512i collect (__m512i *acc) {
+  __m512i sum = _mm512_add_epi64 (_mm512_add_epi64 (acc[0], acc[1]),
+				  _mm512_add_epi64 (acc[2], acc[3]));
+  UNROLL
+  for (int c = 0; c < CHAINS; c++) {
+    acc[c] = _mm512_setzero_si512 ();
+  }
+  return sum;
+}
+
+/* Finish column k, whose sum is l plus the multiple of m: below
+ * `digits`, pick the multiple of m that clears the column and keep it
+ * in y; above, the column is a digit of r. The rest goes to the next
+ * column. */
+IFMA_INLINE __m512i lanes_reduce (uint64_t *r,
+				  __m512i *y,
+				  __m512i l,
+				  __m512i h,
+				  const uint64_t *m,
+				  __m512i n0,
+				  int k,
+				  int digits)
+{
+  if (k < digits) {
+    const __m512i m0 = BCAST (m[0]);
+    y[k] = _mm512_madd52lo_epu64 (_mm512_setzero_si512 (), l, n0);
+    l = _mm512_madd52lo_epu64 (l, m0, y[k]);
+    h = _mm512_madd52hi_epu64 (h, m0, y[k]);
+  }
+  else {
+    _mm512_storeu_si512 (r + 8 * (k - digits),
+			 _mm512_and_si512 (l, BCAST (MASK52)));
+  }
+  return _mm512_add_epi64 (h, _mm512_srli_epi64 (l, 52));
+}
+
+/* Digit i of a, b, m and the multiples of m. */
+#define A(i) LANE (a, i)
+#define B(i) LANE (b, i)
+#define M(i) BCAST (m[i])
+#define Y(i) y[i]
+
+/* r = a * b / R. r may be a or b: digit i of r is only written once
+ * digit i of a and b are done with. */
+IFMA_INLINE void lanes_mul (uint64_t *r,
+			    const uint64_t *a,
+			    const uint64_t *b,
+			    const uint64_t *m,
+			    uint64_t n0,
+			    int digits)
+{
+  __m512i y[MAX_LANE_DIGITS];
+  const __m512i n0v = BCAST (n0), zero = _mm512_setzero_si512 ();
+  __m512i carry = zero;
+  __m512i l[CHAINS], h[CHAINS];
+  UNROLL
+  for (int c = 0; c < CHAINS; c++) {
+    l[c] = h[c] = zero;
+  }
+  for (int k = 0; k < 2 * digits - 1; k++) {
+    const int lo = k < digits ? 0 : k - digits + 1;
+    const int hi = k < digits ? k : digits - 1;
+    l[0] = carry;
+    COLUMN (A, B, lo, hi, k);
+    /* The newest multiple of m, at digit k - 1, comes last. */
+    COLUMN (Y, M, k - hi, k - (lo > 0 ? lo : 1), k);
+    carry = lanes_reduce (r, y, collect (l), collect (h), m, n0v, k, digits);
+  }
+  _mm512_storeu_si512 (r + 8 * (digits - 1), carry);
+}
+
+/* r = a * a / R. Each cross product is done once and doubled. */
+IFMA_INLINE void lanes_sqr (uint64_t *r,
+			    const uint64_t *a,
+			    const uint64_t *m,
+			    uint64_t n0,
+			    int digits)
+{
+  __m512i y[MAX_LANE_DIGITS];
+  const __m512i n0v = BCAST (n0), zero = _mm512_setzero_si512 ();
+  __m512i carry = zero;
+  __m512i l[CHAINS], h[CHAINS];
+  UNROLL
+  for (int c = 0; c < CHAINS; c++) {
+    l[c] = h[c] = zero;
+  }
+  for (int k = 0; k < 2 * digits - 1; k++) {
+    const int lo = k < digits ? 0 : k - digits + 1;
+    const int hi = k < digits ? k : digits - 1;
+    COLUMN (A, A, lo, (k + 1) / 2 - 1, k);
+    __m512i cross = collect (l), cross_hi = collect (h);
+    l[0] = _mm512_add_epi64 (_mm512_add_epi64 (cross, cross), carry);
+    h[0] = _mm512_add_epi64 (cross_hi, cross_hi);
+    if (!(k & 1)) {
+      COLUMN (A, A, k / 2, k / 2, k);
+    }
+    COLUMN (Y, M, k - hi, k - (lo > 0 ? lo : 1), k);
+    carry = lanes_reduce (r, y, collect (l), collect (h), m, n0v, k, digits);
+  }
+  _mm512_storeu_si512 (r + 8 * (digits - 1), carry);
+#undef A
+#undef B
+#undef M
+#undef Y
+}
+
+#define LANES_KERNEL(digits)						\
+  IFMA static void lanes_mul_##digits (uint64_t *r,			\
+				       const uint64_t *a,		\
+				       const uint64_t *b,		\
+				       const uint64_t *m,		\
+				       uint64_t n0)			\
+  {									\
+    lanes_mul (r, a, b, m, n0, (digits));				\
+  }									\
+  IFMA static void lanes_sqr_##digits (uint64_t *r,			\
+				       const uint64_t *a,		\
+				       const uint64_t *m,		\
+				       uint64_t n0)			\
+  {									\
+    lanes_sqr (r, a, m, n0, (digits));					\
+  }
+
+LANES_KERNEL (20)
+LANES_KERNEL (40)
+LANES_KERNEL (60)
+LANES_KERNEL (79)
+
+const golle_mont_kernel_t golle_mont_ifma_lanes[GOLLE_MONT_SIZES] = {
+  { "ifma-lanes", 1024, 20, 52, GOLLE_MONT_LANES, 1,
+    &lanes_mul_20, &lanes_sqr_20 },
+  { "ifma-lanes", 2048, 40, 52, GOLLE_MONT_LANES, 1,
+    &lanes_mul_40, &lanes_sqr_40 },
+  { "ifma-lanes", 3072, 60, 52, GOLLE_MONT_LANES, 1,
+    &lanes_mul_60, &lanes_sqr_60 },
+  { "ifma-lanes", 4096, 79, 52, GOLLE_MONT_LANES, 1,
+    &lanes_mul_79, &lanes_sqr_79 }
+};
+
+int golle_mont_ifma_supported (void) {
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx512f") &&
+    __builtin_cpu_supports ("avx512ifma");
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <golle/netsim.h>
+#include <sched.h>
+#include <time.h>
+
+enum {
+  /* Yield instead of sleeping for the last part of a wait. */
+  MIN_SLEEP_NS = 100000
+};
+
+/* splitmix64, which is plenty for jitter. */
+static double next_uniform (golle_link_t *link) {
+  uint64_t z = (link->state += UINT64_C (0x9E3779B97F4A7C15));
+  z = (z ^ (z >> 30)) * UINT64_C (0xBF58476D1CE4E5B9);
+  z = (z ^ (z >> 27)) * UINT64_C (0x94D049BB133111EB);
+  z ^= z >> 31;
+  return (z >> 11) * (1.0 / (UINT64_C (1) << 53));
+}
+
+golle_error golle_link_init (golle_link_t *link,
+			     const golle_netsim_t *model,
+			     uintmax_t id)
+{
+  GOLLE_ASSERT (link, GOLLE_ERROR);
+  GOLLE_ASSERT (model, GOLLE_ERROR);
+  GOLLE_ASSERT (model->latency >= 0, GOLLE_ERROR);
+  GOLLE_ASSERT (model->jitter >= 0, GOLLE_ERROR);
+  GOLLE_ASSERT (model->bandwidth >= 0, GOLLE_ERROR);
+
+  link->model = *model;
+  link->busy_until = 0;
+  link->last_delivery = 0;
+  link->state = model->seed ^ (id * UINT64_C (0xD1B54A32D192ED03));
+  return GOLLE_OK;
+}
+
+double golle_link_send (golle_link_t *link, double now, size_t bytes) {
+  const golle_netsim_t *m = &link->model;
+
+  /* Wait for the link to finish with the previous message. */
+  double start = now > link->busy_until ? now : link->busy_until;
+  if (m->bandwidth > 0) {
+    start += bytes / m->bandwidth;
+  }
+  link->busy_until = start;
+
+  double at = start + m->latency;
+  if (m->jitter > 0) {
+    at += m->jitter * next_uniform (link);
+  }
+
+  /* Jitter doesn't reorder messages. */
+  if (at < link->last_delivery) {
+    at = link->last_delivery;
+  }
+  link->last_delivery = at;
+  return at;
+}
+
+double golle_netsim_now (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void golle_netsim_wait (double until) {
+  for (;;) {
+    double left = until - golle_netsim_now ();
+    if (left <= 0) {
+      break;
+    }
+    if (left * 1e9 < 2 * MIN_SLEEP_NS) {
+      sched_yield ();
+    }
+    else {
+      /* Wake a little early, and yield for the rest. */
+      struct timespec ts;
+      left -= MIN_SLEEP_NS * 1e-9;
+      ts.tv_sec = (time_t)left;
+      ts.tv_nsec = (long)((left - ts.tv_sec) * 1e9);
+      nanosleep (&ts, NULL);
+    }
+  }
+}
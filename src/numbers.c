@@ -7,11 +7,28 @@
 #include <golle/random.h>
 #include <golle/types.h>
 #include "numbers.h"
+#include "random.h"
+#include "atomic.h"
+#include <openssl/crypto.h>
+#include <limits.h>
+#include <stdlib.h>
 
 #if HAVE_STRING_H
 #include <string.h>
 #endif
 
+enum {
+  /* Random draws up to this size don't need the heap. */
+  RAND_STACK_BYTES = 512,
+  /* A group of lanes takes as long as four or five exponents one at a
+   * time, so smaller groups are quicker done that way. */
+  LANES_MIN = 5,
+  /* Prime candidates are first divided by the odd primes below this. */
+  SIEVE_LIMIT = 1 << 14,
+  /* How far a prime search steps from a start before drawing another. */
+  SIEVE_SPAN = 1 << 16
+};
+
 /*
  * Shorthand for goto error;
  */
@@ -65,18 +82,66 @@ golle_num_t golle_num_new_int (size_t i) {
   return n;
 }
 
+/* Draw a number of `bits` bits. If `top`, the top bit is set, otherwise
+ * draws are repeated until the number is less than `range`. */
+static int rand_draw (BIGNUM *r, int bits, int top, const BIGNUM *range) {
+  unsigned char stack[RAND_STACK_BYTES];
+  size_t bytes = ((size_t)bits + CHAR_BIT - 1) / CHAR_BIT;
+  unsigned char mask = 0xFF >> (bytes * CHAR_BIT - bits);
+  unsigned char *buf = stack;
+  int rc = 0;
+
+  if (bytes > RAND_STACK_BYTES && !(buf = malloc (bytes))) {
+    return 0;
+  }
+  do {
+    if (golle_random_bytes (buf, bytes) != GOLLE_OK) {
+      break;
+    }
+    buf[0] &= mask;
+    if (top) {
+      buf[0] |= (mask >> 1) + 1;
+    }
+    if (!BN_bin2bn (buf, bytes, r)) {
+      break;
+    }
+    rc = top || BN_cmp (r, range) < 0;
+  } while (!rc);
+
+  OPENSSL_cleanse (buf, bytes);
+  if (buf != stack) {
+    free (buf);
+  }
+  return rc;
+}
+
+int golle_rand_range (BIGNUM *r, const BIGNUM *range) {
+  if (BN_is_negative (range) || BN_is_zero (range)) {
+    return 0;
+  }
+  /* At most 2 draws are needed on average. */
+  return rand_draw (r, BN_num_bits (range), 0, range);
+}
+
+int golle_rand_bits (BIGNUM *r, int bits) {
+  if (bits == 0) {
+    BN_zero (r);
+    return 1;
+  }
+  if (bits < 0) {
+    return 0;
+  }
+  return rand_draw (r, bits, 1, NULL);
+}
+
 golle_error golle_num_generate_rand (golle_num_t r, 
 				     const golle_num_t n)
 {
   GOLLE_ASSERT (r, GOLLE_ERROR);
   GOLLE_ASSERT (n, GOLLE_ERROR);
 
-  /* Always seed the RNG. */
-  golle_error err = golle_random_seed ();
-  GOLLE_ASSERT (err == GOLLE_OK, err);
-
   /* A random number */
-  if (!BN_rand_range (r, n)) {
+  if (!golle_bn_rand_range (r, n)) {
     return GOLLE_EMEM;
   }
   return GOLLE_OK;
@@ -100,12 +165,9 @@ golle_num_t golle_num_rand (const golle_num_t n) {
 golle_error golle_num_rand_bits (golle_num_t r, int bits) {
   GOLLE_ASSERT (r, GOLLE_ERROR);
 
-  /* Always seed the RNG. */
-  golle_error err = golle_random_seed ();
-  GOLLE_ASSERT (err == GOLLE_OK, err);
-
   /* A random number */
-  if (!BN_rand (r, bits, 0, 0)) {
+  golle_num_stats_count (GOLLE_NUM_OP_RAND, bits);
+  if (!golle_rand_bits (r, bits)) {
     return GOLLE_ECRYPTO;
   }
   return GOLLE_OK;
@@ -115,17 +177,108 @@ int golle_num_cmp (const golle_num_t n1, const golle_num_t n2) {
   return BN_cmp (n1, n2);
 }
 
+/* 1 if p is probably prime. The witnesses are OpenSSL's own draws,
+ * which change the odds of a wrong answer but not the answer. */
+static int is_prime (const BIGNUM *p, BN_CTX *ctx) {
+  return BN_is_prime_ex (p, BN_prime_checks, ctx, NULL);
+}
+
+#if GOLLE_TEST_RANDOM
+/* Put the odd primes below SIEVE_LIMIT in primes, and count them. */
+static size_t small_primes (unsigned *primes) {
+  unsigned char composite[SIEVE_LIMIT] = { 0 };
+  size_t n = 0;
+  for (unsigned i = 3; i < SIEVE_LIMIT; i += 2) {
+    if (!composite[i]) {
+      primes[n++] = i;
+      for (unsigned j = i * i; j < SIEVE_LIMIT; j += 2 * i) {
+	composite[j] = 1;
+      }
+    }
+  }
+  return n;
+}
+
+/* Find a prime from the library's own draws, so that it comes out the
+ * same under a replaced source. For a safe prime p = 2q + 1 the search
+ * is for q. From a random odd start x, x + d is tried for even d, and
+ * the remainders of x by the small primes rule out most of them. */
+static BIGNUM *seeded_prime (int bits, int safe) {
+  int xbits = safe ? bits - 1 : bits;
+  BN_CTX *ctx = BN_CTX_new ();
+  BIGNUM *x = BN_new (), *q = BN_new (), *p = BN_new ();
+  unsigned *primes = malloc (SIEVE_LIMIT * sizeof (*primes));
+  unsigned *rem = primes ? primes + SIEVE_LIMIT / 2 : NULL;
+  int ok = ctx && x && q && p && primes && xbits >= 2;
+  int found = 0;
+  size_t n = ok ? small_primes (primes) : 0;
+  /* Smaller candidates might be one of the small primes. */
+  int sieve = xbits > 15;
+
+  while (ok && !found) {
+    ok = golle_rand_bits (x, xbits) && BN_set_bit (x, 0);
+    for (size_t i = 0; ok && sieve && i < n; i++) {
+      BN_ULONG r = BN_mod_word (x, primes[i]);
+      ok = r != (BN_ULONG)-1;
+      rem[i] = (unsigned)r;
+    }
+    for (unsigned d = 0; ok && !found && d < SIEVE_SPAN; d += 2) {
+      int skip = 0;
+      for (size_t i = 0; sieve && !skip && i < n; i++) {
+	unsigned r = (rem[i] + d) % primes[i];
+	skip = r == 0 || (safe && (2 * r + 1) % primes[i] == 0);
+      }
+      if (skip) {
+	continue;
+      }
+      if (!(ok = BN_copy (q, x) && BN_add_word (q, d)) ||
+	  BN_num_bits (q) != xbits) {
+	break;
+      }
+      if (!safe) {
+	found = is_prime (q, ctx) == 1;
+      }
+      else if (is_prime (q, ctx) == 1) {
+	ok = BN_lshift1 (p, q) && BN_add_word (p, 1);
+	found = ok && is_prime (p, ctx) == 1;
+      }
+    }
+  }
+
+  free (primes);
+  BN_CTX_free (ctx);
+  BN_clear_free (x);
+  if (found && !safe) {
+    BN_free (p);
+    return q;
+  }
+  BN_clear_free (q);
+  if (found) {
+    return p;
+  }
+  BN_free (p);
+  return NULL;
+}
+#endif
+
 golle_num_t golle_generate_prime (int bits, 
 				  int safe, 
 				  golle_num_t div)
 {
-  BIGNUM* num = BN_new ();
-  GOLLE_ASSERT (num, NULL);
-
   /* Always seed the RNG. */
   golle_error err = golle_random_seed ();
   GOLLE_ASSERT (err == GOLLE_OK, NULL);
 
+  golle_num_stats_count (GOLLE_NUM_OP_PRIME, bits);
+#if GOLLE_TEST_RANDOM
+  /* OpenSSL would draw its candidates from its own generator. */
+  if (!div && golle_random_replaced ()) {
+    return AS_GN (seeded_prime (bits, safe));
+  }
+#endif
+
+  BIGNUM* num = BN_new ();
+  GOLLE_ASSERT (num, NULL);
   if (!BN_generate_prime_ex (num, bits, safe, AS_BN(div), NULL, NULL)) {
     BN_free (num);
     return NULL;
@@ -141,7 +294,8 @@ golle_error golle_test_prime (golle_num_t p) {
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
 
   golle_error err;
-  if (BN_is_prime_ex (AS_BN (p), BN_prime_checks, ctx, NULL)) {
+  golle_num_stats_count (GOLLE_NUM_OP_PRIME, BN_num_bits (AS_BN (p)));
+  if (is_prime (AS_BN (p), ctx)) {
     err = GOLLE_PROBABLY_PRIME;
   }
   else {
@@ -203,19 +357,13 @@ golle_error golle_find_generator (golle_num_t g,
   while (err == GOLLE_OK && 
 	 (n-- > 0))
    {
-     err = golle_random_seed ();
-     if (err != GOLLE_OK) {
-       err = GOLLE_ECRYPTO;
-       break;
-     }
-     
-     if (!BN_rand_range (h, p)) {
+     if (!golle_bn_rand_range (h, p)) {
        err = GOLLE_ECRYPTO;
        break;
      }
 
      /* Set g = h^((p-1)/q) */
-     if (!BN_mod_exp (test, h, j, p, ctx)) {
+     if (!golle_bn_mod_exp (test, h, j, p, ctx)) {
        err = GOLLE_EMEM;
        break;
      }
@@ -244,20 +392,16 @@ golle_error golle_find_generator (golle_num_t g,
 golle_error golle_num_to_bin (const golle_num_t n, golle_bin_t *bin) {
   GOLLE_ASSERT (n, GOLLE_ERROR);
   GOLLE_ASSERT (bin, GOLLE_ERROR);
-  
-  memset (bin->bin, 0, bin->size);
 
+  /* Every byte is written, and the buffer only
+   * reallocates if it has to grow. */
   size_t size = BN_num_bytes (AS_BN(n));
-
-  if (size > bin->size) {
-    golle_error err = golle_bin_resize (bin, size);
-    GOLLE_ASSERT (err == GOLLE_OK, GOLLE_EMEM);
-  }
+  GOLLE_ASSERT (size > 0, GOLLE_EMEM);
+  golle_error err = golle_bin_resize (bin, size);
+  GOLLE_ASSERT (err == GOLLE_OK, GOLLE_EMEM);
 
   size_t copied = BN_bn2bin (AS_BN(n), (unsigned char *)bin->bin);
-  GOLLE_ASSERT (copied > 0, GOLLE_EMEM);
-
-  bin->size = copied;
+  GOLLE_ASSERT (copied == size, GOLLE_EMEM);
 
   return GOLLE_OK;
 }
@@ -286,7 +430,7 @@ golle_error golle_num_mod_exp (golle_num_t out,
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
 
   golle_error err = GOLLE_OK;
-  if (!BN_mod_exp (out, base, exp, mod, ctx)) {
+  if (!golle_bn_mod_exp (out, base, exp, mod, ctx)) {
     err = GOLLE_ECRYPTO;
   }
   
@@ -294,6 +438,73 @@ golle_error golle_num_mod_exp (golle_num_t out,
   return err;
 }
 
+int golle_bn_mod_exp_many (BIGNUM **r,
+			   const BIGNUM **a,
+			   const BIGNUM **e,
+			   size_t count,
+			   const BIGNUM *m,
+			   BN_CTX *ctx)
+{
+  const golle_mont_kernel_t *k = golle_mont_find_lanes (m);
+  size_t i = 0;
+  while (k && count - i >= LANES_MIN) {
+    size_t n = count - i < (size_t)k->lanes ? count - i : (size_t)k->lanes;
+    for (size_t j = i; j < i + n; j++) {
+      if (BN_is_negative (e[j])) {
+	/* Stop here: this one goes to the backend. */
+	n = j - i;
+	break;
+      }
+    }
+    if (!n) {
+      break;
+    }
+    for (size_t j = 0; j < n; j++) {
+      golle_num_stats_count (GOLLE_NUM_OP_MOD_EXP, BN_num_bits (m));
+    }
+    if (!golle_mont_mod_exp_lanes (k, r + i, a + i, e + i, n, m, ctx)) {
+      return 0;
+    }
+    i += n;
+  }
+  /* The rest, one at a time. */
+  for (; i < count; i++) {
+    if (!golle_bn_mod_exp (r[i], a[i], e[i], m, ctx)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+golle_error golle_num_mod_exp_many (golle_num_t *out,
+				    const golle_num_t *base,
+				    const golle_num_t *exp,
+				    size_t count,
+				    const golle_num_t mod)
+{
+  GOLLE_ASSERT (out, GOLLE_ERROR);
+  GOLLE_ASSERT (base, GOLLE_ERROR);
+  GOLLE_ASSERT (exp, GOLLE_ERROR);
+  GOLLE_ASSERT (mod, GOLLE_ERROR);
+  for (size_t i = 0; i < count; i++) {
+    GOLLE_ASSERT (out[i], GOLLE_ERROR);
+    GOLLE_ASSERT (base[i], GOLLE_ERROR);
+    GOLLE_ASSERT (exp[i], GOLLE_ERROR);
+  }
+
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+
+  golle_error err = GOLLE_OK;
+  if (!golle_bn_mod_exp_many ((BIGNUM **)out, (const BIGNUM **)base,
+			      (const BIGNUM **)exp, count, mod, ctx)) {
+    err = GOLLE_ECRYPTO;
+  }
+
+  BN_CTX_free (ctx);
+  return err;
+}
+
 golle_error golle_num_print (FILE *file, const golle_num_t num) {
   GOLLE_ASSERT (file, GOLLE_ERROR);
   GOLLE_ASSERT (num, GOLLE_ERROR);
@@ -328,26 +539,31 @@ golle_error golle_num_xor (golle_num_t out,
   GOLLE_ASSERT (x1, GOLLE_ERROR);
   GOLLE_ASSERT (x2, GOLLE_ERROR);
 
-  /* Hooking into the guts of BIGNUM */
-  BIGNUM *a = AS_BN (x1), *b = AS_BN (x2);
-  
-  /* Find the biggest number, and the
-     maximum number of words to xor. */
-  BIGNUM *c = a;
-  size_t max = b->top;
-  if (b->top > a->top) {
-    c = b;
-    max = a->top;
-  }
-  if (!BN_copy (out, c)) {
-    return GOLLE_EMEM;
+  const BIGNUM *a = AS_BN (x1), *b = AS_BN (x2);
+
+  /* Write both out big-endian at the same length, so that the
+   * shorter one is padded with zeros, then XOR the bytes. */
+  size_t na = BN_num_bytes (a), nb = BN_num_bytes (b);
+  size_t n = na > nb ? na : nb;
+  if (!n) {
+    BN_zero (AS_BN (out));
+    return GOLLE_OK;
+  }
+  unsigned char *buf = calloc (2, n);
+  GOLLE_ASSERT (buf, GOLLE_EMEM);
+  BN_bn2bin (a, buf + n - na);
+  BN_bn2bin (b, buf + n + n - nb);
+  for (size_t i = 0; i < n; i++) {
+    buf[i] ^= buf[n + i];
   }
 
-  /* XOR */
-  for (size_t i = 0; i < max; i++) {
-    AS_BN(out)->d[i] = a->d[i] ^ b->d[i];
+  golle_error err = GOLLE_OK;
+  if (!BN_bin2bn (buf, (int)n, AS_BN (out))) {
+    err = GOLLE_EMEM;
   }
-  return GOLLE_OK;
+  OPENSSL_cleanse (buf, 2 * n);
+  free (buf);
+  return err;
 }
 
 golle_error golle_mod_div (golle_num_t out,
@@ -364,12 +580,12 @@ golle_error golle_mod_div (golle_num_t out,
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_inverse (bi, b, (const BIGNUM*)p, ctx)) {
+  if (!golle_bn_mod_inverse (bi, b, (const BIGNUM*)p, ctx)) {
     err = GOLLE_EMEM;
     goto out;
   }
   /* Multiply by a */
-  if (!BN_mod_mul (out, a, bi, (const BIGNUM*)p, ctx)) {
+  if (!golle_bn_mod_mul (out, a, bi, (const BIGNUM*)p, ctx)) {
     err = GOLLE_EMEM;
     goto out;
   }
@@ -377,3 +593,75 @@ golle_error golle_mod_div (golle_num_t out,
   BN_CTX_end (ctx);
   return err;
 }
+
+/*
+ * Operation counters. Each thread is assigned one of a fixed number of
+ * shards the first time it counts something, so that threads don't
+ * fight over the same cache lines. Threads beyond the number of shards
+ * share, which is still correct because every update is atomic.
+ */
+enum {
+  /* Number of counter shards. */
+  STATS_SHARDS = 16,
+  /* Operand size limit of the first bucket. */
+  STATS_FIRST_BITS = 64
+};
+
+typedef struct stats_shard_t {
+  uintmax_t count[GOLLE_NUM_OP_COUNT][GOLLE_NUM_STATS_BUCKETS];
+} GOLLE_CACHE_ALIGNED stats_shard_t;
+
+static stats_shard_t stats_shards[STATS_SHARDS];
+static size_t stats_next_shard = 0;
+static GOLLE_THREAD_LOCAL stats_shard_t *stats_local = NULL;
+
+/* Find the shard for the calling thread. */
+static stats_shard_t *stats_shard (void) {
+  if (!stats_local) {
+    size_t i = GOLLE_ATOMIC_ADD (&stats_next_shard, 1);
+    stats_local = stats_shards + (i % STATS_SHARDS);
+  }
+  return stats_local;
+}
+
+size_t golle_num_stats_bucket (int bits) {
+  size_t b = 0;
+  long limit = STATS_FIRST_BITS;
+  while (b < GOLLE_NUM_STATS_BUCKETS - 1 && bits > limit) {
+    b++;
+    limit <<= 1;
+  }
+  return b;
+}
+
+void golle_num_stats_count (golle_num_op op, int bits) {
+  if (op < GOLLE_NUM_OP_COUNT) {
+    stats_shard_t *s = stats_shard ();
+    GOLLE_ATOMIC_ADD (&s->count[op][golle_num_stats_bucket (bits)], 1);
+  }
+}
+
+golle_error golle_num_stats_get (golle_num_stats_t *stats) {
+  GOLLE_ASSERT (stats, GOLLE_ERROR);
+  memset (stats, 0, sizeof (*stats));
+
+  for (size_t i = 0; i < STATS_SHARDS; i++) {
+    for (size_t op = 0; op < GOLLE_NUM_OP_COUNT; op++) {
+      for (size_t b = 0; b < GOLLE_NUM_STATS_BUCKETS; b++) {
+	stats->count[op][b] +=
+	  GOLLE_ATOMIC_LOAD (&stats_shards[i].count[op][b]);
+      }
+    }
+  }
+  return GOLLE_OK;
+}
+
+void golle_num_stats_reset (void) {
+  for (size_t i = 0; i < STATS_SHARDS; i++) {
+    for (size_t op = 0; op < GOLLE_NUM_OP_COUNT; op++) {
+      for (size_t b = 0; b < GOLLE_NUM_STATS_BUCKETS; b++) {
+	GOLLE_ATOMIC_STORE (&stats_shards[i].count[op][b], 0);
+      }
+    }
+  }
+}
@@ -6,6 +6,8 @@
 
 #include <golle/numbers.h>
 #include <openssl/bn.h>
+#include "bignum.h"
+#include "mont.h"
 
 /* Calculate a/b mod p by inverse */
 GOLLE_EXTERN golle_error golle_mod_div (golle_num_t out,
@@ -13,4 +15,109 @@ GOLLE_EXTERN golle_error golle_mod_div (golle_num_t out,
 					const golle_num_t b,
 					const golle_num_t p,
 					BN_CTX *ctx);
+
+/* Set r to a uniformly random number in [0, range), drawn from the
+ * library's random source by rejection sampling. Returns 1 on success
+ * and 0 on failure, like the OpenSSL functions. */
+GOLLE_EXTERN int golle_rand_range (BIGNUM *r, const BIGNUM *range);
+
+/* Set r to a random number of exactly `bits` bits. */
+GOLLE_EXTERN int golle_rand_bits (BIGNUM *r, int bits);
+
+/* Count one operation on an operand of the given number of bits. */
+GOLLE_EXTERN void golle_num_stats_count (golle_num_op op, int bits);
+
+/*
+ * Counted versions of the OpenSSL primitives. The library calls these
+ * instead of the BN_* functions directly so that every operation is
+ * seen by golle_num_stats_get(), and so that exponents go to a
+ * fixed-size kernel, or else to the configured backend.
+ */
+GOLLE_INLINE int golle_bn_mod_exp (BIGNUM *r,
+				   const BIGNUM *a,
+				   const BIGNUM *e,
+				   const BIGNUM *m,
+				   BN_CTX *ctx)
+{
+  golle_num_stats_count (GOLLE_NUM_OP_MOD_EXP, BN_num_bits (m));
+  const golle_mont_kernel_t *k = golle_mont_find (m);
+  if (k && !BN_is_negative (e)) {
+    return golle_mont_mod_exp (k, r, a, e, m, ctx);
+  }
+  return golle_bignum_mod_exp (r, a, e, m, ctx);
+}
+
+/* r[i] = a[i]^e[i] mod m for each i < count. Groups of exponents go to
+ * a lane kernel, if there is one for m, and the rest go one at a time
+ * through golle_bn_mod_exp(). Returns 1 on success and 0 on failure. */
+GOLLE_EXTERN int golle_bn_mod_exp_many (BIGNUM **r,
+					const BIGNUM **a,
+					const BIGNUM **e,
+					size_t count,
+					const BIGNUM *m,
+					BN_CTX *ctx);
+
+/* r[i] = a[i]^e[i] mod m for each i < count, for latency. When
+ * golle_num_set_split() has turned splitting on and the default pool
+ * has workers, the exponents run at once, and each is cut into pieces
+ * that also run at once, using powers of its base that are kept from
+ * call to call. So the bases should be fixed ones, like a key's g.
+ * Otherwise, the exponents are done one at a time. Returns 1 on
+ * success and 0 on failure. */
+GOLLE_EXTERN int golle_bn_mod_exp_split (BIGNUM **r,
+					 const BIGNUM **a,
+					 const BIGNUM **e,
+					 size_t count,
+					 const BIGNUM *m,
+					 BN_CTX *ctx);
+
+/* The grain for golle_pool_parallel_for() over items that each need
+ * `exps` exponents modulo m: enough items to fill a group of lanes, or
+ * 0, for the pool's own choice, if m has no lane kernel. */
+GOLLE_INLINE size_t golle_bn_lanes_grain (const BIGNUM *m, size_t exps) {
+  if (!golle_mont_find_lanes (m)) {
+    return 0;
+  }
+  return (GOLLE_MONT_LANES + exps - 1) / exps;
+}
+
+GOLLE_INLINE int golle_bn_mod_mul (BIGNUM *r,
+				   const BIGNUM *a,
+				   const BIGNUM *b,
+				   const BIGNUM *m,
+				   BN_CTX *ctx)
+{
+  golle_num_stats_count (GOLLE_NUM_OP_MOD_MUL, BN_num_bits (m));
+  return BN_mod_mul (r, a, b, m, ctx);
+}
+
+/* r = a * b / R mod m, where mont is set up for m and R is its
+ * Montgomery radix. With a in Montgomery form, aR, r is ab in the same
+ * form, so a chain of products only converts at its ends. a and b must
+ * be in [0, m). */
+GOLLE_INLINE int golle_bn_mod_mul_mont (BIGNUM *r,
+					const BIGNUM *a,
+					const BIGNUM *b,
+					const BIGNUM *m,
+					BN_MONT_CTX *mont,
+					BN_CTX *ctx)
+{
+  golle_num_stats_count (GOLLE_NUM_OP_MOD_MUL, BN_num_bits (m));
+  return BN_mod_mul_montgomery (r, a, b, mont, ctx);
+}
+
+GOLLE_INLINE BIGNUM *golle_bn_mod_inverse (BIGNUM *r,
+					   const BIGNUM *a,
+					   const BIGNUM *m,
+					   BN_CTX *ctx)
+{
+  golle_num_stats_count (GOLLE_NUM_OP_MOD_INVERSE, BN_num_bits (m));
+  return BN_mod_inverse (r, a, m, ctx);
+}
+
+GOLLE_INLINE int golle_bn_rand_range (BIGNUM *r, const BIGNUM *range) {
+  golle_num_stats_count (GOLLE_NUM_OP_RAND, BN_num_bits (range));
+  return golle_rand_range (r, range);
+}
+
 #endif
@@ -19,7 +19,7 @@ static BIGNUM *mod_exp (const BIGNUM *a,
   BIGNUM *n = BN_new ();
   GOLLE_ASSERT (n, NULL);
 
-  if (!BN_mod_exp (n, a, x, p, ctx)) {
+  if (!golle_bn_mod_exp (n, a, x, p, ctx)) {
     BN_free (n);
     return NULL;
   }
@@ -33,7 +33,7 @@ static golle_num_t get_g (const golle_key_t *key,
 {
   golle_num_t G = mod_exp (key->h_product, z, key->p, ctx);
   GOLLE_ASSERT (G, NULL);
-  if (!BN_mod_mul (G, G, key->g, key->p, ctx)) {
+  if (!golle_bn_mod_mul (G, G, key->g, key->p, ctx)) {
     BN_free (G);
     G = NULL;
   }
@@ -49,7 +49,7 @@ static golle_num_t get_y (const golle_key_t *key,
 {
   golle_num_t Y = mod_exp (b, z, key->p, ctx);
   GOLLE_ASSERT (Y, NULL);
-  if (!BN_mod_mul (Y, Y, a, key->p, ctx)) {
+  if (!golle_bn_mod_mul (Y, Y, a, key->p, ctx)) {
     BN_free (Y);
     Y = NULL;
   }
@@ -97,8 +97,8 @@ golle_error golle_pep_prover (const golle_key_t *egKey,
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_exp (b, egKey->h_product, k, egKey->p, ctx) ||
-      !BN_mod_exp (a, egKey->g, k, egKey->p, ctx)) {
+  if (!golle_bn_mod_exp (b, egKey->h_product, k, egKey->p, ctx) ||
+      !golle_bn_mod_exp (a, egKey->g, k, egKey->p, ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/pool.h>
+#include <golle/types.h>
+#include <pthread.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "atomic.h"
+
+enum {
+  /* Chunks each worker gets when the grain is chosen for the caller. */
+  CHUNKS_PER_WORKER = 4,
+  /* Workers to use when the processors can't be counted. */
+  DEFAULT_WORKERS = 4
+};
+
+/* The chunks a worker has left, [lo, hi). The owner takes from the
+ * bottom and thieves take from the top. */
+typedef struct deque_t {
+  pthread_mutex_t lock;
+  size_t lo;
+  size_t hi;
+} deque_t;
+
+typedef struct worker_t {
+  golle_pool_t *pool;
+  size_t index;
+  pthread_t thread;
+} worker_t;
+
+struct golle_pool_t {
+  /* workers - 1 threads, and a deque for each worker. The calling
+   * thread uses the last deque. */
+  worker_t *threads;
+  deque_t *deques;
+  size_t workers;
+  size_t started;
+
+  /* Waking the threads, as for a loopback table. */
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  size_t generation;
+  size_t running;
+  int quit;
+
+  /* Held for the length of a loop. */
+  pthread_mutex_t busy;
+
+  /* The current loop */
+  golle_pool_fn_t fn;
+  void *arg;
+  size_t count;
+  size_t grain;
+  golle_error err;
+  /* The earliest chunk that failed. Later chunks are skipped. */
+  size_t failed;
+};
+
+static golle_pool_t *default_pool = NULL;
+
+/* Take a chunk from the bottom of a deque. */
+static int take (deque_t *d, size_t *chunk) {
+  int ok = 0;
+  pthread_mutex_lock (&d->lock);
+  if (d->lo < d->hi) {
+    *chunk = d->lo++;
+    ok = 1;
+  }
+  pthread_mutex_unlock (&d->lock);
+  return ok;
+}
+
+/* Move the top half of another worker's chunks into an empty deque.
+ * Returns 0 if every other deque was empty. */
+static int steal (golle_pool_t *pool, size_t self) {
+  for (size_t k = 1; k < pool->workers; k++) {
+    deque_t *v = pool->deques + (self + k) % pool->workers;
+    size_t lo = 0, hi = 0;
+    pthread_mutex_lock (&v->lock);
+    if (v->lo < v->hi) {
+      lo = v->lo + (v->hi - v->lo) / 2;
+      hi = v->hi;
+      v->hi = lo;
+    }
+    pthread_mutex_unlock (&v->lock);
+
+    if (lo < hi) {
+      deque_t *d = pool->deques + self;
+      pthread_mutex_lock (&d->lock);
+      d->lo = lo;
+      d->hi = hi;
+      pthread_mutex_unlock (&d->lock);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Run chunks of the current loop until there are none left anywhere. */
+static void run_chunks (golle_pool_t *pool, size_t self) {
+  deque_t *d = pool->deques + self;
+  for (;;) {
+    size_t chunk;
+    if (!take (d, &chunk)) {
+      if (!steal (pool, self)) {
+	return;
+      }
+      continue;
+    }
+    if (chunk > GOLLE_ATOMIC_LOAD (&pool->failed)) {
+      /* A serial loop wouldn't have got this far. */
+      continue;
+    }
+
+    size_t begin = chunk * pool->grain;
+    size_t end = pool->count - begin > pool->grain ?
+      begin + pool->grain : pool->count;
+    golle_error err = pool->fn (pool->arg, begin, end);
+    if (err != GOLLE_OK) {
+      pthread_mutex_lock (&pool->lock);
+      if (chunk < pool->failed) {
+	pool->err = err;
+	GOLLE_ATOMIC_STORE (&pool->failed, chunk);
+      }
+      pthread_mutex_unlock (&pool->lock);
+    }
+  }
+}
+
+static void *worker_main (void *arg) {
+  worker_t *w = arg;
+  golle_pool_t *pool = w->pool;
+  size_t seen = 0;
+  for (;;) {
+    /* Wait for the next loop */
+    pthread_mutex_lock (&pool->lock);
+    while (pool->generation == seen && !pool->quit) {
+      pthread_cond_wait (&pool->start, &pool->lock);
+    }
+    seen = pool->generation;
+    int quit = pool->quit;
+    pthread_mutex_unlock (&pool->lock);
+
+    if (quit) {
+      break;
+    }
+    run_chunks (pool, w->index);
+
+    pthread_mutex_lock (&pool->lock);
+    if (--pool->running == 0) {
+      pthread_cond_signal (&pool->done);
+    }
+    pthread_mutex_unlock (&pool->lock);
+  }
+  return NULL;
+}
+
+/* The number of online processors. */
+static size_t count_processors (void) {
+#if defined (_SC_NPROCESSORS_ONLN)
+  long n = sysconf (_SC_NPROCESSORS_ONLN);
+  if (n > 0) {
+    return (size_t)n;
+  }
+#endif
+  return DEFAULT_WORKERS;
+}
+
+golle_error golle_pool_new (golle_pool_t **pool, size_t workers) {
+  GOLLE_ASSERT (pool, GOLLE_ERROR);
+  if (!workers) {
+    workers = count_processors ();
+  }
+
+  golle_pool_t *p = calloc (1, sizeof (*p));
+  GOLLE_ASSERT (p, GOLLE_EMEM);
+  p->workers = workers;
+  if (!(p->deques = calloc (workers, sizeof (*p->deques))) ||
+      !(p->threads = calloc (workers, sizeof (*p->threads)))) {
+    free (p->deques);
+    free (p);
+    return GOLLE_EMEM;
+  }
+  pthread_mutex_init (&p->lock, NULL);
+  pthread_mutex_init (&p->busy, NULL);
+  pthread_cond_init (&p->start, NULL);
+  pthread_cond_init (&p->done, NULL);
+  for (size_t i = 0; i < workers; i++) {
+    pthread_mutex_init (&p->deques[i].lock, NULL);
+  }
+
+  for (; p->started + 1 < workers; p->started++) {
+    worker_t *w = p->threads + p->started;
+    w->pool = p;
+    w->index = p->started;
+    if (pthread_create (&w->thread, NULL, &worker_main, w) != 0) {
+      golle_pool_delete (p);
+      return GOLLE_EMEM;
+    }
+  }
+
+  *pool = p;
+  return GOLLE_OK;
+}
+
+void golle_pool_delete (golle_pool_t *pool) {
+  if (!pool) {
+    return;
+  }
+  /* Don't leave a dangling default. */
+  if (GOLLE_ATOMIC_LOAD_ACQUIRE (&default_pool) == pool) {
+    golle_pool_set_default (NULL);
+  }
+
+  pthread_mutex_lock (&pool->lock);
+  pool->quit = 1;
+  pthread_cond_broadcast (&pool->start);
+  pthread_mutex_unlock (&pool->lock);
+  for (size_t i = 0; i < pool->started; i++) {
+    pthread_join (pool->threads[i].thread, NULL);
+  }
+
+  for (size_t i = 0; i < pool->workers; i++) {
+    pthread_mutex_destroy (&pool->deques[i].lock);
+  }
+  pthread_cond_destroy (&pool->start);
+  pthread_cond_destroy (&pool->done);
+  pthread_mutex_destroy (&pool->busy);
+  pthread_mutex_destroy (&pool->lock);
+  free (pool->threads);
+  free (pool->deques);
+  free (pool);
+}
+
+size_t golle_pool_workers (const golle_pool_t *pool) {
+  GOLLE_ASSERT (pool, 1);
+  return pool->workers;
+}
+
+void golle_pool_set_default (golle_pool_t *pool) {
+  GOLLE_ATOMIC_STORE_RELEASE (&default_pool, pool);
+}
+
+golle_pool_t *golle_pool_get_default (void) {
+  return GOLLE_ATOMIC_LOAD_ACQUIRE (&default_pool);
+}
+
+golle_error golle_pool_parallel_for (golle_pool_t *pool,
+				     size_t count,
+				     size_t grain,
+				     golle_pool_fn_t fn,
+				     void *arg)
+{
+  GOLLE_ASSERT (fn, GOLLE_ERROR);
+  GOLLE_ASSERT (count, GOLLE_OK);
+  if (!pool) {
+    pool = golle_pool_get_default ();
+  }
+  if (!pool || pool->workers < 2 || count < 2 ||
+      pthread_mutex_trylock (&pool->busy) != 0) {
+    /* Nobody to share with. */
+    return fn (arg, 0, count);
+  }
+
+  if (!grain) {
+    grain = count / (pool->workers * CHUNKS_PER_WORKER);
+  }
+  if (!grain) {
+    grain = 1;
+  }
+  size_t chunks = count / grain + (count % grain != 0);
+
+  /* Deal the chunks out evenly. */
+  for (size_t i = 0; i < pool->workers; i++) {
+    deque_t *d = pool->deques + i;
+    pthread_mutex_lock (&d->lock);
+    d->lo = chunks * i / pool->workers;
+    d->hi = chunks * (i + 1) / pool->workers;
+    pthread_mutex_unlock (&d->lock);
+  }
+
+  /* Wake the threads, and work alongside them. */
+  pthread_mutex_lock (&pool->lock);
+  pool->fn = fn;
+  pool->arg = arg;
+  pool->count = count;
+  pool->grain = grain;
+  pool->err = GOLLE_OK;
+  pool->failed = SIZE_MAX;
+  pool->running = pool->started;
+  pool->generation++;
+  pthread_cond_broadcast (&pool->start);
+  pthread_mutex_unlock (&pool->lock);
+
+  run_chunks (pool, pool->workers - 1);
+
+  pthread_mutex_lock (&pool->lock);
+  while (pool->running) {
+    pthread_cond_wait (&pool->done, &pool->lock);
+  }
+  golle_error err = pool->err;
+  pthread_mutex_unlock (&pool->lock);
+
+  pthread_mutex_unlock (&pool->busy);
+  return err;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_PROBES_H
+#define GOLLE_SRC_PROBES_H
+
+#include <golle/config.h>
+
+/*
+ * Static tracepoints. When configured with --enable-usdt these become
+ * USDT probes in the `golle` provider, which perf and bpftrace can
+ * attach to at runtime. A probe that nobody has attached to is a single
+ * no-op instruction. Otherwise they compile to nothing at all.
+ *
+ * Entry probes are named `<function>_entry` and return probes
+ * `<function>_return`, with the result as the last argument. An entry
+ * probe fires only once its function is past the checks that return
+ * early, so each entry is matched by a return.
+ * Phases of golle_generate() are reported through `phase_entry` and
+ * `phase_return`, whose first argument is the name of the phase.
+ */
+#if GOLLE_USDT && HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define GOLLE_PROBE0(name) DTRACE_PROBE (golle, name)
+#define GOLLE_PROBE1(name,a) DTRACE_PROBE1 (golle, name, a)
+#define GOLLE_PROBE2(name,a,b) DTRACE_PROBE2 (golle, name, a, b)
+#else
+#define GOLLE_PROBE0(name) do {} while (0)
+#define GOLLE_PROBE1(name,a) do {} while (0)
+#define GOLLE_PROBE2(name,a,b) do {} while (0)
+#endif
+
+/* Mark the start and end of a phase of the protocol. */
+#define GOLLE_PHASE_ENTRY(phase) GOLLE_PROBE1 (phase_entry, phase)
+#define GOLLE_PHASE_RETURN(phase,err) GOLLE_PROBE2 (phase_return, phase, err)
+
+#endif
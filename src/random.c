@@ -2,10 +2,12 @@
  * Copyright (C) Anthony Arnold 2014
  */
 
-#include <golle/random.h>
+#include "random.h"
 #include <openssl/rand.h>
 #include <openssl/err.h>
 #include <golle/config.h>
+#include "atomic.h"
+#include "drbg.h"
 
 #if HAVE_SSL
 #include <openssl/engine.h>
@@ -59,36 +61,107 @@ static void load_hardware_engine () {
 #define UNLOAD_HARDWARE_ENGINE do {} while (0)
 #endif
 
+#if GOLLE_TEST_RANDOM
+/* The current source, when it isn't the default. It is written before
+ * have_source is set, so a thread that sees have_source sees it too. */
+static golle_random_source_t source;
+static int have_source = 0;
+/* The generator made by golle_random_seed_deterministic. */
+static golle_drbg_t *owned_drbg = NULL;
+#define HAVE_SOURCE GOLLE_ATOMIC_LOAD_ACQUIRE (&have_source)
+#else
+#define HAVE_SOURCE 0
+#endif
+/* Non-zero once OpenSSL's generator has been seeded. */
+static int seeded = 0;
+
 golle_error golle_random_seed (void) {
-  LOAD_HARDWARE_ENGINE;
-    
   /* Only seed when needed */
+  if (HAVE_SOURCE || GOLLE_ATOMIC_LOAD_ACQUIRE (&seeded)) {
+    return GOLLE_OK;
+  }
+
+  LOAD_HARDWARE_ENGINE;
   if (!RAND_status ()) {
     RAND_poll ();
   }
+  if (RAND_status ()) {
+    GOLLE_ATOMIC_STORE_RELEASE (&seeded, 1);
+  }
   return GOLLE_OK;
 }
 
+golle_error golle_random_bytes (void *buffer, size_t size) {
+#if GOLLE_TEST_RANDOM
+  if (HAVE_SOURCE) {
+    return source.generate (source.state, buffer, size);
+  }
+#endif
+  /* By default, from this thread's generator. */
+  return golle_drbg_thread_generate (buffer, size);
+}
+
 golle_error golle_random_generate (golle_bin_t *buffer) {
   GOLLE_ASSERT (buffer, GOLLE_ERROR);
+  return golle_random_bytes (buffer->bin, buffer->size);
+}
 
-  /* Always seed first. Call will only do something
-   * if seeding is required. */
-  golle_error err = golle_random_seed ();
-  GOLLE_ASSERT (err == GOLLE_OK, err);
-  
-  int rc = RAND_bytes (buffer->bin, buffer->size);
-  ERR_get_error ();
+#if GOLLE_TEST_RANDOM
+int golle_random_replaced (void) {
+  return HAVE_SOURCE;
+}
 
-  if (rc != 1) {
-    return GOLLE_ERROR;
+golle_error golle_random_set_source (const golle_random_source_t *src) {
+  GOLLE_ASSERT (!src || src->generate, GOLLE_ERROR);
+
+  GOLLE_ATOMIC_STORE_RELEASE (&have_source, 0);
+  if (src) {
+    source = *src;
+    GOLLE_ATOMIC_STORE_RELEASE (&have_source, 1);
+  }
+
+  /* Anything we made ourselves is no longer in use. */
+  if (owned_drbg && (!src || src->state != owned_drbg)) {
+    golle_drbg_delete (owned_drbg);
+    owned_drbg = NULL;
   }
   return GOLLE_OK;
 }
 
+golle_error golle_random_seed_deterministic (const void *seed,
+					     size_t size)
+{
+  GOLLE_ASSERT (seed, GOLLE_ERROR);
+  golle_drbg_t *drbg = golle_drbg_new (seed, size);
+  GOLLE_ASSERT (drbg, GOLLE_EMEM);
+
+  golle_random_source_t src = { golle_drbg_generate, drbg };
+  golle_random_set_source (&src);
+  owned_drbg = drbg;
+  return GOLLE_OK;
+}
+#else
+golle_error golle_random_set_source (const golle_random_source_t *src) {
+  GOLLE_UNUSED (src);
+  return GOLLE_EINVALID;
+}
+
+golle_error golle_random_seed_deterministic (const void *seed,
+					     size_t size)
+{
+  GOLLE_UNUSED (seed);
+  GOLLE_UNUSED (size);
+  return GOLLE_EINVALID;
+}
+#endif
+
 golle_error golle_random_clear (void) {
+#if GOLLE_TEST_RANDOM
+  golle_random_set_source (NULL);
+#endif
+  golle_drbg_thread_clear ();
   UNLOAD_HARDWARE_ENGINE;
   RAND_cleanup ();
+  seeded = 0;
   return GOLLE_OK;
 }
-
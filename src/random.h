@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_RANDOM_H
+#define GOLLE_SRC_RANDOM_H
+
+#include <golle/random.h>
+#include <golle/config.h>
+#include <stddef.h>
+
+/* Fill a buffer from the current random source. All of the library's
+ * own random data is drawn through here. */
+GOLLE_EXTERN golle_error golle_random_bytes (void *buffer, size_t size);
+
+#if GOLLE_TEST_RANDOM
+/* Non-zero if the source has been replaced. Anything OpenSSL draws
+ * by itself doesn't come from the replacement. */
+int golle_random_replaced (void);
+#endif
+
+#endif
@@ -2,6 +2,9 @@
  * Copyright (C) Anthony Arnold 2014
  */
 #include "schnorr.h"
+#include <golle/pool.h>
+#include <pthread.h>
+#include "probes.h"
 
 golle_error golle_schnorr_commit_impl (const golle_schnorr_t *key,
 				       golle_num_t r,
@@ -19,7 +22,9 @@ golle_error golle_schnorr_commit_impl (const golle_schnorr_t *key,
   GOLLE_ASSERT (err == GOLLE_OK, err);
 
   /* Get t = g^r */
-  if (!BN_mod_exp (t, key->G, r, key->p, ctx)) {
+  BIGNUM *res[1] = { t };
+  const BIGNUM *base[1] = { key->G }, *exp[1] = { r };
+  if (!golle_bn_mod_exp_split (res, base, exp, 1, key->p, ctx)) {
     err = GOLLE_EMEM;
   }
   return err;
@@ -61,7 +66,7 @@ golle_error golle_schnorr_prove (const golle_schnorr_t *key,
   if (!(cx = BN_CTX_get (ctx))) {
     err = GOLLE_EMEM;
   }
-  else if (!BN_mod_mul (cx, key->x, c, key->q, ctx)) {
+  else if (!golle_bn_mod_mul (cx, key->x, c, key->q, ctx)) {
     err = GOLLE_EMEM;
   }
   /* Calculate s = cx + r */
@@ -90,30 +95,28 @@ golle_error golle_schnorr_verify (const golle_schnorr_t *key,
   /* A context for exponents. */
   BN_CTX *ctx = BN_CTX_new ();
   GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  GOLLE_PROBE0 (schnorr_verify_entry);
   BN_CTX_start (ctx);
 
-  /* Get ty^c */
-  BIGNUM *tyc = NULL, *yc = NULL;
+  /* Get y^c and g^s */
+  BIGNUM *tyc = NULL, *yc = NULL, *gs = NULL;
   golle_error err = GOLLE_OK;
   if (!(yc = BN_CTX_get (ctx)) ||
-      !(tyc = BN_CTX_get (ctx))) {
+      !(tyc = BN_CTX_get (ctx)) ||
+      !(gs = BN_CTX_get (ctx))) {
     err = GOLLE_EMEM;
     goto out;
   }
-  if (!BN_mod_exp (yc, key->Y, c, key->p, ctx) ||
-      !BN_mod_mul (tyc, yc, t, key->p, ctx)) {
+  BIGNUM *res[2] = { yc, gs };
+  const BIGNUM *base[2] = { key->Y, key->G }, *exp[2] = { c, s };
+  if (!golle_bn_mod_exp_split (res, base, exp, 2, key->p, ctx)) {
     err = GOLLE_ECRYPTO;
     goto out;
   }
 
-  /* Get g^s */
-  BIGNUM *gs = NULL;
-  if (!(gs = BN_CTX_get (ctx))) {
-    err = GOLLE_EMEM;
-    goto out;
-  }
-  if (!BN_mod_exp (gs, key->G, s, key->p, ctx)) {
-    err = GOLLE_EMEM;
+  /* Get ty^c */
+  if (!golle_bn_mod_mul (tyc, yc, t, key->p, ctx)) {
+    err = GOLLE_ECRYPTO;
     goto out;
   }
 
@@ -124,5 +127,120 @@ golle_error golle_schnorr_verify (const golle_schnorr_t *key,
 
  out:
   BN_CTX_free (ctx);
+  GOLLE_PROBE1 (schnorr_verify_return, err);
+  return err;
+}
+
+/* A batch of proofs being verified. */
+typedef struct verify_batch_t {
+  const golle_schnorr_t *key;
+  const golle_num_t *s;
+  const golle_num_t *t;
+  const golle_num_t *c;
+  pthread_mutex_t lock;
+  golle_error err;
+  size_t failed;
+} verify_batch_t;
+
+/* Keep the earliest failure of a batch. */
+static void verify_failed (verify_batch_t *b, size_t i, golle_error err) {
+  pthread_mutex_lock (&b->lock);
+  if (b->err == GOLLE_OK || i < b->failed) {
+    b->err = err;
+    b->failed = i;
+  }
+  pthread_mutex_unlock (&b->lock);
+}
+
+/* A chunk is checked a group of proofs at a time, with the exponents of
+ * a group going to golle_bn_mod_exp_many() together. */
+enum {
+  GROUP = GOLLE_MONT_LANES
+};
+
+static golle_error verify_chunk (void *arg, size_t begin, size_t end) {
+  verify_batch_t *b = arg;
+  const golle_schnorr_t *key = b->key;
+  const BIGNUM *base[2 * GROUP], *exp[2 * GROUP];
+  BIGNUM *out[2 * GROUP];
+  golle_error err = GOLLE_OK;
+  size_t at = begin;
+
+  BN_CTX *ctx = BN_CTX_new ();
+  if (!ctx) {
+    verify_failed (b, begin, GOLLE_EMEM);
+    return GOLLE_EMEM;
+  }
+  BN_CTX_start (ctx);
+  for (size_t j = 0; j < 2 * GROUP && err == GOLLE_OK; j++) {
+    if (!(out[j] = BN_CTX_get (ctx))) {
+      err = GOLLE_EMEM;
+    }
+  }
+
+  for (size_t i = begin; i < end && err == GOLLE_OK; i += GROUP) {
+    size_t n = end - i < GROUP ? end - i : GROUP, missing = n;
+    for (size_t j = 0; j < n && missing == n; j++) {
+      if (!b->s[i + j] || !b->t[i + j] || !b->c[i + j]) {
+	missing = j;
+      }
+    }
+
+    /* g^s = ty^c for each proof before any that's missing. */
+    for (size_t j = 0; j < missing; j++) {
+      base[j] = key->Y;
+      exp[j] = b->c[i + j];
+      base[missing + j] = key->G;
+      exp[missing + j] = b->s[i + j];
+    }
+    if (!golle_bn_mod_exp_many (out, base, exp, 2 * missing, key->p, ctx)) {
+      err = GOLLE_ECRYPTO;
+      at = i;
+    }
+    for (size_t j = 0; j < missing && err == GOLLE_OK; j++) {
+      if (!golle_bn_mod_mul (out[j], out[j], b->t[i + j], key->p, ctx) ||
+	  BN_cmp (out[missing + j], out[j]) != 0) {
+	err = GOLLE_ECRYPTO;
+	at = i + j;
+      }
+    }
+    if (err == GOLLE_OK && missing < n) {
+      err = GOLLE_ERROR;
+      at = i + missing;
+    }
+  }
+
+  BN_CTX_end (ctx);
+  BN_CTX_free (ctx);
+  if (err != GOLLE_OK) {
+    verify_failed (b, at, err);
+  }
   return err;
 }
+
+golle_error golle_schnorr_verify_many (const golle_schnorr_t *key,
+				       const golle_num_t *s,
+				       const golle_num_t *t,
+				       const golle_num_t *c,
+				       size_t count,
+				       size_t *failed)
+{
+  GOLLE_ASSERT (key, GOLLE_ERROR);
+  GOLLE_ASSERT (s, GOLLE_ERROR);
+  GOLLE_ASSERT (t, GOLLE_ERROR);
+  GOLLE_ASSERT (c, GOLLE_ERROR);
+  GOLLE_ASSERT (key->p, GOLLE_ERROR);
+  GOLLE_ASSERT (key->G, GOLLE_ERROR);
+  GOLLE_ASSERT (key->Y, GOLLE_ERROR);
+
+  verify_batch_t b = { .key = key, .s = s, .t = t, .c = c };
+  pthread_mutex_init (&b.lock, NULL);
+  size_t grain = golle_bn_lanes_grain (key->p, 2);
+  golle_pool_parallel_for (NULL, count, grain, &verify_chunk, &b);
+  pthread_mutex_destroy (&b.lock);
+
+  if (b.err != GOLLE_OK && failed) {
+    *failed = b.failed;
+  }
+  return b.err;
+}
@@ -7,6 +7,7 @@
 #include <openssl/bn.h>
 #include <golle/errors.h>
 #include <golle/numbers.h>
+#include "numbers.h"
 
 /*
  * The implementation of the commit function.
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include <golle/config.h>
+#include <golle/errors.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <openssl/crypto.h>
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "secure.h"
+
+#if HAVE_SYS_MMAN_H && defined (MAP_ANONYMOUS)
+/* Round a size up to whole pages. 0 on overflow. */
+static size_t page_round (size_t size) {
+  long page = sysconf (_SC_PAGESIZE);
+  size_t p = page > 0 ? (size_t)page : 4096;
+  if (size > SIZE_MAX - p + 1) {
+    return 0;
+  }
+  return (size + p - 1) / p * p;
+}
+
+void *golle_secure_map (size_t size) {
+  size = page_round (size);
+  GOLLE_ASSERT (size, NULL);
+  void *p = mmap (NULL, size, PROT_READ | PROT_WRITE,
+		  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  GOLLE_ASSERT (p != MAP_FAILED, NULL);
+#if HAVE_MLOCK
+  (void)mlock (p, size);
+#endif
+#if HAVE_MADVISE && defined (MADV_DONTDUMP)
+  (void)madvise (p, size, MADV_DONTDUMP);
+#endif
+  return p;
+}
+
+void golle_secure_unmap (void *p, size_t size) {
+  if (p) {
+    size = page_round (size);
+    OPENSSL_cleanse (p, size);
+#if HAVE_MLOCK
+    (void)munlock (p, size);
+#endif
+    munmap (p, size);
+  }
+}
+#else
+void *golle_secure_map (size_t size) {
+  return calloc (1, size);
+}
+
+void golle_secure_unmap (void *p, size_t size) {
+  if (p) {
+    OPENSSL_cleanse (p, size);
+    free (p);
+  }
+}
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#ifndef GOLLE_SRC_SECURE_H
+#define GOLLE_SRC_SECURE_H
+
+#include <stddef.h>
+
+/*
+ * Memory for secrets. It is mapped in whole pages, locked out of swap
+ * where the system allows it, and left out of core dumps. Unmapping
+ * wipes it in one go. Without mmap, it falls back to the heap.
+ *
+ * Locking is best effort: most systems cap how much a process can
+ * lock, and going over the cap only loses the locking.
+ */
+
+/* Map at least `size` bytes of zeroed memory. NULL on failure. */
+void *golle_secure_map (size_t size);
+
+/* Wipe and unmap memory from golle_secure_map(). `size` must be the
+ * size it was mapped with. */
+void golle_secure_unmap (void *p, size_t size);
+
+#endif
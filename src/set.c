@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/set.h>
+#include <string.h>
+#include <golle/types.h>
+#include "bin.h"
+
+enum {
+  /* The minimum degree of the tree. Every node but the root holds
+   * between MIN_KEYS and MAX_KEYS items. */
+  DEGREE = 8,
+  MIN_KEYS = DEGREE - 1,
+  MAX_KEYS = 2 * DEGREE - 1,
+  /* Deep enough for any number of items that fits in memory. */
+  MAX_DEPTH = 32
+};
+
+typedef struct node_t node_t;
+
+struct node_t {
+  size_t count;
+  int leaf;
+  golle_bin_t keys[MAX_KEYS];
+  node_t *children[MAX_KEYS + 1];
+};
+
+struct golle_set_t {
+  node_t *root;
+  size_t size;
+  golle_set_comp_t comp;
+};
+
+struct golle_set_iterator_t {
+  golle_set_t *set;
+  int started;
+  /* The path from the root. index is the next key to visit. */
+  size_t depth;
+  struct {
+    node_t *node;
+    size_t index;
+  } path[MAX_DEPTH];
+};
+
+/* Shift keys [from, count) of a node up by one slot. */
+static void keys_shift_up (node_t *x, size_t from) {
+  for (size_t j = x->count; j > from; j--) {
+    golle_bin_move (x->keys + j, x->keys + j - 1);
+  }
+}
+
+/* Shift keys [from, count) of a node down by one slot. */
+static void keys_shift_down (node_t *x, size_t from) {
+  for (size_t j = from; j < x->count; j++) {
+    golle_bin_move (x->keys + j - 1, x->keys + j);
+  }
+}
+
+static node_t *node_new (int leaf) {
+  node_t *x = malloc (sizeof (*x));
+  GOLLE_ASSERT (x, NULL);
+  x->count = 0;
+  x->leaf = leaf;
+  return x;
+}
+
+/* Free a subtree and its keys. */
+static void node_free (node_t *x) {
+  if (x) {
+    for (size_t i = 0; i < x->count; i++) {
+      golle_bin_release (x->keys + i);
+    }
+    if (!x->leaf) {
+      for (size_t i = 0; i <= x->count; i++) {
+	node_free (x->children[i]);
+      }
+    }
+    free (x);
+  }
+}
+
+/* Find the first key in a node that isn't before the probe. Sets
+ * *equal if that key is the probe. */
+static size_t lower_bound (const golle_set_t *set,
+			   const node_t *x,
+			   const golle_bin_t *probe,
+			   int *equal)
+{
+  size_t lo = 0, hi = x->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (set->comp (x->keys + mid, probe) < 0) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  *equal = lo < x->count && set->comp (probe, x->keys + lo) == 0;
+  return lo;
+}
+
+/* Look up a probe. */
+static golle_bin_t *find (const golle_set_t *set, const golle_bin_t *probe) {
+  node_t *x = set->root;
+  while (x) {
+    int equal;
+    size_t i = lower_bound (set, x, probe, &equal);
+    if (equal) {
+      return x->keys + i;
+    }
+    x = x->leaf ? NULL : x->children[i];
+  }
+  return NULL;
+}
+
+/* Split the full child i of x in two, moving its middle key up. */
+static golle_error split_child (node_t *x, size_t i) {
+  node_t *y = x->children[i];
+  node_t *z = node_new (y->leaf);
+  GOLLE_ASSERT (z, GOLLE_EMEM);
+
+  /* The top half of y goes to z */
+  z->count = MIN_KEYS;
+  for (size_t j = 0; j < MIN_KEYS; j++) {
+    golle_bin_move (z->keys + j, y->keys + j + DEGREE);
+  }
+  if (!y->leaf) {
+    for (size_t j = 0; j < DEGREE; j++) {
+      z->children[j] = y->children[j + DEGREE];
+    }
+  }
+  y->count = MIN_KEYS;
+
+  /* Make room in x for z and the middle key */
+  for (size_t j = x->count; j > i; j--) {
+    x->children[j + 1] = x->children[j];
+  }
+  x->children[i + 1] = z;
+  keys_shift_up (x, i);
+  golle_bin_move (x->keys + i, y->keys + MIN_KEYS);
+  x->count++;
+  return GOLLE_OK;
+}
+
+/* Insert a key into a subtree whose root isn't full. */
+static golle_error insert_nonfull (golle_set_t *set,
+				   node_t *x,
+				   golle_bin_t *key)
+{
+  for (;;) {
+    int equal;
+    size_t i = lower_bound (set, x, key, &equal);
+    if (x->leaf) {
+      keys_shift_up (x, i);
+      golle_bin_move (x->keys + i, key);
+      x->count++;
+      return GOLLE_OK;
+    }
+    if (x->children[i]->count == MAX_KEYS) {
+      golle_error err = split_child (x, i);
+      if (err != GOLLE_OK) {
+	return err;
+      }
+      if (set->comp (key, x->keys + i) > 0) {
+	i++;
+      }
+    }
+    x = x->children[i];
+  }
+}
+
+/* Merge child i+1 of x, and the key between, into child i. */
+static void merge_children (node_t *x, size_t i) {
+  node_t *y = x->children[i], *z = x->children[i + 1];
+
+  golle_bin_move (y->keys + y->count, x->keys + i);
+  for (size_t j = 0; j < z->count; j++) {
+    golle_bin_move (y->keys + y->count + 1 + j, z->keys + j);
+  }
+  if (!y->leaf) {
+    for (size_t j = 0; j <= z->count; j++) {
+      y->children[y->count + 1 + j] = z->children[j];
+    }
+  }
+  y->count += 1 + z->count;
+
+  keys_shift_down (x, i + 1);
+  for (size_t j = i + 2; j <= x->count; j++) {
+    x->children[j - 1] = x->children[j];
+  }
+  x->count--;
+  free (z);
+}
+
+/* Move a key from child i-1 of x, through x, into child i. */
+static void rotate_right (node_t *x, size_t i) {
+  node_t *c = x->children[i], *s = x->children[i - 1];
+
+  keys_shift_up (c, 0);
+  if (!c->leaf) {
+    for (size_t j = c->count + 1; j > 0; j--) {
+      c->children[j] = c->children[j - 1];
+    }
+    c->children[0] = s->children[s->count];
+  }
+  golle_bin_move (c->keys, x->keys + i - 1);
+  c->count++;
+
+  golle_bin_move (x->keys + i - 1, s->keys + s->count - 1);
+  s->count--;
+}
+
+/* Move a key from child i+1 of x, through x, into child i. */
+static void rotate_left (node_t *x, size_t i) {
+  node_t *c = x->children[i], *s = x->children[i + 1];
+
+  golle_bin_move (c->keys + c->count, x->keys + i);
+  if (!c->leaf) {
+    c->children[c->count + 1] = s->children[0];
+    for (size_t j = 0; j < s->count; j++) {
+      s->children[j] = s->children[j + 1];
+    }
+  }
+  c->count++;
+
+  golle_bin_move (x->keys + i, s->keys);
+  keys_shift_down (s, 1);
+  s->count--;
+}
+
+/* Swap two keys. */
+static void key_swap (golle_bin_t *a, golle_bin_t *b) {
+  golle_bin_t t;
+  golle_bin_move (&t, a);
+  golle_bin_move (a, b);
+  golle_bin_move (b, &t);
+}
+
+/* Erase a key that is known to be in the subtree at x. Each node
+ * descended into is first given more than MIN_KEYS keys, so the
+ * erase never has to go back up. */
+static void erase (golle_set_t *set, node_t *x, const golle_bin_t *probe) {
+  for (;;) {
+    int equal;
+    size_t i = lower_bound (set, x, probe, &equal);
+
+    if (equal && x->leaf) {
+      golle_bin_release (x->keys + i);
+      keys_shift_down (x, i + 1);
+      x->count--;
+      return;
+    }
+
+    if (equal) {
+      node_t *y = x->children[i], *z = x->children[i + 1];
+      if (y->count > MIN_KEYS) {
+	/* Swap with the predecessor, which is then erased from y. */
+	node_t *p = y;
+	while (!p->leaf) {
+	  p = p->children[p->count];
+	}
+	key_swap (x->keys + i, p->keys + p->count - 1);
+	x = y;
+      }
+      else if (z->count > MIN_KEYS) {
+	/* Likewise with the successor. */
+	node_t *s = z;
+	while (!s->leaf) {
+	  s = s->children[0];
+	}
+	key_swap (x->keys + i, s->keys);
+	x = z;
+      }
+      else {
+	merge_children (x, i);
+	x = y;
+      }
+      continue;
+    }
+
+    /* Not here, so make sure child i can lose a key. */
+    if (x->children[i]->count == MIN_KEYS) {
+      if (i > 0 && x->children[i - 1]->count > MIN_KEYS) {
+	rotate_right (x, i);
+      }
+      else if (i < x->count && x->children[i + 1]->count > MIN_KEYS) {
+	rotate_left (x, i);
+      }
+      else if (i < x->count) {
+	merge_children (x, i);
+      }
+      else {
+	merge_children (x, --i);
+      }
+    }
+    x = x->children[i];
+  }
+}
+
+/* Make a probe for an item. It only points at the item. */
+static void probe_init (golle_bin_t *probe, const void *item, size_t size) {
+  memset (probe, 0, sizeof (*probe));
+  probe->bin = (void *)item;
+  probe->size = size;
+}
+
+golle_error golle_set_new (golle_set_t **set, golle_set_comp_t comp) {
+  GOLLE_ASSERT (set, GOLLE_ERROR);
+  GOLLE_ASSERT (comp, GOLLE_ERROR);
+
+  golle_set_t *s = calloc (1, sizeof (*s));
+  GOLLE_ASSERT (s, GOLLE_EMEM);
+  s->comp = comp;
+
+  *set = s;
+  return GOLLE_OK;
+}
+
+void golle_set_delete (golle_set_t *set) {
+  if (set) {
+    golle_set_clear (set);
+    free (set);
+  }
+}
+
+size_t golle_set_size (const golle_set_t *set) {
+  GOLLE_ASSERT (set, 0);
+  return set->size;
+}
+
+golle_error golle_set_insert (golle_set_t *set,
+			      const void *item,
+			      size_t size)
+{
+  GOLLE_ASSERT (set, GOLLE_ERROR);
+  GOLLE_ASSERT (item, GOLLE_ERROR);
+
+  golle_bin_t key;
+  probe_init (&key, item, size);
+  GOLLE_ASSERT (!find (set, &key), GOLLE_EEXISTS);
+
+  /* Copy the item. Small items are kept in the key itself. */
+  golle_error err = golle_bin_init (&key, size);
+  GOLLE_ASSERT (err == GOLLE_OK, err);
+  memcpy (key.bin, item, size);
+
+  if (!set->root) {
+    set->root = node_new (1);
+  }
+  else if (set->root->count == MAX_KEYS) {
+    /* Grow the tree upwards. */
+    node_t *s = node_new (0);
+    if (s) {
+      s->children[0] = set->root;
+      if (split_child (s, 0) == GOLLE_OK) {
+	set->root = s;
+      }
+      else {
+	free (s);
+      }
+    }
+    if (set->root != s) {
+      err = GOLLE_EMEM;
+    }
+  }
+  if (!set->root) {
+    err = GOLLE_EMEM;
+  }
+
+  if (err == GOLLE_OK) {
+    err = insert_nonfull (set, set->root, &key);
+  }
+  if (err != GOLLE_OK) {
+    golle_bin_release (&key);
+    return err;
+  }
+  set->size++;
+  return GOLLE_OK;
+}
+
+golle_error golle_set_erase (golle_set_t *set,
+			     const void *item,
+			     size_t size)
+{
+  GOLLE_ASSERT (set, GOLLE_ERROR);
+  GOLLE_ASSERT (item, GOLLE_ERROR);
+
+  golle_bin_t probe;
+  probe_init (&probe, item, size);
+  GOLLE_ASSERT (find (set, &probe), GOLLE_ENOTFOUND);
+
+  erase (set, set->root, &probe);
+  set->size--;
+
+  /* Shrink the tree if the root emptied. */
+  node_t *root = set->root;
+  if (root->count == 0) {
+    set->root = root->leaf ? NULL : root->children[0];
+    free (root);
+  }
+  return GOLLE_OK;
+}
+
+golle_error golle_set_find (const golle_set_t *set,
+			    const void *item,
+			    size_t size,
+			    const golle_bin_t **found)
+{
+  GOLLE_ASSERT (set, GOLLE_ERROR);
+  GOLLE_ASSERT (item, GOLLE_ERROR);
+  GOLLE_ASSERT (found, GOLLE_ERROR);
+
+  golle_bin_t probe;
+  probe_init (&probe, item, size);
+  const golle_bin_t *key = find (set, &probe);
+  GOLLE_ASSERT (key, GOLLE_ENOTFOUND);
+
+  *found = key;
+  return GOLLE_OK;
+}
+
+golle_error golle_set_clear (golle_set_t *set) {
+  GOLLE_ASSERT (set, GOLLE_ERROR);
+  node_free (set->root);
+  set->root = NULL;
+  set->size = 0;
+  return GOLLE_OK;
+}
+
+/* Check a subtree, whose keys must lie strictly between lo and hi
+ * where they are given. Returns the number of keys, or 0 with *ok
+ * cleared if something is wrong. */
+static size_t check_node (const golle_set_t *set,
+			  const node_t *x,
+			  const golle_bin_t *lo,
+			  const golle_bin_t *hi,
+			  size_t depth,
+			  size_t *leaf_depth,
+			  int *ok)
+{
+  int root = x == set->root;
+  if (x->count > MAX_KEYS || (!root && x->count < MIN_KEYS) ||
+      (root && x->count == 0) || depth >= MAX_DEPTH) {
+    *ok = 0;
+    return 0;
+  }
+  for (size_t i = 0; i < x->count; i++) {
+    const golle_bin_t *k = x->keys + i;
+    if ((i > 0 && set->comp (k - 1, k) >= 0) ||
+	(lo && set->comp (lo, k) >= 0) ||
+	(hi && set->comp (k, hi) >= 0)) {
+      *ok = 0;
+      return 0;
+    }
+  }
+
+  if (x->leaf) {
+    /* Every leaf must be at the same depth. */
+    if (*leaf_depth == 0) {
+      *leaf_depth = depth + 1;
+    }
+    *ok &= *leaf_depth == depth + 1;
+    return x->count;
+  }
+
+  size_t total = x->count;
+  for (size_t i = 0; i <= x->count && *ok; i++) {
+    total += check_node (set, x->children[i],
+			 i > 0 ? x->keys + i - 1 : lo,
+			 i < x->count ? x->keys + i : hi,
+			 depth + 1, leaf_depth, ok);
+  }
+  return total;
+}
+
+golle_error golle_set_check (const golle_set_t *set) {
+  GOLLE_ASSERT (set, GOLLE_ERROR);
+  if (!set->root) {
+    return set->size == 0 ? GOLLE_OK : GOLLE_EINVALID;
+  }
+  int ok = 1;
+  size_t leaf_depth = 0;
+  size_t total = check_node (set, set->root, NULL, NULL, 0, &leaf_depth, &ok);
+  return ok && total == set->size ? GOLLE_OK : GOLLE_EINVALID;
+}
+
+golle_error golle_set_iterator (golle_set_t *set,
+				golle_set_iterator_t **iter)
+{
+  GOLLE_ASSERT (set, GOLLE_ERROR);
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+
+  golle_set_iterator_t *it = malloc (sizeof (*it));
+  GOLLE_ASSERT (it, GOLLE_EMEM);
+  it->set = set;
+  golle_set_iterator_reset (it);
+
+  *iter = it;
+  return GOLLE_OK;
+}
+
+void golle_set_iterator_free (golle_set_iterator_t *iter) {
+  free (iter);
+}
+
+/* Push the path to the first key of a subtree. */
+static void push_leftmost (golle_set_iterator_t *it, node_t *x) {
+  while (x) {
+    it->path[it->depth].node = x;
+    it->path[it->depth].index = 0;
+    it->depth++;
+    x = x->leaf ? NULL : x->children[0];
+  }
+}
+
+golle_error golle_set_iterator_next (golle_set_iterator_t *iter,
+				     const golle_bin_t **item)
+{
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+  GOLLE_ASSERT (item, GOLLE_ERROR);
+
+  if (!iter->started) {
+    iter->started = 1;
+    push_leftmost (iter, iter->set->root);
+  }
+  while (iter->depth) {
+    node_t *x = iter->path[iter->depth - 1].node;
+    size_t i = iter->path[iter->depth - 1].index;
+    if (i < x->count) {
+      *item = x->keys + i;
+      iter->path[iter->depth - 1].index = i + 1;
+      if (!x->leaf) {
+	push_leftmost (iter, x->children[i + 1]);
+      }
+      return GOLLE_OK;
+    }
+    iter->depth--;
+  }
+  return GOLLE_END;
+}
+
+golle_error golle_set_iterator_reset (golle_set_iterator_t *iter) {
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+  iter->started = 0;
+  iter->depth = 0;
+  return GOLLE_OK;
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+#include <golle/numbers.h>
+#include <golle/pool.h>
+#include "numbers.h"
+#include "atomic.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/*
+ * Splitting one exponentiation across the default pool. For a base a
+ * that is used again and again, the powers a^(2^(j * step)) are worked
+ * out once and kept. Then a^e is the product of those powers raised to
+ * the step-bit pieces of e, and the pieces can run at once, each on a
+ * worker, with step squarings instead of the whole length of e.
+ */
+
+enum {
+  /* The number of bases whose powers are kept. */
+  CACHE_SIZE = 8,
+  /* A piece shorter than this isn't worth the trip to a worker. */
+  MIN_PIECE_BITS = 128
+};
+
+/* The powers of one base. */
+typedef struct split_table_t {
+  BIGNUM *a;
+  BIGNUM *m;
+  size_t pieces;
+  int step;
+  BIGNUM **powers; /* powers[j] = a^(2^(j * step)) mod m */
+  unsigned refs;
+  unsigned long used;
+  int cached;
+} split_table_t;
+
+static size_t split_ways = 1;
+static split_table_t *cache[CACHE_SIZE];
+static unsigned long cache_tick;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void table_free (split_table_t *t) {
+  if (t) {
+    for (size_t j = 0; t->powers && j < t->pieces; j++) {
+      BN_free (t->powers[j]);
+    }
+    free (t->powers);
+    BN_free (t->a);
+    BN_free (t->m);
+    free (t);
+  }
+}
+
+/* Work out the powers of a modulo m. */
+static split_table_t *table_new (const BIGNUM *a,
+				 const BIGNUM *m,
+				 size_t pieces,
+				 BN_CTX *ctx)
+{
+  split_table_t *t = calloc (1, sizeof (*t));
+  if (!t) {
+    return NULL;
+  }
+  t->pieces = pieces;
+  t->step = (int)((BN_num_bits (m) + pieces - 1) / pieces);
+  t->a = BN_dup (a);
+  t->m = BN_dup (m);
+  t->powers = calloc (pieces, sizeof (*t->powers));
+  if (!t->a || !t->m || !t->powers) {
+    goto fail;
+  }
+
+  BN_CTX_start (ctx);
+  BIGNUM *shift = BN_CTX_get (ctx);
+  int ok = shift != NULL;
+  if (ok) {
+    BN_zero (shift);
+    ok = BN_set_bit (shift, t->step);
+  }
+  for (size_t j = 0; ok && j < pieces; j++) {
+    ok = (t->powers[j] = BN_new ()) != NULL;
+    if (ok && j == 0) {
+      ok = BN_nnmod (t->powers[0], a, m, ctx);
+    }
+    else if (ok) {
+      ok = golle_bn_mod_exp (t->powers[j], t->powers[j - 1], shift, m, ctx);
+    }
+  }
+  BN_CTX_end (ctx);
+  if (ok) {
+    return t;
+  }
+ fail:
+  table_free (t);
+  return NULL;
+}
+
+/* Find the powers of a in the cache, and hold them. Call with the
+ * lock held. */
+static split_table_t *table_find (const BIGNUM *a,
+				  const BIGNUM *m,
+				  size_t pieces)
+{
+  for (size_t i = 0; i < CACHE_SIZE; i++) {
+    split_table_t *t = cache[i];
+    if (t && t->pieces == pieces &&
+	BN_cmp (t->a, a) == 0 && BN_cmp (t->m, m) == 0) {
+      t->refs++;
+      t->used = ++cache_tick;
+      return t;
+    }
+  }
+  return NULL;
+}
+
+/* Get the powers of a, from the cache or made new. New powers replace
+ * the least recently used that nobody holds. */
+static split_table_t *table_get (const BIGNUM *a,
+				 const BIGNUM *m,
+				 size_t pieces,
+				 BN_CTX *ctx)
+{
+  pthread_mutex_lock (&cache_lock);
+  split_table_t *t = table_find (a, m, pieces);
+  pthread_mutex_unlock (&cache_lock);
+  if (t) {
+    return t;
+  }
+
+  /* Build them without the lock; another thread may get there first. */
+  split_table_t *made = table_new (a, m, pieces, ctx);
+  if (!made) {
+    return NULL;
+  }
+  pthread_mutex_lock (&cache_lock);
+  if ((t = table_find (a, m, pieces))) {
+    pthread_mutex_unlock (&cache_lock);
+    table_free (made);
+    return t;
+  }
+  size_t slot = CACHE_SIZE;
+  for (size_t i = 0; i < CACHE_SIZE; i++) {
+    if (!cache[i]) {
+      slot = i;
+      break;
+    }
+    if (cache[i]->refs == 0 &&
+	(slot == CACHE_SIZE || cache[i]->used < cache[slot]->used)) {
+      slot = i;
+    }
+  }
+  made->refs = 1;
+  made->used = ++cache_tick;
+  if (slot < CACHE_SIZE) {
+    table_free (cache[slot]);
+    cache[slot] = made;
+    made->cached = 1;
+  }
+  pthread_mutex_unlock (&cache_lock);
+  return made;
+}
+
+static void table_release (split_table_t *t) {
+  pthread_mutex_lock (&cache_lock);
+  int drop = --t->refs == 0 && !t->cached;
+  pthread_mutex_unlock (&cache_lock);
+  if (drop) {
+    table_free (t);
+  }
+}
+
+/* One piece of an exponent, for a worker. */
+typedef struct split_piece_t {
+  const BIGNUM *a;
+  BIGNUM *e;
+  BIGNUM *r;
+} split_piece_t;
+
+typedef struct split_batch_t {
+  split_piece_t *pieces;
+  const BIGNUM *m;
+} split_batch_t;
+
+/* out = the `bits` bits of e from bit `from` up. */
+static int slice (BIGNUM *out, const BIGNUM *e, int from, int bits) {
+  if (!BN_rshift (out, e, from)) {
+    return 0;
+  }
+  if (BN_num_bits (out) > bits) {
+    BN_mask_bits (out, bits);
+  }
+  return 1;
+}
+
+static golle_error piece_chunk (void *arg, size_t begin, size_t end) {
+  split_batch_t *b = arg;
+  BN_CTX *ctx = BN_CTX_new ();
+  GOLLE_ASSERT (ctx, GOLLE_EMEM);
+  golle_error err = GOLLE_OK;
+  for (size_t i = begin; i < end && err == GOLLE_OK; i++) {
+    split_piece_t *p = b->pieces + i;
+    if (!golle_bn_mod_exp (p->r, p->a, p->e, b->m, ctx)) {
+      err = GOLLE_ECRYPTO;
+    }
+  }
+  BN_CTX_free (ctx);
+  return err;
+}
+
+int golle_bn_mod_exp_split (BIGNUM **r,
+			    const BIGNUM **a,
+			    const BIGNUM **e,
+			    size_t count,
+			    const BIGNUM *m,
+			    BN_CTX *ctx)
+{
+  golle_pool_t *pool = golle_pool_get_default ();
+  size_t ways = GOLLE_ATOMIC_LOAD (&split_ways);
+  if (golle_pool_workers (pool) < ways) {
+    ways = golle_pool_workers (pool);
+  }
+  if (ways < 2 || count == 0) {
+    for (size_t i = 0; i < count; i++) {
+      if (!golle_bn_mod_exp (r[i], a[i], e[i], m, ctx)) {
+	return 0;
+      }
+    }
+    return 1;
+  }
+
+  /* Share the workers between the exponents. */
+  size_t per = ways / count;
+  size_t most = BN_num_bits (m) / MIN_PIECE_BITS;
+  if (per > most) {
+    per = most;
+  }
+  if (per < 1) {
+    per = 1;
+  }
+
+  split_table_t **tables = calloc (count, sizeof (*tables));
+  split_piece_t *pieces = calloc (count * per, sizeof (*pieces));
+  size_t n = 0;
+  int ok = tables && pieces;
+  for (size_t i = 0; ok && i < count; i++) {
+    if (per > 1 && !BN_is_negative (e[i]) &&
+	(tables[i] = table_get (a[i], m, per, ctx)) &&
+	(size_t)BN_num_bits (e[i]) <= per * tables[i]->step) {
+      /* e = sum_j e_j 2^(j * step), so a^e = prod_j powers[j]^e_j. */
+      for (size_t j = 0; ok && j < per; j++) {
+	split_piece_t *p = pieces + n++;
+	p->a = tables[i]->powers[j];
+	ok = (p->e = BN_new ()) && (p->r = BN_new ()) &&
+	  slice (p->e, e[i], (int)j * tables[i]->step, tables[i]->step);
+      }
+    }
+    else {
+      /* No powers, so the whole exponent is one piece. */
+      if (tables[i]) {
+	table_release (tables[i]);
+	tables[i] = NULL;
+      }
+      split_piece_t *p = pieces + n++;
+      p->a = a[i];
+      ok = (p->e = BN_dup (e[i])) && (p->r = BN_new ());
+    }
+  }
+
+  if (ok) {
+    split_batch_t b = { pieces, m };
+    ok = golle_pool_parallel_for (pool, n, 1, piece_chunk, &b) == GOLLE_OK;
+  }
+
+  /* Put the pieces back together. */
+  for (size_t i = 0, k = 0; ok && i < count; i++) {
+    size_t len = tables[i] ? per : 1;
+    ok = BN_copy (r[i], pieces[k].r) != NULL;
+    for (size_t j = 1; ok && j < len; j++) {
+      ok = golle_bn_mod_mul (r[i], r[i], pieces[k + j].r, m, ctx);
+    }
+    k += len;
+  }
+
+  for (size_t i = 0; tables && i < count; i++) {
+    if (tables[i]) {
+      table_release (tables[i]);
+    }
+  }
+  for (size_t i = 0; pieces && i < count * per; i++) {
+    BN_clear_free (pieces[i].e);
+    BN_free (pieces[i].r);
+  }
+  free (pieces);
+  free (tables);
+  return ok;
+}
+
+void golle_num_set_split (size_t ways) {
+  GOLLE_ATOMIC_STORE (&split_ways, ways ? ways : 1);
+  /* Different ways want different powers, so drop the old ones. One
+   * still held by an exponentiation is freed by its last release. */
+  pthread_mutex_lock (&cache_lock);
+  for (size_t i = 0; i < CACHE_SIZE; i++) {
+    split_table_t *t = cache[i];
+    cache[i] = NULL;
+    if (t) {
+      t->cached = 0;
+      if (t->refs == 0) {
+	table_free (t);
+      }
+    }
+  }
+  pthread_mutex_unlock (&cache_lock);
+}
+
+size_t golle_num_split (void) {
+  return GOLLE_ATOMIC_LOAD (&split_ways);
+}
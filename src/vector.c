@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/vector.h>
+#include <string.h>
+#include <golle/types.h>
+
+enum {
+  /* Items to make room for on the first push */
+  MIN_CAPACITY = 8
+};
+
+struct golle_vector_t {
+  unsigned char *items;
+  size_t size;
+  size_t count;
+  size_t capacity;
+};
+
+/* The address of the item at an index. */
+#define ITEM(v, i) ((v)->items + (i) * (v)->size)
+
+golle_error golle_vector_new (golle_vector_t **vector, size_t size) {
+  GOLLE_ASSERT (vector, GOLLE_ERROR);
+  GOLLE_ASSERT (size, GOLLE_ERROR);
+
+  golle_vector_t *v = calloc (1, sizeof (*v));
+  GOLLE_ASSERT (v, GOLLE_EMEM);
+  v->size = size;
+
+  *vector = v;
+  return GOLLE_OK;
+}
+
+void golle_vector_delete (golle_vector_t *vector) {
+  if (vector) {
+    free (vector->items);
+    free (vector);
+  }
+}
+
+size_t golle_vector_size (const golle_vector_t *vector) {
+  GOLLE_ASSERT (vector, 0);
+  return vector->count;
+}
+
+golle_error golle_vector_reserve (golle_vector_t *vector, size_t count) {
+  GOLLE_ASSERT (vector, GOLLE_ERROR);
+  if (count <= vector->capacity) {
+    return GOLLE_OK;
+  }
+  GOLLE_ASSERT (count <= SIZE_MAX / vector->size, GOLLE_EMEM);
+
+  void *items = realloc (vector->items, count * vector->size);
+  GOLLE_ASSERT (items, GOLLE_EMEM);
+  vector->items = items;
+  vector->capacity = count;
+  return GOLLE_OK;
+}
+
+void *golle_vector_at (const golle_vector_t *vector, size_t index) {
+  GOLLE_ASSERT (vector, NULL);
+  GOLLE_ASSERT (index < vector->count, NULL);
+  return ITEM (vector, index);
+}
+
+golle_error golle_vector_push (golle_vector_t *vector, const void *item) {
+  /* Shorthand for pushing many with a count of 1.
+   * It amounts to the same thing. */
+  return golle_vector_push_many (vector, item, 1);
+}
+
+golle_error golle_vector_push_many (golle_vector_t *vector,
+				    const void *item,
+				    size_t count)
+{
+  GOLLE_ASSERT (vector, GOLLE_ERROR);
+  GOLLE_ASSERT (count, GOLLE_OK);
+  GOLLE_ASSERT (count <= SIZE_MAX - vector->count, GOLLE_EMEM);
+
+  size_t need = vector->count + count;
+  if (need > vector->capacity) {
+    /* Double, so that pushing is amortised constant time. */
+    size_t grow = vector->capacity < MIN_CAPACITY ?
+      MIN_CAPACITY : vector->capacity;
+    size_t capacity = vector->capacity;
+    capacity = grow <= SIZE_MAX - capacity ? capacity + grow : SIZE_MAX;
+    golle_error err = golle_vector_reserve (vector,
+					    need > capacity ? need : capacity);
+    if (err != GOLLE_OK) {
+      return err;
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    unsigned char *dest = ITEM (vector, vector->count + i);
+    if (item) {
+      memcpy (dest, item, vector->size);
+    }
+    else {
+      memset (dest, 0, vector->size);
+    }
+  }
+  vector->count = need;
+  return GOLLE_OK;
+}
+
+golle_error golle_vector_swap_erase (golle_vector_t *vector, size_t index) {
+  GOLLE_ASSERT (vector, GOLLE_ERROR);
+  GOLLE_ASSERT (index < vector->count, GOLLE_ENOTFOUND);
+
+  size_t last = vector->count - 1;
+  if (index != last) {
+    memcpy (ITEM (vector, index), ITEM (vector, last), vector->size);
+  }
+  vector->count--;
+  return GOLLE_OK;
+}
+
+golle_error golle_vector_pop_all (golle_vector_t *vector) {
+  GOLLE_ASSERT (vector, GOLLE_ERROR);
+  vector->count = 0;
+  return GOLLE_OK;
+}
+
+golle_error golle_vector_iterator (golle_vector_t *vector,
+				   golle_vector_iterator_t *iter)
+{
+  GOLLE_ASSERT (vector, GOLLE_ERROR);
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+
+  iter->vector = vector;
+  iter->next = 0;
+  return GOLLE_OK;
+}
+
+golle_error golle_vector_iterator_next (golle_vector_iterator_t *iter,
+					void **item)
+{
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+  GOLLE_ASSERT (item, GOLLE_ERROR);
+
+  golle_vector_t *v = iter->vector;
+  if (iter->next >= v->count) {
+    /* Stay at the end, even if items are pushed. */
+    iter->next = SIZE_MAX;
+    return GOLLE_END;
+  }
+  *item = ITEM (v, iter->next);
+  iter->next++;
+  return GOLLE_OK;
+}
+
+golle_error golle_vector_iterator_reset (golle_vector_iterator_t *iter) {
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+  iter->next = 0;
+  return GOLLE_OK;
+}
+
+golle_error golle_vector_erase_at (golle_vector_iterator_t *iter) {
+  GOLLE_ASSERT (iter, GOLLE_ERROR);
+  GOLLE_ASSERT (iter->next != 0 && iter->next != SIZE_MAX, GOLLE_ENOTFOUND);
+
+  /* The item that was returned last. */
+  size_t current = iter->next - 1;
+  golle_error err = golle_vector_swap_erase (iter->vector, current);
+  if (err == GOLLE_OK) {
+    /* Visit the item moved into its place next. */
+    iter->next = current;
+  }
+  return err;
+}
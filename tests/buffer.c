@@ -7,9 +7,142 @@
 #include <assert.h>
 
 enum {
-  BUFFER_SIZE = 1024 /* 1KB */
+  BUFFER_SIZE = 1024, /* 1KB */
+  ARENA_BLOCK = 256
 };
 
+/* Fill a buffer with a pattern. */
+static void fill (golle_bin_t *b, unsigned char start) {
+  for (size_t i = 0; i < b->size; i++) {
+    ((unsigned char *)b->bin)[i] = (unsigned char)(start + i);
+  }
+}
+
+/* Small buffers live inside the structure. */
+static void test_small (void) {
+  golle_bin_t local = { 0 };
+  assert (golle_bin_init (&local, BIN_SMALL_BYTES) == GOLLE_OK);
+  assert (local.bin == local.small);
+  fill (&local, 1);
+
+  /* Shrinking and growing within the capacity doesn't move it. */
+  assert (golle_bin_resize (&local, 1) == GOLLE_OK);
+  assert (local.bin == local.small && local.size == 1);
+  assert (golle_bin_resize (&local, BIN_SMALL_BYTES) == GOLLE_OK);
+  assert (local.bin == local.small);
+  assert (((unsigned char *)local.bin)[0] == 1);
+  assert (((unsigned char *)local.bin)[1] == 0);
+
+  /* Growing past it keeps the contents. */
+  assert (golle_bin_resize (&local, BUFFER_SIZE) == GOLLE_OK);
+  assert (local.bin != local.small && local.capacity == BUFFER_SIZE);
+  assert (((unsigned char *)local.bin)[0] == 1);
+  void *heap = local.bin;
+  assert (golle_bin_resize (&local, 2) == GOLLE_OK);
+  assert (local.bin == heap);
+  golle_bin_release (&local);
+  assert (!local.bin && !local.size && !local.capacity);
+
+  /* An empty buffer starts out inline. */
+  assert (golle_bin_resize (&local, 3) == GOLLE_OK);
+  assert (local.bin == local.small);
+  golle_bin_release (&local);
+
+  golle_bin_t *b = golle_bin_new (BIN_SMALL_BYTES);
+  assert (b && b->bin == b->small);
+  fill (b, 7);
+  golle_bin_t *copy = golle_bin_copy (b);
+  assert (copy && copy->bin == copy->small);
+  assert (memcmp (copy->bin, b->bin, b->size) == 0);
+  assert (golle_bin_resize (b, BUFFER_SIZE) == GOLLE_OK);
+  golle_bin_delete (b);
+  golle_bin_delete (copy);
+}
+
+/* Copying into an existing buffer reuses its memory. */
+static void test_copy_into (void) {
+  golle_bin_t *src = golle_bin_new (BUFFER_SIZE);
+  golle_bin_t dest = { 0 };
+  assert (src);
+  fill (src, 3);
+
+  assert (golle_bin_copy_into (&dest, src) == GOLLE_OK);
+  assert (dest.size == src->size);
+  assert (memcmp (dest.bin, src->bin, src->size) == 0);
+  void *bin = dest.bin;
+  src->size = BUFFER_SIZE / 2;
+  assert (golle_bin_copy_into (&dest, src) == GOLLE_OK);
+  assert (dest.bin == bin && dest.size == BUFFER_SIZE / 2);
+  assert (memcmp (dest.bin, src->bin, src->size) == 0);
+
+  golle_bin_t empty = { 0 };
+  assert (golle_bin_copy_into (&dest, &empty) == GOLLE_ERROR);
+  assert (golle_bin_copy_into (NULL, src) == GOLLE_ERROR);
+
+  golle_bin_release (&dest);
+  src->size = BUFFER_SIZE;
+  golle_bin_delete (src);
+}
+
+/* Buffers carved from an arena. */
+static void test_arena (golle_bin_arena_t *(*make) (size_t)) {
+  golle_bin_arena_t *arena = make (ARENA_BLOCK);
+  assert (arena);
+  golle_bin_t *src = golle_bin_new (BUFFER_SIZE);
+  assert (src);
+  fill (src, 5);
+
+  void *first = NULL;
+  for (int round = 0; round < 3; round++) {
+    golle_bin_t local = { 0 };
+    assert (golle_bin_arena_alloc (arena, &local, 10) == GOLLE_OK);
+    assert (local.arena == arena && local.size == 10);
+    if (round == 0) {
+      first = local.bin;
+    }
+    else {
+      /* The memory is reused after a reset, and was zeroed. */
+      assert (local.bin == first);
+      assert (((unsigned char *)local.bin)[0] == 0);
+    }
+    fill (&local, 9);
+
+    /* Growing stays in the arena. */
+    assert (golle_bin_resize (&local, ARENA_BLOCK) == GOLLE_OK);
+    assert (local.arena == arena);
+    assert (((unsigned char *)local.bin)[0] == 9);
+
+    /* Copies, small and large, spanning several blocks. */
+    golle_bin_t *big = golle_bin_arena_copy (arena, src);
+    assert (big && big->arena == arena);
+    assert (big->size == src->size);
+    assert (memcmp (big->bin, src->bin, src->size) == 0);
+    golle_bin_t *little = golle_bin_arena_copy (arena, &local);
+    assert (little && little->size == local.size);
+    assert (memcmp (little->bin, local.bin, local.size) == 0);
+
+    /* Deleting only zeroes. */
+    golle_bin_delete (little);
+    golle_bin_release (&local);
+    golle_bin_arena_reset (arena);
+  }
+
+  /* Raw memory is aligned for anything. */
+  unsigned char *raw = golle_bin_arena_carve (arena, 3);
+  assert (raw);
+  assert ((size_t)golle_bin_arena_carve (arena, 1) % sizeof (void *) == 0);
+  raw[2] = 1;
+
+  golle_bin_t local;
+  assert (golle_bin_arena_alloc (NULL, &local, 1) == GOLLE_ERROR);
+  assert (!golle_bin_arena_carve (NULL, 1));
+  assert (!golle_bin_arena_copy (arena, NULL));
+  golle_bin_delete (src);
+  golle_bin_arena_delete (arena);
+  golle_bin_arena_reset (NULL);
+  golle_bin_arena_delete (NULL);
+}
+
 
 int main (void) {
   golle_bin_t *buffer = golle_bin_new (BUFFER_SIZE);
@@ -33,4 +166,10 @@ int main (void) {
   assert (local.bin);
   assert (local.size == BUFFER_SIZE);
   golle_bin_release (&local);
+
+  test_small ();
+  test_copy_into ();
+  test_arena (&golle_bin_arena_new);
+  test_arena (&golle_bin_arena_new_secure);
+  return 0;
 }
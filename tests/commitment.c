@@ -5,11 +5,238 @@
 #include <golle/commit.h>
 #include <golle/random.h>
 #include <assert.h>
+#include <string.h>
 
 enum {
-  SECRET_SIZE = 64
+  SECRET_SIZE = 64,
+  BATCH = 5
 };
 
+/* Compare two buffers. */
+static int bin_equal (const golle_bin_t *a, const golle_bin_t *b) {
+  return a->size == b->size && memcmp (a->bin, b->bin, a->size) == 0;
+}
+
+/* Commit to and verify several secrets at once. */
+static void test_many (void) {
+  golle_bin_t *secrets[BATCH];
+  golle_commit_t *commits[BATCH];
+  size_t failed = BATCH;
+
+  for (size_t i = 0; i < BATCH; i++) {
+    secrets[i] = golle_bin_new (SECRET_SIZE + i);
+    assert (secrets[i]);
+    assert (golle_random_generate (secrets[i]) == GOLLE_OK);
+  }
+  assert (golle_commit_new_many (commits,
+				 (const golle_bin_t *const *)secrets,
+				 BATCH) == GOLLE_OK);
+
+  /* Each one verifies alone, and they all verify together. */
+  for (size_t i = 0; i < BATCH; i++) {
+    assert (commits[i]);
+    assert (golle_commit_verify (commits[i]) == GOLLE_COMMIT_PASSED);
+    assert (bin_equal (commits[i]->secret, secrets[i]));
+  }
+  assert (golle_commit_verify_many ((const golle_commit_t *const *)commits,
+				    BATCH, &failed) == GOLLE_COMMIT_PASSED);
+  assert (failed == BATCH);
+
+  /* No two commitments share random values. */
+  assert (!bin_equal (commits[0]->rsend, commits[0]->rkeep));
+  assert (!bin_equal (commits[0]->rkeep, commits[1]->rsend));
+
+  /* The failing commitment is reported. */
+  assert (golle_random_generate (commits[3]->secret) == GOLLE_OK);
+  assert (golle_commit_verify_many ((const golle_commit_t *const *)commits,
+				    BATCH, &failed) == GOLLE_COMMIT_FAILED);
+  assert (failed == 3);
+
+  /* So is a failing batch of one. */
+  failed = BATCH;
+  assert (golle_commit_verify_many ((const golle_commit_t *const *)commits + 3,
+				    1, &failed) == GOLLE_COMMIT_FAILED);
+  assert (failed == 0);
+
+  for (size_t i = 0; i < BATCH; i++) {
+    golle_commit_delete (commits[i]);
+  }
+
+  /* Nothing is made if any secret is bad. */
+  golle_bin_t empty = { 0, NULL };
+  secrets[2] = &empty;
+  assert (golle_commit_new_many (commits,
+				 (const golle_bin_t *const *)secrets,
+				 BATCH) == GOLLE_ERROR);
+  for (size_t i = 0; i < BATCH; i++) {
+    assert (commits[i] == NULL);
+  }
+  secrets[2] = NULL;
+
+  /* An empty batch passes. */
+  assert (golle_commit_verify_many ((const golle_commit_t *const *)commits,
+				    0, NULL) == GOLLE_COMMIT_PASSED);
+  assert (golle_commit_verify_many (NULL, 1, NULL) == GOLLE_ERROR);
+
+  for (size_t i = 0; i < BATCH; i++) {
+    golle_bin_delete (secrets[i]);
+  }
+}
+
+/* A packed commitment, filled in the order of a draw. */
+static void test_pack (void) {
+  golle_commit_pack_t mine, theirs;
+  memset (&mine, 0, sizeof (mine));
+  memset (&theirs, 0, sizeof (theirs));
+  golle_bin_t *secret = golle_bin_new (SECRET_SIZE);
+  assert (secret);
+
+  for (int round = 0; round < 3; round++) {
+    assert (golle_random_generate (secret) == GOLLE_OK);
+    assert (golle_commit_pack_new (&mine, secret) == GOLLE_OK);
+    assert (golle_commit_verify (&mine.commit) == GOLLE_COMMIT_PASSED);
+    assert (bin_equal (mine.commit.secret, secret));
+
+    /* A packed commitment agrees with an ordinary one. */
+    golle_commit_t *c = golle_commit_new (secret);
+    assert (c);
+    golle_bin_delete (c->rsend);
+    golle_bin_delete (c->rkeep);
+    c->rsend = golle_bin_copy (mine.commit.rsend);
+    c->rkeep = golle_bin_copy (mine.commit.rkeep);
+    assert (c->rsend && c->rkeep);
+    assert (golle_commit_verify (c) == GOLLE_COMMIT_FAILED);
+    golle_bin_delete (c->hash);
+    c->hash = golle_bin_copy (mine.commit.hash);
+    assert (golle_commit_verify (c) == GOLLE_COMMIT_PASSED);
+    golle_commit_delete (c);
+
+    /* The public parts arrive first, then the private parts. */
+    assert (golle_commit_pack_set (&theirs, NULL, mine.commit.rsend,
+				   NULL, mine.commit.hash) == GOLLE_OK);
+    assert (theirs.commit.rsend && theirs.commit.hash);
+    assert (!theirs.commit.rkeep && !theirs.commit.secret);
+    assert (golle_commit_verify (&theirs.commit) == GOLLE_ERROR);
+    void *arena = theirs.arena;
+    assert (golle_commit_pack_set (&theirs, mine.commit.secret, NULL,
+				   mine.commit.rkeep, NULL) == GOLLE_OK);
+    assert (bin_equal (theirs.commit.hash, mine.commit.hash));
+    assert (golle_commit_verify (&theirs.commit) == GOLLE_COMMIT_PASSED);
+    if (round > 0) {
+      /* The memory is reused from the round before. */
+      assert (theirs.arena == arena);
+    }
+
+    /* A different secret fails. */
+    ((unsigned char *)theirs.secret.bin)[0] ^= 1;
+    assert (golle_commit_verify (&theirs.commit) == GOLLE_COMMIT_FAILED);
+
+    golle_commit_pack_reset (&mine);
+    golle_commit_pack_reset (&theirs);
+    assert (!theirs.commit.hash && theirs.capacity);
+  }
+
+  /* Errors */
+  golle_bin_t empty = { 0, NULL };
+  assert (golle_commit_pack_set (NULL, NULL, NULL, NULL, NULL) ==
+	  GOLLE_ERROR);
+  assert (golle_commit_pack_set (&theirs, &empty, NULL, NULL, NULL) ==
+	  GOLLE_ERROR);
+  assert (golle_commit_pack_new (&mine, &empty) == GOLLE_ERROR);
+  assert (golle_commit_pack_new (NULL, secret) == GOLLE_ERROR);
+
+  golle_commit_pack_release (&mine);
+  golle_commit_pack_release (&theirs);
+  assert (!theirs.arena && !theirs.capacity);
+
+  /* Packs sharing a secure pool. */
+  golle_bin_arena_t *pool = golle_bin_arena_new_secure (0);
+  assert (pool);
+  mine.pool = theirs.pool = pool;
+  for (int round = 0; round < 3; round++) {
+    assert (golle_random_generate (secret) == GOLLE_OK);
+    assert (golle_commit_pack_new (&mine, secret) == GOLLE_OK);
+    assert (golle_commit_pack_set (&theirs, mine.commit.secret,
+				   mine.commit.rsend, mine.commit.rkeep,
+				   mine.commit.hash) == GOLLE_OK);
+    assert (golle_commit_verify (&theirs.commit) == GOLLE_COMMIT_PASSED);
+    golle_commit_pack_reset (&mine);
+    golle_commit_pack_reset (&theirs);
+  }
+  /* Deleting the pool frees every pack at once. */
+  golle_bin_arena_delete (pool);
+  golle_bin_delete (secret);
+}
+
+/* Commit to numbers without putting them in a buffer first. */
+static void test_stream (void) {
+  enum { WIDTH = 64 };
+  golle_commit_pack_t mine;
+  memset (&mine, 0, sizeof (mine));
+  golle_commit_stream_t *stream = golle_commit_stream_new ();
+  golle_num_t a = golle_num_new ();
+  golle_num_t b = golle_num_new_int (5);
+  assert (stream && a && b);
+  assert (golle_num_rand_bits (a, WIDTH * 8 - 12) == GOLLE_OK);
+
+  assert (golle_commit_pack_begin (&mine, stream) == GOLLE_OK);
+  assert (golle_commit_stream_num (stream, a, WIDTH) == GOLLE_OK);
+  assert (golle_commit_stream_num (stream, b, WIDTH) == GOLLE_OK);
+  assert (golle_commit_pack_end (&mine, stream) == GOLLE_OK);
+  assert (mine.commit.hash && mine.commit.rsend && mine.commit.rkeep);
+  assert (!mine.commit.secret);
+
+  /* The other side streams the same numbers. */
+  assert (golle_commit_stream_begin (stream, mine.commit.rsend,
+				     mine.commit.rkeep) == GOLLE_OK);
+  assert (golle_commit_stream_num (stream, a, WIDTH) == GOLLE_OK);
+  assert (golle_commit_stream_num (stream, b, WIDTH) == GOLLE_OK);
+  assert (golle_commit_stream_check (stream, mine.commit.hash) ==
+	  GOLLE_COMMIT_PASSED);
+
+  /* It is the same as committing to the zero-padded buffer. */
+  golle_bin_t *secret = golle_bin_new (WIDTH * 2);
+  golle_bin_t ba = { 0 }, bb = { 0 };
+  assert (secret);
+  assert (golle_num_to_bin (a, &ba) == GOLLE_OK);
+  assert (golle_num_to_bin (b, &bb) == GOLLE_OK);
+  memset (secret->bin, 0, secret->size);
+  memcpy ((char *)secret->bin + WIDTH - ba.size, ba.bin, ba.size);
+  memcpy ((char *)secret->bin + secret->size - bb.size, bb.bin, bb.size);
+  golle_commit_t c = mine.commit;
+  c.secret = secret;
+  assert (golle_commit_verify (&c) == GOLLE_COMMIT_PASSED);
+  assert (golle_commit_stream_begin (stream, mine.commit.rsend,
+				     mine.commit.rkeep) == GOLLE_OK);
+  assert (golle_commit_stream_bin (stream, secret) == GOLLE_OK);
+  assert (golle_commit_stream_check (stream, mine.commit.hash) ==
+	  GOLLE_COMMIT_PASSED);
+
+  /* A different number fails. */
+  assert (golle_commit_stream_begin (stream, mine.commit.rsend,
+				     mine.commit.rkeep) == GOLLE_OK);
+  assert (golle_commit_stream_num (stream, b, WIDTH) == GOLLE_OK);
+  assert (golle_commit_stream_num (stream, a, WIDTH) == GOLLE_OK);
+  assert (golle_commit_stream_check (stream, mine.commit.hash) ==
+	  GOLLE_COMMIT_FAILED);
+
+  /* Errors */
+  assert (golle_commit_stream_begin (stream, NULL,
+				     mine.commit.rkeep) == GOLLE_ERROR);
+  assert (golle_commit_stream_begin (stream, mine.commit.rsend,
+				     mine.commit.rkeep) == GOLLE_OK);
+  assert (golle_commit_stream_num (stream, a, ba.size - 1) == GOLLE_ERROR);
+  assert (golle_commit_pack_end (NULL, stream) == GOLLE_ERROR);
+
+  golle_bin_clear (&ba);
+  golle_bin_clear (&bb);
+  golle_bin_delete (secret);
+  golle_num_delete (a);
+  golle_num_delete (b);
+  golle_commit_pack_release (&mine);
+  golle_commit_stream_delete (stream);
+}
+
 int main (void) {
   /* Bob has a secret. */
   golle_bin_t *bob_secret = golle_bin_new (64);
@@ -70,4 +297,10 @@ int main (void) {
   golle_bin_delete (alice_store.rsend);
   golle_bin_delete (alice_store.hash);
   golle_bin_delete (alice_store.secret);
+
+  test_many ();
+  test_pack ();
+  test_stream ();
+  golle_random_clear ();
+  return 0;
 }
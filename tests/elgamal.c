@@ -6,14 +6,59 @@
 #include <golle/distribute.h>
 #include <golle/elgamal.h>
 #include <golle/random.h>
+#include <openssl/bn.h>
 #include <assert.h>
 #include <limits.h>
 
 enum {
   MSG_SIZE = 8,
-  NUM_BITS = 16 /* Doing smaller key for speed */
+  NUM_BITS = 16, /* Doing smaller key for speed */
+  NUM_PRODUCT = 5
 };
 
+/* The product of ciphertexts must match a plain chain of modular
+ * products, and decrypt to the product of the plaintexts. */
+static void test_product (golle_key_t *key) {
+  golle_eg_t ciphers[NUM_PRODUCT] = { { 0 } };
+  golle_eg_t product = { 0 };
+  BN_CTX *ctx = BN_CTX_new ();
+  BIGNUM *a = BN_new (), *b = BN_new (), *m = BN_new ();
+  assert (ctx && a && b && m);
+  assert (BN_one (a) && BN_one (b) && BN_one (m));
+
+  for (size_t i = 0; i < NUM_PRODUCT; i++) {
+    golle_num_t e = golle_num_new_int (i + 2);
+    golle_num_t mi = golle_num_new ();
+    assert (e && mi);
+    assert (golle_num_mod_exp (mi, key->g, e, key->q) == GOLLE_OK);
+    assert (golle_eg_encrypt (key, mi, ciphers + i, NULL) == GOLLE_OK);
+    assert (golle_eg_mul (key, &product, ciphers + i) == GOLLE_OK);
+
+    assert (BN_mod_mul (a, a, ciphers[i].a, key->p, ctx));
+    assert (BN_mod_mul (b, b, ciphers[i].b, key->p, ctx));
+    assert (BN_mod_mul (m, m, mi, key->p, ctx));
+    golle_num_delete (e);
+    golle_num_delete (mi);
+  }
+  assert (BN_cmp (product.a, a) == 0);
+  assert (BN_cmp (product.b, b) == 0);
+
+  golle_num_t d = golle_num_new ();
+  assert (d);
+  assert (golle_eg_decrypt (key, &key->x, 1, &product, d) == GOLLE_OK);
+  assert (BN_cmp (d, m) == 0);
+
+  golle_num_delete (d);
+  for (size_t i = 0; i < NUM_PRODUCT; i++) {
+    golle_eg_clear (ciphers + i);
+  }
+  golle_eg_clear (&product);
+  BN_free (a);
+  BN_free (b);
+  BN_free (m);
+  BN_CTX_free (ctx);
+}
+
 int main (void) {
   golle_key_t key = { 0 };
   golle_eg_t cipher = { 0 };
@@ -47,6 +92,8 @@ int main (void) {
   /* Are they the same? */
   assert (golle_num_cmp (m, p) == 0);
 
+  test_product (&key);
+
   golle_eg_clear (&cipher);
   golle_num_delete (p);
   golle_num_delete (n);
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/group.h>
+#include <golle/distribute.h>
+#include <golle/random.h>
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include <openssl/bn.h>
+
+enum {
+  NUM_BITS = 128,
+  ROUNDS = 10
+};
+
+/* Group laws, and writing elements out and back. */
+static void test_elements (const golle_group_t *group) {
+  golle_num_t q = golle_group_order (group);
+  golle_num_t n1 = golle_num_rand (q);
+  golle_num_t n2 = golle_num_rand (q);
+  golle_num_t sum = golle_num_new ();
+  golle_elem_t *a = golle_elem_new (group);
+  golle_elem_t *b = golle_elem_new (group);
+  golle_elem_t *c = golle_elem_new (group);
+  BN_CTX *ctx = BN_CTX_new ();
+  assert (n1 && n2 && sum && a && b && c && ctx);
+
+  /* g^n1 * g^n2 = g^(n1 + n2) */
+  assert (BN_mod_add (sum, n1, n2, q, ctx));
+  assert (golle_group_exp (group, a, NULL, n1) == GOLLE_OK);
+  assert (golle_group_exp (group, b, NULL, n2) == GOLLE_OK);
+  assert (golle_group_mul (group, a, a, b) == GOLLE_OK);
+  assert (golle_group_exp (group, c, NULL, sum) == GOLLE_OK);
+  assert (golle_elem_cmp (group, a, c) == 0);
+  assert (golle_elem_cmp (group, a, b) != 0);
+
+  /* (g^n1)^n2 = (g^n2)^n1 */
+  assert (golle_group_exp (group, a, NULL, n1) == GOLLE_OK);
+  assert (golle_group_exp (group, a, a, n2) == GOLLE_OK);
+  assert (golle_group_exp (group, c, b, n1) == GOLLE_OK);
+  assert (golle_elem_cmp (group, a, c) == 0);
+
+  /* a * a^-1 * b = b */
+  assert (golle_group_inv (group, c, a) == GOLLE_OK);
+  assert (golle_group_mul (group, c, c, b) == GOLLE_OK);
+  assert (golle_group_mul (group, c, c, a) == GOLLE_OK);
+  assert (golle_elem_cmp (group, c, b) == 0);
+
+  /* Elements survive being written out, at the size given. */
+  golle_bin_t bin = { 0 };
+  assert (golle_elem_to_bin (group, a, &bin) == GOLLE_OK);
+  assert (bin.size == golle_group_elem_size (group));
+  assert (golle_bin_to_elem (group, &bin, c) == GOLLE_OK);
+  assert (golle_elem_cmp (group, a, c) == 0);
+  assert (golle_elem_cpy (group, b, a) == GOLLE_OK);
+  assert (golle_elem_cmp (group, a, b) == 0);
+
+  /* Bytes that aren't an element are refused. */
+  memset (bin.bin, 0xFF, bin.size);
+  assert (golle_bin_to_elem (group, &bin, c) == GOLLE_EOUTOFRANGE);
+  golle_bin_release (&bin);
+
+  golle_elem_delete (group, a);
+  golle_elem_delete (group, b);
+  golle_elem_delete (group, c);
+  golle_num_delete (n1);
+  golle_num_delete (n2);
+  golle_num_delete (sum);
+  BN_CTX_free (ctx);
+}
+
+/* Elements of Z*p are written out as the numbers themselves, however
+ * they are held, and stay right along a long chain of products. */
+static void test_modp (const golle_group_t *group, const golle_key_t *key) {
+  golle_num_t n = golle_num_new_int (ROUNDS);
+  golle_num_t one = golle_num_new_int (1);
+  golle_num_t x = golle_num_new ();
+  golle_elem_t *a = golle_elem_new (group);
+  golle_elem_t *g = golle_elem_new (group);
+  golle_bin_t bin = { 0 };
+  BIGNUM *y;
+  assert (n && one && x && a && g);
+
+  /* g * g * ... * g = g^ROUNDS, as golle_num_mod_exp() has it. */
+  assert (golle_group_exp (group, g, NULL, one) == GOLLE_OK);
+  assert (golle_elem_cpy (group, a, g) == GOLLE_OK);
+  for (size_t i = 1; i < ROUNDS; i++) {
+    assert (golle_group_mul (group, a, a, g) == GOLLE_OK);
+  }
+  assert (golle_num_mod_exp (x, key->g, n, key->p) == GOLLE_OK);
+  assert (golle_elem_to_bin (group, a, &bin) == GOLLE_OK);
+  assert ((y = BN_bin2bn (bin.bin, (int)bin.size, NULL)));
+  assert (BN_cmp (y, x) == 0);
+  BN_free (y);
+
+  /* And g^-1, read back, times g^ROUNDS is g^(ROUNDS - 1). */
+  assert (golle_group_inv (group, g, g) == GOLLE_OK);
+  assert (golle_elem_to_bin (group, g, &bin) == GOLLE_OK);
+  assert (golle_bin_to_elem (group, &bin, g) == GOLLE_OK);
+  assert (golle_group_mul (group, a, a, g) == GOLLE_OK);
+  assert (BN_sub_word (n, 1));
+  assert (golle_num_mod_exp (x, key->g, n, key->p) == GOLLE_OK);
+  assert (golle_elem_to_bin (group, a, &bin) == GOLLE_OK);
+  assert ((y = BN_bin2bn (bin.bin, (int)bin.size, NULL)));
+  assert (BN_cmp (y, x) == 0);
+  BN_free (y);
+
+  golle_bin_release (&bin);
+  golle_elem_delete (group, a);
+  golle_elem_delete (group, g);
+  golle_num_delete (n);
+  golle_num_delete (one);
+  golle_num_delete (x);
+}
+
+static void test_group (golle_group_t *group, const char *name) {
+  assert (strcmp (golle_group_name (group), name) == 0);
+  assert (golle_group_order (group));
+  assert (golle_group_elem_size (group) > 0);
+  test_elements (group);
+  golle_group_delete (group);
+}
+
+int main (void) {
+  golle_group_t *group;
+
+  /* The group of a key. */
+  golle_key_t key = { 0 };
+  assert (golle_key_gen_public (&key, NUM_BITS, INT_MAX) == GOLLE_OK);
+  assert (golle_group_new_modp (&group, &key) == GOLLE_OK);
+  assert (golle_group_elem_size (group) == (NUM_BITS + 7) / 8);
+  test_modp (group, &key);
+  test_group (group, "modp");
+  golle_key_cleanup (&key);
+
+  /* Curves, with compressed points. */
+  assert (golle_group_new_curve (&group, GOLLE_CURVE_P256) == GOLLE_OK);
+  assert (golle_group_elem_size (group) == 33);
+  test_group (group, "p256");
+  assert (golle_group_new_curve (&group, GOLLE_CURVE_P384) == GOLLE_OK);
+  assert (golle_group_elem_size (group) == 49);
+  test_group (group, "p384");
+
+  /* Failure cases */
+  assert (golle_group_new_curve (&group, (golle_curve)-1) == GOLLE_EINVALID);
+  assert (golle_group_new_curve (NULL, GOLLE_CURVE_P256) == GOLLE_ERROR);
+  assert (golle_group_new_modp (&group, NULL) == GOLLE_ERROR);
+  assert (golle_group_new_modp (&group, &key) == GOLLE_ERROR);
+  assert (golle_group_name (NULL) == NULL);
+  assert (golle_group_order (NULL) == NULL);
+  assert (golle_group_elem_size (NULL) == 0);
+  assert (golle_elem_new (NULL) == NULL);
+  golle_elem_delete (NULL, NULL);
+  golle_group_delete (NULL);
+
+  golle_random_clear ();
+  return 0;
+}
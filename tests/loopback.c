@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/loopback.h>
+#include <golle/distribute.h>
+#include <golle/random.h>
+#include <assert.h>
+#include <limits.h>
+
+enum {
+  NUM_BITS = 128,
+  NUM_PEERS = 4,
+  NUM_ITEMS = 8,
+  DRAWS = 4
+};
+
+/* Check a draw that everyone can see. */
+static void check_face_up (golle_loopback_t *table) {
+  size_t selection, s;
+  golle_error err = golle_loopback_draw (table, GOLLE_FACE_UP, &selection);
+  assert (err == GOLLE_OK || err == GOLLE_ECOLLISION);
+  assert (selection < NUM_ITEMS);
+  for (size_t i = 0; i < NUM_PEERS; i++) {
+    assert (golle_loopback_result (table, i, &s) == err);
+    assert (s == selection);
+  }
+}
+
+/* Check a draw that only one peer can see. */
+static void check_face_down (golle_loopback_t *table,
+			     size_t num_peers,
+			     size_t to)
+{
+  size_t selection, s;
+  golle_error err = golle_loopback_draw (table, to, &selection);
+  assert (err == GOLLE_OK || err == GOLLE_ECOLLISION);
+  assert (selection < NUM_ITEMS);
+  for (size_t i = 0; i < num_peers; i++) {
+    if (i == to) {
+      assert (golle_loopback_result (table, i, &s) == err);
+      assert (s == selection);
+    }
+    else {
+      assert (golle_loopback_result (table, i, &s) == GOLLE_ENOTFOUND);
+    }
+  }
+}
+
+int main (void) {
+  golle_key_t key = { 0 };
+  golle_loopback_t *table;
+  size_t selection;
+  assert (golle_key_gen_public (&key, NUM_BITS, INT_MAX) == GOLLE_OK);
+
+  assert (golle_loopback_new (&table, &key, NUM_PEERS, NUM_ITEMS) == GOLLE_OK);
+  for (size_t i = 0; i < DRAWS; i++) {
+    check_face_up (table);
+    check_face_down (table, NUM_PEERS, i % NUM_PEERS);
+  }
+
+  /* Start again. */
+  assert (golle_loopback_reset (table) == GOLLE_OK);
+  check_face_up (table);
+
+  /* Errors */
+  assert (golle_loopback_draw (table, NUM_PEERS, &selection) ==
+	  GOLLE_EOUTOFRANGE);
+  assert (golle_loopback_result (table, NUM_PEERS, &selection) ==
+	  GOLLE_EOUTOFRANGE);
+  assert (golle_loopback_draw (NULL, 0, &selection) == GOLLE_ERROR);
+  assert (golle_loopback_reset (NULL) == GOLLE_ERROR);
+  golle_loopback_delete (table);
+
+  assert (golle_loopback_new (NULL, &key, NUM_PEERS, NUM_ITEMS) ==
+	  GOLLE_ERROR);
+  assert (golle_loopback_new (&table, NULL, NUM_PEERS, NUM_ITEMS) ==
+	  GOLLE_ERROR);
+  assert (golle_loopback_new (&table, &key, 0, NUM_ITEMS) == GOLLE_ERROR);
+  assert (golle_loopback_new (&table, &key, NUM_PEERS, 0) == GOLLE_ERROR);
+
+  /* A table of one. */
+  assert (golle_loopback_new (&table, &key, 1, NUM_ITEMS) == GOLLE_OK);
+  check_face_down (table, 1, 0);
+  golle_loopback_delete (table);
+
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include "golle/map.h"
+#include "golle/random.h"
+#include <assert.h>
+#include <string.h>
+
+enum {
+  ITEMS = 10000,
+  /* Bigger than a buffer stores inline. */
+  BIG_KEY = 200
+};
+
+/* Make a key for i of the given size. */
+static void make_key (unsigned char *key, int i, size_t size) {
+  memset (key, i & 0xff, size);
+  memcpy (key, &i, sizeof (i));
+}
+
+int main (void) {
+  /* Make a map */
+  golle_map_t *map;
+
+  golle_error error = golle_map_new (&map, sizeof (int));
+  assert(error == GOLLE_OK);
+  assert(map);
+  assert(golle_map_size(map) == 0);
+
+  /* The hash depends on the data and the seed. */
+  assert(golle_map_hash ("abc", 3, 0) == golle_map_hash ("abc", 3, 0));
+  assert(golle_map_hash ("abc", 3, 0) != golle_map_hash ("abd", 3, 0));
+  assert(golle_map_hash ("abc", 3, 0) != golle_map_hash ("abc", 3, 1));
+  assert(golle_map_hash ("abc", 3, 0) != golle_map_hash ("abc", 2, 0));
+
+  /* Nothing to find in an empty map. */
+  int v = 0;
+  int *found;
+  assert(golle_map_find (map, &v, sizeof (v), NULL) == GOLLE_ENOTFOUND);
+  assert(golle_map_erase (map, &v, sizeof (v)) == GOLLE_ENOTFOUND);
+
+  /* Add lots of entries, with small keys and big keys. */
+  unsigned char key[BIG_KEY];
+  for (int i = 0; i < ITEMS; i++) {
+    size_t size = i % 3 ? sizeof (i) : BIG_KEY;
+    make_key (key, i, size);
+    v = -i;
+    assert(golle_map_insert (map, key, size, &v) == GOLLE_OK);
+    assert(golle_map_insert (map, key, size, &v) == GOLLE_EEXISTS);
+  }
+  assert(golle_map_size(map) == ITEMS);
+
+  /* Find each one. */
+  for (int i = 0; i < ITEMS; i++) {
+    size_t size = i % 3 ? sizeof (i) : BIG_KEY;
+    make_key (key, i, size);
+    assert(golle_map_find (map, key, size, (void**)&found) == GOLLE_OK);
+    assert(*found == -i);
+    /* The same bytes at another size are another key. */
+    assert(golle_map_find (map, key, size - 1, NULL) == GOLLE_ENOTFOUND);
+  }
+
+  /* Erase every odd entry. */
+  for (int i = 1; i < ITEMS; i += 2) {
+    size_t size = i % 3 ? sizeof (i) : BIG_KEY;
+    make_key (key, i, size);
+    assert(golle_map_erase (map, key, size) == GOLLE_OK);
+    assert(golle_map_erase (map, key, size) == GOLLE_ENOTFOUND);
+  }
+  assert(golle_map_size(map) == ITEMS / 2);
+
+  /* The rest are still there, and the iterator sees each once. */
+  static unsigned char seen[ITEMS];
+  golle_map_iterator_t it;
+  const golle_bin_t *k;
+  assert(golle_map_iterator (map, &it) == GOLLE_OK);
+  while (golle_map_iterator_next (&it, &k, (void**)&found) == GOLLE_OK) {
+    int i;
+    memcpy (&i, k->bin, sizeof (i));
+    assert(i >= 0 && i < ITEMS && i % 2 == 0);
+    assert(*found == -i);
+    assert(!seen[i]);
+    seen[i] = 1;
+  }
+  for (int i = 0; i < ITEMS; i += 2) {
+    assert(seen[i]);
+  }
+  assert(golle_map_iterator_next (&it, &k, NULL) == GOLLE_END);
+  assert(golle_map_iterator_reset (&it) == GOLLE_OK);
+  assert(golle_map_iterator_next (&it, &k, NULL) == GOLLE_OK);
+
+  /* Clearing empties it. */
+  assert(golle_map_clear (map) == GOLLE_OK);
+  assert(golle_map_size(map) == 0);
+  assert(golle_map_iterator (map, &it) == GOLLE_OK);
+  assert(golle_map_iterator_next (&it, &k, NULL) == GOLLE_END);
+  golle_map_delete (map);
+
+  /* A map with no values is a set. Numbers can be keys. */
+  error = golle_map_new (&map, 0);
+  assert(error == GOLLE_OK);
+  assert(golle_map_reserve (map, ITEMS) == GOLLE_OK);
+  golle_num_t n = golle_num_new ();
+  assert(n);
+  assert(golle_num_rand_bits (n, 2048) == GOLLE_OK);
+  assert(golle_map_insert_num (map, n, NULL) == GOLLE_OK);
+  assert(golle_map_insert_num (map, n, NULL) == GOLLE_EEXISTS);
+  assert(golle_map_find_num (map, n, NULL) == GOLLE_OK);
+  golle_num_t m = golle_num_new_int (12345);
+  assert(m);
+  assert(golle_map_find_num (map, m, NULL) == GOLLE_ENOTFOUND);
+  assert(golle_map_erase_num (map, n) == GOLLE_OK);
+  assert(golle_map_erase_num (map, n) == GOLLE_ENOTFOUND);
+  assert(golle_map_size (map) == 0);
+  golle_num_delete (n);
+  golle_num_delete (m);
+  golle_map_delete (map);
+
+  /*************************/
+  /* Testing Failure cases */
+
+  /* NULL to allocator gives error. */
+  assert (golle_map_new (NULL, 1) == GOLLE_ERROR);
+
+  /* Querying the size of NULL gives 0 */
+  assert (golle_map_size(NULL) == 0);
+
+  /* NULL map or key gives error */
+  assert (golle_map_insert(NULL, key, 1, NULL) == GOLLE_ERROR);
+  assert (golle_map_find(NULL, key, 1, NULL) == GOLLE_ERROR);
+  assert (golle_map_erase(NULL, key, 1) == GOLLE_ERROR);
+  assert (golle_map_reserve(NULL, 1) == GOLLE_ERROR);
+  assert (golle_map_clear(NULL) == GOLLE_ERROR);
+  assert (golle_map_insert_num(NULL, NULL, NULL) == GOLLE_ERROR);
+  assert (golle_map_find_num(NULL, NULL, NULL) == GOLLE_ERROR);
+  assert (golle_map_erase_num(NULL, NULL) == GOLLE_ERROR);
+
+  /* NULL iterators give error */
+  assert (golle_map_iterator(NULL, &it) == GOLLE_ERROR);
+  assert (golle_map_iterator_next(NULL, &k, NULL) == GOLLE_ERROR);
+  assert (golle_map_iterator_next(&it, NULL, NULL) == GOLLE_ERROR);
+  assert (golle_map_iterator_reset(NULL) == GOLLE_ERROR);
+
+  /* Deleting NULL doesn't segfault */
+  golle_map_delete(NULL);
+  /* Maps draw their hash seeds. */
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/merkle.h>
+#include <golle/random.h>
+#include <assert.h>
+#include <string.h>
+
+enum {
+  MAX_SECRETS = 13,
+  SECRET_SIZE = 40
+};
+
+/* Commit to `count` secrets and open each of them. */
+static void test_tree (golle_bin_t **secrets, size_t count) {
+  golle_merkle_t *tree;
+  golle_merkle_proof_t proof;
+  const golle_bin_t *randoms[MAX_SECRETS];
+
+  assert (golle_merkle_new (&tree, (const golle_bin_t *const *)secrets,
+			    count) == GOLLE_OK);
+  assert (golle_merkle_count (tree) == count);
+  const golle_bin_t *root = golle_merkle_root (tree);
+  assert (root && root->size == 64);
+
+  for (size_t i = 0; i < count; i++) {
+    assert (golle_merkle_open (tree, i, &proof) == GOLLE_OK);
+    assert (proof.index == i && proof.count == count);
+    assert (proof.secret.size == secrets[i]->size);
+    assert (memcmp (proof.secret.bin, secrets[i]->bin,
+		    proof.secret.size) == 0);
+    /* The path is logarithmic. */
+    assert (proof.path.size <= 4 * 64);
+    assert (golle_merkle_verify (root, &proof) == GOLLE_COMMIT_PASSED);
+
+    /* Claiming another position fails, or is malformed. */
+    if (count > 1) {
+      proof.index = (i + 1) % count;
+      assert (golle_merkle_verify (root, &proof) != GOLLE_COMMIT_PASSED);
+      proof.index = i;
+    }
+
+    /* So does changing the secret. */
+    ((unsigned char *)proof.secret.bin)[0] ^= 1;
+    assert (golle_merkle_verify (root, &proof) == GOLLE_COMMIT_FAILED);
+    ((unsigned char *)proof.secret.bin)[0] ^= 1;
+
+    /* Or a sibling. */
+    if (proof.path.size) {
+      ((unsigned char *)proof.path.bin)[proof.path.size - 1] ^= 1;
+      assert (golle_merkle_verify (root, &proof) == GOLLE_COMMIT_FAILED);
+    }
+    golle_merkle_proof_clear (&proof);
+
+    randoms[i] = golle_merkle_random (tree, i);
+    assert (randoms[i]);
+  }
+  assert (golle_merkle_open (tree, count, &proof) == GOLLE_EOUTOFRANGE);
+  assert (golle_merkle_random (tree, count) == NULL);
+
+  /* Open them all at once. */
+  assert (golle_merkle_verify_all (root, (const golle_bin_t *const *)secrets,
+				   randoms, count) == GOLLE_COMMIT_PASSED);
+  if (count > 1) {
+    /* Not in another order, or with fewer secrets. */
+    golle_bin_t *t = secrets[0];
+    secrets[0] = secrets[1];
+    secrets[1] = t;
+    assert (golle_merkle_verify_all (root,
+				     (const golle_bin_t *const *)secrets,
+				     randoms, count) == GOLLE_COMMIT_FAILED);
+    secrets[1] = secrets[0];
+    secrets[0] = t;
+    assert (golle_merkle_verify_all (root,
+				     (const golle_bin_t *const *)secrets,
+				     randoms, count - 1) == GOLLE_COMMIT_FAILED);
+  }
+  golle_merkle_delete (tree);
+}
+
+/* Moving the last byte of the random value to the front of the secret
+ * leaves the bytes hashed for the leaf the same. The opening must still
+ * fail. */
+static void test_shifted_random (void) {
+  golle_bin_t *secrets[2];
+  golle_merkle_t *tree;
+  golle_merkle_proof_t proof;
+  for (size_t i = 0; i < 2; i++) {
+    assert (secrets[i] = golle_bin_new (4));
+    assert (golle_random_generate (secrets[i]) == GOLLE_OK);
+  }
+  assert (golle_merkle_new (&tree, (const golle_bin_t *const *)secrets,
+			    2) == GOLLE_OK);
+  const golle_bin_t *root = golle_merkle_root (tree);
+  assert (golle_merkle_open (tree, 0, &proof) == GOLLE_OK);
+
+  /* Move the last byte of the random value to the front of the
+   * secret. */
+  golle_merkle_proof_t forged = {
+    .index = proof.index, .count = proof.count
+  };
+  assert (golle_bin_init (&forged.random,
+			  proof.random.size - 1) == GOLLE_OK);
+  assert (golle_bin_init (&forged.secret,
+			  proof.secret.size + 1) == GOLLE_OK);
+  assert (golle_bin_init (&forged.path, proof.path.size) == GOLLE_OK);
+  assert (golle_bin_copy_into (&forged.path, &proof.path) == GOLLE_OK);
+  unsigned char *r = proof.random.bin, *t = forged.secret.bin;
+  memcpy (forged.random.bin, r, forged.random.size);
+  t[0] = r[forged.random.size];
+  memcpy (t + 1, proof.secret.bin, proof.secret.size);
+  assert (golle_merkle_verify (root, &forged) == GOLLE_COMMIT_FAILED);
+
+  const golle_bin_t *all_secrets[2] = { &forged.secret, secrets[1] };
+  const golle_bin_t *randoms[2] = {
+    &forged.random, golle_merkle_random (tree, 1)
+  };
+  assert (golle_merkle_verify_all (root, all_secrets, randoms,
+				   2) == GOLLE_COMMIT_FAILED);
+
+  golle_merkle_proof_clear (&forged);
+  golle_merkle_proof_clear (&proof);
+  golle_merkle_delete (tree);
+  golle_bin_delete (secrets[0]);
+  golle_bin_delete (secrets[1]);
+}
+
+int main (void) {
+  golle_bin_t *secrets[MAX_SECRETS];
+  golle_merkle_t *tree;
+  golle_merkle_proof_t proof = { 0 };
+
+  for (size_t i = 0; i < MAX_SECRETS; i++) {
+    secrets[i] = golle_bin_new (SECRET_SIZE);
+    assert (secrets[i]);
+    assert (golle_random_generate (secrets[i]) == GOLLE_OK);
+  }
+
+  /* Trees of every shape up to a few levels. */
+  for (size_t count = 1; count <= MAX_SECRETS; count++) {
+    test_tree (secrets, count);
+  }
+  test_shifted_random ();
+
+  /* Errors */
+  assert (golle_merkle_new (&tree, (const golle_bin_t *const *)secrets,
+			    0) == GOLLE_ERROR);
+  assert (golle_merkle_new (NULL, (const golle_bin_t *const *)secrets,
+			    1) == GOLLE_ERROR);
+  assert (golle_merkle_new (&tree, NULL, 1) == GOLLE_ERROR);
+  assert (golle_merkle_root (NULL) == NULL);
+  assert (golle_merkle_count (NULL) == 0);
+  assert (golle_merkle_verify (NULL, &proof) == GOLLE_ERROR);
+  assert (golle_merkle_verify (secrets[0], &proof) == GOLLE_ERROR);
+  golle_merkle_delete (NULL);
+  golle_merkle_proof_clear (NULL);
+
+  for (size_t i = 0; i < MAX_SECRETS; i++) {
+    golle_bin_delete (secrets[i]);
+  }
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/netsim.h>
+#include <golle/loopback.h>
+#include <golle/random.h>
+#include <assert.h>
+#include <limits.h>
+
+enum {
+  NUM_BITS = 128,
+  NUM_PEERS = 3,
+  NUM_ITEMS = 8,
+  SENDS = 100
+};
+
+#define LATENCY 0.01
+#define JITTER 0.005
+#define BANDWIDTH 1000.0
+
+int main (void) {
+  golle_link_t link;
+  golle_netsim_t model = { 0 };
+  double at, last;
+
+  /* Latency only. */
+  model.latency = LATENCY;
+  assert (golle_link_init (&link, &model, 0) == GOLLE_OK);
+  assert (golle_link_send (&link, 1.0, 1000) == 1.0 + LATENCY);
+
+  /* Messages queue behind each other on a slow link. */
+  model.bandwidth = BANDWIDTH;
+  assert (golle_link_init (&link, &model, 0) == GOLLE_OK);
+  assert (golle_link_send (&link, 0, 1000) == 1.0 + LATENCY);
+  assert (golle_link_send (&link, 0, 500) == 1.5 + LATENCY);
+  /* But not once the link is idle again. */
+  assert (golle_link_send (&link, 10.0, 1000) == 11.0 + LATENCY);
+
+  /* Jitter stays in range and doesn't reorder. */
+  model.bandwidth = 0;
+  model.jitter = JITTER;
+  model.seed = 42;
+  assert (golle_link_init (&link, &model, 1) == GOLLE_OK);
+  last = 0;
+  for (int i = 0; i < SENDS; i++) {
+    at = golle_link_send (&link, i * 0.001, 10);
+    assert (at >= i * 0.001 + LATENCY);
+    assert (at < i * 0.001 + LATENCY + JITTER);
+    assert (at >= last);
+    last = at;
+  }
+
+  /* The same seed gives the same delays. */
+  golle_link_t other;
+  assert (golle_link_init (&link, &model, 1) == GOLLE_OK);
+  assert (golle_link_init (&other, &model, 1) == GOLLE_OK);
+  assert (golle_link_send (&link, 0, 10) == golle_link_send (&other, 0, 10));
+
+  /* Waiting */
+  at = golle_netsim_now () + LATENCY;
+  golle_netsim_wait (at);
+  assert (golle_netsim_now () >= at);
+
+  /* Errors */
+  assert (golle_link_init (NULL, &model, 0) == GOLLE_ERROR);
+  assert (golle_link_init (&link, NULL, 0) == GOLLE_ERROR);
+  model.latency = -1;
+  assert (golle_link_init (&link, &model, 0) == GOLLE_ERROR);
+
+  /* A draw takes at least three round trips over the simulated links. */
+  golle_key_t key = { 0 };
+  golle_loopback_t *table;
+  size_t selection;
+  assert (golle_key_gen_public (&key, NUM_BITS, INT_MAX) == GOLLE_OK);
+  assert (golle_loopback_new (&table, &key, NUM_PEERS, NUM_ITEMS) == GOLLE_OK);
+  model.latency = LATENCY;
+  model.jitter = 0;
+  assert (golle_loopback_set_netsim (table, &model) == GOLLE_OK);
+  double start = golle_netsim_now ();
+  golle_error err = golle_loopback_draw (table, GOLLE_FACE_UP, &selection);
+  assert (err == GOLLE_OK || err == GOLLE_ECOLLISION);
+  assert (golle_netsim_now () - start >= 3 * LATENCY);
+  assert (selection < NUM_ITEMS);
+
+  /* And can be turned off again. */
+  assert (golle_loopback_set_netsim (table, NULL) == GOLLE_OK);
+  err = golle_loopback_draw (table, 0, &selection);
+  assert (err == GOLLE_OK || err == GOLLE_ECOLLISION);
+  assert (golle_loopback_set_netsim (NULL, &model) == GOLLE_ERROR);
+
+  golle_loopback_delete (table);
+  golle_key_clear (&key);
+  golle_random_clear ();
+  return 0;
+}
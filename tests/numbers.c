@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/numbers.h>
+#include <golle/random.h>
+#include <assert.h>
+#include <string.h>
+#include <openssl/bn.h>
+
+enum {
+  /* A prime, and an odd and an even modulus that aren't. */
+  PRIME = 65521,
+  ODD = 65535,
+  EVEN = 65536,
+  BASE = 3,
+  EXPONENTS = 200,
+  /* A size that spans several words. */
+  BIG_BITS = 3072,
+  /* Random bases and exponents tried for each kernel and size. */
+  KERNEL_TRIES = 4,
+  /* A batch: more than a group of lanes, so some are left over. */
+  BATCH = 11
+};
+
+/* The sizes with kernels, one a little short of its kernel's size, and
+ * one that has no kernel. */
+static const int KERNEL_BITS[] = { 1024, 2048, 3072, 4096, 2000, 960 };
+
+/* Check golle_num_mod_exp against OpenSSL for a random odd modulus of
+ * the given size, using whichever kernel is chosen. */
+static void check_kernel_size (int bits) {
+  BN_CTX *ctx = BN_CTX_new ();
+  golle_num_t m = golle_num_new ();
+  golle_num_t a = golle_num_new ();
+  golle_num_t e = golle_num_new ();
+  golle_num_t out = golle_num_new ();
+  golle_num_t expect = golle_num_new ();
+  assert (ctx && m && a && e && out && expect);
+  assert (BN_rand (m, bits, 0, 1));
+
+  for (int i = 0; i < KERNEL_TRIES; i++) {
+    /* Bases up to 2m, and exponents of any size up to 2m. */
+    assert (BN_rand_range (a, m) && BN_lshift1 (a, a));
+    assert (BN_rand (e, 1 + i * bits / 2, -1, 0));
+    assert (BN_mod_exp (expect, a, e, m, ctx));
+    assert (golle_num_mod_exp (out, a, e, m) == GOLLE_OK);
+    assert (BN_cmp (out, expect) == 0);
+  }
+
+  /* Edges: 0, 1 and m - 1 as bases, 0 and 1 as exponents. */
+  assert (BN_rand (e, bits, -1, 0));
+  BN_zero (a);
+  assert (golle_num_mod_exp (out, a, e, m) == GOLLE_OK);
+  assert (BN_is_zero (out));
+  assert (BN_one (a));
+  assert (golle_num_mod_exp (out, a, e, m) == GOLLE_OK);
+  assert (BN_is_one (out));
+  assert (BN_sub (a, m, a));
+  assert (BN_mod_exp (expect, a, e, m, ctx));
+  assert (golle_num_mod_exp (out, a, e, m) == GOLLE_OK);
+  assert (BN_cmp (out, expect) == 0);
+  BN_zero (e);
+  assert (golle_num_mod_exp (out, a, e, m) == GOLLE_OK);
+  assert (BN_is_one (out));
+  assert (BN_one (e));
+  assert (golle_num_mod_exp (out, a, e, m) == GOLLE_OK);
+  assert (BN_cmp (out, a) == 0);
+
+  /* The output can be the base. */
+  assert (BN_rand (e, bits, -1, 0));
+  assert (BN_mod_exp (expect, a, e, m, ctx));
+  assert (golle_num_mod_exp (a, a, e, m) == GOLLE_OK);
+  assert (BN_cmp (a, expect) == 0);
+
+  golle_num_delete (m);
+  golle_num_delete (a);
+  golle_num_delete (e);
+  golle_num_delete (out);
+  golle_num_delete (expect);
+  BN_CTX_free (ctx);
+}
+
+/* Check golle_num_mod_exp_many against OpenSSL for a random odd
+ * modulus of the given size, with the edges among the random values. */
+static void check_batch_size (int bits) {
+  BN_CTX *ctx = BN_CTX_new ();
+  golle_num_t m = golle_num_new ();
+  golle_num_t a[BATCH], e[BATCH], out[BATCH], expect[BATCH];
+  assert (ctx && m);
+  assert (BN_rand (m, bits, 0, 1));
+  for (int i = 0; i < BATCH; i++) {
+    a[i] = golle_num_new ();
+    e[i] = golle_num_new ();
+    out[i] = golle_num_new ();
+    expect[i] = golle_num_new ();
+    assert (a[i] && e[i] && out[i] && expect[i]);
+    /* Bases up to 2m, and exponents of many lengths. */
+    assert (BN_rand_range (a[i], m) && BN_lshift1 (a[i], a[i]));
+    assert (BN_rand (e[i], 1 + i * bits / BATCH, -1, 0));
+  }
+  BN_zero (a[1]);
+  assert (BN_one (a[2]));
+  assert (BN_sub (a[3], m, a[2]));
+  BN_zero (e[4]);
+  assert (BN_one (e[5]));
+  for (int i = 0; i < BATCH; i++) {
+    assert (BN_mod_exp (expect[i], a[i], e[i], m, ctx));
+  }
+
+  /* A whole batch, a part of a group, and just one. */
+  static const size_t counts[] = { BATCH, 5, 1 };
+  for (size_t c = 0; c < sizeof (counts) / sizeof (*counts); c++) {
+    for (int i = 0; i < BATCH; i++) {
+      BN_zero (out[i]);
+    }
+    assert (golle_num_mod_exp_many (out, a, e, counts[c], m) == GOLLE_OK);
+    for (size_t i = 0; i < counts[c]; i++) {
+      assert (BN_cmp (out[i], expect[i]) == 0);
+    }
+  }
+
+  /* All exponents zero. */
+  golle_num_t zeros[BATCH];
+  for (int i = 0; i < BATCH; i++) {
+    zeros[i] = e[4];
+  }
+  assert (golle_num_mod_exp_many (out, a, zeros, BATCH, m) == GOLLE_OK);
+  for (int i = 0; i < BATCH; i++) {
+    assert (BN_is_one (out[i]));
+  }
+
+  /* A negative exponent goes the way golle_num_mod_exp sends it. */
+  BN_set_negative (e[6], 1);
+  assert (golle_num_mod_exp (expect[6], a[6], e[6], m) == GOLLE_OK);
+  assert (golle_num_mod_exp_many (out, a, e, BATCH, m) == GOLLE_OK);
+  for (int i = 0; i < BATCH; i++) {
+    assert (BN_cmp (out[i], expect[i]) == 0);
+  }
+  BN_set_negative (e[6], 0);
+  assert (BN_mod_exp (expect[6], a[6], e[6], m, ctx));
+
+  /* The outputs can be the bases. */
+  assert (golle_num_mod_exp_many (a, a, e, BATCH, m) == GOLLE_OK);
+  for (int i = 0; i < BATCH; i++) {
+    assert (BN_cmp (a[i], expect[i]) == 0);
+  }
+
+  for (int i = 0; i < BATCH; i++) {
+    golle_num_delete (a[i]);
+    golle_num_delete (e[i]);
+    golle_num_delete (out[i]);
+    golle_num_delete (expect[i]);
+  }
+  golle_num_delete (m);
+  BN_CTX_free (ctx);
+}
+
+/* Every kernel that runs here, at every size. */
+static void check_kernels (void) {
+  static const char *names[] = { "scalar", "ifma", "none", "auto" };
+  for (size_t i = 0; i < sizeof (names) / sizeof (*names); i++) {
+    golle_error err = golle_num_set_kernel (names[i]);
+    if (err == GOLLE_EINVALID) {
+      continue;
+    }
+    assert (err == GOLLE_OK);
+    for (size_t j = 0; j < sizeof (KERNEL_BITS) / sizeof (*KERNEL_BITS); j++) {
+      check_kernel_size (KERNEL_BITS[j]);
+      check_batch_size (KERNEL_BITS[j]);
+    }
+  }
+
+  /* Sizes without a kernel say so. */
+  assert (strcmp (golle_num_kernel (960), "none") == 0);
+  assert (golle_num_kernel (2048));
+  assert (golle_num_set_kernel ("none") == GOLLE_OK);
+  assert (strcmp (golle_num_kernel (2048), "none") == 0);
+  assert (strcmp (golle_num_lane_kernel (2048), "none") == 0);
+  assert (golle_num_set_kernel ("auto") == GOLLE_OK);
+  assert (strcmp (golle_num_lane_kernel (960), "none") == 0);
+  assert (golle_num_set_kernel ("fast") == GOLLE_EINVALID);
+  assert (golle_num_set_kernel (NULL) == GOLLE_ERROR);
+}
+
+/* b^e mod m, the slow way. */
+static size_t slow_mod_exp (size_t b, size_t e, size_t m) {
+  size_t r = 1 % m;
+  b %= m;
+  while (e--) {
+    r = r * b % m;
+  }
+  return r;
+}
+
+/* Check the backend against the slow way for one modulus. */
+static void check_mod_exp (size_t m) {
+  golle_num_t mod = golle_num_new_int (m);
+  golle_num_t base = golle_num_new_int (BASE);
+  golle_num_t out = golle_num_new ();
+  assert (mod && base && out);
+
+  for (size_t e = 0; e < EXPONENTS; e++) {
+    golle_num_t exp = golle_num_new_int (e);
+    assert (exp);
+    assert (golle_num_mod_exp (out, base, exp, mod) == GOLLE_OK);
+    assert (BN_get_word (out) == slow_mod_exp (BASE, e, m));
+    golle_num_delete (exp);
+  }
+
+  /* The output can be the base. */
+  golle_num_t exp = golle_num_new_int (EXPONENTS);
+  assert (exp);
+  assert (golle_num_mod_exp (base, base, exp, mod) == GOLLE_OK);
+  assert (BN_get_word (base) == slow_mod_exp (BASE, EXPONENTS, m));
+
+  golle_num_delete (exp);
+  golle_num_delete (mod);
+  golle_num_delete (base);
+  golle_num_delete (out);
+}
+
+/* Fermat's little theorem on a big prime: a^(p-1) = 1 mod p. */
+static void check_big_mod_exp (void) {
+  golle_num_t p = golle_generate_prime (BIG_BITS / 4, 0, NULL);
+  assert (p);
+  golle_num_t a = golle_num_rand (p);
+  golle_num_t e = golle_num_dup (p);
+  golle_num_t out = golle_num_new ();
+  assert (a && e && out);
+  assert (BN_sub_word (e, 1));
+  if (!BN_is_zero (a)) {
+    assert (golle_num_mod_exp (out, a, e, p) == GOLLE_OK);
+    assert (BN_is_one (out));
+  }
+  golle_num_delete (p);
+  golle_num_delete (a);
+  golle_num_delete (e);
+  golle_num_delete (out);
+}
+
+/* XOR numbers of different sizes. */
+static void check_xor (void) {
+  golle_num_t x1 = golle_num_new ();
+  golle_num_t x2 = golle_num_new ();
+  golle_num_t out = golle_num_new ();
+  assert (x1 && x2 && out);
+  assert (golle_num_rand_bits (x1, BIG_BITS) == GOLLE_OK);
+  assert (golle_num_rand_bits (x2, BIG_BITS / 3) == GOLLE_OK);
+
+  /* x ^ y ^ y == x, either way around. */
+  assert (golle_num_xor (out, x1, x2) == GOLLE_OK);
+  assert (golle_num_cmp (out, x1) != 0);
+  assert (golle_num_xor (out, out, x2) == GOLLE_OK);
+  assert (golle_num_cmp (out, x1) == 0);
+  assert (golle_num_xor (out, x2, x1) == GOLLE_OK);
+  assert (golle_num_xor (out, x1, out) == GOLLE_OK);
+  assert (golle_num_cmp (out, x2) == 0);
+
+  /* x ^ x == 0, and 0 ^ 0 == 0. */
+  assert (golle_num_xor (out, x1, x1) == GOLLE_OK);
+  assert (BN_is_zero (out));
+  assert (golle_num_xor (out, out, out) == GOLLE_OK);
+  assert (BN_is_zero (out));
+
+  /* Small values */
+  assert (BN_set_word (x1, 0xF0F0) && BN_set_word (x2, 0xFF));
+  assert (golle_num_xor (out, x1, x2) == GOLLE_OK);
+  assert (BN_get_word (out) == 0xF00F);
+
+  assert (golle_num_xor (NULL, x1, x2) == GOLLE_ERROR);
+  assert (golle_num_xor (out, NULL, x2) == GOLLE_ERROR);
+  assert (golle_num_xor (out, x1, NULL) == GOLLE_ERROR);
+
+  golle_num_delete (x1);
+  golle_num_delete (x2);
+  golle_num_delete (out);
+}
+
+int main (void) {
+  /* There is a backend, and it's one that's known. */
+  const char *backend = golle_num_backend ();
+  assert (backend);
+  assert (strcmp (backend, "openssl") == 0 || strcmp (backend, "gmp") == 0);
+
+  /* Prime, odd and even moduli all give the right answer. */
+  check_mod_exp (PRIME);
+  check_mod_exp (ODD);
+  check_mod_exp (EVEN);
+  check_mod_exp (1);
+  check_big_mod_exp ();
+  check_kernels ();
+
+  check_xor ();
+
+  /* Failure cases */
+  golle_num_t n = golle_num_new_int (1);
+  assert (n);
+  assert (golle_num_mod_exp (NULL, n, n, n) == GOLLE_ERROR);
+  assert (golle_num_mod_exp (n, n, n, NULL) == GOLLE_ERROR);
+  golle_num_t ns[] = { n, NULL };
+  assert (golle_num_mod_exp_many (ns, ns, ns, 1, NULL) == GOLLE_ERROR);
+  assert (golle_num_mod_exp_many (ns, ns, ns + 1, 1, n) == GOLLE_ERROR);
+  assert (golle_num_mod_exp_many (NULL, ns, ns, 1, n) == GOLLE_ERROR);
+  golle_num_delete (n);
+
+  golle_random_clear ();
+  return 0;
+}
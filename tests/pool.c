@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/pool.h>
+#include <golle/distribute.h>
+#include <golle/elgamal.h>
+#include <golle/commit.h>
+#include <golle/schnorr.h>
+#include <golle/random.h>
+#include <golle/numbers.h>
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include <openssl/bn.h>
+
+enum {
+  WORKERS = 4,
+  ITEMS = 100000,
+  BATCH = 64,
+  NUM_BITS = 64,
+  SECRET_SIZE = 32
+};
+
+static unsigned char hits[ITEMS];
+
+/* Mark each index as seen. */
+static golle_error mark (void *arg, size_t begin, size_t end) {
+  assert (!arg);
+  assert (begin < end && end <= ITEMS);
+  for (size_t i = begin; i < end; i++) {
+    hits[i]++;
+  }
+  return GOLLE_OK;
+}
+
+/* Fail at one index. */
+static golle_error fail_at (void *arg, size_t begin, size_t end) {
+  size_t bad = *(size_t *)arg;
+  return bad >= begin && bad < end ? GOLLE_EABORT : GOLLE_OK;
+}
+
+/* Mark an index given by the outer loop. */
+static golle_error mark_outer (void *arg, size_t begin, size_t end) {
+  GOLLE_UNUSED (end);
+  hits[*(size_t *)arg + begin]++;
+  return GOLLE_OK;
+}
+
+/* Start a loop from inside a loop, on the same pool. */
+static golle_error nested (void *arg, size_t begin, size_t end) {
+  golle_error err = GOLLE_OK;
+  for (size_t i = begin; i < end && err == GOLLE_OK; i++) {
+    err = golle_pool_parallel_for (arg, 1, 0, &mark_outer, &i);
+  }
+  return err;
+}
+
+/* Every index is visited exactly once. */
+static void check_hits (size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    assert (hits[i] == 1);
+  }
+  memset (hits, 0, sizeof (hits));
+}
+
+static void test_parallel_for (golle_pool_t *pool) {
+  /* Chosen grain, a given grain, and a grain bigger than the loop. */
+  assert (golle_pool_parallel_for (pool, ITEMS, 0, &mark, NULL) == GOLLE_OK);
+  check_hits (ITEMS);
+  assert (golle_pool_parallel_for (pool, ITEMS, 7, &mark, NULL) == GOLLE_OK);
+  check_hits (ITEMS);
+  assert (golle_pool_parallel_for (pool, 3, 100, &mark, NULL) == GOLLE_OK);
+  check_hits (3);
+  assert (golle_pool_parallel_for (pool, 0, 0, &mark, NULL) == GOLLE_OK);
+
+  /* Errors come back. */
+  size_t bad = ITEMS / 3;
+  assert (golle_pool_parallel_for (pool, ITEMS, 10,
+				   &fail_at, &bad) == GOLLE_EABORT);
+
+  /* A nested loop runs on the worker. */
+  assert (golle_pool_parallel_for (pool, WORKERS, 1,
+				   &nested, pool) == GOLLE_OK);
+  check_hits (WORKERS);
+}
+
+/* The 1024-bit prime of RFC 2409's second group. It's safe, and 2
+ * generates the subgroup of order q. */
+static const char MODP_1024[] =
+  "FFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD1"
+  "29024E088A67CC74020BBEA63B139B22514A08798E3404DD"
+  "EF9519B3CD3A431B302B0A6DF25F14374FE1356D6D51C245"
+  "E485B576625E7EC6F44C42E9A637ED6B0BFF5CB6F406B7ED"
+  "EE386BFB5A899FA5AE9F24117C4B1FE649286651ECE65381"
+  "FFFFFFFFFFFFFFFF";
+
+/* Make a key: a small one, or one big enough for the exponent
+ * kernels. */
+static void make_key (golle_key_t *key, int big) {
+  memset (key, 0, sizeof (*key));
+  if (big) {
+    golle_num_t p = NULL, g = golle_num_new_int (2);
+    assert (BN_hex2bn ((BIGNUM **)&p, MODP_1024) && g);
+    assert (golle_key_set_public (key, p, g) == GOLLE_OK);
+    golle_num_delete (p);
+    golle_num_delete (g);
+  }
+  else {
+    assert (golle_key_gen_public (key, NUM_BITS, INT_MAX) == GOLLE_OK);
+  }
+  assert (golle_key_gen_private (key) == GOLLE_OK);
+}
+
+/* Encrypt, re-encrypt and decrypt a batch. */
+static void test_elgamal (int big) {
+  golle_key_t key;
+  make_key (&key, big);
+
+  golle_num_t m[BATCH], p[BATCH];
+  golle_eg_t c1[BATCH], c2[BATCH];
+  memset (c1, 0, sizeof (c1));
+  memset (c2, 0, sizeof (c2));
+  for (size_t i = 0; i < BATCH; i++) {
+    golle_num_t n = golle_num_new_int (i + 1);
+    assert (n);
+    assert (m[i] = golle_num_new ());
+    assert (p[i] = golle_num_new ());
+    assert (golle_num_mod_exp (m[i], key.g, n, key.q) == GOLLE_OK);
+    golle_num_delete (n);
+  }
+
+  assert (golle_eg_encrypt_many (&key, m, c1, BATCH) == GOLLE_OK);
+  assert (golle_eg_reencrypt_many (&key, c1, c2, BATCH) == GOLLE_OK);
+  assert (golle_eg_decrypt_many (&key, &key.x, 1, c2, p, BATCH) == GOLLE_OK);
+  for (size_t i = 0; i < BATCH; i++) {
+    assert (golle_num_cmp (c1[i].a, c2[i].a) != 0);
+    assert (golle_num_cmp (m[i], p[i]) == 0);
+  }
+
+  /* Nothing is kept if one fails. */
+  golle_num_t kept = m[BATCH / 2];
+  m[BATCH / 2] = key.q;
+  for (size_t i = 0; i < BATCH; i++) {
+    golle_eg_clear (c1 + i);
+  }
+  assert (golle_eg_encrypt_many (&key, m, c1, BATCH) == GOLLE_EOUTOFRANGE);
+  for (size_t i = 0; i < BATCH; i++) {
+    assert (!c1[i].a && !c1[i].b);
+  }
+  m[BATCH / 2] = kept;
+  assert (golle_eg_encrypt_many (NULL, m, c1, BATCH) == GOLLE_ERROR);
+
+  for (size_t i = 0; i < BATCH; i++) {
+    golle_eg_clear (c2 + i);
+    golle_num_delete (m[i]);
+    golle_num_delete (p[i]);
+  }
+  golle_key_cleanup (&key);
+}
+
+/* The first failing commitment is found. */
+static void test_commit (void) {
+  golle_bin_t *secrets[BATCH];
+  golle_commit_t *commits[BATCH];
+  size_t failed = BATCH;
+  for (size_t i = 0; i < BATCH; i++) {
+    assert (secrets[i] = golle_bin_new (SECRET_SIZE));
+    assert (golle_random_generate (secrets[i]) == GOLLE_OK);
+  }
+  assert (golle_commit_new_many (commits,
+				 (const golle_bin_t *const *)secrets,
+				 BATCH) == GOLLE_OK);
+  assert (golle_commit_verify_many ((const golle_commit_t *const *)commits,
+				    BATCH, &failed) == GOLLE_COMMIT_PASSED);
+  assert (failed == BATCH);
+
+  assert (golle_random_generate (commits[BATCH - 1]->secret) == GOLLE_OK);
+  assert (golle_random_generate (commits[BATCH / 4]->secret) == GOLLE_OK);
+  assert (golle_commit_verify_many ((const golle_commit_t *const *)commits,
+				    BATCH, &failed) == GOLLE_COMMIT_FAILED);
+  assert (failed == BATCH / 4);
+
+  for (size_t i = 0; i < BATCH; i++) {
+    golle_commit_delete (commits[i]);
+    golle_bin_delete (secrets[i]);
+  }
+}
+
+/* Check a batch of Schnorr proofs. */
+static void test_schnorr (int big) {
+  golle_key_t key;
+  make_key (&key, big);
+  golle_schnorr_t sk = { 0 };
+  assert (sk.Y = BN_dup (key.h_product));
+  assert (sk.G = BN_dup (key.g));
+  assert (sk.x = BN_dup (key.x));
+  assert (sk.q = BN_dup (key.q));
+  assert (sk.p = BN_dup (key.p));
+
+  golle_num_t r[BATCH], t[BATCH], c[BATCH], s[BATCH];
+  for (size_t i = 0; i < BATCH; i++) {
+    assert (r[i] = golle_num_new ());
+    assert (t[i] = golle_num_new ());
+    assert (s[i] = golle_num_new ());
+    assert (golle_schnorr_commit (&sk, r[i], t[i]) == GOLLE_OK);
+    assert (c[i] = golle_num_rand (sk.q));
+    assert (golle_schnorr_prove (&sk, s[i], r[i], c[i]) == GOLLE_OK);
+  }
+
+  size_t failed = BATCH;
+  assert (golle_schnorr_verify_many (&sk, s, t, c, BATCH,
+				     &failed) == GOLLE_OK);
+  assert (failed == BATCH);
+
+  /* Swap two challenges, and the first is caught. */
+  golle_num_t x = c[5];
+  c[5] = c[40];
+  c[40] = x;
+  assert (golle_schnorr_verify_many (&sk, s, t, c, BATCH,
+				     &failed) == GOLLE_ECRYPTO);
+  assert (failed == 5);
+
+  /* A missing value fails its proof, after the ones before it. */
+  c[40] = c[5];
+  c[5] = x;
+  x = t[10];
+  t[10] = NULL;
+  assert (golle_schnorr_verify_many (&sk, s, t, c, BATCH,
+				     &failed) == GOLLE_ERROR);
+  assert (failed == 10);
+  t[10] = x;
+
+  for (size_t i = 0; i < BATCH; i++) {
+    golle_num_delete (r[i]);
+    golle_num_delete (t[i]);
+    golle_num_delete (c[i]);
+    golle_num_delete (s[i]);
+  }
+  golle_schnorr_clear (&sk);
+  golle_key_cleanup (&key);
+}
+
+/* Single operations give the same results when split. */
+static void test_split (int big) {
+  golle_key_t key;
+  make_key (&key, big);
+  golle_num_t m = golle_num_new (), five = golle_num_new_int (5);
+  golle_num_t r = golle_num_rand (key.q), p = golle_num_new ();
+  golle_num_t longer = golle_num_new ();
+  assert (m && five && r && p && longer);
+  assert (golle_num_mod_exp (m, key.g, five, key.q) == GOLLE_OK);
+  /* r + q 2^k has the same powers, but more bits than p. */
+  assert (BN_lshift (longer, key.q, BN_num_bits (key.p)));
+  assert (BN_add (longer, longer, r));
+
+  golle_eg_t c1 = { 0 }, c2 = { 0 }, c3 = { 0 }, c4 = { 0 };
+  assert (golle_num_split () == 1);
+  assert (golle_eg_encrypt (&key, m, &c1, &r) == GOLLE_OK);
+  assert (golle_eg_reencrypt (&key, &c1, &c2, &r) == GOLLE_OK);
+
+  golle_num_set_split (WORKERS);
+  assert (golle_num_split () == WORKERS);
+  /* The second time, the powers are kept from the first. */
+  for (int i = 0; i < 2; i++) {
+    assert (golle_eg_encrypt (&key, m, &c3, &r) == GOLLE_OK);
+    assert (golle_num_cmp (c1.a, c3.a) == 0);
+    assert (golle_num_cmp (c1.b, c3.b) == 0);
+    assert (golle_eg_reencrypt (&key, &c3, &c4, &r) == GOLLE_OK);
+    assert (golle_num_cmp (c2.a, c4.a) == 0);
+    assert (golle_num_cmp (c2.b, c4.b) == 0);
+  }
+  assert (golle_eg_encrypt (&key, m, &c3, &longer) == GOLLE_OK);
+  assert (golle_num_cmp (c1.a, c3.a) == 0);
+  assert (golle_num_cmp (c1.b, c3.b) == 0);
+  assert (golle_eg_decrypt (&key, &key.x, 1, &c4, p) == GOLLE_OK);
+  assert (golle_num_cmp (m, p) == 0);
+
+  /* A proof still checks out, and a bad one doesn't. */
+  golle_schnorr_t sk = { 0 };
+  assert (sk.Y = BN_dup (key.h_product));
+  assert (sk.G = BN_dup (key.g));
+  assert (sk.x = BN_dup (key.x));
+  assert (sk.q = BN_dup (key.q));
+  assert (sk.p = BN_dup (key.p));
+  golle_num_t t = golle_num_new (), s = golle_num_new ();
+  assert (t && s);
+  assert (golle_schnorr_commit (&sk, r, t) == GOLLE_OK);
+  assert (golle_schnorr_prove (&sk, s, r, five) == GOLLE_OK);
+  assert (golle_schnorr_verify (&sk, s, t, five) == GOLLE_OK);
+  assert (golle_schnorr_verify (&sk, t, s, five) == GOLLE_ECRYPTO);
+
+  golle_num_set_split (0);
+  assert (golle_num_split () == 1);
+  golle_num_delete (t);
+  golle_num_delete (s);
+  golle_schnorr_clear (&sk);
+  golle_eg_clear (&c1);
+  golle_eg_clear (&c2);
+  golle_eg_clear (&c3);
+  golle_eg_clear (&c4);
+  golle_num_delete (m);
+  golle_num_delete (five);
+  golle_num_delete (r);
+  golle_num_delete (p);
+  golle_num_delete (longer);
+  golle_key_cleanup (&key);
+}
+
+int main (void) {
+  golle_pool_t *pool;
+
+  /* Without a pool, loops run on this thread. */
+  assert (golle_pool_get_default () == NULL);
+  assert (golle_pool_workers (NULL) == 1);
+  test_parallel_for (NULL);
+
+  assert (golle_pool_new (&pool, WORKERS) == GOLLE_OK);
+  assert (golle_pool_workers (pool) == WORKERS);
+  test_parallel_for (pool);
+
+  /* The batch functions use the default pool. */
+  golle_pool_set_default (pool);
+  assert (golle_pool_get_default () == pool);
+  test_elgamal (0);
+  test_elgamal (1);
+  test_commit ();
+  test_schnorr (0);
+  test_schnorr (1);
+  test_split (0);
+  test_split (1);
+
+  /* Deleting the default pool unsets it. */
+  golle_pool_delete (pool);
+  assert (golle_pool_get_default () == NULL);
+
+  /* Without a pool, splitting does nothing. */
+  test_split (1);
+
+  /* One worker per processor. */
+  assert (golle_pool_new (&pool, 0) == GOLLE_OK);
+  assert (golle_pool_workers (pool) >= 1);
+  test_parallel_for (pool);
+  golle_pool_delete (pool);
+
+  /* Failure cases */
+  assert (golle_pool_new (NULL, 1) == GOLLE_ERROR);
+  assert (golle_pool_parallel_for (NULL, 1, 0, NULL, NULL) == GOLLE_ERROR);
+  golle_pool_delete (NULL);
+
+  golle_random_clear ();
+  return 0;
+}
@@ -3,6 +3,9 @@
  */
 
 #include <golle/random.h>
+#include <golle/numbers.h>
+#include <openssl/bn.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -13,9 +16,178 @@
 */
 
 enum {
-  DATA_SIZE = 4096
+  DATA_SIZE = 4096,
+  SMALL_SIZE = 37,
+  SMALL_RANGE = 3,
+  DRAWS = 300,
+  RAND_BITS = 131,
+  BIG_BITS = 8192,
+  PRIME_BITS = 64
 };
 
+/* A source that counts how many bytes it was asked for. */
+static golle_error counting_source (void *state, void *buffer, size_t size) {
+  *(size_t *)state += size;
+  memset (buffer, 0x5A, size);
+  return GOLLE_OK;
+}
+
+/* Fill a buffer from the current source. */
+static void fill (void *bin, size_t size) {
+  golle_bin_t buff = { size, bin };
+  assert (golle_random_generate (&buff) == GOLLE_OK);
+}
+
+#if GOLLE_TEST_RANDOM
+static const char SEED[] = "libgolle";
+static const char OTHER_SEED[] = "libgollf";
+
+/* The same seed gives the same bytes, whatever the request sizes. */
+static void test_deterministic (void) {
+  unsigned char a[DATA_SIZE], b[DATA_SIZE], c[DATA_SIZE];
+
+  assert (golle_random_seed_deterministic (SEED, sizeof (SEED)) == GOLLE_OK);
+  fill (a, DATA_SIZE);
+
+  assert (golle_random_seed_deterministic (SEED, sizeof (SEED)) == GOLLE_OK);
+  fill (b, SMALL_SIZE);
+  fill (b + SMALL_SIZE, DATA_SIZE - SMALL_SIZE);
+  assert (memcmp (a, b, DATA_SIZE) == 0);
+
+  assert (golle_random_seed_deterministic (OTHER_SEED,
+					   sizeof (OTHER_SEED)) == GOLLE_OK);
+  fill (c, DATA_SIZE);
+  assert (memcmp (a, c, DATA_SIZE) != 0);
+}
+
+/* Random numbers are repeatable too. */
+static void test_deterministic_numbers (void) {
+  golle_num_t n = golle_num_new_int (0);
+  golle_num_t r1, r2;
+  assert (n);
+  assert (golle_num_rand_bits (n, 512) == GOLLE_OK);
+
+  assert (golle_random_seed_deterministic (SEED, sizeof (SEED)) == GOLLE_OK);
+  r1 = golle_num_rand (n);
+  assert (golle_random_seed_deterministic (SEED, sizeof (SEED)) == GOLLE_OK);
+  r2 = golle_num_rand (n);
+  assert (r1 && r2);
+  assert (golle_num_cmp (r1, r2) == 0);
+
+  golle_num_delete (n);
+  golle_num_delete (r1);
+  golle_num_delete (r2);
+}
+
+/* So are primes, which OpenSSL would otherwise draw for itself. */
+static void test_deterministic_primes (void) {
+  golle_num_t p1, p2, p3;
+  assert (golle_random_seed_deterministic (SEED, sizeof (SEED)) == GOLLE_OK);
+  p1 = golle_generate_prime (PRIME_BITS, 1, NULL);
+  assert (golle_random_seed_deterministic (SEED, sizeof (SEED)) == GOLLE_OK);
+  p2 = golle_generate_prime (PRIME_BITS, 1, NULL);
+  p3 = golle_generate_prime (PRIME_BITS, 0, NULL);
+  assert (p1 && p2 && p3);
+  assert (golle_num_cmp (p1, p2) == 0);
+  assert (BN_num_bits (p1) == PRIME_BITS && BN_num_bits (p3) == PRIME_BITS);
+  assert (golle_test_prime (p1) == GOLLE_PROBABLY_PRIME);
+  assert (golle_test_prime (p3) == GOLLE_PROBABLY_PRIME);
+
+  /* p1 is safe. */
+  assert (BN_rshift1 (p3, p1));
+  assert (golle_test_prime (p3) == GOLLE_PROBABLY_PRIME);
+
+  golle_num_delete (p1);
+  golle_num_delete (p2);
+  golle_num_delete (p3);
+  assert (golle_random_set_source (NULL) == GOLLE_OK);
+}
+
+/* A custom source gets every request. */
+static void test_source (void) {
+  size_t count = 0;
+  unsigned char a[SMALL_SIZE];
+  golle_random_source_t src = { counting_source, &count };
+
+  assert (golle_random_set_source (&src) == GOLLE_OK);
+  fill (a, SMALL_SIZE);
+  assert (count == SMALL_SIZE);
+  assert (a[0] == 0x5A && a[SMALL_SIZE - 1] == 0x5A);
+
+  /* Back to the default. */
+  assert (golle_random_set_source (NULL) == GOLLE_OK);
+  fill (a, SMALL_SIZE);
+  assert (count == SMALL_SIZE);
+
+  /* Errors */
+  src.generate = NULL;
+  assert (golle_random_set_source (&src) == GOLLE_ERROR);
+  assert (golle_random_seed_deterministic (NULL, 1) == GOLLE_ERROR);
+  assert (golle_random_generate (NULL) == GOLLE_ERROR);
+}
+#else
+/* Without --enable-test-random the source can't be replaced. */
+static void test_source (void) {
+  static const char seed[] = "libgolle";
+  golle_random_source_t src = { counting_source, NULL };
+  assert (golle_random_set_source (&src) == GOLLE_EINVALID);
+  assert (golle_random_seed_deterministic (seed,
+					   sizeof (seed)) == GOLLE_EINVALID);
+  assert (golle_random_generate (NULL) == GOLLE_ERROR);
+}
+#endif
+
+/* Draws in a range stay in it and reach every value. */
+static void test_range (void) {
+  int seen[SMALL_RANGE] = { 0 };
+  golle_num_t n = golle_num_new_int (SMALL_RANGE);
+  golle_num_t one = golle_num_new_int (1);
+  golle_num_t r = golle_num_new ();
+  assert (n && one && r);
+
+  for (int i = 0; i < DRAWS; i++) {
+    assert (golle_num_generate_rand (r, n) == GOLLE_OK);
+    assert (golle_num_cmp (r, n) < 0);
+    seen[BN_get_word (r)]++;
+  }
+  for (int i = 0; i < SMALL_RANGE; i++) {
+    assert (seen[i] > 0);
+  }
+
+  /* [0, 1) only holds 0, and [0, 0) holds nothing. */
+  assert (golle_num_generate_rand (r, one) == GOLLE_OK);
+  assert (BN_is_zero ((BIGNUM *)r));
+  BN_zero ((BIGNUM *)n);
+  assert (golle_num_generate_rand (r, n) != GOLLE_OK);
+
+  /* Numbers of a given size have exactly that many bits. */
+  for (int i = 0; i < DRAWS; i++) {
+    assert (golle_num_rand_bits (r, RAND_BITS) == GOLLE_OK);
+    assert (BN_num_bits (r) == RAND_BITS);
+  }
+  assert (golle_num_rand_bits (r, BIG_BITS) == GOLLE_OK);
+  assert (BN_num_bits (r) == BIG_BITS);
+
+  golle_num_delete (n);
+  golle_num_delete (one);
+  golle_num_delete (r);
+}
+
+static void *thread_fill (void *arg) {
+  fill (arg, DATA_SIZE);
+  return NULL;
+}
+
+/* Each thread has its own generator, and they don't repeat each other. */
+static void test_threads (void) {
+  unsigned char a[DATA_SIZE], b[DATA_SIZE];
+  pthread_t t;
+  assert (pthread_create (&t, NULL, thread_fill, b) == 0);
+  fill (a, DATA_SIZE);
+  assert (pthread_join (t, NULL) == 0);
+  assert (memcmp (a, b, DATA_SIZE) != 0);
+}
+
 int main (void) {
   golle_bin_t buff;
 
@@ -33,6 +205,18 @@ int main (void) {
   err = memcmp (buff.bin, (char*)buff.bin + DATA_SIZE, DATA_SIZE);
   err = err == 0;
   free (buff.bin);
+  if (err) {
+    goto out;
+  }
+
+  test_range ();
+  test_threads ();
+#if GOLLE_TEST_RANDOM
+  test_deterministic ();
+  test_deterministic_numbers ();
+  test_deterministic_primes ();
+#endif
+  test_source ();
   golle_random_clear ();
  out:
   return err;
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include <golle/numbers.h>
+#include <golle/random.h>
+#include <assert.h>
+
+enum {
+  EXPONENTS = 10,
+  NUM_BITS = 16
+};
+
+int main (void) {
+  golle_num_stats_t stats;
+
+  /* Buckets double from 64 bits. */
+  assert (golle_num_stats_bucket (1) == 0);
+  assert (golle_num_stats_bucket (64) == 0);
+  assert (golle_num_stats_bucket (65) == 1);
+  assert (golle_num_stats_bucket (1024) == 4);
+  assert (golle_num_stats_bucket (2048) == 5);
+  assert (golle_num_stats_bucket (3072) == 6);
+  assert (golle_num_stats_bucket (1 << 20) == GOLLE_NUM_STATS_BUCKETS - 1);
+
+  /* Start from nothing. */
+  golle_num_stats_reset ();
+  assert (golle_num_stats_get (&stats) == GOLLE_OK);
+  for (size_t op = 0; op < GOLLE_NUM_OP_COUNT; op++) {
+    for (size_t b = 0; b < GOLLE_NUM_STATS_BUCKETS; b++) {
+      assert (stats.count[op][b] == 0);
+    }
+  }
+
+  /* Do some exponents and random draws. */
+  golle_num_t mod = golle_num_new_int (65521);
+  golle_num_t base = golle_num_new_int (3);
+  golle_num_t out = golle_num_new ();
+  assert (mod && base && out);
+
+  for (int i = 0; i < EXPONENTS; i++) {
+    golle_num_t e = golle_num_rand (mod);
+    assert (e);
+    assert (golle_num_mod_exp (out, base, e, mod) == GOLLE_OK);
+    golle_num_delete (e);
+  }
+  assert (golle_test_prime (mod) == GOLLE_PROBABLY_PRIME);
+
+  /* Everything landed in the smallest bucket. */
+  size_t b = golle_num_stats_bucket (NUM_BITS);
+  assert (golle_num_stats_get (&stats) == GOLLE_OK);
+  assert (stats.count[GOLLE_NUM_OP_MOD_EXP][b] == EXPONENTS);
+  assert (stats.count[GOLLE_NUM_OP_RAND][b] == EXPONENTS);
+  assert (stats.count[GOLLE_NUM_OP_PRIME][b] == 1);
+  assert (stats.count[GOLLE_NUM_OP_MOD_MUL][b] == 0);
+
+  /* Reset clears everything. */
+  golle_num_stats_reset ();
+  assert (golle_num_stats_get (&stats) == GOLLE_OK);
+  assert (stats.count[GOLLE_NUM_OP_MOD_EXP][b] == 0);
+
+  /* Errors */
+  assert (golle_num_stats_get (NULL) == GOLLE_ERROR);
+
+  golle_num_delete (mod);
+  golle_num_delete (base);
+  golle_num_delete (out);
+  golle_random_clear ();
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) Anthony Arnold 2014
+ */
+
+#include "golle/vector.h"
+#include <assert.h>
+#include <string.h>
+
+#define ONE "1"
+
+enum {
+  STRING_LENGTH = 15,
+  ITEMS = 10000
+};
+
+typedef struct entry {
+  int id;
+  char str[STRING_LENGTH + 1];
+} entry;
+
+int main (void) {
+  /* Make a vector */
+  golle_vector_t *vector;
+
+  golle_error error = golle_vector_new (&vector, sizeof (entry));
+
+  assert(error == GOLLE_OK);
+  assert(vector);
+  assert(golle_vector_size(vector) == 0);
+
+  /* Add an item. */
+  entry e;
+  memset(&e, 0, sizeof(e));
+  e.id = 1;
+  strcpy(e.str, ONE);
+
+  error = golle_vector_push(vector, &e);
+  assert(error == GOLLE_OK);
+  assert(golle_vector_size(vector) == 1);
+
+  /* Check its value, with an iterator on the stack. */
+  golle_vector_iterator_t it;
+  error = golle_vector_iterator (vector, &it);
+  assert(error == GOLLE_OK);
+
+  entry *e2;
+  error = golle_vector_iterator_next (&it, (void**)&e2);
+  assert(error == GOLLE_OK);
+  assert(e2->id == 1);
+  assert(strcmp(e2->str, ONE) == 0);
+  assert(e2 == golle_vector_at (vector, 0));
+
+  error = golle_vector_iterator_next (&it, (void**)&e2);
+  assert(error == GOLLE_END);
+
+  /* Reset the iterator. */
+  error = golle_vector_iterator_reset (&it);
+  assert(error == GOLLE_OK);
+  error = golle_vector_iterator_next (&it, (void**)&e2);
+  assert(error == GOLLE_OK);
+  assert(e2->id == 1);
+
+  /* Remove using the iterator. */
+  error = golle_vector_erase_at (&it);
+  assert(error == GOLLE_OK);
+  assert(golle_vector_size(vector) == 0);
+  assert(golle_vector_iterator_next (&it, (void**)&e2) == GOLLE_END);
+  assert(golle_vector_erase_at (&it) == GOLLE_ENOTFOUND);
+
+  /* Add a NULL item, which is zeroed. */
+  error = golle_vector_push(vector, NULL);
+  assert(error == GOLLE_OK);
+  e2 = golle_vector_at (vector, 0);
+  assert(e2 && e2->id == 0 && e2->str[0] == 0);
+  assert(golle_vector_pop_all (vector) == GOLLE_OK);
+
+  /* Add 0 items. */
+  error = golle_vector_push_many (vector, &e, 0);
+  assert(error == GOLLE_OK);
+  assert(golle_vector_size(vector) == 0);
+
+  /* Add lots of items, one at a time, numbered. */
+  for (int i = 0; i < ITEMS; i++) {
+    e.id = i;
+    assert(golle_vector_push (vector, &e) == GOLLE_OK);
+  }
+  assert(golle_vector_size(vector) == ITEMS);
+  assert(((entry *)golle_vector_at (vector, ITEMS - 1))->id == ITEMS - 1);
+  assert(!golle_vector_at (vector, ITEMS));
+
+  /* Erase every odd item while iterating. Each item is seen once. */
+  static unsigned char seen[ITEMS];
+  golle_vector_iterator (vector, &it);
+  while (golle_vector_iterator_next (&it, (void**)&e2) == GOLLE_OK) {
+    assert(!seen[e2->id]);
+    seen[e2->id] = 1;
+    if (e2->id % 2) {
+      assert(golle_vector_erase_at (&it) == GOLLE_OK);
+    }
+  }
+  for (int i = 0; i < ITEMS; i++) {
+    assert(seen[i]);
+  }
+  assert(golle_vector_size(vector) == ITEMS / 2);
+  for (size_t i = 0; i < ITEMS / 2; i++) {
+    assert(((entry *)golle_vector_at (vector, i))->id % 2 == 0);
+  }
+
+  /* Swap erase moves the last item. */
+  int last = ((entry *)golle_vector_at (vector, ITEMS / 2 - 1))->id;
+  assert(golle_vector_swap_erase (vector, 0) == GOLLE_OK);
+  assert(((entry *)golle_vector_at (vector, 0))->id == last);
+  assert(golle_vector_swap_erase (vector, ITEMS) == GOLLE_ENOTFOUND);
+
+  /* Clearing keeps the memory. */
+  e2 = golle_vector_at (vector, 0);
+  assert(golle_vector_pop_all(vector) == GOLLE_OK);
+  assert(golle_vector_size(vector) == 0);
+  assert(golle_vector_reserve (vector, ITEMS) == GOLLE_OK);
+  assert(golle_vector_push_many (vector, &e, ITEMS) == GOLLE_OK);
+  assert(golle_vector_at (vector, 0) == e2);
+
+  /* Delete a full vector */
+  golle_vector_delete(vector);
+
+  /*************************/
+  /* Testing Failure cases */
+
+  /* NULL to allocator gives error. */
+  assert (golle_vector_new (NULL, sizeof (e)) == GOLLE_ERROR);
+  assert (golle_vector_new (&vector, 0) == GOLLE_ERROR);
+
+  /* Querying the size of NULL gives 0 */
+  assert (golle_vector_size(NULL) == 0);
+
+  /* Pushing to NULL gives error */
+  assert (golle_vector_push(NULL, NULL) == GOLLE_ERROR);
+  assert (golle_vector_reserve(NULL, 1) == GOLLE_ERROR);
+  assert (golle_vector_swap_erase(NULL, 0) == GOLLE_ERROR);
+  assert (golle_vector_pop_all(NULL) == GOLLE_ERROR);
+  assert (!golle_vector_at(NULL, 0));
+
+  /* NULL vector or iterator gives error */
+  assert (golle_vector_iterator(NULL, &it) == GOLLE_ERROR);
+  assert (golle_vector_iterator(vector, NULL) == GOLLE_ERROR);
+  assert (golle_vector_iterator_next(NULL, (void**)&e2) == GOLLE_ERROR);
+  assert (golle_vector_iterator_next(&it, NULL) == GOLLE_ERROR);
+  assert (golle_vector_iterator_reset(NULL) == GOLLE_ERROR);
+  assert (golle_vector_erase_at(NULL) == GOLLE_ERROR);
+
+  /* Deleting NULL doesn't segfault */
+  golle_vector_delete(NULL);
+  return 0;
+}